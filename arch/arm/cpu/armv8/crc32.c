@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * CRC32 using the ARMv8 CRC32 instructions
+ */
+
+#include <common.h>
+#include <u-boot/crc.h>
+
+/* CRC32 field of ID_AA64ISAR0_EL1, non-zero if the instructions exist */
+#define ID_AA64ISAR0_CRC32_SHIFT	16
+#define ID_AA64ISAR0_CRC32_MASK		0xf
+
+#define CRC32B(crc, val) \
+	asm("crc32b %w0, %w0, %w1" : "+r" (crc) : "r" (val))
+#define CRC32X(crc, val) \
+	asm("crc32x %w0, %w0, %x1" : "+r" (crc) : "r" (le64_to_cpu(val)))
+
+/* Reading the ID register is cheap, so nothing needs to be remembered */
+int crc32_armv8_available(void)
+{
+	u64 isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> ID_AA64ISAR0_CRC32_SHIFT) & ID_AA64ISAR0_CRC32_MASK ?
+		1 : 0;
+}
+
+uint32_t crc32_armv8_no_comp(uint32_t crc, const unsigned char *buf,
+			     uint len)
+{
+	const u64 *p;
+
+	/* Align to 8 bytes */
+	for (; len && ((ulong)buf & 7); len--)
+		CRC32B(crc, *buf++);
+
+	for (p = (const u64 *)buf; len >= 32; len -= 32, p += 4) {
+		CRC32X(crc, p[0]);
+		CRC32X(crc, p[1]);
+		CRC32X(crc, p[2]);
+		CRC32X(crc, p[3]);
+	}
+	for (; len >= 8; len -= 8)
+		CRC32X(crc, *p++);
+
+	for (buf = (const unsigned char *)p; len; len--)
+		CRC32B(crc, *buf++);
+
+	return crc;
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 and SHA-256 using the ARMv8 Crypto Extensions
+ */
+
+#include <common.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* SHA1 and SHA2 fields of ID_AA64ISAR0_EL1, non-zero if implemented */
+#define ID_AA64ISAR0_SHA1_SHIFT		8
+#define ID_AA64ISAR0_SHA2_SHIFT		12
+#define ID_AA64ISAR0_SHA_MASK		0xf
+
+/* sha1_ce_core.S and sha256_ce_core.S */
+void sha1_ce_transform(u32 state[5], const unsigned char *data,
+		       unsigned int blocks);
+void sha256_ce_transform(u32 state[8], const uint8_t *data,
+			 unsigned int blocks);
+
+static int sha_ce_has(int shift)
+{
+	u64 isar0;
+
+	/* This is cheap, so there is no need to remember the result */
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> shift) & ID_AA64ISAR0_SHA_MASK ? 1 : 0;
+}
+
+int sha1_armv8_ce_available(void)
+{
+	return sha_ce_has(ID_AA64ISAR0_SHA1_SHIFT);
+}
+
+void sha1_armv8_ce_process(sha1_context *ctx, const unsigned char *data,
+			   unsigned int blocks)
+{
+	u32 state[5];
+	int i;
+
+	/* The context holds the state as unsigned long */
+	for (i = 0; i < 5; i++)
+		state[i] = ctx->state[i];
+	sha1_ce_transform(state, data, blocks);
+	for (i = 0; i < 5; i++)
+		ctx->state[i] = state[i];
+}
+
+int sha256_armv8_ce_available(void)
+{
+	return sha_ce_has(ID_AA64ISAR0_SHA2_SHIFT);
+}
+
+void sha256_armv8_ce_process(sha256_context *ctx, const uint8_t *data,
+			     unsigned int blocks)
+{
+	sha256_ce_transform(ctx->state, data, blocks);
+}
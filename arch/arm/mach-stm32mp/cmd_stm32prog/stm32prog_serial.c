@@ -285,6 +285,7 @@ static bool stm32prog_serial_get_buffer(u8 *buffer, u32 *count)
 			*buffer++ = err;
 			*count -= 1;
 		} else if (err == -EAGAIN) {
+			dfu_write_poll();
 			ctrlc();
 			WATCHDOG_RESET();
 		} else {
@@ -19,6 +19,9 @@ DECLARE_GLOBAL_DATA_PTR;
 /* Enable access to PCI memory with map_sysmem() */
 static bool enable_pci_map;
 
+/* Number of bytes passed to flush_dcache_range(), for testing */
+static ulong dcache_flushed;
+
 #ifdef CONFIG_PCI
 /* Last device that was mapped into memory, and length of mapping */
 static struct udevice *map_dev;
@@ -284,6 +287,17 @@ void sandbox_set_enable_pci_map(int enable)
 
 void flush_dcache_range(unsigned long start, unsigned long stop)
 {
+	dcache_flushed += stop - start;
+}
+
+ulong sandbox_get_dcache_flushed(bool reset)
+{
+	ulong flushed = dcache_flushed;
+
+	if (reset)
+		dcache_flushed = 0;
+
+	return flushed;
 }
 
 void invalidate_dcache_range(unsigned long start, unsigned long stop)
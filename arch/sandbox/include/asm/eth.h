@@ -59,6 +59,21 @@ int sandbox_eth_recv_arp_req(struct udevice *dev);
  */
 int sandbox_eth_recv_ping_req(struct udevice *dev);
 
+/*
+ * sandbox_eth_recv_udp()
+ *
+ * Inject a UDP packet from the fake host to this target
+ *
+ * @dev: device that received the packet
+ * @dport: destination UDP port, on this target
+ * @sport: source UDP port, on the fake host
+ * @payload: UDP payload
+ * @len: length of the UDP payload
+ * @return 0 if injected, -EOVERFLOW if not
+ */
+int sandbox_eth_recv_udp(struct udevice *dev, int dport, int sport,
+			 const void *payload, unsigned int len);
+
 /**
  * A packet handler
  *
@@ -75,9 +90,7 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * fake_host_hwaddr - MAC address of mocked machine
  * fake_host_ipaddr - IP address of mocked machine
  * disabled - Will not respond
- * recv_packet_buffer - buffers of the packet returned as received
- * recv_packet_length - lengths of the packet returned as received
- * recv_packets - number of packets returned
+ * rx_ring - ring of packets waiting to be returned as received
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
  */
@@ -85,9 +98,7 @@ struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
 	bool disabled;
-	uchar * recv_packet_buffer[PKTBUFSRX];
-	int recv_packet_length[PKTBUFSRX];
-	int recv_packets;
+	struct eth_rx_ring rx_ring;
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
 };
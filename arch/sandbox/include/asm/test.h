@@ -126,6 +126,19 @@ int sandbox_pwm_get_config(struct udevice *dev, uint channel, uint *period_nsp,
  */
 void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask);
 
+/**
+ * sandbox_sf_get_erase_stats() - Get the erase commands done by a SPI flash
+ *
+ * The time is from a simple model of how long each erase command takes, with
+ * a fixed time for each command and a time for each KiB erased.
+ *
+ * @dev: Device to check
+ * @countp: Returns the number of erase commands done
+ * @time_usp: Returns the modelled time taken by those commands, in us
+ */
+void sandbox_sf_get_erase_stats(struct udevice *dev, uint *countp,
+				ulong *time_usp);
+
 /**
  * sandbox_get_codec_params() - Read back codec parameters
  *
@@ -224,4 +237,15 @@ uint sandbox_pci_read_bar(u32 barval, int type, uint size);
  */
 void sandbox_set_enable_memio(bool enable);
 
+/**
+ * sandbox_get_dcache_flushed() - Get the number of bytes flushed from dcache
+ *
+ * flush_dcache_range() does nothing on sandbox, but it counts the size of
+ * each range it is given, so that tests can check how much is flushed.
+ *
+ * @reset: true to reset the count to 0 after reading it
+ * @return number of bytes flushed since the count was last reset
+ */
+ulong sandbox_get_dcache_flushed(bool reset);
+
 #endif
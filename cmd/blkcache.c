@@ -13,15 +13,32 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 		     int argc, char * const argv[])
 {
 	struct block_cache_stats stats;
+	struct block_cache_dev_stats dstats;
+	int i;
+
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
+	       "max cache entries: %u\n"
+	       "entries/set: %u\n"
+	       "mode: %s\n"
+	       "dirty entries: %u\n"
+	       "write-backs: %u\n",
 	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       stats.max_blocks_per_entry, stats.max_entries, stats.ways,
+	       stats.writeback ? "write-back" : "write-through",
+	       stats.dirty, stats.writebacks);
+
+	for (i = 0; !blkcache_dev_stats(i, &dstats); i++) {
+		printf("%s %d: hits %u, misses %u, readahead %u blocks, bypass %u\n",
+		       blk_get_if_type_name(dstats.iftype), dstats.devnum,
+		       dstats.hits, dstats.misses, dstats.readahead,
+		       dstats.bypass);
+	}
+
 	return 0;
 }
 
@@ -40,9 +57,34 @@ static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 	return 0;
 }
 
+static int blkc_flush(cmd_tbl_t *cmdtp, int flag,
+		      int argc, char * const argv[])
+{
+	if (blkcache_flush(NULL))
+		return CMD_RET_FAILURE;
+
+	return 0;
+}
+
+static int blkc_writeback(cmd_tbl_t *cmdtp, int flag,
+			  int argc, char * const argv[])
+{
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	if (!strcmp(argv[1], "on"))
+		return blkcache_set_writeback(true) ? CMD_RET_FAILURE : 0;
+	else if (!strcmp(argv[1], "off"))
+		return blkcache_set_writeback(false) ? CMD_RET_FAILURE : 0;
+
+	return CMD_RET_USAGE;
+}
+
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
 	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(flush, 0, 0, blkc_flush, "", ""),
+	U_BOOT_CMD_MKENT(writeback, 2, 0, blkc_writeback, "", ""),
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -83,4 +125,6 @@ U_BOOT_CMD(
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
 	"blkcache configure blocks entries\n"
+	"blkcache flush - write dirty blocks back to their devices\n"
+	"blkcache writeback on|off - select write-back or write-through\n"
 );
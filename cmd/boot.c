@@ -8,6 +8,7 @@
  * Misc boot support
  */
 #include <common.h>
+#include <blk.h>
 #include <command.h>
 #include <net.h>
 
@@ -55,15 +56,35 @@ U_BOOT_CMD(
 
 #endif
 
+/*
+ * Not every board resets through the sysreset uclass, so write out the
+ * block cache here as well
+ */
+static int do_reset_flush(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	blkcache_flush(NULL);
+
+	return do_reset(cmdtp, flag, argc, argv);
+}
+
 U_BOOT_CMD(
-	reset, 1, 0,	do_reset,
+	reset, 1, 0,	do_reset_flush,
 	"Perform RESET of the CPU",
 	""
 );
 
 #ifdef CONFIG_CMD_POWEROFF
+static int do_poweroff_flush(cmd_tbl_t *cmdtp, int flag, int argc,
+			     char * const argv[])
+{
+	blkcache_flush(NULL);
+
+	return do_poweroff(cmdtp, flag, argc, argv);
+}
+
 U_BOOT_CMD(
-	poweroff, 1, 0,	do_poweroff,
+	poweroff, 1, 0,	do_poweroff_flush,
 	"Perform POWEROFF of the device",
 	""
 );
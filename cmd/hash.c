@@ -12,13 +12,56 @@
 #include <common.h>
 #include <command.h>
 #include <hash.h>
+#include <malloc.h>
+#include <mapmem.h>
 #include <linux/ctype.h>
+#include <linux/sizes.h>
+
+#ifdef CONFIG_HASH_BENCH
+/* Size of the buffer hashed when no address is given */
+#define HASH_BENCH_SIZE		SZ_1M
+
+static int do_hash_bench(int argc, char * const argv[])
+{
+	ulong addr, len;
+	void *buf;
+	int ret;
+
+	if (argc == 3) {
+		addr = simple_strtoul(argv[1], NULL, 16);
+		len = simple_strtoul(argv[2], NULL, 16);
+		buf = map_sysmem(addr, len);
+	} else if (argc == 1) {
+		len = HASH_BENCH_SIZE;
+		buf = malloc(len);
+		if (!buf) {
+			printf("Out of memory\n");
+			return CMD_RET_FAILURE;
+		}
+		memset(buf, 0xa5, len);
+	} else {
+		return CMD_RET_USAGE;
+	}
+
+	ret = hash_bench(buf, len);
+	if (argc == 3)
+		unmap_sysmem(buf);
+	else
+		free(buf);
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
+#endif
 
 static int do_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+#ifdef CONFIG_HASH_BENCH
+	if (argc >= 2 && !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc - 1, argv + 1);
+#endif
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -52,4 +95,8 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#ifdef CONFIG_HASH_BENCH
+	"\nhash bench [address count]\n"
+		"    - measure the speed of each algorithm [on a memory area]"
+#endif
 );
@@ -18,6 +18,7 @@
 #include <console.h>
 #include <hash.h>
 #include <mapmem.h>
+#include <memtest.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
@@ -576,238 +577,26 @@ static int do_mem_loopw(cmd_tbl_t *cmdtp, int flag, int argc,
 #endif /* CONFIG_LOOPW */
 
 #ifdef CONFIG_CMD_MEMTEST
-static ulong mem_test_alt(vu_long *buf, ulong start_addr, ulong end_addr,
-			  vu_long *dummy)
+static int mem_test_alt(struct memtest *mt, vu_long *dummy, ulong pattern)
 {
-	vu_long *addr;
-	ulong errs = 0;
-	ulong val, readback;
-	int j;
-	vu_long offset;
-	vu_long test_offset;
-	vu_long pattern;
-	vu_long temp;
-	vu_long anti_pattern;
-	vu_long num_words;
-	static const ulong bitpattern[] = {
-		0x00000001,	/* single bit */
-		0x00000003,	/* two adjacent bits */
-		0x00000007,	/* three adjacent bits */
-		0x0000000F,	/* four adjacent bits */
-		0x00000005,	/* two non-adjacent bits */
-		0x00000015,	/* three non-adjacent bits */
-		0x00000055,	/* four non-adjacent bits */
-		0xaaaaaaaa,	/* alternating 1/0 */
-	};
-
-	num_words = (end_addr - start_addr) / sizeof(vu_long);
-
-	/*
-	 * Data line test: write a pattern to the first
-	 * location, write the 1's complement to a 'parking'
-	 * address (changes the state of the data bus so a
-	 * floating bus doesn't give a false OK), and then
-	 * read the value back. Note that we read it back
-	 * into a variable because the next time we read it,
-	 * it might be right (been there, tough to explain to
-	 * the quality guys why it prints a failure when the
-	 * "is" and "should be" are obviously the same in the
-	 * error message).
-	 *
-	 * Rather than exhaustively testing, we test some
-	 * patterns by shifting '1' bits through a field of
-	 * '0's and '0' bits through a field of '1's (i.e.
-	 * pattern and ~pattern).
-	 */
-	addr = buf;
-	for (j = 0; j < sizeof(bitpattern) / sizeof(bitpattern[0]); j++) {
-		val = bitpattern[j];
-		for (; val != 0; val <<= 1) {
-			*addr = val;
-			*dummy  = ~val; /* clear the test data off the bus */
-			readback = *addr;
-			if (readback != val) {
-				printf("FAILURE (data line): "
-					"expected %08lx, actual %08lx\n",
-						val, readback);
-				errs++;
-				if (ctrlc())
-					return -1;
-			}
-			*addr  = ~val;
-			*dummy  = val;
-			readback = *addr;
-			if (readback != ~val) {
-				printf("FAILURE (data line): "
-					"Is %08lx, should be %08lx\n",
-						readback, ~val);
-				errs++;
-				if (ctrlc())
-					return -1;
-			}
-		}
-	}
-
-	/*
-	 * Based on code whose Original Author and Copyright
-	 * information follows: Copyright (c) 1998 by Michael
-	 * Barr. This software is placed into the public
-	 * domain and may be used for any purpose. However,
-	 * this notice must not be changed or removed and no
-	 * warranty is either expressed or implied by its
-	 * publication or distribution.
-	 */
-
-	/*
-	* Address line test
-
-	 * Description: Test the address bus wiring in a
-	 *              memory region by performing a walking
-	 *              1's test on the relevant bits of the
-	 *              address and checking for aliasing.
-	 *              This test will find single-bit
-	 *              address failures such as stuck-high,
-	 *              stuck-low, and shorted pins. The base
-	 *              address and size of the region are
-	 *              selected by the caller.
-
-	 * Notes:	For best results, the selected base
-	 *              address should have enough LSB 0's to
-	 *              guarantee single address bit changes.
-	 *              For example, to test a 64-Kbyte
-	 *              region, select a base address on a
-	 *              64-Kbyte boundary. Also, select the
-	 *              region size as a power-of-two if at
-	 *              all possible.
-	 *
-	 * Returns:     0 if the test succeeds, 1 if the test fails.
-	 */
-	pattern = (vu_long) 0xaaaaaaaa;
-	anti_pattern = (vu_long) 0x55555555;
-
-	debug("%s:%d: length = 0x%.8lx\n", __func__, __LINE__, num_words);
 	/*
-	 * Write the default pattern at each of the
-	 * power-of-two offsets.
+	 * Test the data lines, then the address lines, then every bit of
+	 * the memory as a zero and a one. Finish off with the word address
+	 * in each word and moving inversions of the pattern.
 	 */
-	for (offset = 1; offset < num_words; offset <<= 1)
-		addr[offset] = pattern;
+	if (memtest_data_bus(mt, dummy) ||
+	    memtest_addr_bus(mt) ||
+	    memtest_device(mt) ||
+	    memtest_addr_in_addr(mt) ||
+	    memtest_moving_inv(mt, pattern))
+		return -EINTR;
 
-	/*
-	 * Check for address bits stuck high.
-	 */
-	test_offset = 0;
-	addr[test_offset] = anti_pattern;
-
-	for (offset = 1; offset < num_words; offset <<= 1) {
-		temp = addr[offset];
-		if (temp != pattern) {
-			printf("\nFAILURE: Address bit stuck high @ 0x%.8lx:"
-				" expected 0x%.8lx, actual 0x%.8lx\n",
-				start_addr + offset*sizeof(vu_long),
-				pattern, temp);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-	}
-	addr[test_offset] = pattern;
-	WATCHDOG_RESET();
-
-	/*
-	 * Check for addr bits stuck low or shorted.
-	 */
-	for (test_offset = 1; test_offset < num_words; test_offset <<= 1) {
-		addr[test_offset] = anti_pattern;
-
-		for (offset = 1; offset < num_words; offset <<= 1) {
-			temp = addr[offset];
-			if ((temp != pattern) && (offset != test_offset)) {
-				printf("\nFAILURE: Address bit stuck low or"
-					" shorted @ 0x%.8lx: expected 0x%.8lx,"
-					" actual 0x%.8lx\n",
-					start_addr + offset*sizeof(vu_long),
-					pattern, temp);
-				errs++;
-				if (ctrlc())
-					return -1;
-			}
-		}
-		addr[test_offset] = pattern;
-	}
-
-	/*
-	 * Description: Test the integrity of a physical
-	 *		memory device by performing an
-	 *		increment/decrement test over the
-	 *		entire region. In the process every
-	 *		storage bit in the device is tested
-	 *		as a zero and a one. The base address
-	 *		and the size of the region are
-	 *		selected by the caller.
-	 *
-	 * Returns:     0 if the test succeeds, 1 if the test fails.
-	 */
-	num_words++;
-
-	/*
-	 * Fill memory with a known pattern.
-	 */
-	for (pattern = 1, offset = 0; offset < num_words; pattern++, offset++) {
-		WATCHDOG_RESET();
-		addr[offset] = pattern;
-	}
-
-	/*
-	 * Check each location and invert it for the second pass.
-	 */
-	for (pattern = 1, offset = 0; offset < num_words; pattern++, offset++) {
-		WATCHDOG_RESET();
-		temp = addr[offset];
-		if (temp != pattern) {
-			printf("\nFAILURE (read/write) @ 0x%.8lx:"
-				" expected 0x%.8lx, actual 0x%.8lx)\n",
-				start_addr + offset*sizeof(vu_long),
-				pattern, temp);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-
-		anti_pattern = ~pattern;
-		addr[offset] = anti_pattern;
-	}
-
-	/*
-	 * Check each location for the inverted pattern and zero it.
-	 */
-	for (pattern = 1, offset = 0; offset < num_words; pattern++, offset++) {
-		WATCHDOG_RESET();
-		anti_pattern = ~pattern;
-		temp = addr[offset];
-		if (temp != anti_pattern) {
-			printf("\nFAILURE (read/write): @ 0x%.8lx:"
-				" expected 0x%.8lx, actual 0x%.8lx)\n",
-				start_addr + offset*sizeof(vu_long),
-				anti_pattern, temp);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-		addr[offset] = 0;
-	}
-
-	return errs;
+	return 0;
 }
 
-static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
-			    vu_long pattern, int iteration)
+static int mem_test_quick(struct memtest *mt, ulong pattern, int iteration)
 {
-	vu_long *end;
-	vu_long *addr;
-	ulong errs = 0;
-	ulong incr, length;
-	ulong val, readback;
+	ulong incr;
 
 	/* Alternate the pattern */
 	incr = 1;
@@ -824,39 +613,17 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 		else
 			pattern = ~pattern;
 	}
-	length = (end_addr - start_addr) / sizeof(ulong);
-	end = buf + length;
 	printf("\rPattern %08lX  Writing..."
 		"%12s"
 		"\b\b\b\b\b\b\b\b\b\b",
 		pattern, "");
 
-	for (addr = buf, val = pattern; addr < end; addr++) {
-		WATCHDOG_RESET();
-		*addr = val;
-		val += incr;
-	}
+	if (memtest_fill(mt, pattern, incr))
+		return -EINTR;
 
 	puts("Reading...");
 
-	for (addr = buf, val = pattern; addr < end; addr++) {
-		WATCHDOG_RESET();
-		readback = *addr;
-		if (readback != val) {
-			ulong offset = addr - buf;
-
-			printf("\nMem error @ 0x%08X: "
-				"found %08lX, expected %08lX\n",
-				(uint)(uintptr_t)(start_addr + offset*sizeof(vu_long)),
-				readback, val);
-			errs++;
-			if (ctrlc())
-				return -1;
-		}
-		val += incr;
-	}
-
-	return errs;
+	return memtest_check(mt, pattern, incr, false);
 }
 
 /*
@@ -867,12 +634,13 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 			char * const argv[])
 {
+	struct memtest mt;
 	ulong start, end;
 	vu_long *buf, *dummy;
 	ulong iteration_limit = 0;
-	int ret;
-	ulong errs = 0;	/* number of errors, or -1 if interrupted */
+	int ret = 0;
 	ulong pattern = 0;
+	uint flags = 0;
 	int iteration;
 #if defined(CONFIG_SYS_ALT_MEMTEST)
 	const int alt_test = 1;
@@ -908,25 +676,26 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 	debug("%s:%d: start %#08lx end %#08lx\n", __func__, __LINE__,
 	      start, end);
 
+	if (IS_ENABLED(CONFIG_SYS_MEMTEST_FLUSH_CACHE))
+		flags |= MEMTEST_FLUSH_CACHE;
 	buf = map_sysmem(start, end - start);
 	dummy = map_sysmem(CONFIG_SYS_MEMTEST_SCRATCH, sizeof(vu_long));
+	memtest_init(&mt, (void *)buf, start, end - start, flags);
 	for (iteration = 0;
 			!iteration_limit || iteration < iteration_limit;
 			iteration++) {
 		if (ctrlc()) {
-			errs = -1UL;
+			ret = -EINTR;
 			break;
 		}
 
 		printf("Iteration: %6d\r", iteration + 1);
 		debug("\n");
-		if (alt_test) {
-			errs = mem_test_alt(buf, start, end, dummy);
-		} else {
-			errs = mem_test_quick(buf, start, end, pattern,
-					      iteration);
-		}
-		if (errs == -1UL)
+		if (alt_test)
+			ret = mem_test_alt(&mt, dummy, pattern);
+		else
+			ret = mem_test_quick(&mt, pattern, iteration);
+		if (ret)
 			break;
 	}
 
@@ -943,15 +712,16 @@ static int do_mem_mtest(cmd_tbl_t *cmdtp, int flag, int argc,
 		unmap_sysmem(vdummy);
 	}
 
-	if (errs == -1UL) {
+	if (ret) {
 		/* Memory test was aborted - write a newline to finish off */
 		putc('\n');
 		ret = 1;
 	} else {
 		printf("Tested %d iteration(s) with %lu errors.\n",
-			iteration, errs);
-		ret = errs != 0;
+			iteration, mt.errs);
+		ret = mt.errs != 0;
 	}
+	memtest_show_speed(&mt);
 
 	return ret;
 }
@@ -168,33 +168,50 @@ static int do_spi_flash_probe(int argc, char * const argv[])
  * @return NULL if OK, else a string containing the stage which failed
  */
 static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf, char *cmp_buf, size_t *skipped)
+		size_t len, const char *buf, char *cmp_buf, size_t *skipped,
+		bool *changedp)
 {
-	char *ptr = (char *)buf;
-
 	debug("offset=%#x, sector_size=%#x, len=%#zx\n",
 	      offset, flash->sector_size, len);
 	/* Read the entire sector so to allow for rewriting */
 	if (spi_flash_read(flash, offset, flash->sector_size, cmp_buf))
 		return "read";
 	/* Compare only what is meaningful (len) */
-	if (memcmp(cmp_buf, buf, len) == 0) {
+	*changedp = memcmp(cmp_buf, buf, len) != 0;
+	if (!*changedp) {
 		debug("Skip region %x size %zx: no change\n",
 		      offset, len);
 		*skipped += len;
-		return NULL;
 	}
-	/* Erase the entire sector */
-	if (spi_flash_erase(flash, offset, flash->sector_size))
+
+	return NULL;
+}
+
+/*
+ * Erase and write a run of sectors which all need to change. The run is
+ * erased in one go so that the flash can use its larger erase commands.
+ * Only the last sector of the run can be partial, in which case cmp_buf
+ * holds its existing contents.
+ */
+static const char *spi_flash_update_run(struct spi_flash *flash, u32 offset,
+		size_t len, const char *buf, char *cmp_buf)
+{
+	size_t full = len - len % flash->sector_size;
+
+	debug("offset=%#x, run len=%#zx\n", offset, len);
+	/* Erase all the sectors in the run */
+	if (spi_flash_erase(flash, offset, roundup(len, flash->sector_size)))
 		return "erase";
-	/* If it's a partial sector, copy the data into the temp-buffer */
-	if (len != flash->sector_size) {
-		memcpy(cmp_buf, buf, len);
-		ptr = cmp_buf;
-	}
-	/* Write one complete sector */
-	if (spi_flash_write(flash, offset, flash->sector_size, ptr))
+	/* Write the complete sectors */
+	if (full && spi_flash_write(flash, offset, full, buf))
 		return "write";
+	/* If the last sector is partial, copy the data into the temp-buffer */
+	if (len != full) {
+		memcpy(cmp_buf, buf + full, len - full);
+		if (spi_flash_write(flash, offset + full, flash->sector_size,
+				    cmp_buf))
+			return "write";
+	}
 
 	return NULL;
 }
@@ -220,6 +237,9 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 	const ulong start_time = get_timer(0);
 	size_t scale = 1;
 	const char *start_buf = buf;
+	const char *run_buf = NULL;	/* start of sectors needing update */
+	u32 run_offset = 0;
+	bool changed;
 	ulong delta;
 
 	if (end - buf >= 200)
@@ -238,7 +258,21 @@ static int spi_flash_update(struct spi_flash *flash, u32 offset,
 				last_update = get_timer(0);
 			}
 			err_oper = spi_flash_update_block(flash, offset, todo,
-					buf, cmp_buf, &skipped);
+					buf, cmp_buf, &skipped, &changed);
+			if (err_oper)
+				break;
+			if (changed && !run_buf) {
+				run_buf = buf;
+				run_offset = offset;
+			}
+			/* Update the run when it ends, or at the end */
+			if (run_buf && (!changed || buf + todo == end)) {
+				err_oper = spi_flash_update_run(flash,
+						run_offset,
+						(changed ? buf + todo : buf) -
+						run_buf, run_buf, cmp_buf);
+				run_buf = NULL;
+			}
 		}
 	} else {
 		err_oper = "malloc";
@@ -232,6 +232,7 @@ static int do_usb_mass_storage(cmd_tbl_t *cmdtp, int flag,
 	}
 
 cleanup_register:
+	fsg_cleanup();
 	g_dnl_unregister();
 cleanup_board:
 	usb_gadget_release(controller_index);
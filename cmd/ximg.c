@@ -24,6 +24,7 @@
 #endif
 #include <asm/byteorder.h>
 #include <asm/io.h>
+#include <u-boot/zstd.h>
 
 #ifndef CONFIG_SYS_XIMG_LEN
 /* use 8MByte as default max gunzip size */
@@ -244,6 +245,21 @@ do_imgextract(cmd_tbl_t * cmdtp, int flag, int argc, char * const argv[])
 			}
 			break;
 #endif /* CONFIG_BZIP2 */
+#ifdef CONFIG_ZSTD
+		case IH_COMP_ZSTD:
+			{
+				size_t size = unc_len;
+
+				printf("   Uncompressing part %d ... ", part);
+				if (zstd_decompress((void *)data, len,
+						    (void *)dest, &size)) {
+					puts("ZSTD ERROR - image not loaded\n");
+					return 1;
+				}
+				len = size;
+			}
+			break;
+#endif /* CONFIG_ZSTD */
 		default:
 			printf("Unimplemented compression type %d\n", comp);
 			return 1;
@@ -302,6 +302,9 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	gd->dm_compat_index = NULL;
+	gd->uclass_by_id = NULL;
+	gd->dm_stats = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
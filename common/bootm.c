@@ -6,6 +6,7 @@
 
 #ifndef USE_HOSTCC
 #include <common.h>
+#include <blk.h>
 #include <bootstage.h>
 #include <cpu_func.h>
 #include <env.h>
@@ -587,6 +588,10 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 		return 1;
 	}
 
+	/* Write out cached blocks before the OS takes over the devices */
+	if (states & (BOOTM_STATE_OS_PREP | BOOTM_STATE_OS_FAKE_GO |
+		      BOOTM_STATE_OS_GO))
+		blkcache_flush(NULL);
 
 	/* Call various other states that are not generally used */
 	if (!ret && (states & BOOTM_STATE_OS_CMDLINE))
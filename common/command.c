@@ -12,8 +12,12 @@
 #include <command.h>
 #include <console.h>
 #include <env.h>
+#include <malloc.h>
+#include <sort.h>
 #include <linux/ctype.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
  * for long help messages
@@ -117,10 +121,112 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Index of the command table, sorted by name, so that commands can be
+ * found with a binary search. The linker sorts the table by the name of the
+ * variable for each command, which is not always the command name (e.g.
+ * for '?'), so the index is sorted here. It is built on first use after
+ * relocation, since the BSS cannot be used before then.
+ */
+static cmd_tbl_t **cmd_index;
+static int cmd_index_count;
+
+static int cmd_index_cmp(const void *a, const void *b)
+{
+	const cmd_tbl_t *const *cmda = a;
+	const cmd_tbl_t *const *cmdb = b;
+
+	return strcmp((*cmda)->name, (*cmdb)->name);
+}
+
+/* Get the command index, building it if needed. Returns NULL if none */
+static cmd_tbl_t **cmd_get_index(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	int i;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return NULL;
+	if (cmd_index)
+		return cmd_index;
+
+	cmd_index = malloc(count * sizeof(*cmd_index));
+	if (!cmd_index)
+		return NULL;
+	for (i = 0; i < count; i++)
+		cmd_index[i] = start + i;
+	qsort(cmd_index, count, sizeof(*cmd_index), cmd_index_cmp);
+	cmd_index_count = count;
+
+	return cmd_index;
+}
+
+/*
+ * Find the commands whose names start with the first @len characters of
+ * @cmd. Since the index is sorted, these are next to each other and a full
+ * match comes first. Returns the number of commands found, setting *firstp
+ * to the index position of the first.
+ */
+static int cmd_index_find(const char *cmd, int len, int *firstp)
+{
+	int first, lo, hi, mid;
+
+	/* Find the first name which is not before the prefix */
+	lo = 0;
+	hi = cmd_index_count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strncmp(cmd_index[mid]->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	first = lo;
+
+	/* Find the first name after the prefix */
+	hi = cmd_index_count;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (strncmp(cmd_index[mid]->name, cmd, len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*firstp = first;
+
+	return lo - first;
+}
+
+/* Get the length of a command name, ignoring any size (like "cp.b") */
+static int cmd_name_len(const char *cmd)
+{
+	const char *p = strchr(cmd, '.');
+
+	return p ? p - cmd : strlen(cmd);
+}
+#endif /* CONFIG_CMDLINE */
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+
+#ifdef CONFIG_CMDLINE
+	if (cmd && cmd_get_index()) {
+		int name_len = cmd_name_len(cmd);
+		int first, n_found;
+
+		n_found = cmd_index_find(cmd, name_len, &first);
+		if (n_found == 1 ||
+		    (n_found && strlen(cmd_index[first]->name) == name_len))
+			return cmd_index[first];
+
+		return NULL;	/* not found or ambiguous command */
+	}
+#endif
+
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -258,9 +364,41 @@ static int complete_cmdv(int argc, char * const argv[], char last_char,
 			 int maxv, char *cmdv[])
 {
 #ifdef CONFIG_CMDLINE
-	return complete_subcmdv(ll_entry_start(cmd_tbl_t, cmd),
-				ll_entry_count(cmd_tbl_t, cmd), argc, argv,
-				last_char, maxv, cmdv);
+	cmd_tbl_t *cmdtp;
+	const char *cmd;
+	int first, n, i;
+	int n_found = 0;
+
+	if (maxv < 2 || !cmd_get_index())
+		return complete_subcmdv(ll_entry_start(cmd_tbl_t, cmd),
+					ll_entry_count(cmd_tbl_t, cmd), argc,
+					argv, last_char, maxv, cmdv);
+
+	/* more than one arg or one but the start of the next */
+	if (argc > 1 ||
+	    (argc == 1 && (last_char == '\0' || isblank(last_char)))) {
+		cmdtp = find_cmd(argv[0]);
+		if (!cmdtp || !cmdtp->complete) {
+			cmdv[0] = NULL;
+			return 0;
+		}
+		return cmdtp->complete(argc, argv, last_char, maxv, cmdv);
+	}
+
+	/* return the partial matches, or all commands, in order */
+	cmd = argc ? argv[0] : "";
+	n = cmd_index_find(cmd, cmd_name_len(cmd), &first);
+	for (i = 0; i < n; i++) {
+		/* too many! */
+		if (n_found >= maxv - 2) {
+			cmdv[n_found++] = "...";
+			break;
+		}
+		cmdv[n_found++] = cmd_index[first + i]->name;
+	}
+	cmdv[n_found] = NULL;
+
+	return n_found;
 #else
 	return 0;
 #endif
@@ -12,6 +12,8 @@
 #ifndef USE_HOSTCC
 #include <common.h>
 #include <command.h>
+#include <console.h>
+#include <div64.h>
 #include <env.h>
 #include <malloc.h>
 #include <mapmem.h>
@@ -49,7 +51,7 @@ static int hash_init_sha1(struct hash_algo *algo, void **ctxp)
 static int hash_update_sha1(struct hash_algo *algo, void *ctx, const void *buf,
 			    unsigned int size, int is_last)
 {
-	sha1_update((sha1_context *)ctx, buf, size);
+	sha1_update_wd((sha1_context *)ctx, buf, size, algo->chunk_size);
 	return 0;
 }
 
@@ -77,7 +79,7 @@ static int hash_init_sha256(struct hash_algo *algo, void **ctxp)
 static int hash_update_sha256(struct hash_algo *algo, void *ctx,
 			      const void *buf, unsigned int size, int is_last)
 {
-	sha256_update((sha256_context *)ctx, buf, size);
+	sha256_update_wd((sha256_context *)ctx, buf, size, algo->chunk_size);
 	return 0;
 }
 
@@ -141,7 +143,8 @@ static int hash_finish_crc32(struct hash_algo *algo, void *ctx, void *dest_buf,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* Same byte order as crc32_wd_buf() */
+	*((uint32_t *)dest_buf) = cpu_to_be32(*((uint32_t *)ctx));
 	free(ctx);
 	return 0;
 }
@@ -321,6 +324,43 @@ int hash_block(const char *algo_name, const void *data, unsigned int len,
 	return 0;
 }
 
+#ifdef CONFIG_HASH_BENCH
+/* Time spent on each algorithm by hash_bench() */
+#define HASH_BENCH_MS	1000
+
+int hash_bench(const void *data, unsigned int len)
+{
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	ulong start, ms, rate;
+	u64 bytes;
+	int i;
+
+	reloc_update();
+
+	printf("%-12s %8s\n", "Algorithm", "MB/s");
+	for (i = 0; i < ARRAY_SIZE(hash_algo); i++) {
+		algo = &hash_algo[i];
+		bytes = 0;
+		start = get_timer(0);
+		do {
+			algo->hash_func_ws(data, len, output, algo->chunk_size);
+			bytes += len;
+			if (ctrlc())
+				return -EINTR;
+			ms = get_timer(start);
+		} while (ms < HASH_BENCH_MS);
+
+		/* Bytes per millisecond is thousandths of a MB/s */
+		rate = lldiv(bytes, ms);
+		printf("%-12s %6lu.%lu\n", algo->name, rate / 1000,
+		       rate % 1000 / 100);
+	}
+
+	return 0;
+}
+#endif
+
 #if defined(CONFIG_CMD_HASH) || defined(CONFIG_CMD_SHA1SUM) || defined(CONFIG_CMD_CRC32)
 /**
  * store_result: Store the resulting sum to an address or variable
@@ -17,6 +17,7 @@
 #include <linux/kconfig.h>
 #include <common.h>
 #include <errno.h>
+#include <hash.h>
 #include <mapmem.h>
 #include <asm/io.h>
 #include <malloc.h>
@@ -1354,6 +1355,247 @@ int fit_all_image_verify(const void *fit)
 	return 1;
 }
 
+#if IMAGE_ENABLE_STREAM
+/*
+ * Check whether a required signature of type @type ("image" or "conf", or
+ * NULL for either) is present in the key blob
+ */
+static bool fit_stream_sig_required(const void *sig_blob, const char *type)
+{
+	int sig_node;
+	int noffset;
+
+	sig_node = fdt_subnode_offset(sig_blob, 0, FIT_SIG_NODENAME);
+	if (sig_node < 0)
+		return false;
+
+	fdt_for_each_subnode(noffset, sig_blob, sig_node) {
+		const char *required;
+
+		required = fdt_getprop(sig_blob, noffset, "required", NULL);
+		if (required && (!type || !strcmp(required, type)))
+			return true;
+	}
+
+	return false;
+}
+
+static void fit_stream_free_hashes(struct fit_stream *st)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int i;
+
+	for (i = 0; i < st->hash_count; i++) {
+		struct hash_algo *algo = st->hash_algo[i];
+
+		if (algo && st->hash_ctx[i])
+			algo->hash_finish(algo, st->hash_ctx[i], value,
+					  sizeof(value));
+		st->hash_ctx[i] = NULL;
+	}
+}
+
+static int fit_stream_add_hashes(struct fit_stream *st)
+{
+	const void *fit = st->fit;
+	int noffset;
+	int ret;
+
+	/*
+	 * A required image signature needs the complete image data, so the
+	 * image cannot be streamed
+	 */
+	if (IMAGE_ENABLE_VERIFY &&
+	    fit_stream_sig_required(gd_fdt_blob(), "image"))
+		return -EPROTONOSUPPORT;
+
+	fdt_for_each_subnode(noffset, fit, st->noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		struct hash_algo *algo = NULL;
+		char *algo_name;
+		int ignore = 0;
+
+		if (!strncmp(name, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME))) {
+			if (IMAGE_ENABLE_VERIFY)
+				return -EPROTONOSUPPORT;
+			continue;
+		}
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (st->hash_count == FIT_STREAM_MAX_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo_name))
+			return -EPROTONOSUPPORT;
+
+		if (IMAGE_ENABLE_IGNORE)
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (!ignore) {
+			ret = hash_progressive_lookup_algo(algo_name, &algo);
+			if (ret || algo->digest_size > FIT_MAX_HASH_LEN)
+				return -EPROTONOSUPPORT;
+		}
+		st->hash_node[st->hash_count] = noffset;
+		st->hash_algo[st->hash_count] = algo;
+		st->hash_ctx[st->hash_count] = NULL;
+		st->hash_count++;
+	}
+	if (noffset == -FDT_ERR_TRUNCATED || noffset == -FDT_ERR_BADSTRUCTURE)
+		return -EPROTONOSUPPORT;
+
+	return 0;
+}
+
+int fit_stream_start(struct fit_stream *st, const void *fit, int noffset,
+		     int comp, void *dst, ulong dst_size, bool verify)
+{
+	ulong len;
+	int ret;
+	int i;
+
+	/*
+	 * The hashes are only checked once all the data has been through the
+	 * decompressor. When a signature is required, keep the decompressor
+	 * away from data that has not been checked.
+	 */
+	if (verify && comp != IH_COMP_NONE && IMAGE_ENABLE_VERIFY &&
+	    fit_stream_sig_required(gd_fdt_blob(), NULL))
+		return -EPROTONOSUPPORT;
+
+	memset(st, '\0', sizeof(*st));
+	st->fit = fit;
+	st->noffset = noffset;
+
+	ret = image_decomp_stream_start(&st->ds, comp, dst, dst_size);
+	if (ret)
+		return ret;
+
+	if (verify) {
+		ret = fit_stream_add_hashes(st);
+		if (ret)
+			goto err;
+	}
+
+	for (i = 0; i < st->hash_count; i++) {
+		struct hash_algo *algo = st->hash_algo[i];
+
+		if (algo && algo->hash_init(algo, &st->hash_ctx[i])) {
+			st->hash_ctx[i] = NULL;
+			fit_stream_free_hashes(st);
+			ret = -ENOMEM;
+			goto err;
+		}
+	}
+
+	return 0;
+err:
+	image_decomp_stream_end(&st->ds, &len);
+
+	return ret;
+}
+
+int fit_stream_feed(struct fit_stream *st, const void *buf, ulong len)
+{
+	int ret = 0;
+	int i;
+
+	if (st->err)
+		return st->err;
+
+	/* Hash the data while it is still in the cache */
+	for (i = 0; i < st->hash_count; i++) {
+		struct hash_algo *algo = st->hash_algo[i];
+
+		if (!algo)
+			continue;
+		if (algo->hash_update(algo, st->hash_ctx[i], buf, len, 0)) {
+			/* The context has been freed */
+			st->hash_ctx[i] = NULL;
+			ret = -EIO;
+		}
+	}
+
+	if (!ret)
+		ret = image_decomp_stream_feed(&st->ds, buf, len);
+	st->err = ret;
+
+	return ret;
+}
+
+int fit_stream_finish(struct fit_stream *st, ulong *lenp)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	const char *err_msg = NULL;
+	int noffset = 0;
+	int ret = st->err;
+	int i;
+
+	if (image_decomp_stream_end(&st->ds, lenp) && !ret)
+		ret = -EIO;
+	if (ret) {
+		fit_stream_free_hashes(st);
+		return ret;
+	}
+
+	for (i = 0; i < st->hash_count; i++) {
+		struct hash_algo *algo = st->hash_algo[i];
+		uint8_t *fit_value;
+		int fit_value_len;
+		char *algo_name;
+
+		if (!algo) {
+			fit_image_hash_get_algo(st->fit, st->hash_node[i],
+						&algo_name);
+			if (!err_msg)
+				printf("%s-skipped ", algo_name);
+			continue;
+		}
+		if (!err_msg)
+			noffset = st->hash_node[i];
+		if (algo->hash_finish(algo, st->hash_ctx[i], value,
+				      sizeof(value)) && !err_msg)
+			err_msg = "Unsupported hash algorithm";
+		st->hash_ctx[i] = NULL;
+		if (err_msg)
+			continue;
+
+		printf("%s", algo->name);
+		if (fit_image_hash_get_value(st->fit, noffset, &fit_value,
+					     &fit_value_len))
+			err_msg = "Can't get hash value property";
+		else if (fit_value_len != algo->digest_size)
+			err_msg = "Bad hash value len";
+		else if (memcmp(value, fit_value, fit_value_len))
+			err_msg = "Bad hash value";
+		else
+			puts("+ ");
+	}
+
+	if (err_msg) {
+		printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+		       err_msg, fit_get_name(st->fit, noffset, NULL),
+		       fit_get_name(st->fit, st->noffset, NULL));
+		return -EACCES;
+	}
+
+	return 0;
+}
+
+int fit_stream_load(struct fit_stream *st, const void *data, ulong size,
+		    ulong *lenp)
+{
+	ulong pos, chunk;
+
+	for (pos = 0; pos < size; pos += chunk) {
+		chunk = min_t(ulong, size - pos, CONFIG_FIT_STREAM_CHUNK_SIZE);
+		if (fit_stream_feed(st, data + pos, chunk))
+			break;
+	}
+
+	return fit_stream_finish(st, lenp);
+}
+#endif /* IMAGE_ENABLE_STREAM */
+
 /**
  * fit_image_check_os - check whether image node is of a given os type
  * @fit: pointer to the FIT format image header
@@ -1729,20 +1971,60 @@ int fit_conf_get_prop_node(const void *fit, int noffset,
 	return fit_conf_get_prop_node_index(fit, noffset, prop_name, 0);
 }
 
+static int fit_image_check_hashes(const void *fit, int noffset)
+{
+	puts("   Verifying Hash Integrity ... ");
+	if (!fit_image_verify(fit, noffset)) {
+		puts("Bad Data Hash\n");
+		return -EACCES;
+	}
+	puts("OK\n");
+
+	return 0;
+}
+
 static int fit_image_select(const void *fit, int rd_noffset, int verify)
 {
 	fit_image_print(fit, rd_noffset, "   ");
 
-	if (verify) {
-		puts("   Verifying Hash Integrity ... ");
-		if (!fit_image_verify(fit, rd_noffset)) {
-			puts("Bad Data Hash\n");
-			return -EACCES;
-		}
-		puts("OK\n");
+	if (verify)
+		return fit_image_check_hashes(fit, rd_noffset);
+
+	return 0;
+}
+
+/*
+ * Verify the image hashes while copying or decompressing the image data to
+ * @dst, so that the data is only traversed once. Returns -EPROTONOSUPPORT
+ * if the image cannot be handled this way, -EACCES if a hash is wrong.
+ */
+static int fit_image_load_stream(const void *fit, int noffset, int comp,
+				 void *dst, ulong dst_size, const void *src,
+				 ulong len, ulong *lenp)
+{
+#if IMAGE_ENABLE_STREAM
+	struct fit_stream st;
+	int ret;
+
+	ret = fit_stream_start(&st, fit, noffset, comp, dst, dst_size, true);
+	if (ret)
+		return ret == -EPROTONOSUPPORT ? ret : -EIO;
+
+	puts("   Verifying Hash Integrity ... ");
+	ret = fit_stream_load(&st, src, len, lenp);
+	if (ret == -EACCES) {
+		puts("Bad Data Hash\n");
+		return ret;
+	} else if (ret) {
+		puts("\n");
+		return ret;
 	}
+	puts("OK\n");
 
 	return 0;
+#else
+	return -EPROTONOSUPPORT;
+#endif
 }
 
 int fit_get_node_from_config(bootm_headers_t *images, const char *prop_name,
@@ -1825,6 +2107,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	uint8_t os_arch;
 #endif
 	const char *prop_name;
+	bool defer_verify;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -1896,7 +2179,12 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/*
+	 * If possible, check the hashes while the image data is copied or
+	 * decompressed below, rather than in a separate pass
+	 */
+	defer_verify = IMAGE_ENABLE_STREAM && images->verify;
+	ret = fit_image_select(fit, noffset, images->verify && !defer_verify);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -2011,16 +2299,52 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		} else {
 			loadbuf = map_sysmem(load, max_decomp_len);
 		}
-		if (image_decomp(comp, load, data, image_type,
-				loadbuf, buf, len, max_decomp_len, &load_end)) {
+		ret = -EPROTONOSUPPORT;
+		if (defer_verify)
+			ret = fit_image_load_stream(fit, noffset, comp, loadbuf,
+						    max_decomp_len, buf, len,
+						    &len);
+		if (ret == -EPROTONOSUPPORT) {
+			ret = 0;
+			if (defer_verify)
+				ret = fit_image_check_hashes(fit, noffset);
+			if (!ret) {
+				if (image_decomp(comp, load, data, image_type,
+						 loadbuf, buf, len,
+						 max_decomp_len, &load_end)) {
+					printf("Error decompressing %s\n",
+					       prop_name);
+					return -ENOEXEC;
+				}
+				len = load_end - load;
+			}
+		} else if (ret && ret != -EACCES) {
 			printf("Error decompressing %s\n", prop_name);
-
 			return -ENOEXEC;
 		}
-		len = load_end - load;
 	} else if (load != data) {
 		loadbuf = map_sysmem(load, len);
-		memcpy(loadbuf, buf, len);
+		ret = -EPROTONOSUPPORT;
+		/* Copy in pieces only if the image does not overlap itself */
+		if (defer_verify && (load + len <= data || load >= data + len))
+			ret = fit_image_load_stream(fit, noffset, IH_COMP_NONE,
+						    loadbuf, len, buf, len,
+						    &len);
+		if (ret == -EPROTONOSUPPORT) {
+			ret = 0;
+			if (defer_verify)
+				ret = fit_image_check_hashes(fit, noffset);
+			if (!ret)
+				memcpy(loadbuf, buf, len);
+		}
+	} else {
+		ret = 0;
+		if (defer_verify)
+			ret = fit_image_check_hashes(fit, noffset);
+	}
+	if (ret) {
+		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+		return ret;
 	}
 
 	if (image_type == IH_TYPE_RAMDISK && comp != IH_COMP_NONE)
@@ -41,6 +41,7 @@
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
+#include <u-boot/zstd.h>
 
 #ifdef CONFIG_CMD_BDI
 extern int do_bdinfo(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[]);
@@ -191,6 +192,7 @@ static const table_entry_t uimage_comp[] = {
 	{	IH_COMP_LZMA,	"lzma",		"lzma compressed",	},
 	{	IH_COMP_LZO,	"lzo",		"lzo compressed",	},
 	{	IH_COMP_LZ4,	"lz4",		"lz4 compressed",	},
+	{	IH_COMP_ZSTD,	"zstd",		"zstd compressed",	},
 	{	-1,		"",		"",			},
 };
 
@@ -478,6 +480,15 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return -ENOSYS;
@@ -488,6 +499,131 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return ret;
 }
 
+#ifndef USE_HOSTCC
+int image_decomp_stream_start(struct image_decomp_stream *ds, int comp,
+			      void *dst, ulong dst_size)
+{
+	memset(ds, '\0', sizeof(*ds));
+	ds->comp = comp;
+	ds->dst = dst;
+	ds->dst_size = dst_size;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		return 0;
+	case IH_COMP_GZIP:
+		if (!CONFIG_IS_ENABLED(GZIP))
+			return -EPROTONOSUPPORT;
+		ds->ctx = gunzip_stream_start(dst, dst_size);
+		break;
+	case IH_COMP_LZMA:
+		if (!CONFIG_IS_ENABLED(LZMA))
+			return -EPROTONOSUPPORT;
+		ds->ctx = lzma_stream_start(dst, dst_size);
+		break;
+	case IH_COMP_LZ4:
+		if (!CONFIG_IS_ENABLED(LZ4))
+			return -EPROTONOSUPPORT;
+		ds->ctx = lz4_stream_start(dst, dst_size);
+		break;
+	case IH_COMP_ZSTD:
+		if (!CONFIG_IS_ENABLED(ZSTD))
+			return -EPROTONOSUPPORT;
+		ds->ctx = zstd_stream_start(dst, dst_size);
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	return ds->ctx ? 0 : -ENOMEM;
+}
+
+int image_decomp_stream_feed(struct image_decomp_stream *ds, const void *src,
+			     ulong len)
+{
+	switch (ds->comp) {
+	case IH_COMP_NONE:
+		if (len > ds->dst_size - ds->pos)
+			return -ENOSPC;
+		if (src != ds->dst + ds->pos)
+			memmove(ds->dst + ds->pos, src, len);
+		ds->pos += len;
+		return 0;
+	case IH_COMP_GZIP:
+		if (CONFIG_IS_ENABLED(GZIP))
+			return gunzip_stream_feed(ds->ctx, src, len);
+		break;
+	case IH_COMP_LZMA:
+		if (CONFIG_IS_ENABLED(LZMA))
+			return lzma_stream_feed(ds->ctx, src, len);
+		break;
+	case IH_COMP_LZ4:
+		if (CONFIG_IS_ENABLED(LZ4))
+			return lz4_stream_feed(ds->ctx, src, len);
+		break;
+	case IH_COMP_ZSTD:
+		if (CONFIG_IS_ENABLED(ZSTD))
+			return zstd_stream_feed(ds->ctx, src, len);
+		break;
+	}
+
+	return -EPROTONOSUPPORT;
+}
+
+int image_decomp_stream_end(struct image_decomp_stream *ds, ulong *lenp)
+{
+	*lenp = ds->pos;
+	switch (ds->comp) {
+	case IH_COMP_NONE:
+		return 0;
+	case IH_COMP_GZIP:
+		if (CONFIG_IS_ENABLED(GZIP))
+			return gunzip_stream_end(ds->ctx, lenp);
+		break;
+	case IH_COMP_LZMA:
+		if (CONFIG_IS_ENABLED(LZMA))
+			return lzma_stream_end(ds->ctx, lenp);
+		break;
+	case IH_COMP_LZ4:
+		if (CONFIG_IS_ENABLED(LZ4))
+			return lz4_stream_end(ds->ctx, lenp);
+		break;
+	case IH_COMP_ZSTD:
+		if (CONFIG_IS_ENABLED(ZSTD))
+			return zstd_stream_end(ds->ctx, lenp);
+		break;
+	}
+
+	return -EPROTONOSUPPORT;
+}
+
+int image_decomp_detect(const void *buf, ulong len)
+{
+	static const struct {
+		int comp;
+		int len;
+		const char *magic;
+	} magics[] = {
+		{ IH_COMP_GZIP, 2, "\x1f\x8b" },
+		{ IH_COMP_LZ4, 4, "\x04\x22\x4d\x18" },
+		{ IH_COMP_ZSTD, 4, "\x28\xb5\x2f\xfd" },
+		{ IH_COMP_BZIP2, 3, "BZh" },
+		{ IH_COMP_LZO, 4, "\x89LZO" },
+		/* LZMA_Alone has no magic, but the properties rarely vary */
+		{ IH_COMP_LZMA, 3, "\x5d\x00\x00" },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(magics); i++) {
+		if (len >= magics[i].len &&
+		    !memcmp(buf, magics[i].magic, magics[i].len))
+			return magics[i].comp;
+	}
+
+	return IH_COMP_NONE;
+}
+#endif /* !USE_HOSTCC */
+
 
 #ifndef USE_HOSTCC
 #if CONFIG_IS_ENABLED(LEGACY_IMAGE_FORMAT)
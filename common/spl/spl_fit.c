@@ -10,7 +10,10 @@
 #include <gzip.h>
 #include <image.h>
 #include <linux/libfdt.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <spl.h>
+#include <u-boot/zstd.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -153,6 +156,112 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/**
+ * spl_fit_stream_image(): read external image data in pieces, hashing and
+ * decompressing each piece as soon as it has been read
+ * @info:	points to information about the device to load data from
+ * @sector:	the start sector of the FIT image on the device
+ * @fit:	points to the flattened device tree blob describing the FIT
+ *		image
+ * @node:	offset of the DT node describing the image to load
+ * @offset:	offset of the image data, relative to the beginning of the FIT
+ * @length:	size of the image data
+ * @comp:	compression of the image data
+ * @load_ptr:	aligned address to read uncompressed image data to
+ * @load_addr:	address to decompress compressed image data to
+ * @lengthp:	returns the size of the (uncompressed) image data
+ *
+ * Uncompressed data is read straight to @load_ptr and hashed there, with the
+ * image data starting at @load_ptr plus the alignment overhead. Compressed
+ * data is read to a buffer of CONFIG_FIT_STREAM_CHUNK_SIZE bytes and
+ * decompressed to @load_addr.
+ *
+ * Return:	0 on success, -EPROTONOSUPPORT if the image cannot be streamed
+ *		or another negative error number.
+ */
+static int spl_fit_stream_image(struct spl_load_info *info, ulong sector,
+				void *fit, int node, int offset, size_t length,
+				int comp, ulong load_ptr, ulong load_addr,
+				size_t *lengthp)
+{
+#if CONFIG_IS_ENABLED(FIT_STREAM)
+	bool verify = IS_ENABLED(CONFIG_SPL_FIT_SIGNATURE);
+	ulong unit = info->filename ? 1 : info->bl_len;
+	int overhead = get_aligned_image_overhead(info, offset);
+	int nr_sectors = get_aligned_image_size(info, length, offset);
+	int chunk_sectors = max(CONFIG_FIT_STREAM_CHUNK_SIZE / unit, 1UL);
+	struct fit_stream st;
+	void *buf = NULL;
+	void *dst;
+	ulong size;
+	int i, count;
+	int ret, err;
+
+	if (comp == IH_COMP_NONE) {
+		dst = (void *)load_ptr + overhead;
+		size = length;
+	} else {
+		dst = (void *)load_addr;
+		size = CONFIG_SYS_BOOTM_LEN;
+		buf = malloc_cache_aligned(chunk_sectors * unit);
+		if (!buf)
+			return -ENOMEM;
+	}
+
+	ret = fit_stream_start(&st, fit, node, comp, dst, size, verify);
+	if (ret) {
+		free(buf);
+		return ret;
+	}
+
+	if (verify)
+		printf("## Checking hash(es) for Image %s ... ",
+		       fit_get_name(fit, node, NULL));
+
+	for (i = 0; i < nr_sectors; i += count) {
+		ulong start, end;
+		void *piece;
+
+		count = min(chunk_sectors, nr_sectors - i);
+		piece = buf ? buf : (void *)load_ptr + i * unit;
+		if (info->read(info,
+			       sector + get_aligned_image_offset(info, offset) +
+			       i, count, piece) != count) {
+			ret = -EIO;
+			break;
+		}
+
+		/* Skip the alignment overhead before and after the data */
+		start = max((ulong)i * unit, (ulong)overhead);
+		end = min((ulong)(i + count) * unit,
+			  (ulong)(overhead + length));
+		if (start < end &&
+		    fit_stream_feed(&st, piece + start - i * unit, end - start))
+			break;
+	}
+
+	err = fit_stream_finish(&st, &size);
+	free(buf);
+	if (!ret && err == -EACCES)
+		return -EPERM;
+	if (ret || err) {
+		if (comp != IH_COMP_NONE)
+			puts("Uncompressing error\n");
+		return -EIO;
+	}
+	if (verify)
+		puts("OK\n");
+
+	debug("Streamed data: dst=%p, offset=%x, size=%lx\n", dst, offset,
+	      size);
+	*lengthp = size;
+
+	return 0;
+#else
+	return -EPROTONOSUPPORT;
+#endif
+}
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -184,8 +293,11 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	int nr_sectors;
 	int align_len = ARCH_DMA_MINALIGN - 1;
 	uint8_t image_comp = -1, type = -1;
+	int stream_comp = IH_COMP_NONE;
 	const void *data;
 	bool external_data = false;
+	bool streamed = false;
+	int ret;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
@@ -195,7 +307,8 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && (IS_ENABLED(CONFIG_SPL_GZIP) ||
+					       IS_ENABLED(CONFIG_SPL_ZSTD))) {
 		if (fit_image_get_comp(fit, node, &image_comp))
 			puts("Cannot get image compression format.\n");
 		else
@@ -223,10 +336,33 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
-		if (info->read(info,
-			       sector + get_aligned_image_offset(info, offset),
-			       nr_sectors, (void *)load_ptr) != nr_sectors)
-			return -EIO;
+		ret = -EPROTONOSUPPORT;
+		/*
+		 * Only gzip is streamed here. The lz4 and zstd stream decoders
+		 * allocate up to several MiB depending on the image, which
+		 * most SPL heaps cannot provide, and they would only find out
+		 * part way through. Such images are read whole and
+		 * decompressed below.
+		 */
+		if (CONFIG_IS_ENABLED(GZIP) && image_comp == IH_COMP_GZIP)
+			stream_comp = IH_COMP_GZIP;
+		if (IS_ENABLED(CONFIG_SPL_FIT_SIGNATURE) ||
+		    stream_comp != IH_COMP_NONE)
+			ret = spl_fit_stream_image(info, sector, fit, node,
+						   offset, length, stream_comp,
+						   load_ptr, load_addr,
+						   &length);
+		if (ret == -EPROTONOSUPPORT) {
+			if (info->read(info, sector +
+				       get_aligned_image_offset(info, offset),
+				       nr_sectors,
+				       (void *)load_ptr) != nr_sectors)
+				return -EIO;
+		} else if (ret) {
+			return ret;
+		} else {
+			streamed = true;
+		}
 
 		debug("External data: dst=%lx, offset=%x, size=%lx\n",
 		      load_ptr, offset, (unsigned long)length);
@@ -243,19 +379,23 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	}
 
 #ifdef CONFIG_SPL_FIT_SIGNATURE
-	printf("## Checking hash(es) for Image %s ... ",
-	       fit_get_name(fit, node, NULL));
-	if (!fit_image_verify_with_data(fit, node,
-					 src, length))
-		return -EPERM;
-	puts("OK\n");
+	if (!streamed) {
+		printf("## Checking hash(es) for Image %s ... ",
+		       fit_get_name(fit, node, NULL));
+		if (!fit_image_verify_with_data(fit, node,
+						 src, length))
+			return -EPERM;
+		puts("OK\n");
+	}
 #endif
 
 #ifdef CONFIG_SPL_FIT_IMAGE_POST_PROCESS
 	board_fit_image_post_process(&src, &length);
 #endif
 
-	if (IS_ENABLED(CONFIG_SPL_GZIP) && image_comp == IH_COMP_GZIP) {
+	if (streamed && stream_comp != IH_COMP_NONE) {
+		/* Already decompressed to load_addr */
+	} else if (IS_ENABLED(CONFIG_SPL_GZIP) && image_comp == IH_COMP_GZIP) {
 		size = length;
 		if (gunzip((void *)load_addr, CONFIG_SYS_BOOTM_LEN,
 			   src, &size)) {
@@ -263,6 +403,14 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return -EIO;
 		}
 		length = size;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && image_comp == IH_COMP_ZSTD) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		if (zstd_decompress(src, length, (void *)load_addr, &unc_len)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
 	} else {
 		memcpy((void *)load_addr, src, length);
 	}
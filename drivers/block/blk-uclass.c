@@ -7,6 +7,7 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -337,13 +338,30 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 int blk_select_hwpart(struct udevice *dev, int hwpart)
 {
 	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	bool change = hwpart != desc->hwpart;
+	int ret;
 
 	if (!ops)
 		return -ENOSYS;
 	if (!ops->select_hwpart)
 		return 0;
 
-	return ops->select_hwpart(dev, hwpart);
+	/*
+	 * The filesystems on another hardware partition are different, and
+	 * dirty cache lines must be written to the partition they came from
+	 */
+	if (change) {
+		fs_invalidate(desc);
+		ret = blkcache_flush(desc);
+		if (ret)
+			return ret;
+	}
+	ret = ops->select_hwpart(dev, hwpart);
+	if (!ret && change)
+		blkcache_invalidate(desc->if_type, desc->devnum);
+
+	return ret;
 }
 
 int blk_dselect_hwpart(struct blk_desc *desc, int hwpart)
@@ -431,20 +449,14 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
-	ulong blks_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+	if (CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return blkcache_dread(block_dev, start, blkcnt, buffer);
 
-	return blks_read;
+	return ops->read(dev, start, blkcnt, buffer);
 }
 
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
@@ -456,7 +468,10 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	fs_invalidate(block_dev);
+	if (CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return blkcache_dwrite(block_dev, start, blkcnt, buffer);
+
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -470,6 +485,7 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	fs_invalidate(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -649,9 +665,21 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	/* Write back and drop anything cached for this device */
+	blkcache_invalidate(desc->if_type, desc->devnum);
+	fs_invalidate(desc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
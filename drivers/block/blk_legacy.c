@@ -191,13 +191,25 @@ struct blk_desc *blk_get_devnum_by_type(enum if_type if_type, int devnum)
 int blk_dselect_hwpart(struct blk_desc *desc, int hwpart)
 {
 	struct blk_driver *drv = blk_driver_lookup_type(desc->if_type);
+	bool change = hwpart != desc->hwpart;
+	int ret;
 
 	if (!drv)
 		return -ENOSYS;
-	if (drv->select_hwpart)
-		return drv->select_hwpart(desc, hwpart);
+	if (!drv->select_hwpart)
+		return 0;
 
-	return 0;
+	/* Dirty cache lines must be written to the partition they came from */
+	if (change) {
+		ret = blkcache_flush(desc);
+		if (ret)
+			return ret;
+	}
+	ret = drv->select_hwpart(desc, hwpart);
+	if (!ret && change)
+		blkcache_invalidate(desc->if_type, desc->devnum);
+
+	return ret;
 }
 
 struct blk_desc *blk_get_devnum_by_typename(const char *if_typename, int devnum)
@@ -260,5 +272,5 @@ int blk_select_hwpart_devnum(enum if_type if_type, int devnum, int hwpart)
 	ret = get_desc(drv, devnum, &desc);
 	if (ret)
 		return ret;
-	return drv->select_hwpart(desc, hwpart);
+	return blk_dselect_hwpart(desc, hwpart);
 }
@@ -3,158 +3,564 @@
  * Copyright (C) Nelson Integration, LLC 2016
  * Author: Eric Nelson<eric@nelint.com>
  *
+ * Set-associative block cache. The cache is made of lines of a fixed number
+ * of consecutive blocks, aligned to the line size. A line is placed in one
+ * of the sets selected by hashing its device and block number, and may live
+ * in any of the ways of that set. Lines are replaced in LRU order within a
+ * set.
+ *
+ * Small reads are served from the cache and, when a device is read
+ * sequentially, the cache reads ahead of the requested range. Large reads
+ * bypass the cache so that streaming file data does not evict metadata.
+ *
+ * Writes are written through by default. In write-back mode small writes
+ * only update the cache and the dirty lines are written to the device by
+ * blkcache_flush(), on eviction or when the device is invalidated. All
+ * devices are flushed before a system reset or power-off and before bootm
+ * starts the OS.
  */
 #include <config.h>
 #include <common.h>
+#include <blk.h>
+#include <dm.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
 
-struct block_cache_node {
-	struct list_head lh;
+struct block_cache_line {
+	struct blk_desc *desc;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
-	char *cache;
+	lbaint_t start;
+	ulong age;
+	bool valid;
+	bool dirty;
+	char *data;
+	unsigned long size;
 };
 
-static LIST_HEAD(block_cache);
+struct block_cache_dev {
+	struct list_head lh;
+	struct block_cache_dev_stats stats;
+	lbaint_t next;		/* block following the last read */
+	unsigned int seq;	/* number of sequential reads in a row */
+};
+
+static struct block_cache_line *lines;
+static unsigned int num_sets;
+static ulong tick;
+static unsigned int dirty_lines;
+static void *scratch;
+static unsigned long scratch_size;
+static LIST_HEAD(block_cache_devs);
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_blocks_per_entry = CONFIG_BLOCK_CACHE_LINE_BLOCKS,
+	.max_entries = CONFIG_BLOCK_CACHE_SIZE * SZ_1M /
+		       (CONFIG_BLOCK_CACHE_LINE_BLOCKS * 512),
+	.ways = CONFIG_BLOCK_CACHE_WAYS,
+	.writeback = IS_ENABLED(CONFIG_BLOCK_CACHE_WRITEBACK),
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
-{
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
+static lbaint_t line_blocks(void)
+{
+	return _stats.max_blocks_per_entry;
+}
+
+static lbaint_t line_base(lbaint_t blk)
+{
+	return blk & ~(line_blocks() - 1);
+}
+
+static bool cache_enabled(void)
+{
+	return _stats.max_entries && _stats.max_blocks_per_entry;
+}
+
+static int cache_init(void)
+{
+	if (lines)
+		return 0;
+	num_sets = max(_stats.max_entries / _stats.ways, 1U);
+	lines = calloc(num_sets * _stats.ways, sizeof(*lines));
+	if (!lines)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static struct block_cache_dev *cache_dev(struct blk_desc *desc)
+{
+	struct block_cache_dev *cdev;
+
+	list_for_each_entry(cdev, &block_cache_devs, lh)
+		if (cdev->stats.iftype == desc->if_type &&
+		    cdev->stats.devnum == desc->devnum)
+			return cdev;
+
+	cdev = calloc(1, sizeof(*cdev));
+	if (!cdev)
+		return NULL;
+	cdev->stats.iftype = desc->if_type;
+	cdev->stats.devnum = desc->devnum;
+	list_add_tail(&cdev->lh, &block_cache_devs);
+
+	return cdev;
+}
+
+static struct block_cache_line *cache_set(int iftype, int devnum,
+					  lbaint_t start)
+{
+	u32 hash;
+
+	hash = (u32)(start / line_blocks()) ^ ((u32)devnum << 20) ^
+	       ((u32)iftype << 26);
+	hash ^= hash >> 16;
+
+	return &lines[(hash % num_sets) * _stats.ways];
+}
+
+static bool line_matches(struct block_cache_line *line,
+			 struct blk_desc *desc, lbaint_t start)
+{
+	return line->valid && line->start == start &&
+	       line->iftype == desc->if_type &&
+	       line->devnum == desc->devnum && line->blksz == desc->blksz;
+}
+
+static struct block_cache_line *cache_find(struct blk_desc *desc,
+					   lbaint_t start)
+{
+	struct block_cache_line *set;
+	int i;
+
+	set = cache_set(desc->if_type, desc->devnum, start);
+	for (i = 0; i < _stats.ways; i++) {
+		if (line_matches(&set[i], desc, start)) {
+			set[i].age = ++tick;
+			return &set[i];
 		}
+	}
+
+	return NULL;
+}
+
+/* Read blocks from the device itself, bypassing the cache */
+static ulong dev_read(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		      void *buffer)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	return blk_get_ops(desc->bdev)->read(desc->bdev, start, blkcnt, buffer);
+#else
+	return desc->block_read(desc, start, blkcnt, buffer);
+#endif
+}
+
+/* Write blocks to the device itself, bypassing the cache */
+static ulong dev_write(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		       const void *buffer)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	return blk_get_ops(desc->bdev)->write(desc->bdev, start, blkcnt,
+					      buffer);
+#else
+	return desc->block_write(desc, start, blkcnt, buffer);
+#endif
+}
+
+static int line_writeback(struct block_cache_line *line)
+{
+	ulong n;
+
+	if (!line->dirty)
+		return 0;
+	n = dev_write(line->desc, line->start, line_blocks(), line->data);
+	if (n != line_blocks())
+		return -EIO;
+	line->dirty = false;
+	dirty_lines--;
+	_stats.writebacks++;
+	debug("writeback: start " LBAF "\n", line->start);
+
 	return 0;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+/* Pick a line for @start, evicting the least-recently-used way if needed */
+static struct block_cache_line *cache_alloc(struct blk_desc *desc,
+					    lbaint_t start)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_line *set, *line = NULL;
+	unsigned long bytes = line_blocks() * desc->blksz;
+	int i;
+
+	set = cache_set(desc->if_type, desc->devnum, start);
+	for (i = 0; i < _stats.ways; i++) {
+		if (!set[i].valid) {
+			line = &set[i];
+			break;
+		}
+		if (!line || set[i].age < line->age)
+			line = &set[i];
+	}
+
+	if (line->valid) {
+		debug("drop: start " LBAF "\n", line->start);
+		if (line_writeback(line))
+			return NULL;
+		line->valid = false;
+		_stats.entries--;
+	}
+
+	if (line->size < bytes) {
+		free(line->data);
+		line->data = malloc_cache_aligned(bytes);
+		if (!line->data) {
+			line->size = 0;
+			return NULL;
+		}
+		line->size = bytes;
+	}
+
+	line->desc = desc;
+	line->iftype = desc->if_type;
+	line->devnum = desc->devnum;
+	line->blksz = desc->blksz;
+	line->start = start;
+	line->age = ++tick;
+	line->valid = true;
+	_stats.entries++;
+
+	return line;
+}
+
+static void *cache_scratch(unsigned long bytes)
+{
+	if (scratch_size < bytes) {
+		free(scratch);
+		scratch = malloc_cache_aligned(bytes);
+		scratch_size = scratch ? bytes : 0;
+	}
+
+	return scratch;
+}
+
+/*
+ * Read @count lines starting at @start from the device and install them in
+ * the cache. Lines that are already cached are not replaced, since they may
+ * be dirty.
+ */
+static int cache_fill_lines(struct blk_desc *desc, lbaint_t start,
+			    lbaint_t count)
+{
+	unsigned long bytes = line_blocks() * desc->blksz;
+	struct block_cache_line *line;
+	lbaint_t i;
+	char *buf;
+	ulong n;
+
+	buf = cache_scratch(count * bytes);
+	if (!buf)
+		return -ENOMEM;
+	n = dev_read(desc, start, count * line_blocks(), buf);
+	if (n != count * line_blocks())
+		return -EIO;
+
+	for (i = 0; i < count; i++) {
+		lbaint_t blk = start + i * line_blocks();
+
+		if (cache_find(desc, blk))
+			continue;
+		line = cache_alloc(desc, blk);
+		if (!line)
+			return -ENOMEM;
+		memcpy(line->data, buf + i * bytes, bytes);
 	}
+	debug("fill: start " LBAF ", count " LBAFU "\n", start,
+	      count * line_blocks());
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
 	return 0;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+/* Copy dirty cached data over a buffer that was read from the device */
+static void cache_overlay_dirty(struct blk_desc *desc, lbaint_t start,
+				lbaint_t blkcnt, char *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	lbaint_t blk, end = start + blkcnt;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	for (blk = line_base(start); blk < end; blk += line_blocks()) {
+		struct block_cache_line *line = cache_find(desc, blk);
+		lbaint_t from, to;
 
-	if (_stats.max_entries == 0)
-		return;
+		if (!line || !line->dirty)
+			continue;
+		from = max(blk, start);
+		to = min(blk + line_blocks(), end);
+		memcpy(buffer + (from - start) * desc->blksz,
+		       line->data + (from - blk) * desc->blksz,
+		       (to - from) * desc->blksz);
+	}
+}
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
+/* Update cached lines with data that was just written to the device */
+static void cache_update(struct blk_desc *desc, lbaint_t start,
+			 lbaint_t blkcnt, const char *buffer, bool ok)
+{
+	lbaint_t blk, end = start + blkcnt;
+
+	for (blk = line_base(start); blk < end; blk += line_blocks()) {
+		struct block_cache_line *line = cache_find(desc, blk);
+		lbaint_t from, to;
+
+		if (!line)
+			continue;
+		if (!ok) {
+			if (!line->dirty) {
+				line->valid = false;
+				_stats.entries--;
+			}
+			continue;
 		}
+		from = max(blk, start);
+		to = min(blk + line_blocks(), end);
+		memcpy(line->data + (from - blk) * desc->blksz,
+		       buffer + (from - start) * desc->blksz,
+		       (to - from) * desc->blksz);
+	}
+}
+
+static ulong cache_bypass_read(struct blk_desc *desc, lbaint_t start,
+			       lbaint_t blkcnt, void *buffer)
+{
+	ulong n;
+
+	n = dev_read(desc, start, blkcnt, buffer);
+	if (n == blkcnt && dirty_lines)
+		cache_overlay_dirty(desc, start, blkcnt, buffer);
+
+	return n;
+}
+
+ulong blkcache_dread(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		     void *buffer)
+{
+	lbaint_t blk, end = start + blkcnt, ra_end;
+	lbaint_t max_lines = CONFIG_BLOCK_CACHE_READAHEAD;
+	struct block_cache_dev *cdev;
+	char *dst = buffer;
+	bool hit = true;
+
+	if (!blkcnt)
+		return 0;
+	if (!cache_enabled() || cache_init())
+		return cache_bypass_read(desc, start, blkcnt, buffer);
+
+	cdev = cache_dev(desc);
+	if (!cdev)
+		return cache_bypass_read(desc, start, blkcnt, buffer);
+	if (start == cdev->next)
+		cdev->seq++;
+	else
+		cdev->seq = 0;
+	cdev->next = end;
+
+	/* Don't cache big stuff, nor the partial line at the end of a disk */
+	if (blkcnt > max_lines * line_blocks() ||
+	    line_base(end - 1) + line_blocks() > desc->lba) {
+		cdev->stats.bypass++;
+		return cache_bypass_read(desc, start, blkcnt, buffer);
+	}
+
+	/* Read ahead once the device is being read sequentially */
+	ra_end = line_base(end - 1) + line_blocks();
+	if (cdev->seq >= 2) {
+		ra_end += min_t(lbaint_t, cdev->seq - 1, max_lines) *
+			  line_blocks();
+		while (ra_end > desc->lba)
+			ra_end -= line_blocks();
+	}
+
+	for (blk = line_base(start); blk < end; blk += line_blocks()) {
+		struct block_cache_line *line = cache_find(desc, blk);
+		lbaint_t from, to;
+
+		if (!line) {
+			lbaint_t run = blk + line_blocks();
+
+			/* Read all missing lines up to the readahead limit */
+			while (run < ra_end && !cache_find(desc, run))
+				run += line_blocks();
+			if (run > line_base(end - 1) + line_blocks())
+				cdev->stats.readahead += run - line_base(end - 1) -
+							 line_blocks();
+			if (cache_fill_lines(desc, blk,
+					     (run - blk) / line_blocks()) ||
+			    !(line = cache_find(desc, blk))) {
+				return cache_bypass_read(desc, start, blkcnt,
+							 buffer);
+			}
+			hit = false;
+		}
+		from = max(blk, start);
+		to = min(blk + line_blocks(), end);
+		memcpy(dst + (from - start) * desc->blksz,
+		       line->data + (from - blk) * desc->blksz,
+		       (to - from) * desc->blksz);
+	}
+
+	if (hit) {
+		debug("hit: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+		++_stats.hits;
+		++cdev->stats.hits;
 	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		debug("miss: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+		++_stats.misses;
+		++cdev->stats.misses;
 	}
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
+	return blkcnt;
+}
+
+ulong blkcache_dwrite(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		      const void *buffer)
+{
+	lbaint_t blk, end = start + blkcnt;
+	const char *src = buffer;
+	ulong n;
+
+	if (!blkcnt)
+		return 0;
+	if (!cache_enabled() || cache_init()) {
+		return dev_write(desc, start, blkcnt, buffer);
+	} else if (!_stats.writeback ||
+		   blkcnt > CONFIG_BLOCK_CACHE_READAHEAD * line_blocks() ||
+		   line_base(end - 1) + line_blocks() > desc->lba) {
+		n = dev_write(desc, start, blkcnt, buffer);
+		cache_update(desc, start, blkcnt, buffer, n == blkcnt);
+		return n;
+	}
+
+	for (blk = line_base(start); blk < end; blk += line_blocks()) {
+		struct block_cache_line *line = cache_find(desc, blk);
+		lbaint_t from = max(blk, start);
+		lbaint_t to = min(blk + line_blocks(), end);
+
+		if (!line) {
+			if (from == blk && to == blk + line_blocks())
+				line = cache_alloc(desc, blk);
+			else if (!cache_fill_lines(desc, blk, 1))
+				line = cache_find(desc, blk);
+		}
+		if (!line) {
+			n = dev_write(desc, from, to - from,
+				      src + (from - start) * desc->blksz);
+			if (n != to - from)
+				return from - start + n;
+			continue;
+		}
+		memcpy(line->data + (from - blk) * desc->blksz,
+		       src + (from - start) * desc->blksz,
+		       (to - from) * desc->blksz);
+		if (!line->dirty) {
+			line->dirty = true;
+			dirty_lines++;
 		}
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	return blkcnt;
+}
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+int blkcache_flush(struct blk_desc *desc)
+{
+	int i, ret = 0;
+
+	if (!lines || !dirty_lines)
+		return 0;
+
+	for (i = 0; i < num_sets * _stats.ways; i++) {
+		struct block_cache_line *line = &lines[i];
+
+		if (!line->valid || !line->dirty)
+			continue;
+		if (desc && (line->iftype != desc->if_type ||
+			     line->devnum != desc->devnum))
+			continue;
+		if (line_writeback(line)) {
+			printf("blkcache: write-back of block " LBAF
+			       " failed\n", line->start);
+			ret = -EIO;
+		}
+	}
+
+	return ret;
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	struct block_cache_dev *cdev;
+	int i;
+
+	list_for_each_entry(cdev, &block_cache_devs, lh) {
+		if (cdev->stats.iftype == iftype &&
+		    cdev->stats.devnum == devnum) {
+			cdev->next = 0;
+			cdev->seq = 0;
 		}
 	}
+
+	if (!lines)
+		return;
+
+	for (i = 0; i < num_sets * _stats.ways; i++) {
+		struct block_cache_line *line = &lines[i];
+
+		if (!line->valid || line->iftype != iftype ||
+		    line->devnum != devnum)
+			continue;
+		if (line->dirty && line_writeback(line)) {
+			printf("blkcache: write-back of block " LBAF
+			       " failed\n", line->start);
+			line->dirty = false;
+			dirty_lines--;
+		}
+		line->valid = false;
+		--_stats.entries;
+	}
+}
+
+static void cache_free(void)
+{
+	int i;
+
+	if (!lines)
+		return;
+	blkcache_flush(NULL);
+	for (i = 0; i < num_sets * _stats.ways; i++)
+		free(lines[i].data);
+	free(lines);
+	lines = NULL;
+	free(scratch);
+	scratch = NULL;
+	scratch_size = 0;
+	dirty_lines = 0;
+	_stats.entries = 0;
 }
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
+	struct block_cache_dev *cdev;
+
+	if (blocks && !is_power_of_2(blocks))
+		blocks = roundup_pow_of_two(blocks);
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
-		}
-		_stats.entries = 0;
+		cache_free();
 	}
 
 	_stats.max_blocks_per_entry = blocks;
@@ -162,11 +568,48 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	list_for_each_entry(cdev, &block_cache_devs, lh) {
+		cdev->stats.hits = 0;
+		cdev->stats.misses = 0;
+		cdev->stats.readahead = 0;
+		cdev->stats.bypass = 0;
+	}
+}
+
+int blkcache_set_writeback(bool enable)
+{
+	int ret = 0;
+
+	if (!enable)
+		ret = blkcache_flush(NULL);
+	_stats.writeback = enable;
+
+	return ret;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
+	stats->dirty = dirty_lines;
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.writebacks = 0;
+}
+
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *cdev;
+
+	list_for_each_entry(cdev, &block_cache_devs, lh) {
+		if (index--)
+			continue;
+		memcpy(stats, &cdev->stats, sizeof(*stats));
+		cdev->stats.hits = 0;
+		cdev->stats.misses = 0;
+		cdev->stats.readahead = 0;
+		cdev->stats.bypass = 0;
+		return 0;
+	}
+
+	return -ENOENT;
 }
@@ -10,6 +10,8 @@
 #include <dm/util.h>
 #include <dm/uclass-internal.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
 	int i, is_last;
@@ -96,3 +98,27 @@ void dm_dump_uclass(void)
 		puts("\n");
 	}
 }
+
+#if CONFIG_IS_ENABLED(DM_STATS)
+static void dm_display_stat(const char *name, ulong find, ulong walk)
+{
+	printf("%-8s %10lu %10lu", name, find, walk);
+	if (find)
+		printf(" %8lu.%lu", walk / find, walk * 10 / find % 10);
+	puts("\n");
+}
+
+void dm_dump_stats(void)
+{
+	struct dm_stats *stats = gd->dm_stats;
+
+	if (!stats)
+		return;
+	printf("Maps %s\n", CONFIG_IS_ENABLED(DM_UCLASS_MAPS) ?
+	       "enabled" : "disabled");
+	printf("Lookup        Count   Compared  Average\n");
+	dm_display_stat("uclass", stats->uclass_find, stats->uclass_walk);
+	dm_display_stat("seq", stats->seq_find, stats->seq_walk);
+	dm_display_stat("ofnode", stats->ofnode_find, stats->ofnode_walk);
+}
+#endif
@@ -9,7 +9,9 @@
 #define LOG_CATEGORY LOGC_DM
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
+#include <malloc.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -18,6 +20,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -124,11 +129,198 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct dm_compat_slot - one entry of the compatible-string hash table
+ *
+ * Entries refer to drivers by their position in the linker list rather than
+ * by pointer, so they stay the same when U-Boot relocates itself.
+ *
+ * @hash:	Hash of the compatible string
+ * @drv:	Index of the driver in the driver list plus one, 0 if unused
+ * @id:		Index of the compatible string in the driver's of_match table
+ */
+struct dm_compat_slot {
+	u32 hash;
+	u16 drv;
+	u16 id;
+};
+
+/**
+ * struct dm_compat_index - hash table of all drivers' compatible strings
+ *
+ * @full_malloc: true if allocated with the full malloc(). An index built
+ *		before that is in the pre-relocation malloc() area, so it is
+ *		built again once the full malloc() is ready. initr_dm() drops
+ *		the pointer on relocation, since that area is abandoned.
+ * @size:	Number of slots, a power of two. If 0 there was not enough
+ *		memory for the table, and drivers are searched linearly.
+ * @slot:	Open-addressed slots, probed linearly
+ */
+struct dm_compat_index {
+	bool full_malloc;
+	uint size;
+	struct dm_compat_slot slot[];
+};
+
+static u32 lists_compat_hash(const char *str)
+{
+	u32 hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*str) {
+		hash ^= (u8)*str++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/* Get the driver and of_match entry which a slot refers to */
+static const struct udevice_id *
+lists_compat_slot_id(const struct dm_compat_slot *slot, struct driver **drvp)
+{
+	ulong base = (ulong)ll_entry_start(struct driver, driver);
+	struct driver *drv;
+
+	drv = (struct driver *)base + slot->drv - 1;
+	*drvp = drv;
+
+	return drv->of_match + slot->id;
+}
+
+static struct dm_compat_index *lists_compat_index_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id;
+	struct dm_compat_index *idx;
+	struct dm_compat_slot *slot;
+	struct driver *entry, *drv;
+	uint count = 0, size, i;
+	u32 hash;
+
+	if (n_ents >= U16_MAX)
+		return NULL;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+
+	/* Keep the table at most 3/4 full so that probe chains stay short */
+	size = roundup_pow_of_two(max(count * 4 / 3 + 1, 16U));
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	/*
+	 * Leave at least half of the pre-relocation malloc() area to the
+	 * devices. If the table does not fit, record an empty index so that
+	 * drivers are searched linearly without trying again.
+	 */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    size * sizeof(*slot) > (gd->malloc_limit - gd->malloc_ptr) / 2)
+		size = 0;
+#endif
+	idx = calloc(1, sizeof(*idx) + size * sizeof(*slot));
+	if (!idx)
+		return NULL;
+	idx->full_malloc = gd->flags & GD_FLG_FULL_MALLOC_INIT;
+	idx->size = size;
+	if (!size)
+		return idx;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			hash = lists_compat_hash(of_match->compatible);
+			for (i = hash & (size - 1); idx->slot[i].drv;
+			     i = (i + 1) & (size - 1)) {
+				slot = &idx->slot[i];
+				if (slot->hash != hash)
+					continue;
+				/* The first driver in the list wins */
+				id = lists_compat_slot_id(slot, &drv);
+				if (!strcmp(id->compatible,
+					    of_match->compatible))
+					break;
+			}
+			slot = &idx->slot[i];
+			if (slot->drv)
+				continue;
+			slot->hash = hash;
+			slot->drv = entry - driver + 1;
+			slot->id = of_match - entry->of_match;
+		}
+	}
+	log_debug("%u compatible strings, %u slots\n", count, size);
+
+	return idx;
+}
+
+static struct dm_compat_index *lists_compat_index(void)
+{
+	struct dm_compat_index *idx = gd->dm_compat_index;
+
+	if (idx && idx->full_malloc == !!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return idx;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_INDEX, "dm_index");
+	idx = lists_compat_index_build();
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_INDEX);
+	gd->dm_compat_index = idx;
+
+	return idx;
+}
+
+void lists_compat_index_free(void)
+{
+	struct dm_compat_index *idx = gd->dm_compat_index;
+
+	if (idx && idx->full_malloc &&
+	    (gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		free(idx);
+	gd->dm_compat_index = NULL;
+}
+#endif /* DM_COMPAT_INDEX */
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	struct dm_compat_index *idx = lists_compat_index();
+
+	if (idx && idx->size) {
+		const struct udevice_id *of_match;
+		u32 hash = lists_compat_hash(compat);
+		uint mask = idx->size - 1;
+		uint i;
+
+		for (i = hash & mask; idx->slot[i].drv; i = (i + 1) & mask) {
+			if (idx->slot[i].hash != hash)
+				continue;
+			of_match = lists_compat_slot_id(&idx->slot[i], &entry);
+			if (!strcmp(of_match->compatible, compat)) {
+				*of_idp = of_match;
+				return entry;
+			}
+		}
+
+		return NULL;
+	}
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -165,13 +357,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		log_debug("   - attempt to match compatible string '%s'\n",
 			  compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compat(compat, &id);
+		if (!entry)
 			continue;
 
 		if (pre_reloc_only) {
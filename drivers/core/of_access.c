@@ -20,11 +20,13 @@
  */
 
 #include <common.h>
+#include <malloc.h>
 #include <linux/libfdt.h>
 #include <dm/of_access.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -43,6 +45,19 @@ static struct device_node *of_stdout;
 /* pointer to options given after the alias (separated by :) or NULL if none */
 static const char *of_stdout_options;
 
+/*
+ * phandle -> node cache, indexed by the phandle masked with phandle_cache_mask.
+ * It is filled by of_populate_phandle_cache() and on each miss.
+ */
+static struct device_node **phandle_cache;
+static u32 phandle_cache_mask;
+
+/* root of the tree that phandle_cache refers to */
+static struct device_node *phandle_cache_root;
+
+/* number of nodes visited by phandle lookups that missed the cache */
+static ulong phandle_walk_count;
+
 /**
  * struct alias_prop - Alias property in 'aliases' node
  *
@@ -437,19 +452,69 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 
 struct device_node *of_find_node_by_phandle(phandle handle)
 {
+	struct device_node **slot = NULL;
 	struct device_node *np;
 
 	if (!handle)
 		return NULL;
 
-	for_each_of_allnodes(np)
+	if (phandle_cache && phandle_cache_root == gd->of_root) {
+		slot = &phandle_cache[handle & phandle_cache_mask];
+		if (*slot && (*slot)->phandle == handle)
+			return of_node_get(*slot);
+	}
+
+	for_each_of_allnodes(np) {
+		phandle_walk_count++;
 		if (np->phandle == handle)
 			break;
+	}
+	if (np && slot)
+		*slot = np;
 	(void)of_node_get(np);
 
 	return np;
 }
 
+void of_free_phandle_cache(void)
+{
+	free(phandle_cache);
+	phandle_cache = NULL;
+	phandle_cache_root = NULL;
+}
+
+int of_populate_phandle_cache(void)
+{
+	struct device_node *np;
+	u32 count = 0;
+
+	of_free_phandle_cache();
+	for_each_of_allnodes(np)
+		if (np->phandle)
+			count++;
+	if (!count)
+		return 0;
+
+	/* dtc numbers phandles from 1, so these should not collide */
+	count = roundup_pow_of_two(count);
+	phandle_cache = calloc(count, sizeof(*phandle_cache));
+	if (!phandle_cache)
+		return -ENOMEM;
+	phandle_cache_mask = count - 1;
+	phandle_cache_root = gd->of_root;
+
+	for_each_of_allnodes(np)
+		if (np->phandle)
+			phandle_cache[np->phandle & phandle_cache_mask] = np;
+
+	return 0;
+}
+
+ulong of_phandle_walk_count(void)
+{
+	return phandle_walk_count;
+}
+
 /**
  * of_find_property_value_of_size() - find property of given size
  *
@@ -129,6 +129,26 @@ void fix_devices(void)
 
 #endif
 
+/* Set up the uclass array and lookup counts, clearing any left over */
+static void dm_init_lookup(void)
+{
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	size_t size = UCLASS_COUNT * sizeof(struct uclass *);
+
+	/* If this fails, uclass_find() walks the list of uclasses instead */
+	if (gd->uclass_by_id)
+		memset(gd->uclass_by_id, '\0', size);
+	else
+		gd->uclass_by_id = calloc(1, size);
+#endif
+#if CONFIG_IS_ENABLED(DM_STATS)
+	if (gd->dm_stats)
+		memset(gd->dm_stats, '\0', sizeof(*gd->dm_stats));
+	else
+		gd->dm_stats = calloc(1, sizeof(*gd->dm_stats));
+#endif
+}
+
 int dm_init(bool of_live)
 {
 	int ret;
@@ -138,6 +158,7 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	dm_init_lookup();
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -151,10 +172,10 @@ int dm_init(bool of_live)
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 # if CONFIG_IS_ENABLED(OF_LIVE)
 	if (of_live)
-		DM_ROOT_NON_CONST->node = np_to_ofnode(gd->of_root);
+		dev_set_ofnode(DM_ROOT_NON_CONST, np_to_ofnode(gd->of_root));
 	else
 #endif
-		DM_ROOT_NON_CONST->node = offset_to_ofnode(0);
+		dev_set_ofnode(DM_ROOT_NON_CONST, offset_to_ofnode(0));
 #endif
 	ret = device_probe(DM_ROOT_NON_CONST);
 	if (ret)
@@ -168,6 +189,11 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+	lists_compat_index_free();
+	free(gd->uclass_by_id);
+	gd->uclass_by_id = NULL;
+	free(gd->dm_stats);
+	gd->dm_stats = NULL;
 
 	return 0;
 }
@@ -21,18 +21,93 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Count a lookup or comparison, see struct dm_stats */
+#if CONFIG_IS_ENABLED(DM_STATS)
+#define dm_stats_inc(_field)				\
+	do {						\
+		if (gd->dm_stats)			\
+			gd->dm_stats->_field++;		\
+	} while (0)
+#else
+#define dm_stats_inc(_field)	do { } while (0)
+#endif
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+static struct hlist_head *uclass_seq_bucket(struct uclass *uc, int seq)
+{
+	return &uc->seq_map[seq & (DM_UCLASS_MAP_SIZE - 1)];
+}
+
+static struct hlist_head *uclass_node_bucket(struct uclass *uc, ofnode node)
+{
+	/* Offsets and pointers are aligned, so take the top bits of a hash */
+	u32 hash = (u32)node.of_offset * 0x9e3779b9;
+
+	return &uc->node_map[hash >> (32 - DM_UCLASS_MAP_BITS)];
+}
+
+/* Add to the end of a bucket so that lookups find devices in uclass order */
+static void uclass_map_add(struct hlist_node *n, struct hlist_head *head)
+{
+	struct hlist_node *last = head->first;
+
+	if (!last) {
+		hlist_add_head(n, head);
+		return;
+	}
+	while (last->next)
+		last = last->next;
+	hlist_add_after(last, n);
+}
+
+static void uclass_map_ofnode(struct udevice *dev)
+{
+	if (ofnode_valid(dev->node))
+		uclass_map_add(&dev->node_hnode,
+			       uclass_node_bucket(dev->uclass, dev->node));
+}
+
+static void uclass_unmap_device(struct udevice *dev)
+{
+	hlist_del_init(&dev->seq_hnode);
+	hlist_del_init(&dev->node_hnode);
+}
+
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+	hlist_del_init(&dev->seq_hnode);
+	dev->seq = seq;
+	if (seq != -1)
+		uclass_map_add(&dev->seq_hnode,
+			       uclass_seq_bucket(dev->uclass, seq));
+}
+
+void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	hlist_del_init(&dev->node_hnode);
+	dev->node = node;
+	uclass_map_ofnode(dev);
+}
+#else
+static inline void uclass_map_ofnode(struct udevice *dev) {}
+static inline void uclass_unmap_device(struct udevice *dev) {}
+#endif
+
 struct uclass *uclass_find(enum uclass_id key)
 {
 	struct uclass *uc;
 
 	if (!gd->dm_root)
 		return NULL;
-	/*
-	 * TODO(sjg@chromium.org): Optimise this, perhaps moving the found
-	 * node to the start of the list, or creating a linear array mapping
-	 * id to node.
-	 */
+	dm_stats_inc(uclass_find);
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	if (gd->uclass_by_id && (uint)key < UCLASS_COUNT) {
+		dm_stats_inc(uclass_walk);
+		return gd->uclass_by_id[key];
+	}
+#endif
 	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		dm_stats_inc(uclass_walk);
 		if (uc->uc_drv->id == key)
 			return uc;
 	}
@@ -81,6 +156,10 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	if (gd->uclass_by_id)
+		gd->uclass_by_id[id] = uc;
+#endif
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -97,6 +176,10 @@ fail:
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	if (gd->uclass_by_id)
+		gd->uclass_by_id[id] = NULL;
+#endif
 fail_mem:
 	free(uc);
 
@@ -130,6 +213,10 @@ int uclass_destroy(struct uclass *uc)
 	if (uc_drv->destroy)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	if (gd->uclass_by_id && gd->uclass_by_id[uc_drv->id] == uc)
+		gd->uclass_by_id[uc_drv->id] = NULL;
+#endif
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
 	free(uc);
@@ -312,7 +399,29 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	dm_stats_inc(seq_find);
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	/* req_seq can be changed at any time, so only seq is mapped */
+	if (!find_req_seq) {
+		struct hlist_node *pos;
+
+		hlist_for_each_entry(dev, pos,
+				     uclass_seq_bucket(uc, seq_or_req_seq),
+				     seq_hnode) {
+			dm_stats_inc(seq_walk);
+			if (dev->seq == seq_or_req_seq) {
+				*devp = dev;
+				log_debug("   - found '%s'\n", dev->name);
+				return 0;
+			}
+		}
+		log_debug("   - not found\n");
+
+		return -ENODEV;
+	}
+#endif
 	uclass_foreach_dev(dev, uc) {
+		dm_stats_inc(seq_walk);
 		log_debug("   - %d %d '%s'\n",
 			  dev->req_seq, dev->seq, dev->name);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -330,30 +439,20 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 				    struct udevice **devp)
 {
-	struct uclass *uc;
-	struct udevice *dev;
-	int ret;
-
 	*devp = NULL;
-	if (node < 0)
+	/* Devices do not have a flat-tree offset when the live tree is used */
+	if (node < 0 || of_live_active())
 		return -ENODEV;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
 
-	uclass_foreach_dev(dev, uc) {
-		if (dev_of_offset(dev) == node) {
-			*devp = dev;
-			return 0;
-		}
-	}
-
-	return -ENODEV;
+	return uclass_find_device_by_ofnode(id, offset_to_ofnode(node), devp);
 }
 
 int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 				 struct udevice **devp)
 {
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	struct hlist_node *pos;
+#endif
 	struct uclass *uc;
 	struct udevice *dev;
 	int ret;
@@ -366,7 +465,14 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	dm_stats_inc(ofnode_find);
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	hlist_for_each_entry(dev, pos, uclass_node_bucket(uc, node),
+			     node_hnode) {
+#else
 	uclass_foreach_dev(dev, uc) {
+#endif
+		dm_stats_inc(ofnode_walk);
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
 		if (ofnode_equal(dev_ofnode(dev), node)) {
@@ -386,31 +492,16 @@ done:
 int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 				  const char *name, struct udevice **devp)
 {
-	struct udevice *dev;
-	struct uclass *uc;
 	int find_phandle;
-	int ret;
 
 	*devp = NULL;
 	find_phandle = dev_read_u32_default(parent, name, -1);
 	if (find_phandle <= 0)
 		return -ENOENT;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
-
-	uclass_foreach_dev(dev, uc) {
-		uint phandle;
 
-		phandle = dev_read_phandle(dev);
-
-		if (phandle == find_phandle) {
-			*devp = dev;
-			return 0;
-		}
-	}
-
-	return -ENODEV;
+	return uclass_find_device_by_ofnode(id,
+					    ofnode_get_by_phandle(find_phandle),
+					    devp);
 }
 #endif
 
@@ -518,26 +609,14 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 				    struct udevice **devp)
 {
 	struct udevice *dev;
-	struct uclass *uc;
 	int ret;
 
 	*devp = NULL;
-	ret = uclass_get(id, &uc);
-	if (ret)
-		return ret;
-
-	uclass_foreach_dev(dev, uc) {
-		uint phandle;
-
-		phandle = dev_read_phandle(dev);
-
-		if (phandle == phandle_id) {
-			*devp = dev;
-			return uclass_get_device_tail(dev, ret, devp);
-		}
-	}
+	ret = uclass_find_device_by_ofnode(id,
+					   ofnode_get_by_phandle(phandle_id),
+					   &dev);
 
-	return -ENODEV;
+	return uclass_get_device_tail(dev, ret, devp);
 }
 
 int uclass_get_device_by_phandle(enum uclass_id id, struct udevice *parent,
@@ -636,6 +715,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_map_ofnode(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -651,6 +731,7 @@ int uclass_bind_device(struct udevice *dev)
 err:
 	/* There is no need to undo the parent's post_bind call */
 	list_del(&dev->uclass_node);
+	uclass_unmap_device(dev);
 
 	return ret;
 }
@@ -669,6 +750,7 @@ int uclass_unbind_device(struct udevice *dev)
 	}
 
 	list_del(&dev->uclass_node);
+	uclass_unmap_device(dev);
 	return 0;
 }
 #endif
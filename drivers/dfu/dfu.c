@@ -7,6 +7,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <env.h>
 #include <errno.h>
 #include <malloc.h>
@@ -153,8 +154,29 @@ static unsigned char *dfu_buf;
 static unsigned long dfu_buf_size;
 static enum dfu_device_type dfu_buf_device_type;
 
+/*
+ * Write ring: slot 0 is dfu_buf, the other slots are allocated on first use.
+ * Filled slots are queued in order from dfu_wbuf_head and written to the
+ * medium by dfu_write_poll(), or by dfu_write() once no free slot is left.
+ * The slot being filled is always the one after the last queued slot.
+ */
+static unsigned char *dfu_wbuf[CONFIG_DFU_WRITE_BUFFERS];
+static long dfu_wbuf_len[CONFIG_DFU_WRITE_BUFFERS];
+static int dfu_wbuf_head;
+static int dfu_wbuf_count;
+static int dfu_wbuf_err;
+static struct dfu_entity *dfu_wbuf_dfu;
+
 unsigned char *dfu_free_buf(void)
 {
+	int i;
+
+	for (i = 1; i < CONFIG_DFU_WRITE_BUFFERS; i++) {
+		free(dfu_wbuf[i]);
+		dfu_wbuf[i] = NULL;
+	}
+	dfu_wbuf[0] = NULL;
+
 	free(dfu_buf);
 	dfu_buf = NULL;
 	return dfu_buf;
@@ -192,9 +214,19 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 		       __func__, dfu_buf_size);
 
 	dfu_buf_device_type = dfu->dev_type;
+	dfu_wbuf[0] = dfu_buf;
 	return dfu_buf;
 }
 
+static unsigned char *dfu_get_wbuf(int slot)
+{
+	if (!dfu_wbuf[slot])
+		dfu_wbuf[slot] = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					  dfu_buf_size);
+
+	return dfu_wbuf[slot];
+}
+
 static char *dfu_get_hash_algo(void)
 {
 	char *s;
@@ -212,6 +244,26 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static int dfu_write_buffer(struct dfu_entity *dfu, void *buf, long w_size)
+{
+	int ret;
+
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   buf, w_size, 0);
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &w_size);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
+
+	/* update offset */
+	dfu->offset += w_size;
+
+	puts("#");
+
+	return ret;
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
@@ -222,23 +274,103 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
-
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	ret = dfu_write_buffer(dfu, dfu->i_buf_start, w_size);
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
 
-	/* update offset */
-	dfu->offset += w_size;
+	return ret;
+}
 
-	puts("#");
+int dfu_write_poll(void)
+{
+	int slot = dfu_wbuf_head;
 
-	return ret;
+	if (!dfu_wbuf_count || dfu_wbuf_err)
+		return dfu_wbuf_err;
+
+	dfu_wbuf_err = dfu_write_buffer(dfu_wbuf_dfu, dfu_wbuf[slot],
+					dfu_wbuf_len[slot]);
+	dfu_wbuf_head = (slot + 1) % CONFIG_DFU_WRITE_BUFFERS;
+	dfu_wbuf_count--;
+
+	return dfu_wbuf_err;
+}
+
+static int dfu_write_ring_drain(void)
+{
+	while (dfu_wbuf_count && !dfu_write_poll())
+		;
+
+	return dfu_wbuf_err;
+}
+
+static bool dfu_write_ring_busy(void *buf)
+{
+	int i, slot;
+
+	for (i = 0; i < dfu_wbuf_count; i++) {
+		slot = (dfu_wbuf_head + i) % CONFIG_DFU_WRITE_BUFFERS;
+		if (buf >= (void *)dfu_wbuf[slot] &&
+		    buf < (void *)dfu_wbuf[slot] + dfu_buf_size)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Queue the buffer being filled for writing and move on to the next free
+ * slot. The oldest queued buffer is only written here when the ring is full;
+ * otherwise that is left to dfu_write_poll().
+ */
+static int dfu_write_buffer_queue(struct dfu_entity *dfu)
+{
+	unsigned char *buf;
+	int slot, ret;
+
+	if (CONFIG_DFU_WRITE_BUFFERS == 1)
+		return dfu_write_buffer_drain(dfu);
+
+	if (dfu->i_buf == dfu->i_buf_start)
+		return 0;
+
+	slot = (dfu_wbuf_head + dfu_wbuf_count) % CONFIG_DFU_WRITE_BUFFERS;
+	dfu_wbuf_len[slot] = dfu->i_buf - dfu->i_buf_start;
+	dfu_wbuf_dfu = dfu;
+	dfu_wbuf_count++;
+
+	if (dfu_wbuf_count == CONFIG_DFU_WRITE_BUFFERS) {
+		ret = dfu_write_poll();
+		if (ret)
+			return ret;
+	}
+
+	slot = (slot + 1) % CONFIG_DFU_WRITE_BUFFERS;
+	buf = dfu_get_wbuf(slot);
+	if (!buf) {
+		/* Out of memory: carry on with the slots we already have */
+		debug("%s: Could not allocate slot %d\n", __func__, slot);
+		ret = dfu_write_ring_drain();
+		if (ret)
+			return ret;
+		dfu_wbuf_head = 0;
+		buf = dfu_wbuf[0];
+	}
+
+	dfu->i_buf_start = buf;
+	dfu->i_buf = buf;
+	dfu->i_buf_end = buf + dfu_buf_size;
+
+	return 0;
+}
+
+static void dfu_show_throughput(struct dfu_entity *dfu)
+{
+	ulong ms = max(get_timer(dfu->start_time), 1UL);
+
+	printf("\nDFU %s: %llu bytes in %lu ms (%llu KiB/s)\n", dfu->name,
+	       dfu->offset, ms, lldiv(dfu->offset * 1000, ms) / 1024);
 }
 
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
@@ -255,6 +387,10 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->bad_skip = 0;
 
 	dfu->inited = 0;
+
+	dfu_wbuf_head = 0;
+	dfu_wbuf_count = 0;
+	dfu_wbuf_err = 0;
 }
 
 int dfu_transaction_initiate(struct dfu_entity *dfu, bool read)
@@ -278,6 +414,7 @@ int dfu_transaction_initiate(struct dfu_entity *dfu, bool read)
 		debug("%s: %s %lld [B]\n", __func__, dfu->name, dfu->r_left);
 	}
 
+	dfu->start_time = get_timer(0);
 	dfu->inited = 1;
 	dfu_initiated_callback(dfu);
 
@@ -288,6 +425,10 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 {
 	int ret = 0;
 
+	ret = dfu_write_ring_drain();
+	if (ret)
+		return ret;
+
 	ret = dfu_write_buffer_drain(dfu);
 	if (ret)
 		return ret;
@@ -295,6 +436,9 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	if (dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
 
+	if (dfu->inited)
+		dfu_show_throughput(dfu);
+
 	if (dfu_hash_algo)
 		printf("\nDFU complete %s: 0x%08x\n", dfu_hash_algo->name,
 		       dfu->crc);
@@ -325,6 +469,13 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		return -1;
 	}
 
+	/* a queued buffer failed to write in the background */
+	if (dfu_wbuf_err) {
+		ret = dfu_wbuf_err;
+		dfu_transaction_cleanup(dfu);
+		return ret;
+	}
+
 	/* DFU 1.1 standard says:
 	 * The wBlockNum field is a block sequence number. It increments each
 	 * time a block is transferred, wrapping to zero from 65,535. It is used
@@ -343,7 +494,7 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_queue(dfu);
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			return ret;
@@ -363,7 +514,19 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 
 	/* if end or if buffer full flush */
 	if (size == 0 || (dfu->i_buf + size) > dfu->i_buf_end) {
-		ret = dfu_write_buffer_drain(dfu);
+		ret = dfu_write_buffer_queue(dfu);
+		if (ret) {
+			dfu_transaction_cleanup(dfu);
+			return ret;
+		}
+	}
+
+	/*
+	 * Some callers (e.g. thor) receive straight into dfu_get_buf(), so
+	 * that buffer must be written out before they fill it again.
+	 */
+	if (dfu_write_ring_busy(buf)) {
+		ret = dfu_write_ring_drain();
 		if (ret) {
 			dfu_transaction_cleanup(dfu);
 			return ret;
@@ -97,6 +97,31 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	if (fastboot_progress_callback)
+		fastboot_progress_callback("erasing");
+
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+
+/**
+ * fb_mmc_erases_to_zero() - Check whether erased blocks read back as zero
+ *
+ * @mmc: MMC device
+ * @return true if erased blocks read as zero, false if they read as 0xff
+ */
+static bool fb_mmc_erases_to_zero(struct mmc *mmc)
+{
+	if (IS_SD(mmc))
+		return !(mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE);
+
+	return mmc->ext_csd && !mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT];
+}
+
 static void write_raw_image(struct blk_desc *dev_desc, disk_partition_t *info,
 		const char *part_name, void *buffer,
 		u32 download_bytes, char *response)
@@ -499,15 +524,22 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
 		struct sparse_storage sparse;
+		struct mmc *mmc;
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
+		mmc = find_mmc_device(CONFIG_FASTBOOT_FLASH_MMC_DEV);
 
 		sparse.blksz = info.blksz;
 		sparse.start = info.start;
 		sparse.size = info.size;
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
+		sparse.erase = NULL;
+		if (mmc && fb_mmc_erases_to_zero(mmc)) {
+			sparse.erase = fb_mmc_sparse_erase;
+			sparse.erase_grp = mmc->erase_grp_size;
+		}
 		sparse.mssg = fastboot_fail;
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
@@ -12,6 +12,7 @@
 #include <dm.h>
 #include <dm/device-internal.h>
 #include <errno.h>
+#include <fs.h>
 #include <mmc.h>
 #include <part.h>
 #include <power/regulator.h>
@@ -2603,6 +2604,9 @@ static int mmc_startup(struct mmc *mmc)
 	bdesc->revision[0] = 0;
 #endif
 
+	/* This may be a different card, so forget its filesystem */
+	fs_invalidate(bdesc);
+
 #if !defined(CONFIG_DM_MMC) && (!defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBDISK_SUPPORT))
 	part_init(bdesc);
 #endif
@@ -68,6 +68,14 @@ static const char *sandbox_sf_state_name(enum sandbox_sf_state state)
 /* Used to quickly bulk erase backing store */
 static u8 sandbox_sf_0xff[0x1000];
 
+/*
+ * Model of the time an erase command takes: a fixed time plus a time for each
+ * KiB erased. This is roughly what datasheets give for 4KiB, 32KiB and 64KiB
+ * erase, so large erase commands are much faster per byte than small ones.
+ */
+#define SF_ERASE_TIME_US	30000
+#define SF_ERASE_TIME_KIB_US	2000
+
 /* Internal state data for each SPI flash */
 struct sandbox_spi_flash {
 	unsigned int cs;	/* Chip select we are attached to */
@@ -95,6 +103,9 @@ struct sandbox_spi_flash {
 	const struct flash_info *data;
 	/* The file on disk to serv up data from */
 	int fd;
+	/* Number of erase commands done, and their time in the model above */
+	uint erase_count;
+	ulong erase_time_us;
 };
 
 struct sandbox_spi_flash_plat_data {
@@ -112,6 +123,15 @@ void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask)
 	sbsf->status |= bp_mask << STAT_BP_SHIFT;
 }
 
+void sandbox_sf_get_erase_stats(struct udevice *dev, uint *countp,
+				ulong *time_usp)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	*countp = sbsf->erase_count;
+	*time_usp = sbsf->erase_time_us;
+}
+
 /**
  * This is a very strange probe function. If it has platform data (which may
  * have come from the device tree) then this function gets the filename and
@@ -231,6 +251,50 @@ static void sandbox_spi_tristate(u8 *buf, uint len)
 	memset(buf, 0xff, len);
 }
 
+int sandbox_erase_part(struct sandbox_spi_flash *sbsf, int size)
+{
+	int todo;
+	int ret;
+
+	while (size > 0) {
+		todo = min(size, (int)sizeof(sandbox_sf_0xff));
+		ret = os_write(sbsf->fd, sandbox_sf_0xff, todo);
+		if (ret != todo)
+			return ret;
+		size -= todo;
+	}
+
+	return 0;
+}
+
+/* Erase sbsf->erase_size bytes at the current file position */
+static void sandbox_sf_erase(struct sandbox_spi_flash *sbsf)
+{
+	int ret;
+
+	if (!(sbsf->status & STAT_WEL)) {
+		puts("sandbox_sf: write enable not set before erase\n");
+		return;
+	}
+
+	log_content(" sector erase addr: %u, size: %u\n",
+		    sbsf->off, sbsf->erase_size);
+
+	/*
+	 * TODO(vapier@gentoo.org): latch WIP in status, and
+	 * delay before clearing it ?
+	 */
+	ret = sandbox_erase_part(sbsf, sbsf->erase_size);
+	sbsf->status &= ~STAT_WEL;
+	if (ret) {
+		log_content("sandbox_sf: Erase failed\n");
+		return;
+	}
+	sbsf->erase_count++;
+	sbsf->erase_time_us += SF_ERASE_TIME_US +
+		(sbsf->erase_size >> 10) * SF_ERASE_TIME_KIB_US;
+}
+
 /* Figure out what command this stream is telling us to do */
 static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 				  u8 *tx)
@@ -270,17 +334,25 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 	case SPINOR_OP_WRSR:
 		sbsf->state = SF_WRITE_STATUS;
 		break;
+	case SPINOR_OP_CHIP_ERASE:
+		/* This has no address, so erase straight away */
+		sbsf->off = 0;
+		sbsf->erase_size = sbsf->data->sector_size *
+			sbsf->data->n_sectors;
+		if (os_lseek(sbsf->fd, 0, OS_SEEK_SET) < 0)
+			return -EIO;
+		sandbox_sf_erase(sbsf);
+		break;
 	default: {
 		int flags = sbsf->data->flags;
 
 		/* we only support erase here */
-		if (sbsf->cmd == SPINOR_OP_CHIP_ERASE) {
-			sbsf->erase_size = sbsf->data->sector_size *
-				sbsf->data->n_sectors;
-		} else if (sbsf->cmd == SPINOR_OP_BE_4K && (flags & SECT_4K)) {
+		if (sbsf->cmd == SPINOR_OP_BE_4K && (flags & SECT_4K)) {
 			sbsf->erase_size = 4 << 10;
-		} else if (sbsf->cmd == SPINOR_OP_SE && !(flags & SECT_4K)) {
-			sbsf->erase_size = 64 << 10;
+		} else if (sbsf->cmd == SPINOR_OP_BE_32K && (flags & SECT_4K)) {
+			sbsf->erase_size = 32 << 10;
+		} else if (sbsf->cmd == SPINOR_OP_SE) {
+			sbsf->erase_size = sbsf->data->sector_size;
 		} else {
 			debug(" cmd unknown: %#x\n", sbsf->cmd);
 			return -EIO;
@@ -297,22 +369,6 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 	return 0;
 }
 
-int sandbox_erase_part(struct sandbox_spi_flash *sbsf, int size)
-{
-	int todo;
-	int ret;
-
-	while (size > 0) {
-		todo = min(size, (int)sizeof(sandbox_sf_0xff));
-		ret = os_write(sbsf->fd, sandbox_sf_0xff, todo);
-		if (ret != todo)
-			return ret;
-		size -= todo;
-	}
-
-	return 0;
-}
-
 static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			   const void *rxp, void *txp, unsigned long flags)
 {
@@ -453,11 +509,6 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			break;
 		case SF_ERASE:
  case_sf_erase: {
-			if (!(sbsf->status & STAT_WEL)) {
-				puts("sandbox_sf: write enable not set before erase\n");
-				goto done;
-			}
-
 			/* verify address is aligned */
 			if (sbsf->off & (sbsf->erase_size - 1)) {
 				log_content(" sector erase: cmd:%#x needs align:%#x, but we got %#x\n",
@@ -467,24 +518,12 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 				goto done;
 			}
 
-			log_content(" sector erase addr: %u, size: %u\n",
-				    sbsf->off, sbsf->erase_size);
-
 			cnt = bytes - pos;
 			if (tx)
 				sandbox_spi_tristate(&tx[pos], cnt);
 			pos += cnt;
 
-			/*
-			 * TODO(vapier@gentoo.org): latch WIP in status, and
-			 * delay before clearing it ?
-			 */
-			ret = sandbox_erase_part(sbsf, sbsf->erase_size);
-			sbsf->status &= ~STAT_WEL;
-			if (ret) {
-				log_content("sandbox_sf: Erase failed\n");
-				goto done;
-			}
+			sandbox_sf_erase(sbsf);
 			goto done;
 		}
 		default:
@@ -34,6 +34,12 @@
 
 #define DEFAULT_READY_WAIT_JIFFIES		(40UL * HZ)
 
+/*
+ * For full-chip erase, calibrated to a 2MB flash (M25P16); should be scaled up
+ * for larger flash
+ */
+#define CHIP_ERASE_2MB_READY_WAIT_JIFFIES	(40UL * HZ)
+
 static int spi_nor_read_write_reg(struct spi_nor *nor, struct spi_mem_op
 		*op, void *buf)
 {
@@ -288,12 +294,17 @@ static u8 spi_nor_convert_3to4_erase(u8 opcode)
 static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 				      const struct flash_info *info)
 {
+	int i;
+
 	/* Do some manufacturer fixups first */
 	switch (JEDEC_MFR(info)) {
 	case SNOR_MFR_SPANSION:
 		/* No small sector erase for 4-byte command set */
 		nor->erase_opcode = SPINOR_OP_SE;
 		nor->mtd.erasesize = info->sector_size;
+		memset(nor->erase_types, '\0', sizeof(nor->erase_types));
+		nor->erase_types[0].size = info->sector_size;
+		nor->erase_types[0].opcode = SPINOR_OP_SE;
 		break;
 
 	default:
@@ -303,6 +314,11 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor,
 	nor->read_opcode = spi_nor_convert_3to4_read(nor->read_opcode);
 	nor->program_opcode = spi_nor_convert_3to4_program(nor->program_opcode);
 	nor->erase_opcode = spi_nor_convert_3to4_erase(nor->erase_opcode);
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		struct spi_nor_erase_type *type = &nor->erase_types[i];
+
+		type->opcode = spi_nor_convert_3to4_erase(type->opcode);
+	}
 }
 #endif /* !CONFIG_SPI_FLASH_BAR */
 
@@ -512,13 +528,54 @@ static int read_bar(struct spi_nor *nor, const struct flash_info *info)
 }
 #endif
 
+/*
+ * Record an erase command supported by the flash, keeping the erase types
+ * sorted by size. A command replaces an earlier one of the same size.
+ */
+static void spi_nor_add_erase_type(struct spi_nor *nor, u32 size, u8 opcode)
+{
+	struct spi_nor_erase_type *types = nor->erase_types;
+	int i, j;
+
+	for (i = 0; i < SNOR_ERASE_TYPE_MAX; i++) {
+		if (types[i].size == size) {
+			types[i].opcode = opcode;
+			return;
+		}
+		if (!types[i].size || types[i].size > size)
+			break;
+	}
+	if (i == SNOR_ERASE_TYPE_MAX || types[SNOR_ERASE_TYPE_MAX - 1].size)
+		return;
+
+	for (j = SNOR_ERASE_TYPE_MAX - 1; j > i; j--)
+		types[j] = types[j - 1];
+	types[i].size = size;
+	types[i].opcode = opcode;
+}
+
+const struct spi_nor_erase_type *
+spi_nor_erase_plan(const struct spi_nor_erase_type *types, u32 addr, u64 len)
+{
+	int i;
+
+	for (i = SNOR_ERASE_TYPE_MAX - 1; i >= 0; i--) {
+		u32 size = types[i].size;
+
+		if (size && !(addr & (size - 1)) && size <= len)
+			return &types[i];
+	}
+
+	return NULL;
+}
+
 /*
  * Initiate the erasure of a single sector
  */
-static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
+static int spi_nor_erase_sector(struct spi_nor *nor, u8 opcode, u32 addr)
 {
 	struct spi_mem_op op =
-		SPI_MEM_OP(SPI_MEM_OP_CMD(nor->erase_opcode, 1),
+		SPI_MEM_OP(SPI_MEM_OP_CMD(opcode, 1),
 			   SPI_MEM_OP_ADDR(nor->addr_width, addr, 1),
 			   SPI_MEM_OP_NO_DUMMY,
 			   SPI_MEM_OP_NO_DATA);
@@ -533,13 +590,67 @@ static int spi_nor_erase_sector(struct spi_nor *nor, u32 addr)
 	return spi_mem_exec_op(nor->spi, &op);
 }
 
+/*
+ * Check whether a range covers the whole flash and can be erased with a
+ * single chip erase command. Flashes ignore that command if any block is
+ * protected, so it is only used when nothing is.
+ */
+static bool spi_nor_can_erase_chip(struct spi_nor *nor, u32 addr, u64 len)
+{
+	int sr;
+
+	if (addr || len != nor->mtd.size || nor->erase ||
+	    (nor->flags & SNOR_F_NO_OP_CHIP_ERASE))
+		return false;
+
+	sr = read_sr(nor);
+	if (sr < 0 || (sr & (SR_BP0 | SR_BP1 | SR_BP2)))
+		return false;
+	if (nor->flash_is_locked && nor->flash_is_locked(nor, 0, len))
+		return false;
+
+	return true;
+}
+
+/*
+ * Erase the whole flash
+ */
+static int spi_nor_erase_chip(struct spi_nor *nor)
+{
+	struct spi_mem_op op =
+		SPI_MEM_OP(SPI_MEM_OP_CMD(SPINOR_OP_CHIP_ERASE, 1),
+			   SPI_MEM_OP_NO_ADDR,
+			   SPI_MEM_OP_NO_DUMMY,
+			   SPI_MEM_OP_NO_DATA);
+	unsigned long timeout;
+	int ret;
+
+	dev_dbg(nor->dev, "chip erase, %llx bytes\n", (long long)nor->mtd.size);
+
+	write_enable(nor);
+	ret = spi_mem_exec_op(nor->spi, &op);
+	if (ret)
+		return ret;
+
+	timeout = max(CHIP_ERASE_2MB_READY_WAIT_JIFFIES,
+		      CHIP_ERASE_2MB_READY_WAIT_JIFFIES *
+		      (unsigned long)(nor->mtd.size / SZ_2M));
+
+	return spi_nor_wait_till_ready_with_timeout(nor, timeout);
+}
+
 /*
  * Erase an address range on the nor chip.  The address range may extend
  * one or more erase sectors.  Return an error is there is a problem erasing.
+ *
+ * Each step uses the largest erase command which fits, so that only the
+ * edges of the range are erased in small sectors.
  */
 static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
+	const struct spi_nor_erase_type *type;
+	struct spi_nor_erase_type sector;
 	u32 addr, len, rem;
 	int ret;
 
@@ -556,7 +667,21 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	addr = instr->addr;
 	len = instr->len;
 
+	if (spi_nor_can_erase_chip(nor, addr, instr->len)) {
+		ret = spi_nor_erase_chip(nor);
+		goto erase_err;
+	}
+
+	sector.size = mtd->erasesize;
+	sector.opcode = nor->erase_opcode;
 	while (len) {
+		/* A driver's erase() method only does sector erase */
+		type = NULL;
+		if (!nor->erase)
+			type = spi_nor_erase_plan(nor->erase_types, addr, len);
+		if (!type)
+			type = &sector;
+
 #ifdef CONFIG_SPI_FLASH_BAR
 		ret = write_bar(nor, addr);
 		if (ret < 0)
@@ -564,12 +689,12 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 #endif
 		write_enable(nor);
 
-		ret = spi_nor_erase_sector(nor, addr);
+		ret = spi_nor_erase_sector(nor, type->opcode, addr);
 		if (ret)
 			goto erase_err;
 
-		addr += mtd->erasesize;
-		len -= mtd->erasesize;
+		addr += type->size;
+		len -= type->size;
 
 		ret = spi_nor_wait_till_ready(nor);
 		if (ret)
@@ -1922,12 +2047,17 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 
 		erasesize = 1U << erasesize;
 		opcode = (half >> 8) & 0xff;
+		/* Keep going to record all the erase types */
+		spi_nor_add_erase_type(nor, erasesize, opcode);
 #ifdef CONFIG_SPI_FLASH_USE_4K_SECTORS
 		if (erasesize == SZ_4K) {
 			nor->erase_opcode = opcode;
 			mtd->erasesize = erasesize;
-			break;
+			continue;
 		}
+		/* Once 4KiB sectors are chosen, keep them */
+		if (mtd->erasesize == SZ_4K)
+			continue;
 #endif
 		if (!mtd->erasesize || mtd->erasesize < erasesize) {
 			nor->erase_opcode = opcode;
@@ -2163,6 +2293,7 @@ static int spi_nor_init_params(struct spi_nor *nor,
 	/* Override the parameters with data read from SFDP tables. */
 	nor->addr_width = 0;
 	nor->mtd.erasesize = 0;
+	memset(nor->erase_types, '\0', sizeof(nor->erase_types));
 	if ((info->flags & (SPI_NOR_DUAL_READ | SPI_NOR_QUAD_READ)) &&
 	    !(info->flags & SPI_NOR_SKIP_SFDP)) {
 		struct spi_nor_flash_parameter sfdp_params;
@@ -2171,6 +2302,8 @@ static int spi_nor_init_params(struct spi_nor *nor,
 		if (spi_nor_parse_sfdp(nor, &sfdp_params)) {
 			nor->addr_width = 0;
 			nor->mtd.erasesize = 0;
+			memset(nor->erase_types, '\0',
+			       sizeof(nor->erase_types));
 		} else {
 			memcpy(params, &sfdp_params, sizeof(*params));
 		}
@@ -2289,7 +2422,13 @@ static int spi_nor_select_erase(struct spi_nor *nor,
 
 	/* Do nothing if already configured from SFDP. */
 	if (mtd->erasesize)
-		return 0;
+		goto done;
+
+	/* Both small and large sectors can be erased if the flash has both */
+	if (info->flags & SECT_4K)
+		spi_nor_add_erase_type(nor, SZ_4K, SPINOR_OP_BE_4K);
+	else if (info->flags & SECT_4K_PMC)
+		spi_nor_add_erase_type(nor, SZ_4K, SPINOR_OP_BE_4K_PMC);
 
 #ifdef CONFIG_SPI_FLASH_USE_4K_SECTORS
 	/* prefer "small sector" erase if possible */
@@ -2305,6 +2444,11 @@ static int spi_nor_select_erase(struct spi_nor *nor,
 		nor->erase_opcode = SPINOR_OP_SE;
 		mtd->erasesize = info->sector_size;
 	}
+	spi_nor_add_erase_type(nor, info->sector_size, SPINOR_OP_SE);
+done:
+	/* The sector erase command is always one of the erase types */
+	spi_nor_add_erase_type(nor, mtd->erasesize, nor->erase_opcode);
+
 	return 0;
 }
 
@@ -72,14 +72,14 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	eth_recv = (void *)eth_rx_ring_get_buf(&priv->rx_ring);
+	if (!eth_recv)
 		return 0;
 
 	/* store this as the assumed IP of the fake host */
 	priv->fake_host_ipaddr = net_read_ip(&arp->ar_tpa);
 
 	/* Formulate a fake response */
-	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
 	memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
 	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
 	eth_recv->et_protlen = htons(PROT_ARP);
@@ -95,9 +95,7 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 	memcpy(&arp_recv->ar_tha, &arp->ar_sha, ARP_HLEN);
 	net_copy_ip(&arp_recv->ar_tpa, &arp->ar_spa);
 
-	priv->recv_packet_length[priv->recv_packets] =
-		ETHER_HDR_SIZE + ARP_HDR_SIZE;
-	++priv->recv_packets;
+	eth_rx_ring_push(&priv->rx_ring, ETHER_HDR_SIZE + ARP_HDR_SIZE);
 
 	return 0;
 }
@@ -134,11 +132,11 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 		return -EAGAIN;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	eth_recv = (void *)eth_rx_ring_get_buf(&priv->rx_ring);
+	if (!eth_recv)
 		return 0;
 
 	/* reply to the ping */
-	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
 	memcpy(eth_recv, packet, len);
 	ipr = (void *)eth_recv + ETHER_HDR_SIZE;
 	icmpr = (struct icmp_hdr *)&ipr->udp_src;
@@ -154,8 +152,7 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 	icmpr->checksum = 0;
 	icmpr->checksum = compute_ip_checksum(icmpr, ICMP_HDR_SIZE);
 
-	priv->recv_packet_length[priv->recv_packets] = len;
-	++priv->recv_packets;
+	eth_rx_ring_push(&priv->rx_ring, len);
 
 	return 0;
 }
@@ -174,11 +171,11 @@ int sandbox_eth_recv_arp_req(struct udevice *dev)
 	struct arp_hdr *arp_recv;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	eth_recv = (void *)eth_rx_ring_get_buf(&priv->rx_ring);
+	if (!eth_recv)
 		return -EOVERFLOW;
 
 	/* Formulate a fake request */
-	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
 	memcpy(eth_recv->et_dest, net_bcast_ethaddr, ARP_HLEN);
 	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
 	eth_recv->et_protlen = htons(PROT_ARP);
@@ -194,9 +191,7 @@ int sandbox_eth_recv_arp_req(struct udevice *dev)
 	memcpy(&arp_recv->ar_tha, net_null_ethaddr, ARP_HLEN);
 	net_write_ip(&arp_recv->ar_tpa, net_ip);
 
-	priv->recv_packet_length[priv->recv_packets] =
-		ETHER_HDR_SIZE + ARP_HDR_SIZE;
-	++priv->recv_packets;
+	eth_rx_ring_push(&priv->rx_ring, ETHER_HDR_SIZE + ARP_HDR_SIZE);
 
 	return 0;
 }
@@ -216,12 +211,11 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	struct icmp_hdr *icmpr;
 
 	/* Don't allow the buffer to overrun */
-	if (priv->recv_packets >= PKTBUFSRX)
+	eth_recv = (void *)eth_rx_ring_get_buf(&priv->rx_ring);
+	if (!eth_recv)
 		return -EOVERFLOW;
 
 	/* Formulate a fake ping */
-	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
-
 	memcpy(eth_recv->et_dest, net_ethaddr, ARP_HLEN);
 	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
 	eth_recv->et_protlen = htons(PROT_IP);
@@ -245,9 +239,56 @@ int sandbox_eth_recv_ping_req(struct udevice *dev)
 	icmpr->un.echo.sequence = htons(1);
 	icmpr->checksum = compute_ip_checksum(icmpr, ICMP_HDR_SIZE);
 
-	priv->recv_packet_length[priv->recv_packets] =
-		ETHER_HDR_SIZE + IP_ICMP_HDR_SIZE;
-	++priv->recv_packets;
+	eth_rx_ring_push(&priv->rx_ring, ETHER_HDR_SIZE + IP_ICMP_HDR_SIZE);
+
+	return 0;
+}
+
+/*
+ * sandbox_eth_recv_udp()
+ *
+ * Inject a UDP packet from the fake host to this target
+ *
+ * returns 0 if injected, -EOVERFLOW if not
+ */
+int sandbox_eth_recv_udp(struct udevice *dev, int dport, int sport,
+			 const void *payload, unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth_recv;
+	struct ip_udp_hdr *ipr;
+
+	/* Don't allow the buffer to overrun */
+	eth_recv = (void *)eth_rx_ring_get_buf(&priv->rx_ring);
+	if (!eth_recv || ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len > PKTSIZE_ALIGN)
+		return -EOVERFLOW;
+
+	/* Formulate a fake datagram */
+	memcpy(eth_recv->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+
+	ipr = (void *)eth_recv + ETHER_HDR_SIZE;
+	ipr->ip_hl_v = 0x45;
+	ipr->ip_tos = 0;
+	ipr->ip_len = htons(IP_UDP_HDR_SIZE + len);
+	ipr->ip_id = 0;
+	ipr->ip_off = htons(IP_FLAGS_DFRAG);
+	ipr->ip_ttl = 255;
+	ipr->ip_p = IPPROTO_UDP;
+	ipr->ip_sum = 0;
+	net_write_ip(&ipr->ip_src, priv->fake_host_ipaddr);
+	net_write_ip(&ipr->ip_dst, net_ip);
+	ipr->ip_sum = compute_ip_checksum(ipr, IP_HDR_SIZE);
+
+	ipr->udp_src = htons(sport);
+	ipr->udp_dst = htons(dport);
+	ipr->udp_len = htons(UDP_HDR_SIZE + len);
+	ipr->udp_xsum = 0;
+	memcpy((void *)ipr + IP_UDP_HDR_SIZE, payload, len);
+
+	eth_rx_ring_push(&priv->rx_ring,
+			 ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len);
 
 	return 0;
 }
@@ -324,11 +365,7 @@ static int sb_eth_start(struct udevice *dev)
 
 	debug("eth_sandbox: Start\n");
 
-	priv->recv_packets = 0;
-	for (int i = 0; i < PKTBUFSRX; i++) {
-		priv->recv_packet_buffer[i] = net_rx_packets[i];
-		priv->recv_packet_length[i] = 0;
-	}
+	eth_rx_ring_reset(&priv->rx_ring);
 
 	return 0;
 }
@@ -348,41 +385,27 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int ret;
 
 	if (skip_timeout) {
 		timer_test_add_offset(11000UL);
 		skip_timeout = false;
 	}
 
-	if (priv->recv_packets) {
-		int lcl_recv_packet_length = priv->recv_packet_length[0];
+	/* Packets are handed to the stack in place, without copying */
+	ret = eth_rx_ring_recv(&priv->rx_ring, packetp);
+	if (ret > 0)
+		debug("eth_sandbox: received packet[%d], %d waiting\n", ret,
+		      priv->rx_ring.used - 1);
 
-		debug("eth_sandbox: received packet[%d], %d waiting\n",
-		      lcl_recv_packet_length, priv->recv_packets - 1);
-		*packetp = priv->recv_packet_buffer[0];
-		return lcl_recv_packet_length;
-	}
-	return 0;
+	return ret;
 }
 
 static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
-	int i;
-
-	if (!priv->recv_packets)
-		return 0;
-
-	--priv->recv_packets;
-	for (i = 0; i < priv->recv_packets; i++) {
-		priv->recv_packet_length[i] = priv->recv_packet_length[i + 1];
-		memcpy(priv->recv_packet_buffer[i],
-		       priv->recv_packet_buffer[i + 1],
-		       priv->recv_packet_length[i + 1]);
-	}
-	priv->recv_packet_length[priv->recv_packets] = 0;
 
-	return 0;
+	return eth_rx_ring_free_pkt(&priv->rx_ring, packet);
 }
 
 static void sb_eth_stop(struct udevice *dev)
@@ -408,8 +431,19 @@ static const struct eth_ops sb_eth_ops = {
 	.write_hwaddr		= sb_eth_write_hwaddr,
 };
 
+static int sb_eth_probe(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	return eth_rx_ring_init(&priv->rx_ring, PKTBUFSRX);
+}
+
 static int sb_eth_remove(struct udevice *dev)
 {
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	eth_rx_ring_uninit(&priv->rx_ring);
+
 	return 0;
 }
 
@@ -443,6 +477,7 @@ U_BOOT_DRIVER(eth_sandbox) = {
 	.id	= UCLASS_ETH,
 	.of_match = sb_eth_ids,
 	.ofdata_to_platdata = sb_eth_ofdata_to_platdata,
+	.probe	= sb_eth_probe,
 	.remove	= sb_eth_remove,
 	.ops	= &sb_eth_ops,
 	.priv_auto_alloc_size = sizeof(struct eth_sandbox_priv),
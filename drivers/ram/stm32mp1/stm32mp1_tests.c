@@ -4,6 +4,7 @@
  */
 #include <common.h>
 #include <console.h>
+#include <memtest.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/log2.h>
@@ -161,176 +162,6 @@ static int test_loop_end(u32 *loop, u32 nb_loop, u32 progress)
 	return 0;
 }
 
-/**********************************************************************
- *
- * Function:    memTestDataBus()
- *
- * Description: Test the data bus wiring in a memory region by
- *              performing a walking 1's test at a fixed address
- *              within that region.  The address is selected
- *              by the caller.
- *
- * Notes:
- *
- * Returns:     0 if the test succeeds.
- *              A non-zero result is the first pattern that failed.
- *
- **********************************************************************/
-static u32 databus(u32 *address)
-{
-	u32 pattern;
-	u32 read_value;
-
-	/* Perform a walking 1's test at the given address. */
-	for (pattern = 1; pattern != 0; pattern <<= 1) {
-		/* Write the test pattern. */
-		writel(pattern, address);
-
-		/* Read it back (immediately is okay for this test). */
-		read_value = readl(address);
-		debug("%x: %x <=> %x\n",
-		      (u32)address, read_value, pattern);
-
-		if (read_value != pattern)
-			return pattern;
-	}
-
-	return 0;
-}
-
-/**********************************************************************
- *
- * Function:    memTestAddressBus()
- *
- * Description: Test the address bus wiring in a memory region by
- *              performing a walking 1's test on the relevant bits
- *              of the address and checking for aliasing. This test
- *              will find single-bit address failures such as stuck
- *              -high, stuck-low, and shorted pins.  The base address
- *              and size of the region are selected by the caller.
- *
- * Notes:       For best results, the selected base address should
- *              have enough LSB 0's to guarantee single address bit
- *              changes.  For example, to test a 64-Kbyte region,
- *              select a base address on a 64-Kbyte boundary.  Also,
- *              select the region size as a power-of-two--if at all
- *              possible.
- *
- * Returns:     NULL if the test succeeds.
- *              A non-zero result is the first address at which an
- *              aliasing problem was uncovered.  By examining the
- *              contents of memory, it may be possible to gather
- *              additional information about the problem.
- *
- **********************************************************************/
-static u32 *addressbus(u32 *address, u32 nb_bytes)
-{
-	u32 mask = (nb_bytes / sizeof(u32) - 1);
-	u32 offset;
-	u32 test_offset;
-	u32 read_value;
-
-	u32 pattern     = 0xAAAAAAAA;
-	u32 antipattern = 0x55555555;
-
-	/* Write the default pattern at each of the power-of-two offsets. */
-	for (offset = 1; (offset & mask) != 0; offset <<= 1)
-		writel(pattern, &address[offset]);
-
-	/* Check for address bits stuck high. */
-	test_offset = 0;
-	writel(antipattern, &address[test_offset]);
-
-	for (offset = 1; (offset & mask) != 0; offset <<= 1) {
-		read_value = readl(&address[offset]);
-		debug("%x: %x <=> %x\n",
-		      (u32)&address[offset], read_value, pattern);
-		if (read_value != pattern)
-			return &address[offset];
-	}
-
-	writel(pattern, &address[test_offset]);
-
-	/* Check for address bits stuck low or shorted. */
-	for (test_offset = 1; (test_offset & mask) != 0; test_offset <<= 1) {
-		writel(antipattern, &address[test_offset]);
-		if (readl(&address[0]) != pattern)
-			return &address[test_offset];
-
-		for (offset = 1; (offset & mask) != 0; offset <<= 1) {
-			if (readl(&address[offset]) != pattern &&
-			    offset != test_offset)
-				return &address[test_offset];
-		}
-		writel(pattern, &address[test_offset]);
-	}
-
-	return NULL;
-}
-
-/**********************************************************************
- *
- * Function:    memTestDevice()
- *
- * Description: Test the integrity of a physical memory device by
- *              performing an increment/decrement test over the
- *              entire region.  In the process every storage bit
- *              in the device is tested as a zero and a one.  The
- *              base address and the size of the region are
- *              selected by the caller.
- *
- * Notes:
- *
- * Returns:     NULL if the test succeeds.
- *
- *              A non-zero result is the first address at which an
- *              incorrect value was read back.  By examining the
- *              contents of memory, it may be possible to gather
- *              additional information about the problem.
- *
- **********************************************************************/
-static u32 *memdevice(u32 *address, u32 nb_bytes)
-{
-	u32 offset;
-	u32 nb_words = nb_bytes / sizeof(u32);
-
-	u32 pattern;
-	u32 antipattern;
-
-	puts("Fill with pattern");
-	/* Fill memory with a known pattern. */
-	for (pattern = 1, offset = 0; offset < nb_words; pattern++, offset++) {
-		writel(pattern, &address[offset]);
-		if (progress(offset))
-			return NULL;
-	}
-
-	puts("\nCheck and invert pattern");
-	/* Check each location and invert it for the second pass. */
-	for (pattern = 1, offset = 0; offset < nb_words; pattern++, offset++) {
-		if (readl(&address[offset]) != pattern)
-			return &address[offset];
-
-		antipattern = ~pattern;
-		writel(antipattern, &address[offset]);
-		if (progress(offset))
-			return NULL;
-	}
-
-	puts("\nCheck inverted pattern");
-	/* Check each location for the inverted pattern and zero it. */
-	for (pattern = 1, offset = 0; offset < nb_words; pattern++, offset++) {
-		antipattern = ~pattern;
-		if (readl(&address[offset]) != antipattern)
-			return &address[offset];
-		if (progress(offset))
-			return NULL;
-	}
-	printf("\n");
-
-	return NULL;
-}
-
 static enum test_result databuswalk0(struct stm32mp1_ddrctl *ctl,
 				     struct stm32mp1_ddrphy *phy,
 				     char *string, int argc, char *argv[])
@@ -412,32 +243,42 @@ static enum test_result databuswalk1(struct stm32mp1_ddrctl *ctl,
 	return TEST_PASSED;
 }
 
+/*
+ * Verify each data line by walking 1 (and 0) on a fixed address. A
+ * non-zero err_bits gives the data lines which failed.
+ */
 static enum test_result test_databus(struct stm32mp1_ddrctl *ctl,
 				     struct stm32mp1_ddrphy *phy,
 				     char *string, int argc, char *argv[])
 {
+	struct memtest mt;
 	u32 addr;
-	u32 error;
 
 	if (get_addr(string, argc, argv, 0, &addr))
 		return TEST_ERROR;
-	error = databus((u32 *)addr);
-	if (error) {
-		sprintf(string, "0x%x: error for bits 0x%x",
-			addr, error);
+	memtest_init(&mt, (void *)addr, addr, sizeof(u32), MEMTEST_QUIET);
+	memtest_data_bus(&mt, NULL);
+	if (mt.errs) {
+		sprintf(string, "0x%x: error for bits 0x%lx",
+			addr, mt.err_bits);
 		return TEST_FAILED;
 	}
 	sprintf(string, "address 0x%x", addr);
 	return TEST_PASSED;
 }
 
+/*
+ * Walk 1 on the relevant bits of the address and check for aliasing. This
+ * finds single-bit failures such as stuck-high, stuck-low and shorted pins,
+ * so the buffer must be aligned to its size, which is a power of 2.
+ */
 static enum test_result test_addressbus(struct stm32mp1_ddrctl *ctl,
 					struct stm32mp1_ddrphy *phy,
 					char *string, int argc, char *argv[])
 {
+	struct memtest mt;
 	u32 addr;
 	u32 bufsize;
-	u32 error;
 
 	if (get_bufsize(string, argc, argv, 0, &bufsize, 4 * 1024, 4))
 		return TEST_ERROR;
@@ -449,10 +290,11 @@ static enum test_result test_addressbus(struct stm32mp1_ddrctl *ctl,
 	if (get_addr(string, argc, argv, 1, &addr))
 		return TEST_ERROR;
 
-	error = (u32)addressbus((u32 *)addr, bufsize);
-	if (error) {
-		sprintf(string, "0x%x: error for address 0x%x",
-			addr, error);
+	memtest_init(&mt, (void *)addr, addr, bufsize, MEMTEST_QUIET);
+	memtest_addr_bus(&mt);
+	if (mt.errs) {
+		sprintf(string, "0x%x: error for address 0x%lx",
+			addr, mt.first_err);
 		return TEST_FAILED;
 	}
 	sprintf(string, "address 0x%x, size 0x%x",
@@ -460,27 +302,74 @@ static enum test_result test_addressbus(struct stm32mp1_ddrctl *ctl,
 	return TEST_PASSED;
 }
 
+/* Run a test from the memtest library over a buffer, showing progress */
+static enum test_result memtest_run(struct memtest *mt, char *string, u32 addr,
+				    u32 bufsize, int ret)
+{
+	printf("\n");
+	if (ret) {
+		sprintf(string, "test interrupted");
+		return TEST_FAILED;
+	}
+	memtest_show_speed(mt);
+	if (mt->errs) {
+		sprintf(string, "0x%x: %ld errors, first at address 0x%lx",
+			addr, mt->errs, mt->first_err);
+		return TEST_FAILED;
+	}
+	sprintf(string, "address 0x%x, size 0x%x", addr, bufsize);
+	return TEST_PASSED;
+}
+
+/*
+ * Test every storage bit in the region as a zero and a one, with an
+ * increment/decrement test.
+ */
 static enum test_result test_memdevice(struct stm32mp1_ddrctl *ctl,
 				       struct stm32mp1_ddrphy *phy,
 				       char *string, int argc, char *argv[])
 {
+	struct memtest mt;
 	u32 addr;
 	size_t bufsize;
-	u32 error;
+	int ret;
 
 	if (get_bufsize(string, argc, argv, 0, &bufsize, 4 * 1024, 4))
 		return TEST_ERROR;
 	if (get_addr(string, argc, argv, 1, &addr))
 		return TEST_ERROR;
-	error = (u32)memdevice((u32 *)addr, (unsigned long)bufsize);
-	if (error) {
-		sprintf(string, "0x%x: error for address 0x%x",
-			addr, error);
-		return TEST_FAILED;
-	}
-	sprintf(string, "address 0x%x, size 0x%x",
-		addr, bufsize);
-	return TEST_PASSED;
+	memtest_init(&mt, (void *)addr, addr, bufsize,
+		     MEMTEST_QUIET | MEMTEST_PROGRESS);
+	ret = memtest_device(&mt);
+
+	return memtest_run(&mt, string, addr, bufsize, ret);
+}
+
+/*
+ * Moving inversions: fill with a pattern, then check each word and write
+ * its inverse, going up through the region and then down again.
+ */
+static enum test_result test_movinginv(struct stm32mp1_ddrctl *ctl,
+				       struct stm32mp1_ddrphy *phy,
+				       char *string, int argc, char *argv[])
+{
+	struct memtest mt;
+	u32 addr;
+	size_t bufsize;
+	u32 pattern;
+	int ret;
+
+	if (get_bufsize(string, argc, argv, 0, &bufsize, 4 * 1024, 4))
+		return TEST_ERROR;
+	if (get_pattern(string, argc, argv, 1, &pattern, 0x00000000))
+		return TEST_ERROR;
+	if (get_addr(string, argc, argv, 2, &addr))
+		return TEST_ERROR;
+	memtest_init(&mt, (void *)addr, addr, bufsize,
+		     MEMTEST_QUIET | MEMTEST_PROGRESS);
+	ret = memtest_moving_inv(&mt, pattern);
+
+	return memtest_run(&mt, string, addr, bufsize, ret);
 }
 
 /**********************************************************************
@@ -1400,6 +1289,10 @@ const struct test_desc test[] = {
 	 "Test the integrity of a physical memory (test every storage bit in the region)",
 	 2
 	 },
+	{test_movinginv, "MovingInversions", "[size] [pattern] [addr]",
+	 "Write a pattern and its inverse going up, then down the region",
+	 3
+	},
 	{test_sso, "SimultaneousSwitchingOutput", "[size] [addr] ",
 	 "Stress the data bus over an address range",
 	 2
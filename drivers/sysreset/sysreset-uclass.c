@@ -7,6 +7,7 @@
 #define LOG_CATEGORY UCLASS_SYSRESET
 
 #include <common.h>
+#include <blk.h>
 #include <sysreset.h>
 #include <dm.h>
 #include <errno.h>
@@ -51,6 +52,9 @@ int sysreset_walk(enum sysreset_t type)
 	struct udevice *dev;
 	int ret = -ENOSYS;
 
+	/* Write out anything held in the block cache before it is lost */
+	blkcache_flush(NULL);
+
 	while (ret != -EINPROGRESS && type < SYSRESET_COUNT) {
 		for (uclass_first_device(UCLASS_SYSRESET, &dev);
 		     dev;
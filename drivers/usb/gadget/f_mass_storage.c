@@ -244,6 +244,7 @@
 #include <malloc.h>
 #include <common.h>
 #include <console.h>
+#include <div64.h>
 #include <g_dnl.h>
 
 #include <linux/err.h>
@@ -281,9 +282,29 @@ static const char fsg_string_interface[] = "Mass Storage";
 #define kthread_create(...)	__builtin_return_address(0)
 #define wait_for_completion(...) do {} while (0)
 
+/* Whether to read ahead, and the size of the write cache (0 for none) */
+#define FSG_READAHEAD	IS_ENABLED(CONFIG_USB_FUNCTION_MASS_STORAGE_READAHEAD)
+#define FSG_WRITE_CACHE	((u32)CONFIG_USB_FUNCTION_MASS_STORAGE_WRITE_CACHE)
+
+/* Write out the write cache when the host has been idle for this long */
+#define FSG_WRITE_CACHE_IDLE_MS	1000
+
 struct kref {int x; };
 struct completion {int x; };
 
+/* Amount of data moved by READ or WRITE commands, and the time it took */
+struct fsg_stats {
+	u64	bytes;
+	ulong	us;
+};
+
+enum {
+	FSG_STATS_READ,
+	FSG_STATS_WRITE,
+
+	FSG_STATS_COUNT,
+};
+
 struct fsg_dev;
 struct fsg_common;
 
@@ -300,6 +321,27 @@ struct fsg_common {
 	struct fsg_buffhd	*next_buffhd_to_drain;
 	struct fsg_buffhd	buffhds[FSG_NUM_BUFFERS];
 
+	/* Read-ahead buffer, holding sectors of the LUN last read */
+	void			*ra_buf;
+	unsigned int		ra_lun;
+	u32			ra_lba;		/* First sector in ra_buf */
+	u32			ra_count;	/* Sectors in ra_buf */
+	u32			ra_next;	/* Sector after the last read */
+	u32			ra_want;	/* Sectors to read ahead */
+
+	/* Write cache, holding sectors written by the host */
+	void			*wc_buf;
+	unsigned int		wc_lun;
+	u32			wc_lba;		/* First sector in wc_buf */
+	u32			wc_count;	/* Sectors in wc_buf */
+	ulong			wc_time;	/* get_timer() of last write */
+
+	/* Statistics, shown by fsg_cleanup() */
+	struct fsg_stats	stats[FSG_STATS_COUNT];
+	int			cmd_stats;	/* FSG_STATS_... or -1 */
+	ulong			cmd_start_us;	/* When the command arrived */
+	ulong			in_done_us;	/* Last bulk-in completion */
+
 	int			cmnd_size;
 	u8			cmnd[MAX_COMMAND_SIZE];
 
@@ -500,6 +542,7 @@ static void bulk_in_complete(struct usb_ep *ep, struct usb_request *req)
 	/* Hold the lock while we update the request and buffer states */
 	bh->inreq_busy = 0;
 	bh->state = BUF_STATE_EMPTY;
+	common->in_done_us = timer_get_us();
 	wakeup_thread(common);
 }
 
@@ -616,6 +659,227 @@ static void start_transfer(struct fsg_dev *fsg, struct usb_ep *ep,
 #define START_TRANSFER(common, ep_name, req, pbusy, state)		\
 	START_TRANSFER_OR(common, ep_name, req, pbusy, state) (void)0
 
+/*-------------------------------------------------------------------------*/
+
+/* Read-ahead and write cache */
+
+static void fsg_add_time(struct fsg_common *common, int stats, ulong start)
+{
+	common->stats[stats].us += timer_get_us() - start;
+}
+
+/* Write out the write cache, returning -EIO if that fails */
+static int fsg_cache_flush(struct fsg_common *common)
+{
+	struct ums *ums_dev = &ums[common->wc_lun];
+	u32 count = common->wc_count;
+	int rc;
+
+	if (!count)
+		return 0;
+	common->wc_count = 0;
+	rc = ums_dev->write_sector(ums_dev, common->wc_lba, count,
+				   common->wc_buf);
+	if (rc != count) {
+		LDBG(&common->luns[common->wc_lun],
+		     "error in cached write: %d/%u\n", rc, count);
+		common->luns[common->wc_lun].write_failed = 1;
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void fsg_cache_flush_timed(struct fsg_common *common)
+{
+	ulong start = timer_get_us();
+
+	fsg_cache_flush(common);
+	fsg_add_time(common, FSG_STATS_WRITE, start);
+}
+
+/* Write out the write cache if it holds any of the given sectors */
+static void fsg_cache_flush_range(struct fsg_common *common, unsigned int lun,
+				  u32 lba, u32 count)
+{
+	if (common->wc_count && common->wc_lun == lun &&
+	    lba < common->wc_lba + common->wc_count &&
+	    lba + count > common->wc_lba)
+		fsg_cache_flush(common);
+}
+
+/* Report a failure to write out cached data for a LUN, once */
+static int fsg_write_failed(struct fsg_lun *curlun)
+{
+	if (!curlun->write_failed)
+		return 0;
+	curlun->write_failed = 0;
+	curlun->sense_data = SS_WRITE_ERROR;
+	curlun->info_valid = 1;
+
+	return 1;
+}
+
+/*
+ * Write sectors of the current LUN. With a write cache the data is copied
+ * into it, after writing out what it already holds if the new data does not
+ * follow on from that. Returns the number of sectors written, as with
+ * ums->write_sector().
+ */
+static int fsg_write(struct fsg_common *common, u32 lba, u32 count,
+		     void *buf, bool fua)
+{
+	struct ums *ums_dev = &ums[common->lun];
+	u32 size = count * SECTOR_SIZE;
+
+	/* The read-ahead data may be out of date now */
+	if (common->ra_lun == common->lun)
+		common->ra_count = 0;
+
+	if (common->wc_count &&
+	    (fua || common->wc_lun != common->lun ||
+	     common->wc_lba + common->wc_count != lba ||
+	     common->wc_count * SECTOR_SIZE + size > FSG_WRITE_CACHE))
+		fsg_cache_flush(common);
+	if (fua || size > FSG_WRITE_CACHE)
+		return ums_dev->write_sector(ums_dev, lba, count, buf);
+
+	if (!common->wc_count) {
+		common->wc_lun = common->lun;
+		common->wc_lba = lba;
+	}
+	memcpy(common->wc_buf + common->wc_count * SECTOR_SIZE, buf, size);
+	common->wc_count += count;
+	common->wc_time = get_timer(0);
+
+	return count;
+}
+
+/*
+ * Read sectors of the current LUN into a buffer, taking them from the
+ * read-ahead buffer if it holds the first one. In that case *amount may be
+ * reduced to the number of bytes it holds. Returns the number of sectors
+ * read, as with ums->read_sector().
+ */
+static int fsg_read(struct fsg_common *common, struct fsg_buffhd *bh,
+		    u32 lba, unsigned int *amount)
+{
+	struct ums *ums_dev = &ums[common->lun];
+	u32 count = *amount / SECTOR_SIZE;
+	u32 offset;
+
+	if (!FSG_READAHEAD || !common->ra_count ||
+	    common->ra_lun != common->lun || lba < common->ra_lba ||
+	    lba >= common->ra_lba + common->ra_count)
+		return ums_dev->read_sector(ums_dev, lba, count, bh->buf);
+
+	offset = lba - common->ra_lba;
+	count = min(count, common->ra_count - offset);
+	*amount = count * SECTOR_SIZE;
+	if (!offset && count == common->ra_count) {
+		/* Swap the buffers rather than copying all of the data */
+		swap(bh->buf, common->ra_buf);
+		bh->inreq->buf = bh->buf;
+		bh->outreq->buf = bh->buf;
+		common->ra_count = 0;
+	} else {
+		memcpy(bh->buf, common->ra_buf + offset * SECTOR_SIZE,
+		       *amount);
+	}
+
+	return count;
+}
+
+/*
+ * Note a completed read of the current LUN. If it followed on from the
+ * previous read, plan to read ahead by the same amount.
+ */
+static void fsg_readahead(struct fsg_common *common, u32 lba, u32 count)
+{
+	struct fsg_lun *curlun = &common->luns[common->lun];
+	u32 next = lba + count;
+	bool seq;
+
+	seq = common->ra_lun == common->lun && lba == common->ra_next;
+	if (common->ra_lun != common->lun) {
+		common->ra_lun = common->lun;
+		common->ra_count = 0;
+	}
+	common->ra_next = next;
+	common->ra_want = 0;
+	if (!seq || next >= curlun->num_sectors)
+		return;
+
+	/* There is nothing to do if we already have the next sector */
+	if (common->ra_count && next >= common->ra_lba &&
+	    next < common->ra_lba + common->ra_count)
+		return;
+	count = min_t(u32, count, FSG_BUFLEN / SECTOR_SIZE);
+	common->ra_want = min_t(u32, count, curlun->num_sectors - next);
+}
+
+/*
+ * Use the block device while the host is busy with data and status which
+ * are already queued: read ahead after a sequential read, and write out
+ * the write cache once it cannot take another buffer
+ */
+static void fsg_background(struct fsg_common *common)
+{
+	u32 count = common->ra_want;
+	struct ums *ums_dev;
+	ulong start;
+	int rc;
+
+	if (count) {
+		start = timer_get_us();
+		common->ra_want = 0;
+		fsg_cache_flush_range(common, common->ra_lun, common->ra_next,
+				      count);
+		ums_dev = &ums[common->ra_lun];
+		rc = ums_dev->read_sector(ums_dev, common->ra_next, count,
+					  common->ra_buf);
+		common->ra_lba = common->ra_next;
+		common->ra_count = rc == count ? count : 0;
+		fsg_add_time(common, FSG_STATS_READ, start);
+	}
+	if (common->wc_count &&
+	    common->wc_count * SECTOR_SIZE + FSG_BUFLEN > FSG_WRITE_CACHE)
+		fsg_cache_flush_timed(common);
+}
+
+/* Add the time taken by a READ or WRITE, up to when its status was sent */
+static void fsg_stats_end(struct fsg_common *common)
+{
+	long us = common->in_done_us - common->cmd_start_us;
+
+	if (common->cmd_stats < 0)
+		return;
+	if (us > 0)
+		common->stats[common->cmd_stats].us += us;
+	common->cmd_stats = -1;
+}
+
+/* Start timing a new command, if it is a READ or WRITE */
+static void fsg_stats_start(struct fsg_common *common)
+{
+	fsg_stats_end(common);
+	switch (common->cmnd[0]) {
+	case SC_READ_6:
+	case SC_READ_10:
+	case SC_READ_12:
+		common->cmd_stats = FSG_STATS_READ;
+		break;
+	case SC_WRITE_6:
+	case SC_WRITE_10:
+	case SC_WRITE_12:
+		common->cmd_stats = FSG_STATS_WRITE;
+		break;
+	default:
+		return;
+	}
+	common->cmd_start_us = timer_get_us();
+}
+
 static void busy_indicator(void)
 {
 	static int state;
@@ -669,6 +933,13 @@ static int sleep_thread(struct fsg_common *common)
 			if (!g_dnl_board_usb_cable_connected())
 				return -EIO;
 
+			/* Write out the write cache once the host goes quiet */
+			if (common->wc_count &&
+			    common->state == FSG_STATE_IDLE &&
+			    get_timer(common->wc_time) >
+			    FSG_WRITE_CACHE_IDLE_MS)
+				fsg_cache_flush_timed(common);
+
 			k = 0;
 		}
 
@@ -718,6 +989,10 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	/* Write out any cached data which the host is reading back */
+	fsg_cache_flush_range(common, common->lun, lba,
+			      amount_left / SECTOR_SIZE);
+
 	for (;;) {
 
 		/* Figure out how much we need to read:
@@ -754,10 +1029,7 @@ static int do_read(struct fsg_common *common)
 		}
 
 		/* Perform the read */
-		rc = ums[common->lun].read_sector(&ums[common->lun],
-				      file_offset / SECTOR_SIZE,
-				      amount / SECTOR_SIZE,
-				      (char __user *)bh->buf);
+		rc = fsg_read(common, bh, file_offset / SECTOR_SIZE, &amount);
 		if (!rc)
 			return -EIO;
 
@@ -789,8 +1061,13 @@ static int do_read(struct fsg_common *common)
 			break;
 		}
 
-		if (amount_left == 0)
+		if (amount_left == 0) {
+			if (FSG_READAHEAD)
+				fsg_readahead(common, lba,
+					      common->data_size_from_cmnd /
+					      SECTOR_SIZE);
 			break;		/* No more left to read */
+		}
 
 		/* Send this buffer and go read some more */
 		bh->inreq->zero = 0;
@@ -818,6 +1095,7 @@ static int do_write(struct fsg_common *common)
 	unsigned int		amount;
 	unsigned int		partial_page;
 	ssize_t			nwritten;
+	bool			fua = false;
 	int			rc;
 
 	if (curlun->ro) {
@@ -840,12 +1118,17 @@ static int do_write(struct fsg_common *common)
 			curlun->sense_data = SS_INVALID_FIELD_IN_CDB;
 			return -EINVAL;
 		}
+		fua = common->cmnd[1] & 0x08;
 	}
 	if (lba >= curlun->num_sectors) {
 		curlun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
 		return -EINVAL;
 	}
 
+	/* Fail if earlier cached data could not be written */
+	if (fsg_write_failed(curlun))
+		return -EINVAL;
+
 	/* Carry out the file writes */
 	get_some_more = 1;
 	file_offset = usb_offset = ((loff_t) lba) << 9;
@@ -928,10 +1211,8 @@ static int do_write(struct fsg_common *common)
 			amount = bh->outreq->actual;
 
 			/* Perform the write */
-			rc = ums[common->lun].write_sector(&ums[common->lun],
-					       file_offset / SECTOR_SIZE,
-					       amount / SECTOR_SIZE,
-					       (char __user *)bh->buf);
+			rc = fsg_write(common, file_offset / SECTOR_SIZE,
+				       amount / SECTOR_SIZE, bh->buf, fua);
 			if (!rc)
 				return -EIO;
 			nwritten = rc * SECTOR_SIZE;
@@ -963,6 +1244,10 @@ static int do_write(struct fsg_common *common)
 				break;
 			}
 
+			/* Or writing out the cached data before it */
+			if (fsg_write_failed(curlun))
+				break;
+
 			/* Did the host decide to stop early? */
 			if (bh->outreq->actual != bh->outreq->length) {
 				common->short_packet_received = 1;
@@ -984,6 +1269,12 @@ static int do_write(struct fsg_common *common)
 
 static int do_synchronize_cache(struct fsg_common *common)
 {
+	struct fsg_lun	*curlun = &common->luns[common->lun];
+
+	fsg_cache_flush(common);
+	if (fsg_write_failed(curlun))
+		return -EINVAL;
+
 	return 0;
 }
 
@@ -1025,6 +1316,7 @@ static int do_verify(struct fsg_common *common)
 	file_offset = ((loff_t) lba) << 9;
 
 	/* Write out all the dirty buffers before invalidating them */
+	fsg_cache_flush_range(common, common->lun, lba, verification_length);
 
 	/* Just try to read the requested blocks */
 	while (amount_left > 0) {
@@ -1318,6 +1610,9 @@ static int do_start_stop(struct fsg_common *common)
 		return -EINVAL;
 	}
 
+	/* The medium may be about to be ejected */
+	fsg_cache_flush(common);
+
 	return 0;
 }
 
@@ -2110,6 +2405,8 @@ static int get_next_command(struct fsg_common *common)
 
 	/* Wait for the next buffer to become available */
 	bh = common->next_buffhd_to_fill;
+	if (bh->state != BUF_STATE_EMPTY)
+		fsg_background(common);
 	while (bh->state != BUF_STATE_EMPTY) {
 		rc = sleep_thread(common);
 		if (rc)
@@ -2129,6 +2426,7 @@ static int get_next_command(struct fsg_common *common)
 	 * next_buffhd_to_fill. */
 
 	/* Wait for the CBW to arrive */
+	fsg_background(common);
 	while (bh->state != BUF_STATE_FULL) {
 		rc = sleep_thread(common);
 		if (rc)
@@ -2405,6 +2703,7 @@ int fsg_main_thread(void *common_)
 		ret = get_next_command(common);
 		if (ret)
 			return ret;
+		fsg_stats_start(common);
 
 		if (!exception_in_progress(common))
 			common->state = FSG_STATE_DATA_PHASE;
@@ -2417,6 +2716,9 @@ int fsg_main_thread(void *common_)
 
 		if (send_status(common))
 			continue;
+		if (common->cmd_stats >= 0)
+			common->stats[common->cmd_stats].bytes +=
+				common->data_size - common->residue;
 
 		if (!exception_in_progress(common))
 			common->state = FSG_STATE_IDLE;
@@ -2461,6 +2763,7 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 	common->gadget = gadget;
 	common->ep0 = gadget->ep0;
 	common->ep0req = cdev->req;
+	common->cmd_stats = -1;
 
 	/* Maybe allocate device-global string IDs, and patch descriptors */
 	if (fsg_strings[FSG_STRING_INTERFACE].id == 0) {
@@ -2508,6 +2811,25 @@ buffhds_first_it:
 	} while (--i);
 	bh->next = common->buffhds;
 
+	BUILD_BUG_ON(FSG_BUFLEN % PAGE_CACHE_SIZE);
+	if (FSG_READAHEAD) {
+		common->ra_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					  FSG_BUFLEN);
+		if (!common->ra_buf) {
+			rc = -ENOMEM;
+			goto error_release;
+		}
+	}
+	BUILD_BUG_ON(FSG_WRITE_CACHE % SECTOR_SIZE);
+	if (FSG_WRITE_CACHE) {
+		common->wc_buf = memalign(CONFIG_SYS_CACHELINE_SIZE,
+					  FSG_WRITE_CACHE);
+		if (!common->wc_buf) {
+			rc = -ENOMEM;
+			goto error_release;
+		}
+	}
+
 	snprintf(common->inquiry_string, sizeof common->inquiry_string,
 		 "%-8s%-16s%04x",
 		 "Linux   ",
@@ -2573,6 +2895,8 @@ static void fsg_common_release(struct kref *ref)
 			kfree(bh->buf);
 		} while (++bh, --i);
 	}
+	kfree(common->ra_buf);
+	kfree(common->wc_buf);
 
 	if (common->free_storage_on_release)
 		kfree(common);
@@ -2765,4 +3089,36 @@ int fsg_init(struct ums *ums_devs, int count)
 	return 0;
 }
 
+static void fsg_show_stats(const char *name, struct fsg_stats *stats)
+{
+	if (!stats->bytes)
+		return;
+	printf("UMS: %s ", name);
+	print_size(stats->bytes, "");
+	printf(" in %lu ms", stats->us / 1000);
+	if (stats->us)
+		printf(", %llu MB/s", lldiv(stats->bytes, stats->us));
+	printf("\n");
+}
+
+void fsg_cleanup(void)
+{
+	struct fsg_common *common = the_fsg_common;
+
+	if (!common)
+		return;
+	if (fsg_cache_flush(common))
+		printf("UMS: Failed to write cached data to LUN %u\n",
+		       common->wc_lun);
+	fsg_stats_end(common);
+	fsg_show_stats("read", &common->stats[FSG_STATS_READ]);
+	fsg_show_stats("wrote", &common->stats[FSG_STATS_WRITE]);
+
+	free(common->ra_buf);
+	common->ra_buf = NULL;
+	free(common->wc_buf);
+	common->wc_buf = NULL;
+	the_fsg_common = NULL;
+}
+
 DECLARE_GADGET_BIND_CALLBACK(usb_dnl_ums, fsg_add);
@@ -554,6 +554,7 @@ static int thor_rx_data(void)
 
 		while (!dev->rxdata) {
 			usb_gadget_handle_interrupts(0);
+			dfu_write_poll();
 			if (ctrlc())
 				return -1;
 		}
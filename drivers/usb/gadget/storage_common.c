@@ -284,6 +284,7 @@ struct fsg_lun {
 	unsigned int	registered:1;
 	unsigned int	info_valid:1;
 	unsigned int	nofua:1;
+	unsigned int	write_failed:1;	/* Writing cached data failed */
 
 	u32		sense_data;
 	u32		sense_data_info;
@@ -305,10 +306,10 @@ static struct fsg_lun *fsg_lun_from_dev(struct device *dev)
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
 /* Number of buffers we will use.  2 is enough for double-buffering */
-#define FSG_NUM_BUFFERS	2
+#define FSG_NUM_BUFFERS	CONFIG_USB_FUNCTION_MASS_STORAGE_NUM_BUFFERS
 
 /* Default size of buffer length. */
-#define FSG_BUFLEN	((u32)131072)
+#define FSG_BUFLEN	((u32)CONFIG_USB_FUNCTION_MASS_STORAGE_BUFLEN)
 
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	8
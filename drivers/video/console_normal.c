@@ -50,6 +50,9 @@ static int console_normal_set_row(struct udevice *dev, uint row, int clr)
 		return -ENOSYS;
 	}
 
+	video_damage(dev->parent, 0, row * VIDEO_FONT_HEIGHT, vid_priv->xsize,
+		     VIDEO_FONT_HEIGHT);
+
 	return 0;
 }
 
@@ -64,6 +67,9 @@ static int console_normal_move_rows(struct udevice *dev, uint rowdst,
 	src = vid_priv->fb + rowsrc * VIDEO_FONT_HEIGHT * vid_priv->line_length;
 	memmove(dst, src, VIDEO_FONT_HEIGHT * vid_priv->line_length * count);
 
+	video_damage(dev->parent, 0, rowdst * VIDEO_FONT_HEIGHT,
+		     vid_priv->xsize, VIDEO_FONT_HEIGHT * count);
+
 	return 0;
 }
 
@@ -127,6 +133,9 @@ static int console_normal_putc_xy(struct udevice *dev, uint x_frac, uint y,
 		line += vid_priv->line_length;
 	}
 
+	video_damage(vid, VID_TO_PIXEL(x_frac), y, VIDEO_FONT_WIDTH,
+		     VIDEO_FONT_HEIGHT);
+
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
 
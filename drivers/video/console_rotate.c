@@ -52,6 +52,10 @@ static int console_set_row_1(struct udevice *dev, uint row, int clr)
 		line += vid_priv->line_length;
 	}
 
+	video_damage(dev->parent,
+		     vid_priv->xsize - (row + 1) * VIDEO_FONT_HEIGHT, 0,
+		     VIDEO_FONT_HEIGHT, vid_priv->ysize);
+
 	return 0;
 }
 
@@ -75,6 +79,10 @@ static int console_move_rows_1(struct udevice *dev, uint rowdst, uint rowsrc,
 		dst += vid_priv->line_length;
 	}
 
+	video_damage(dev->parent,
+		     vid_priv->xsize - (rowdst + count) * VIDEO_FONT_HEIGHT, 0,
+		     count * VIDEO_FONT_HEIGHT, vid_priv->ysize);
+
 	return 0;
 }
 
@@ -136,6 +144,10 @@ static int console_putc_xy_1(struct udevice *dev, uint x_frac, uint y, char ch)
 		mask >>= 1;
 	}
 
+	video_damage(vid, vid_priv->xsize - y - VIDEO_FONT_HEIGHT,
+		     VID_TO_PIXEL(x_frac), VIDEO_FONT_HEIGHT,
+		     VIDEO_FONT_HEIGHT);
+
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
 
@@ -178,6 +190,10 @@ static int console_set_row_2(struct udevice *dev, uint row, int clr)
 		return -ENOSYS;
 	}
 
+	video_damage(dev->parent, 0,
+		     vid_priv->ysize - (row + 1) * VIDEO_FONT_HEIGHT,
+		     vid_priv->xsize, VIDEO_FONT_HEIGHT);
+
 	return 0;
 }
 
@@ -196,6 +212,10 @@ static int console_move_rows_2(struct udevice *dev, uint rowdst, uint rowsrc,
 		vid_priv->line_length;
 	memmove(dst, src, VIDEO_FONT_HEIGHT * vid_priv->line_length * count);
 
+	video_damage(dev->parent, 0,
+		     vid_priv->ysize - (rowdst + count) * VIDEO_FONT_HEIGHT,
+		     vid_priv->xsize, count * VIDEO_FONT_HEIGHT);
+
 	return 0;
 }
 
@@ -262,6 +282,12 @@ static int console_putc_xy_2(struct udevice *dev, uint x_frac, uint y, char ch)
 		line -= vid_priv->line_length;
 	}
 
+	video_damage(vid,
+		     vid_priv->xsize - VID_TO_PIXEL(x_frac) -
+		     2 * VIDEO_FONT_WIDTH,
+		     vid_priv->ysize - y - VIDEO_FONT_HEIGHT, VIDEO_FONT_WIDTH,
+		     VIDEO_FONT_HEIGHT);
+
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
 
@@ -305,6 +331,9 @@ static int console_set_row_3(struct udevice *dev, uint row, int clr)
 		line += vid_priv->line_length;
 	}
 
+	video_damage(dev->parent, row * VIDEO_FONT_HEIGHT, 0,
+		     VIDEO_FONT_HEIGHT, vid_priv->ysize);
+
 	return 0;
 }
 
@@ -326,6 +355,9 @@ static int console_move_rows_3(struct udevice *dev, uint rowdst, uint rowsrc,
 		dst += vid_priv->line_length;
 	}
 
+	video_damage(dev->parent, rowdst * VIDEO_FONT_HEIGHT, 0,
+		     count * VIDEO_FONT_HEIGHT, vid_priv->ysize);
+
 	return 0;
 }
 
@@ -387,6 +419,9 @@ static int console_putc_xy_3(struct udevice *dev, uint x_frac, uint y, char ch)
 		mask >>= 1;
 	}
 
+	video_damage(vid, y, vid_priv->ysize - VID_TO_PIXEL(x_frac) -
+		     VIDEO_FONT_HEIGHT, VIDEO_FONT_HEIGHT, VIDEO_FONT_HEIGHT);
+
 	return VID_TO_POS(VIDEO_FONT_WIDTH);
 }
 
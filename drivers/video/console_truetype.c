@@ -162,6 +162,9 @@ static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 		return -ENOSYS;
 	}
 
+	video_damage(dev->parent, 0, row * priv->font_size, vid_priv->xsize,
+		     priv->font_size);
+
 	return 0;
 }
 
@@ -177,6 +180,8 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 	dst = vid_priv->fb + rowdst * priv->font_size * vid_priv->line_length;
 	src = vid_priv->fb + rowsrc * priv->font_size * vid_priv->line_length;
 	memmove(dst, src, priv->font_size * vid_priv->line_length * count);
+	video_damage(dev->parent, 0, rowdst * priv->font_size, vid_priv->xsize,
+		     priv->font_size * count);
 
 	/* Scroll up our position history */
 	diff = (rowsrc - rowdst) * priv->font_size;
@@ -296,6 +301,9 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	}
 	free(data);
 
+	video_damage(vid, VID_TO_PIXEL(x) + xoff,
+		     y + (linenum > 0 ? linenum : 0), width, height);
+
 	return width_frac;
 }
 
@@ -358,6 +366,8 @@ static int console_truetype_erase(struct udevice *dev, int xstart, int ystart,
 		line += vid_priv->line_length;
 	}
 
+	video_damage(dev->parent, xstart, ystart, xend - xstart, yend - ystart);
+
 	return 0;
 }
 
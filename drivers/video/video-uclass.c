@@ -114,6 +114,7 @@ int video_clear(struct udevice *dev)
 		memset(priv->fb, priv->colour_bg, priv->fb_size);
 		break;
 	}
+	video_damage(dev, 0, 0, priv->xsize, priv->ysize);
 
 	return 0;
 }
@@ -144,26 +145,98 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 	priv->colour_bg = vid_console_color(priv, back);
 }
 
-/* Flush video activity to the caches */
-void video_sync(struct udevice *vid, bool force)
+void video_damage(struct udevice *vid, int x, int y, int width, int height)
 {
-	/*
-	 * flush_dcache_range() is declared in common.h but it seems that some
-	 * architectures do not actually implement it. Is there a way to find
-	 * out whether it exists? For now, ARM is safe.
-	 */
-#if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
 	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct video_damage *damage = &priv->damage;
+	int xend = min(x + width, (int)priv->xsize);
+	int yend = min(y + height, (int)priv->ysize);
+
+	if (!CONFIG_IS_ENABLED(VIDEO_DAMAGE))
+		return;
+
+	x = max(x, 0);
+	y = max(y, 0);
+	if (x >= xend || y >= yend)
+		return;
+
+	if (damage->xend) {
+		damage->xstart = min(damage->xstart, x);
+		damage->ystart = min(damage->ystart, y);
+		damage->xend = max(damage->xend, xend);
+		damage->yend = max(damage->yend, yend);
+	} else {
+		damage->xstart = x;
+		damage->ystart = y;
+		damage->xend = xend;
+		damage->yend = yend;
+	}
+}
+
+/*
+ * flush_dcache_range() is declared in common.h but it seems that some
+ * architectures do not actually implement it. Is there a way to find
+ * out whether it exists? For now, ARM is safe. Sandbox counts the bytes
+ * flushed, for testing.
+ */
+#if (defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)) || \
+	defined(CONFIG_SANDBOX)
+/*
+ * Flush the damaged area of the frame buffer, or all of it if @force is
+ * true. An area narrower than the display is flushed a line at a time, so
+ * that the rest of each line is skipped.
+ */
+static void video_flush_dcache(struct video_priv *priv, bool force)
+{
+	struct video_damage *damage = &priv->damage;
+	ulong fb = (ulong)priv->fb;
+	ulong start, end;
+	int bits = VNBITS(priv->bpix);
+	int y;
+
+	if (!CONFIG_IS_ENABLED(VIDEO_DAMAGE) || force) {
+		flush_dcache_range(fb, ALIGN(fb + priv->fb_size,
+					     CONFIG_SYS_CACHELINE_SIZE));
+		return;
+	}
+	if (!damage->xend)
+		return;
+
+	start = fb + damage->ystart * priv->line_length +
+		damage->xstart * bits / 8;
+	if (!damage->xstart && damage->xend == priv->xsize) {
+		end = fb + damage->yend * priv->line_length;
+		flush_dcache_range(ALIGN_DOWN(start, CONFIG_SYS_CACHELINE_SIZE),
+				   ALIGN(end, CONFIG_SYS_CACHELINE_SIZE));
+		return;
+	}
 
-	if (priv->flush_dcache) {
-		flush_dcache_range((ulong)priv->fb,
-				   ALIGN((ulong)priv->fb + priv->fb_size,
-					 CONFIG_SYS_CACHELINE_SIZE));
+	end = start + DIV_ROUND_UP((damage->xend - damage->xstart) * bits, 8);
+	for (y = damage->ystart; y < damage->yend; y++) {
+		flush_dcache_range(ALIGN_DOWN(start, CONFIG_SYS_CACHELINE_SIZE),
+				   ALIGN(end, CONFIG_SYS_CACHELINE_SIZE));
+		start += priv->line_length;
+		end += priv->line_length;
 	}
-#elif defined(CONFIG_VIDEO_SANDBOX_SDL)
+}
+#endif
+
+/* Flush video activity to the caches */
+void video_sync(struct udevice *vid, bool force)
+{
 	struct video_priv *priv = dev_get_uclass_priv(vid);
+#if defined(CONFIG_VIDEO_SANDBOX_SDL)
 	static ulong last_sync;
+#endif
+
+#if (defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)) || \
+	defined(CONFIG_SANDBOX)
+	if (priv->flush_dcache)
+		video_flush_dcache(priv, force);
+#endif
+	priv->damage.xend = 0;
 
+#if defined(CONFIG_VIDEO_SANDBOX_SDL)
 	if (force || get_timer(last_sync) > 10) {
 		sandbox_sdl_sync(priv->fb);
 		last_sync = get_timer(0);
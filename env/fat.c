@@ -52,6 +52,7 @@ static int env_fat_save(void)
 		return 1;
 
 	dev = dev_desc->devnum;
+	fs_unmount();
 	if (fat_set_blk_dev(dev_desc, &info) != 0) {
 		/*
 		 * This printf is embedded in the messages from env_save that
@@ -99,6 +100,7 @@ static int env_fat_load(void)
 		goto err_env_relocate;
 
 	dev = dev_desc->devnum;
+	fs_unmount();
 	if (fat_set_blk_dev(dev_desc, &info) != 0) {
 		/*
 		 * This printf is embedded in the messages from env_save that
@@ -1522,6 +1522,12 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+/*
+ * Find the extent tree leaf covering file block 'fileblock'. If 'cache' holds
+ * it already, as recorded by a previous lookup, the tree is not walked again.
+ * Otherwise the leaf is read into 'cache' and the range of file blocks it
+ * covers is recorded there.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
 	(struct ext2_data *data, struct ext_block_cache *cache,
 		struct ext4_extent_header *ext_block,
@@ -1530,16 +1536,24 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
+	uint32_t first = 0, end = U32_MAX;
 	int i;
 
+	if (ext_block->eh_depth && cache->buf &&
+	    fileblock >= cache->leaf_first && fileblock < cache->leaf_end)
+		return (struct ext4_extent_header *)cache->buf;
+
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
 		if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC)
 			return NULL;
 
-		if (ext_block->eh_depth == 0)
+		if (ext_block->eh_depth == 0) {
+			cache->leaf_first = first;
+			cache->leaf_end = end;
 			return ext_block;
+		}
 		i = -1;
 		do {
 			i++;
@@ -1547,12 +1561,17 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 				break;
 		} while (fileblock >= le32_to_cpu(index[i].ei_block));
 
+		/* The next index starts the part of the tree not covered */
+		if (i < le16_to_cpu(ext_block->eh_entries))
+			end = min(end, le32_to_cpu(index[i].ei_block));
+
 		/*
 		 * If first logical block number is higher than requested fileblock,
 		 * it is a sparse file. This is handled on upper layer.
 		 */
 		if (i > 0)
 			i--;
+		first = max(first, le32_to_cpu(index[i].ei_block));
 
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
@@ -1639,6 +1658,80 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/**
+ * ext4fs_map_extent() - map file blocks of an inode using extents
+ *
+ * Look up the extent holding file block @fileblock, walking the extent tree
+ * only if the leaf found by the previous lookup through @cache does not
+ * cover it.
+ *
+ * @inode:	inode, with EXT4_EXTENTS_FL set
+ * @fileblock:	file block to look up
+ * @cache:	cache for the extent tree leaf
+ * @blknr:	returns the filesystem block holding @fileblock, or 0 if it
+ *		is in a hole
+ * @unwrittenp:	returns true if @fileblock is in an unwritten extent, whose
+ *		blocks are allocated but read as zeroes
+ * Return:	number of file blocks from @fileblock on which are contiguous
+ *		on the disk, or all in a hole (at least 1); -EINVAL if the
+ *		extent tree is invalid
+ */
+long int ext4fs_map_extent(struct ext2_inode *inode, uint32_t fileblock,
+			   struct ext_block_cache *cache, long int *blknr,
+			   bool *unwrittenp)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	uint32_t startblock, len;
+	unsigned long long start;
+	int log2_blksz;
+	bool unwritten;
+	int i;
+
+	*blknr = 0;
+	*unwrittenp = false;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
+		- get_fs()->dev_desc->log2blksz;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, cache,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		startblock = le32_to_cpu(extent[i].ee_block);
+		len = le16_to_cpu(extent[i].ee_len);
+		unwritten = len > EXT_INIT_MAX_LEN;
+		if (unwritten)
+			len -= EXT_INIT_MAX_LEN;
+
+		if (startblock > fileblock) {
+			/* Sparse file */
+			return startblock - fileblock;
+
+		} else if (fileblock - startblock < len) {
+			*unwrittenp = unwritten;
+			start = le16_to_cpu(extent[i].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			*blknr = (fileblock - startblock) + start;
+			return len - (fileblock - startblock);
+		}
+	}
+
+	/* The hole goes on up to the end of what this leaf covers */
+	if (cache->leaf_end > fileblock)
+		return cache->leaf_end - fileblock;
+
+	return 1;
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache)
 {
@@ -1649,18 +1742,15 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
 		struct ext_block_cache *c, cd;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
+		bool unwritten;
+		long int count;
 
 		if (cache) {
 			c = cache;
@@ -1668,43 +1758,15 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			c = &cd;
 			ext_cache_init(c);
 		}
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, c,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			if (!cache)
-				ext_cache_fini(c);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				if (!cache)
-					ext_cache_fini(c);
-				return 0;
-
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				if (!cache)
-					ext_cache_fini(c);
-				return (fileblock - startblock) + start;
-			}
-		}
-
+		/* Blocks of unwritten extents are allocated all the same */
+		count = ext4fs_map_extent(inode, fileblock, c, &blknr,
+					  &unwritten);
 		if (!cache)
 			ext_cache_fini(c);
-		return 0;
+		if (count < 0)
+			return count;
+
+		return blknr;
 	}
 
 	/* Direct blocks. */
@@ -2338,7 +2400,11 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* Free the file opened last, which may still be open */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -23,6 +23,7 @@
 #include <common.h>
 #include <ext_common.h>
 #include <ext4fs.h>
+#include <fs.h>
 #include "ext4_common.h"
 #include <div64.h>
 
@@ -40,143 +41,127 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/*
+ * Map the run of file blocks starting at 'fileblock' to filesystem blocks.
+ * Extents are mapped whole; other inodes a block at a time.
+ * Return the number of blocks in the run, setting *blknr to the first
+ * filesystem block or 0 for a hole, or -1 on error. Unwritten extents read
+ * as zeroes, so they are treated as holes.
+ */
+static long int ext4fs_map_blocks(struct ext2fs_node *node, lbaint_t fileblock,
+				  struct ext_block_cache *cache,
+				  long int *blknr)
+{
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		bool unwritten;
+		long int count = ext4fs_map_extent(&node->inode, fileblock,
+						   cache, blknr, &unwritten);
+
+		if (unwritten)
+			*blknr = 0;
+
+		return count < 0 ? -1 : count;
+	}
+
+	*blknr = read_allocated_block(&node->inode, fileblock, cache);
+
+	return *blknr < 0 ? -1 : 1;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
- * reads into one potentially more efficient larger sequential read action
+ * reads into one potentially more efficient larger sequential read action.
+ * Files using extents are mapped an extent at a time, so that each
+ * contiguous extent is read with a single request straight into 'buf'.
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
+	lbaint_t i, blockcnt;
+	long int count;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
 	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
 	lbaint_t delayed_next = 0;
+	loff_t delayed_skipfirst = 0;
+	loff_t delayed_extent = 0;
 	char *delayed_buf = NULL;
-	char *start_buf = buf;
-	short status;
+	loff_t end = pos + len;
 	struct ext_block_cache cache;
+	int ret = -1;
 
 	ext_cache_init(&cache);
 
 	/* Adjust len so it we can't read past the end of the file. */
-	if (len + pos > filesize)
+	if (len + pos > filesize) {
 		len = (filesize - pos);
-
-	if (blocksize <= 0 || len <= 0) {
-		ext_cache_fini(&cache);
-		return -1;
+		end = filesize;
 	}
 
-	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
+	if (blocksize <= 0 || len <= 0)
+		goto out;
 
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
-		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
-		if (blknr < 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
+	blockcnt = lldiv(end + blocksize - 1, blocksize);
 
-		blknr = blknr << log2_fs_blocksize;
+	for (i = lldiv(pos, blocksize); i < blockcnt; i += count) {
+		long int blknr;
+		loff_t runstart, runend;
 
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
+		count = ext4fs_map_blocks(node, i, &cache, &blknr);
+		if (count < 0)
+			goto out;
+		if (count > blockcnt - i)
+			count = blockcnt - i;
 
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
+		/* The part of the file this run holds */
+		runstart = max(pos, (loff_t)i * blocksize);
+		runend = min(end, (loff_t)(i + count) * blocksize);
 
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
 		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0) {
-						ext_cache_fini(&cache);
-						return -1;
-					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
+			lbaint_t sector = (lbaint_t)blknr << log2_fs_blocksize;
+
+			/* Add the run to the pending read if contiguous */
+			if (delayed_extent && delayed_next == sector &&
+			    delayed_extent + runend - runstart <= INT_MAX) {
+				delayed_extent += runend - runstart;
+				delayed_next += count << log2_fs_blocksize;
+				continue;
 			}
+			if (delayed_extent &&
+			    !ext4fs_devread(delayed_start, delayed_skipfirst,
+					    delayed_extent, delayed_buf))
+				goto out;
+
+			delayed_start = sector;
+			delayed_skipfirst = runstart - (loff_t)i * blocksize;
+			delayed_extent = runend - runstart;
+			delayed_buf = buf + (runstart - pos);
+			delayed_next = sector + (count << log2_fs_blocksize);
 		} else {
-			int n;
-			int n_left;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0) {
-					ext_cache_fini(&cache);
-					return -1;
-				}
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
-			memset(buf, 0, n);
+			if (delayed_extent &&
+			    !ext4fs_devread(delayed_start, delayed_skipfirst,
+					    delayed_extent, delayed_buf))
+				goto out;
+			delayed_extent = 0;
+
+			/* Holes read as zeroes */
+			memset(buf + (runstart - pos), 0, runend - runstart);
 		}
-		buf += blocksize - skipfirst;
-	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
-		previous_block_number = -1;
 	}
+	if (delayed_extent &&
+	    !ext4fs_devread(delayed_start, delayed_skipfirst, delayed_extent,
+			    delayed_buf))
+		goto out;
 
 	*actread  = len;
+	ret = 0;
+out:
 	ext_cache_fini(&cache);
-	return 0;
+	return ret;
 }
 
 int ext4fs_ls(const char *dirname)
@@ -255,6 +240,35 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	return ext4fs_read(buf, offset, len, len_read);
 }
 
+int ext4fs_file_open(const char *filename, struct fs_file *file)
+{
+	loff_t size;
+	int ret;
+
+	ret = ext4fs_open(filename, &size);
+	if (ret < 0)
+		return -ENOENT;
+
+	/* Take the node, so that ext4fs_close() does not free it */
+	file->priv = ext4fs_file;
+	file->size = size;
+	ext4fs_file = NULL;
+
+	return 0;
+}
+
+int ext4fs_file_read(struct fs_file *file, void *buf, loff_t offset,
+		     loff_t len, loff_t *actread)
+{
+	return ext4fs_read_file(file->priv, offset, len, buf, actread);
+}
+
+void ext4fs_file_close(struct fs_file *file)
+{
+	/* The node of a regular file is never the root, so can be freed */
+	free(file->priv);
+}
+
 int ext4fs_uuid(char *uuid_str)
 {
 	if (ext4fs_root == NULL)
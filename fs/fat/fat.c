@@ -144,95 +144,162 @@ static void get_name(dir_entry *dirent, char *s_name)
 		*s_name = DELETED_FLAG;
 }
 
-static int flush_dirty_fat_buffer(fsdata *mydata);
+static int flush_fat_window(fsdata *mydata, int slot);
 
 #if !CONFIG_IS_ENABLED(FAT_WRITE)
 /* Stub for read only operation */
-int flush_dirty_fat_buffer(fsdata *mydata)
+static int flush_fat_window(fsdata *mydata, int slot)
 {
 	(void)(mydata);
+	(void)(slot);
 	return 0;
 }
 #endif
 
 /*
- * Get the entry at index 'entry' in a FAT (12/16/32) table.
- * On failure 0x00 is returned.
+ * Forget all FAT windows held in the cache, without writing them back.
  */
-static __u32 get_fatent(fsdata *mydata, __u32 entry)
+static void fat_init_cache(fsdata *mydata)
 {
-	__u32 bufnum;
-	__u32 offset, off8;
-	__u32 ret = 0x00;
+	int i;
 
-	if (CHECK_CLUST(entry, mydata->fatsize)) {
-		printf("Error: Invalid FAT entry: 0x%08x\n", entry);
-		return ret;
+	for (i = 0; i < FATBUFWINDOWS; i++) {
+		mydata->fatbufnum[i] = -1;
+		mydata->fatbufage[i] = 0;
 	}
+	mydata->fatbufclock = 0;
+	mydata->fat_dirty = 0;
+}
+
+/*
+ * Find the FAT window holding entry 'entry' and the offset of the entry in it.
+ * Return the window number, or -1 for an unsupported FAT size.
+ */
+static int fat_entry_window(fsdata *mydata, __u32 entry, __u32 *offset)
+{
+	__u32 entries;
 
 	switch (mydata->fatsize) {
 	case 32:
-		bufnum = entry / FAT32BUFSIZE;
-		offset = entry - bufnum * FAT32BUFSIZE;
+		entries = FAT32BUFSIZE;
 		break;
 	case 16:
-		bufnum = entry / FAT16BUFSIZE;
-		offset = entry - bufnum * FAT16BUFSIZE;
+		entries = FAT16BUFSIZE;
 		break;
 	case 12:
-		bufnum = entry / FAT12BUFSIZE;
-		offset = entry - bufnum * FAT12BUFSIZE;
+		entries = FAT12BUFSIZE;
 		break;
-
 	default:
 		/* Unsupported FAT size */
-		return ret;
+		return -1;
 	}
+	*offset = entry % entries;
 
-	debug("FAT%d: entry: 0x%08x = %d, offset: 0x%04x = %d\n",
-	       mydata->fatsize, entry, entry, offset, offset);
+	return entry / entries;
+}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
+/*
+ * Get the cache slot holding FAT window 'bufnum', reading it from the disk
+ * into the least recently used slot if needed. That slot is written back
+ * first if it is dirty.
+ * Return a pointer to the window, or NULL on failure.
+ */
+static __u8 *fat_cache_window(fsdata *mydata, int bufnum, int *slotp)
+{
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	int i, slot = 0;
+
+	for (i = 0; i < FATBUFWINDOWS; i++) {
+		if (mydata->fatbufnum[i] == bufnum) {
+			slot = i;
+			goto found;
+		}
+		if (mydata->fatbufage[i] < mydata->fatbufage[slot])
+			slot = i;
+	}
 
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
 
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
+	startblock += mydata->fat_sect;	/* Offset from start of disk */
 
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
+	/* Write back the evicted window to the disk */
+	if (flush_fat_window(mydata, slot) < 0)
+		return NULL;
 
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
+	mydata->fatbufnum[slot] = -1;
+	if (disk_read(startblock, getsize,
+		      mydata->fatbuf + slot * FATBUFSIZE) < 0) {
+		debug("Error reading FAT blocks\n");
+		return NULL;
 	}
+	mydata->fatbufnum[slot] = bufnum;
+
+found:
+	mydata->fatbufage[slot] = ++mydata->fatbufclock;
+	*slotp = slot;
+
+	return mydata->fatbuf + slot * FATBUFSIZE;
+}
+
+/*
+ * Decode the entry at index 'offset' of the FAT window at 'buf'.
+ */
+static __u32 fat_decode_entry(fsdata *mydata, const __u8 *buf, __u32 offset)
+{
+	__u32 off8, ret = 0x00;
 
-	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)buf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)buf)[offset]);
 		break;
 	case 12:
 		off8 = (offset * 3) / 2;
-		/* fatbut + off8 may be unaligned, read in byte granularity */
-		ret = mydata->fatbuf[off8] + (mydata->fatbuf[off8 + 1] << 8);
+		/* buf + off8 may be unaligned, read in byte granularity */
+		ret = buf[off8] + (buf[off8 + 1] << 8);
 
 		if (offset & 0x1)
 			ret >>= 4;
 		ret &= 0xfff;
 	}
+
+	return ret;
+}
+
+/*
+ * Get the entry at index 'entry' in a FAT (12/16/32) table.
+ * On failure 0x00 is returned.
+ */
+static __u32 get_fatent(fsdata *mydata, __u32 entry)
+{
+	__u32 offset;
+	__u32 ret = 0x00;
+	__u8 *buf;
+	int bufnum, slot;
+
+	if (CHECK_CLUST(entry, mydata->fatsize)) {
+		printf("Error: Invalid FAT entry: 0x%08x\n", entry);
+		return ret;
+	}
+
+	bufnum = fat_entry_window(mydata, entry, &offset);
+	if (bufnum < 0)
+		return ret;
+
+	debug("FAT%d: entry: 0x%08x = %d, offset: 0x%04x = %d\n",
+	       mydata->fatsize, entry, entry, offset, offset);
+
+	buf = fat_cache_window(mydata, bufnum, &slot);
+	if (!buf)
+		return ret;
+
+	/* Get the actual entry from the table */
+	ret = fat_decode_entry(mydata, buf, offset);
 	debug("FAT%d: ret: 0x%08x, entry: 0x%08x, offset: 0x%04x\n",
 	       mydata->fatsize, ret, entry, offset);
 
@@ -409,18 +476,18 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 		/* get remaining bytes */
 		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
 		return 0;
 getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
-		*gotsize += (int)actsize;
+		*gotsize += actsize;
 		filesize -= actsize;
 		buffer += actsize;
 
@@ -621,9 +688,9 @@ static int get_fs_info(fsdata *mydata)
 		mydata->root_cluster = 0;
 	}
 
-	mydata->fatbufnum = -1;
-	mydata->fat_dirty = 0;
-	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	fat_init_cache(mydata);
+	mydata->free_map = NULL;
+	mydata->fatbuf = malloc_cache_aligned(FATBUFWINDOWS * FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
 		return -1;
@@ -1224,6 +1291,62 @@ out_free_itr:
 	return ret;
 }
 
+/* A file opened by fat_file_open() */
+typedef struct {
+	fsdata fsdata;
+	dir_entry dent;
+} fat_file;
+
+int fat_file_open(const char *filename, struct fs_file *file)
+{
+	fat_file *ff;
+	fat_itr *itr;
+	int ret;
+
+	ff = calloc(1, sizeof(*ff));
+	itr = malloc_cache_aligned(sizeof(fat_itr));
+	if (!ff || !itr) {
+		ret = -ENOMEM;
+		goto out_free_itr;
+	}
+	ret = fat_itr_root(itr, &ff->fsdata);
+	if (ret)
+		goto out_free_itr;
+
+	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
+	if (ret) {
+		free(ff->fsdata.fatbuf);
+		goto out_free_itr;
+	}
+
+	/* Keep the FAT cache and a copy of the entry for reading */
+	ff->dent = *itr->dent;
+	file->size = FAT2CPU32(ff->dent.size);
+	file->priv = ff;
+	ff = NULL;
+
+out_free_itr:
+	free(itr);
+	free(ff);
+	return ret;
+}
+
+int fat_file_read(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		  loff_t *actread)
+{
+	fat_file *ff = file->priv;
+
+	return get_contents(&ff->fsdata, &ff->dent, offset, buf, len, actread);
+}
+
+void fat_file_close(struct fs_file *file)
+{
+	fat_file *ff = file->priv;
+
+	free(ff->fsdata.fatbuf);
+	free(ff);
+}
+
 int file_fat_read(const char *filename, void *buffer, int maxsize)
 {
 	loff_t actread;
@@ -100,21 +100,22 @@ static void set_name(dir_entry *dirent, const char *filename)
 }
 
 /*
- * Write fat buffer into block device
+ * Write the FAT window held in cache slot 'slot' into block device, if it
+ * has been modified
  */
-static int flush_dirty_fat_buffer(fsdata *mydata)
+static int flush_fat_window(fsdata *mydata, int slot)
 {
 	int getsize = FATBUFBLOCKS;
 	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
-
-	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
-	      (int)mydata->fat_dirty);
+	__u8 *bufptr = mydata->fatbuf + slot * FATBUFSIZE;
+	__u32 startblock = mydata->fatbufnum[slot] * FATBUFBLOCKS;
 
-	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
+	if (!(mydata->fat_dirty & BIT(slot)) || mydata->fatbufnum[slot] == -1)
 		return 0;
 
+	debug("debug: evicting %d from slot %d\n", mydata->fatbufnum[slot],
+	      slot);
+
 	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
 	if (startblock + getsize > fatlength)
 		getsize = fatlength - startblock;
@@ -135,11 +136,175 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 			return -1;
 		}
 	}
-	mydata->fat_dirty = 0;
+	mydata->fat_dirty &= ~BIT(slot);
+
+	return 0;
+}
+
+/*
+ * Write all modified FAT windows into block device
+ */
+static int flush_dirty_fat_buffer(fsdata *mydata)
+{
+	int i;
+
+	for (i = 0; i < FATBUFWINDOWS && mydata->fat_dirty; i++) {
+		if (flush_fat_window(mydata, i) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Number of FAT windows decoded at once into the free-cluster map */
+#define FAT_MAP_WINDOWS	8
+
+/*
+ * Allocate the bitmap of clusters in use, so that free clusters can be found
+ * without walking the FAT through the cache. It is filled in from the FAT by
+ * fat_map_extend() as far as searches need. Allocation falls back to
+ * scanning the FAT if this fails.
+ */
+static int fat_map_init(fsdata *mydata)
+{
+	__u32 entries, max;
+
+	if (mydata->free_map)
+		return 0;
+
+	/* One entry per cluster on the disk, as far as the FAT can hold */
+	entries = (mydata->total_sect - mydata->data_begin) /
+		  mydata->clust_size;
+	if (mydata->fatsize == 12)
+		max = mydata->fatlength * mydata->sect_size * 2 / 3;
+	else
+		max = mydata->fatlength *
+		      (mydata->sect_size / (mydata->fatsize / 8));
+	entries = min(entries, max);
+
+	mydata->free_map = calloc(DIV_ROUND_UP(entries, 32), sizeof(__u32));
+	if (!mydata->free_map) {
+		debug("Error: allocating free cluster map\n");
+		return -ENOMEM;
+	}
+	mydata->free_map_size = entries;
+	mydata->free_map_valid = 0;
+	mydata->free_hint = 2;
+	debug("FAT free map: %u entries\n", entries);
+
+	return 0;
+}
+
+/*
+ * Decode the next FAT_MAP_WINDOWS windows of the FAT into the free-cluster
+ * map, reading them from the disk in one go
+ */
+static int fat_map_extend(fsdata *mydata)
+{
+	__u32 per_window, entry, offset, blk, cnt;
+	__u32 *map = mydata->free_map;
+	__u8 *buf;
+	int ret = 0;
+
+	/* The map is built from the disk, so write back the cache first */
+	if (flush_dirty_fat_buffer(mydata) < 0)
+		return -EIO;
+
+	buf = malloc_cache_aligned(FAT_MAP_WINDOWS * FATBUFSIZE);
+	if (!buf)
+		return -ENOMEM;
+
+	per_window = mydata->fatsize == 12 ? FAT12BUFSIZE :
+		     FATBUFSIZE / (mydata->fatsize / 8);
+	entry = mydata->free_map_valid;
+	blk = entry / per_window * FATBUFBLOCKS;
+	cnt = min_t(__u32, FAT_MAP_WINDOWS * FATBUFBLOCKS,
+		    mydata->fatlength - blk);
+	if (disk_read(mydata->fat_sect + blk, cnt, buf) < 0) {
+		debug("Error reading FAT blocks\n");
+		ret = -EIO;
+		goto out;
+	}
+
+	for (offset = entry % per_window;
+	     offset < FAT_MAP_WINDOWS * per_window &&
+	     entry < mydata->free_map_size; offset++, entry++) {
+		if (entry < 2 || fat_decode_entry(mydata, buf, offset))
+			map[entry / 32] |= BIT(entry % 32);
+	}
+	mydata->free_map_valid = entry;
+
+out:
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Record in the free-cluster map whether cluster 'entry' is in use
+ */
+static void fat_map_update(fsdata *mydata, __u32 entry, int used)
+{
+	__u32 *word;
+
+	/* Entries not decoded yet are read from the FAT later */
+	if (!mydata->free_map || entry >= mydata->free_map_valid)
+		return;
+
+	word = &mydata->free_map[entry / 32];
+	if (used) {
+		*word |= BIT(entry % 32);
+	} else {
+		*word &= ~BIT(entry % 32);
+		if (entry < mydata->free_hint)
+			mydata->free_hint = entry;
+	}
+}
+
+/*
+ * Find the first free cluster at or after 'start' using the free-cluster
+ * map, decoding more of the FAT into it as needed.
+ * Return the cluster, or 0 if there is none or the map cannot be used.
+ */
+static __u32 fat_map_find_free(fsdata *mydata, __u32 start)
+{
+	__u32 entry, word;
+
+	if (fat_map_init(mydata))
+		return 0;
+
+	entry = max(start, mydata->free_hint);
+	while (entry < mydata->free_map_size) {
+		if (entry >= mydata->free_map_valid &&
+		    fat_map_extend(mydata))
+			return 0;
+
+		/* Ignore the clusters before 'entry' in its word */
+		word = mydata->free_map[entry / 32] | (BIT(entry % 32) - 1);
+		if (word != ~0U) {
+			entry = entry / 32 * 32 + ffs(~word) - 1;
+			if (entry >= mydata->free_map_valid)
+				continue;
+			/* Every cluster before the first free one is in use */
+			if (start <= mydata->free_hint)
+				mydata->free_hint = entry;
+			return entry;
+		}
+		entry = (entry / 32 + 1) * 32;
+	}
 
 	return 0;
 }
 
+/*
+ * Release the free-cluster map at the end of a write operation
+ */
+static void fat_free_map(fsdata *mydata)
+{
+	free(mydata->free_map);
+	mydata->free_map = NULL;
+}
+
 /*
  * Set the file name information from 'name' into 'slotptr',
  */
@@ -263,60 +428,30 @@ fill_dir_slot(fat_itr *itr, const char *l_name)
  */
 static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
-	__u32 bufnum, offset, off16;
+	__u32 offset, off16;
 	__u16 val1, val2;
+	__u8 *fatbuf;
+	int bufnum, slot;
 
-	switch (mydata->fatsize) {
-	case 32:
-		bufnum = entry / FAT32BUFSIZE;
-		offset = entry - bufnum * FAT32BUFSIZE;
-		break;
-	case 16:
-		bufnum = entry / FAT16BUFSIZE;
-		offset = entry - bufnum * FAT16BUFSIZE;
-		break;
-	case 12:
-		bufnum = entry / FAT12BUFSIZE;
-		offset = entry - bufnum * FAT12BUFSIZE;
-		break;
-	default:
-		/* Unsupported FAT size */
+	bufnum = fat_entry_window(mydata, entry, &offset);
+	if (bufnum < 0)
 		return -1;
-	}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	fatbuf = fat_cache_window(mydata, bufnum, &slot);
+	if (!fatbuf)
+		return -1;
 
 	/* Mark as dirty */
-	mydata->fat_dirty = 1;
+	mydata->fat_dirty |= BIT(slot);
+	fat_map_update(mydata, entry, entry_value != 0);
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
-		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		((__u32 *)fatbuf)[offset] = cpu_to_le32(entry_value);
 		break;
 	case 16:
-		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		((__u16 *)fatbuf)[offset] = cpu_to_le16(entry_value);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
@@ -324,33 +459,33 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		switch (offset & 0x3) {
 		case 0:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff;
-			((__u16 *)mydata->fatbuf)[off16] |= val1;
+			((__u16 *)fatbuf)[off16] &= ~0xfff;
+			((__u16 *)fatbuf)[off16] |= val1;
 			break;
 		case 1:
 			val1 = cpu_to_le16(entry_value) & 0xf;
 			val2 = (cpu_to_le16(entry_value) >> 4) & 0xff;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xf000;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 12);
+			((__u16 *)fatbuf)[off16] &= ~0xf000;
+			((__u16 *)fatbuf)[off16] |= (val1 << 12);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xff;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xff;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 2:
 			val1 = cpu_to_le16(entry_value) & 0xff;
 			val2 = (cpu_to_le16(entry_value) >> 8) & 0xf;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xff00;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 8);
+			((__u16 *)fatbuf)[off16] &= ~0xff00;
+			((__u16 *)fatbuf)[off16] |= (val1 << 8);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xf;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xf;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 3:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff0;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 4);
+			((__u16 *)fatbuf)[off16] &= ~0xfff0;
+			((__u16 *)fatbuf)[off16] |= (val1 << 4);
 			break;
 		default:
 			break;
@@ -370,8 +505,15 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
  */
 static __u32 determine_fatent(fsdata *mydata, __u32 entry)
 {
-	__u32 next_fat, next_entry = entry + 1;
+	__u32 next_fat, next_entry;
 
+	next_entry = fat_map_find_free(mydata, entry + 1);
+	if (next_entry) {
+		set_fatent_value(mydata, entry, next_entry);
+		goto out;
+	}
+
+	next_entry = entry + 1;
 	while (1) {
 		next_fat = get_fatent(mydata, next_entry);
 		if (next_fat == 0) {
@@ -381,6 +523,7 @@ static __u32 determine_fatent(fsdata *mydata, __u32 entry)
 		}
 		next_entry++;
 	}
+out:
 	debug("FAT%d: entry: %08x, entry_value: %04x\n",
 	       mydata->fatsize, entry, next_entry);
 
@@ -608,8 +751,13 @@ get_set_cluster(fsdata *mydata, __u32 clustnum, loff_t pos, __u8 *buffer,
  */
 static int find_empty_cluster(fsdata *mydata)
 {
-	__u32 fat_val, entry = 3;
+	__u32 fat_val, entry;
+
+	entry = fat_map_find_free(mydata, 3);
+	if (entry)
+		return entry;
 
+	entry = 3;
 	while (1) {
 		fat_val = get_fatent(mydata, entry);
 		if (fat_val == 0)
@@ -1203,6 +1351,7 @@ int file_fat_write_at(const char *filename, loff_t pos, void *buffer,
 
 exit:
 	free(filename_copy);
+	fat_free_map(mydata);
 	free(mydata->fatbuf);
 	free(itr);
 	return ret;
@@ -1233,13 +1382,14 @@ static int fat_dir_entries(fat_itr *itr)
 	fsdata = *dirs->fsdata;
 
 	/* allocate local fat buffer */
-	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	fsdata.fatbuf = malloc_cache_aligned(FATBUFWINDOWS * FATBUFSIZE);
 	if (!fsdata.fatbuf) {
 		debug("Error: allocating memory\n");
 		count = -ENOMEM;
 		goto exit;
 	}
-	fsdata.fatbufnum = -1;
+	fat_init_cache(&fsdata);
+	fsdata.free_map = NULL;
 	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
@@ -1344,6 +1494,7 @@ int fat_unlink(const char *filename)
 	ret = delete_dentry(itr);
 
 exit:
+	fat_free_map(&fsdata);
 	free(fsdata.fatbuf);
 	free(itr);
 	free(filename_copy);
@@ -1480,6 +1631,7 @@ int fat_mkdir(const char *new_dirname)
 
 exit:
 	free(dirname_copy);
+	fat_free_map(mydata);
 	free(mydata->fatbuf);
 	free(itr);
 	free(dotdent);
@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <common.h>
 #include <env.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <part.h>
 #include <ext4fs.h>
@@ -19,14 +20,44 @@
 #include <div64.h>
 #include <linux/math64.h>
 #include <efi_loader.h>
+#include <image.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Size of each read by load -z, small enough to stay in the cache */
+#define FS_DECOMP_CHUNK_SIZE	SZ_64K
+
 static struct blk_desc *fs_dev_desc;
 static int fs_dev_part;
 static disk_partition_t fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/**
+ * struct fs_mount - The filesystem mounted by the last probe
+ *
+ * The filesystem drivers keep the state of a single mounted filesystem in
+ * global variables, so only the last one mounted can be kept.
+ *
+ * @desc:	Block device holding the filesystem
+ * @part:	Partition number
+ * @fstype:	Filesystem type
+ * @gen:	Incremented each time a filesystem is mounted
+ * @mounted:	true if the driver's close() method has not been called
+ * @stale:	true if the device has changed, so the mount must not be reused
+ */
+static struct fs_mount {
+	struct blk_desc *desc;
+	int part;
+	int fstype;
+	uint gen;
+	bool mounted;
+	bool stale;
+} fs_mount;
+
+/* Number of filesystems mounted */
+static ulong fs_mount_count;
+
 static inline int fs_probe_unsupported(struct blk_desc *fs_dev_desc,
 				      disk_partition_t *fs_partition)
 {
@@ -162,6 +193,19 @@ struct fstype_info {
 	int (*unlink)(const char *filename);
 	int (*mkdir)(const char *dirname);
 	int (*ln)(const char *filename, const char *target);
+	/*
+	 * Open a file, setting file->size and file->priv. Optional: without
+	 * it, each read uses read() with the file's path. See fs_open().
+	 */
+	int (*file_open)(const char *filename, struct fs_file *file);
+	/* Read from a file opened with file_open() */
+	int (*file_read)(struct fs_file *file, void *buf, loff_t offset,
+			 loff_t len, loff_t *actread);
+	/*
+	 * Free file->priv. This may be called after the filesystem has been
+	 * closed, so must not access it.
+	 */
+	void (*file_close)(struct fs_file *file);
 };
 
 static struct fstype_info fstypes[] = {
@@ -190,6 +234,9 @@ static struct fstype_info fstypes[] = {
 		.readdir = fat_readdir,
 		.closedir = fat_closedir,
 		.ln = fs_ln_unsupported,
+		.file_open = fat_file_open,
+		.file_read = fat_file_read,
+		.file_close = fat_file_close,
 	},
 #endif
 
@@ -215,6 +262,9 @@ static struct fstype_info fstypes[] = {
 		.opendir = fs_opendir_unsupported,
 		.unlink = fs_unlink_unsupported,
 		.mkdir = fs_mkdir_unsupported,
+		.file_open = ext4fs_file_open,
+		.file_read = ext4fs_file_read,
+		.file_close = ext4fs_file_close,
 	},
 #endif
 #ifdef CONFIG_SANDBOX
@@ -333,14 +383,88 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
-int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+/*
+ * Use the filesystem which is still mounted, if it is on the given partition.
+ * Filesystems without a block device, such as hostfs, are always probed.
+ */
+static bool fs_mount_reuse(struct blk_desc *desc, int part, int fstype)
+{
+	if (!CONFIG_IS_ENABLED(FS_MOUNT_CACHE) || !desc ||
+	    !fs_mount.mounted || fs_mount.stale || fs_mount.desc != desc ||
+	    fs_mount.part != part)
+		return false;
+	if (fstype != FS_TYPE_ANY && fstype != fs_mount.fstype)
+		return false;
+
+	debug("%s: reusing %s mount\n", __func__,
+	      fs_get_info(fs_mount.fstype)->name);
+	fs_dev_desc = desc;
+	fs_dev_part = part;
+	fs_type = fs_mount.fstype;
+
+	return true;
+}
+
+/* Close the mounted filesystem, if any */
+static void fs_release(void)
+{
+	if (fs_mount.mounted) {
+		fs_get_info(fs_mount.fstype)->close();
+		fs_mount.mounted = false;
+	}
+	fs_type = FS_TYPE_ANY;
+}
+
+/* Mount the filesystem on a partition, unless it is still mounted */
+static int fs_mount_dev(struct blk_desc *desc, int part,
+			disk_partition_t *partition, int fstype)
 {
 	struct fstype_info *info;
-	int part, i;
+	int i;
+
+	if (fs_mount_reuse(desc, part, fstype))
+		return 0;
+	fs_release();
+	fs_dev_desc = desc;
+	fs_partition = *partition;
+
+	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
+		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
+				fstype != info->fstype)
+			continue;
+
+		if (!fs_dev_desc && !info->null_dev_desc_ok)
+			continue;
+
+		if (!info->probe(fs_dev_desc, &fs_partition)) {
+			fs_type = info->fstype;
+			fs_dev_part = part;
+			fs_mount.desc = desc;
+			fs_mount.part = part;
+			fs_mount.fstype = fs_type;
+			fs_mount.gen++;
+			fs_mount.mounted = true;
+			fs_mount.stale = false;
+			fs_mount_count++;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+{
+	struct blk_desc *desc;
+	disk_partition_t partition;
+	int part;
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
 	static int relocated;
 
 	if (!relocated) {
+		struct fstype_info *info;
+		int i;
+
 		for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes);
 				i++, info++) {
 			info->name += gd->reloc_off;
@@ -354,63 +478,69 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	}
 #endif
 
-	part = blk_get_device_part_str(ifname, dev_part_str, &fs_dev_desc,
-					&fs_partition, 1);
+	part = blk_get_device_part_str(ifname, dev_part_str, &desc,
+				       &partition, 1);
 	if (part < 0)
 		return -1;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
-				fstype != info->fstype)
-			continue;
+	return fs_mount_dev(desc, part, &partition, fstype);
+}
 
-		if (!fs_dev_desc && !info->null_dev_desc_ok)
-			continue;
+/* Select a partition, mounting its filesystem unless it is still mounted */
+static int fs_select(struct blk_desc *desc, int part, int fstype)
+{
+	disk_partition_t partition;
+	int ret;
 
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
+	if (fs_mount_reuse(desc, part, fstype))
+		return 0;
+
+	if (!desc) {
+		memset(&partition, '\0', sizeof(partition));
+		ret = 0;
+	} else if (part >= 1) {
+		ret = part_get_info(desc, part, &partition);
+	} else {
+		ret = part_get_info_whole_disk(desc, &partition);
 	}
+	if (ret)
+		return ret;
 
-	return -1;
+	return fs_mount_dev(desc, part, &partition, fstype);
 }
 
 /* set current blk device w/ blk_desc + partition # */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 {
-	struct fstype_info *info;
-	int ret, i;
-
-	if (part >= 1)
-		ret = part_get_info(desc, part, &fs_partition);
-	else
-		ret = part_get_info_whole_disk(desc, &fs_partition);
-	if (ret)
-		return ret;
-	fs_dev_desc = desc;
-
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
+	return fs_select(desc, part, FS_TYPE_ANY);
 }
 
 void fs_close(void)
 {
-	struct fstype_info *info = fs_get_info(fs_type);
-
-	info->close();
+	/*
+	 * Keep the filesystem mounted so that the next operation on this
+	 * partition does not need to probe it again
+	 */
+	if (!CONFIG_IS_ENABLED(FS_MOUNT_CACHE) || !fs_mount.desc ||
+	    fs_mount.stale)
+		fs_release();
 
 	fs_type = FS_TYPE_ANY;
 }
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+void fs_unmount(void)
+{
+	fs_release();
+}
+
+void fs_invalidate(struct blk_desc *desc)
+{
+	if (fs_mount.mounted && fs_mount.desc == desc)
+		fs_mount.stale = true;
+}
+#endif
+
 int fs_uuid(char *uuid_str)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
@@ -457,20 +587,140 @@ int fs_size(const char *filename, loff_t *size)
 	return ret;
 }
 
+/* Open a file on the current filesystem, which is left mounted */
+static int fs_file_do_open(struct fstype_info *info, const char *filename,
+			   struct fs_file **filep)
+{
+	struct fs_file *file;
+	int ret;
+
+	file = calloc(1, sizeof(*file) + strlen(filename) + 1);
+	if (!file)
+		return -ENOMEM;
+	strcpy(file->name, filename);
+	file->desc = fs_dev_desc;
+	file->part = fs_dev_part;
+	file->fstype = fs_type;
+	file->gen = fs_mount.gen;
+
+	if (info->file_open)
+		ret = info->file_open(filename, file);
+	else
+		ret = info->size(filename, &file->size);
+	if (ret) {
+		free(file);
+		return ret < 0 ? ret : -ENOENT;
+	}
+	*filep = file;
+
+	return 0;
+}
+
+/* Read part of an open file, which must be on the current filesystem */
+static int fs_file_do_read(struct fstype_info *info, struct fs_file *file,
+			   void *buf, loff_t offset, loff_t len,
+			   loff_t *actread)
+{
+	if (info->file_read)
+		return info->file_read(file, buf, offset, len, actread);
+
+	/* Drivers without file_read() look up the file each time */
+	return info->read(file->name, buf, offset, len, actread);
+}
+
+/* Free the filesystem driver's data for a file */
+static void fs_file_release(struct fs_file *file)
+{
+	struct fstype_info *info = fs_get_info(file->fstype);
+
+	if (file->priv && info->file_close)
+		info->file_close(file);
+	file->priv = NULL;
+}
+
+int fs_open(const char *filename, struct fs_file **filep)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	int ret;
+
+	ret = fs_file_do_open(info, filename, filep);
+	fs_close();
+
+	return ret;
+}
+
+int fs_file_read(struct fs_file *file, void *buf, loff_t len,
+		 loff_t *actread)
+{
+	struct fstype_info *info;
+	int ret;
+
+	*actread = 0;
+	if (!len || file->pos >= file->size)
+		return 0;
+	len = min(len, file->size - file->pos);
+
+	ret = fs_select(file->desc, file->part, file->fstype);
+	if (ret)
+		return ret < 0 ? ret : -ENODEV;
+	info = fs_get_info(fs_type);
+
+	/*
+	 * If the filesystem has been mounted again since the file was
+	 * opened, the driver's data for it is no longer valid
+	 */
+	if (file->gen != fs_mount.gen) {
+		fs_file_release(file);
+		if (info->file_open) {
+			ret = info->file_open(file->name, file);
+			if (ret)
+				goto out;
+		}
+		file->gen = fs_mount.gen;
+		if (file->pos >= file->size)
+			goto out;
+		len = min(len, file->size - file->pos);
+	}
+
+	ret = fs_file_do_read(info, file, buf, file->pos, len, actread);
+	if (!ret)
+		file->pos += *actread;
+out:
+	fs_close();
+
+	return ret;
+}
+
+int fs_file_seek(struct fs_file *file, loff_t pos)
+{
+	if (pos < 0)
+		return -EINVAL;
+	file->pos = pos;
+
+	return 0;
+}
+
+void fs_file_close(struct fs_file *file)
+{
+	if (!file)
+		return;
+	fs_file_release(file);
+	free(file);
+}
+
+ulong fs_get_mount_count(void)
+{
+	return fs_mount_count;
+}
+
 #ifdef CONFIG_LMB
-/* Check if a file may be read to the given address */
-static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
-			     loff_t len, struct fstype_info *info)
+/* Check if a file of the given size may be read to the given address */
+static int fs_read_lmb_check(ulong addr, loff_t offset, loff_t len,
+			     loff_t size)
 {
 	struct lmb lmb;
-	int ret;
-	loff_t size;
 	loff_t read_len;
 
-	/* get the actual size of the file */
-	ret = info->size(filename, &size);
-	if (ret)
-		return ret;
 	if (offset >= size) {
 		/* offset >= EOF, no bytes will be written */
 		return 0;
@@ -496,28 +746,44 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 		    int do_lmb_check, loff_t *actread)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
+	struct fs_file *file;
+	loff_t read_len;
 	void *buf;
 	int ret;
 
+	/* Look up the file once, for both the size check and the read */
+	ret = fs_file_do_open(info, filename, &file);
+	if (ret) {
+		printf("** File not found %s **\n", filename);
+		goto out;
+	}
+
 #ifdef CONFIG_LMB
 	if (do_lmb_check) {
-		ret = fs_read_lmb_check(filename, addr, offset, len, info);
+		ret = fs_read_lmb_check(addr, offset, len, file->size);
 		if (ret)
-			return ret;
+			goto out_close;
 	}
 #endif
 
-	/*
-	 * We don't actually know how many bytes are being read, since len==0
-	 * means read the whole file.
-	 */
-	buf = map_sysmem(addr, len);
-	ret = info->read(filename, buf, offset, len, actread);
-	unmap_sysmem(buf);
+	/* len==0 means read the whole file */
+	*actread = 0;
+	read_len = file->size - offset;
+	if (len && len < read_len)
+		read_len = len;
+	if (read_len > 0) {
+		buf = map_sysmem(addr, read_len);
+		ret = fs_file_do_read(info, file, buf, offset, read_len,
+				      actread);
+		unmap_sysmem(buf);
+	}
 
 	/* If we requested a specific number of bytes, check we got it */
 	if (ret == 0 && len && *actread != len)
 		debug("** %s shorter than offset + len **\n", filename);
+out_close:
+	fs_file_close(file);
+out:
 	fs_close();
 
 	return ret;
@@ -529,6 +795,98 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return _fs_read(filename, addr, offset, len, 0, actread);
 }
 
+/* Get the number of bytes which may be written at @addr */
+static ulong fs_get_free_size(ulong addr)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	return lmb_get_free_size(&lmb, addr);
+#else
+	return gd->ram_top > addr ? gd->ram_top - addr : 0;
+#endif
+}
+
+/*
+ * Read a compressed file a chunk at a time, decompressing each chunk while
+ * it is still in the cache. The compression is worked out from the start of
+ * the file.
+ */
+static int fs_read_decomp(const char *filename, ulong addr, loff_t offset,
+			  ulong max, ulong *sizep, loff_t *actread)
+{
+	struct fstype_info *info = fs_get_info(fs_type);
+	struct image_decomp_stream ds;
+	struct fs_file *file;
+	loff_t len;
+	void *buf;
+	int comp;
+	int ret, err;
+
+	*actread = 0;
+	ret = fs_file_do_open(info, filename, &file);
+	if (ret) {
+		printf("** File not found %s **\n", filename);
+		goto out;
+	}
+	buf = malloc(FS_DECOMP_CHUNK_SIZE);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out_close;
+	}
+
+	len = min_t(loff_t, file->size - offset, FS_DECOMP_CHUNK_SIZE);
+	ret = len > 0 ? fs_file_do_read(info, file, buf, offset, len, &len) :
+		-EINVAL;
+	if (ret)
+		goto out_free;
+	comp = image_decomp_detect(buf, len);
+	ret = image_decomp_stream_start(&ds, comp, map_sysmem(addr, max), max);
+	if (ret == -EPROTONOSUPPORT) {
+		printf("** %s compression is not supported **\n",
+		       genimg_get_comp_name(comp));
+		goto out_free;
+	} else if (ret) {
+		goto out_free;
+	}
+
+	while (len) {
+		*actread += len;
+		ret = image_decomp_stream_feed(&ds, buf, len);
+		if (ret)
+			break;
+		len = min_t(loff_t, file->size - offset - *actread,
+			    FS_DECOMP_CHUNK_SIZE);
+		if (len)
+			ret = fs_file_do_read(info, file, buf,
+					      offset + *actread, len, &len);
+		if (ret)
+			break;
+	}
+	err = image_decomp_stream_end(&ds, sizep);
+	unmap_sysmem(ds.dst);
+	if (ret == -ENOSPC)
+		printf("** Uncompressed file is larger than %#lx bytes **\n",
+		       max);
+	else if (!ret && err)
+		printf("** %s is truncated **\n", filename);
+	if (!ret)
+		ret = err;
+	if (!ret && comp != IH_COMP_NONE)
+		printf("%s data: %lu bytes uncompressed\n",
+		       genimg_get_comp_name(comp), *sizep);
+out_free:
+	free(buf);
+out_close:
+	fs_file_close(file);
+out:
+	fs_close();
+
+	return ret;
+}
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -544,7 +902,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 		printf("** Unable to write file %s **\n", filename);
 		ret = -1;
 	}
-	fs_close();
+	fs_release();
 
 	return ret;
 }
@@ -609,7 +967,7 @@ int fs_unlink(const char *filename)
 
 	ret = info->unlink(filename);
 
-	fs_close();
+	fs_release();
 
 	return ret;
 }
@@ -622,7 +980,7 @@ int fs_mkdir(const char *dirname)
 
 	ret = info->mkdir(dirname);
 
-	fs_close();
+	fs_release();
 
 	return ret;
 }
@@ -638,7 +996,7 @@ int fs_ln(const char *fname, const char *target)
 		printf("** Unable to create link %s -> %s **\n", fname, target);
 		ret = -1;
 	}
-	fs_close();
+	fs_release();
 
 	return ret;
 }
@@ -671,10 +1029,18 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	loff_t bytes;
 	loff_t pos;
 	loff_t len_read;
+	ulong size;
+	bool decomp = false;
 	int ret;
 	unsigned long time;
 	char *ep;
 
+	if (IS_ENABLED(CONFIG_CMD_FS_LOAD_DECOMP) && argc > 1 &&
+	    !strcmp(argv[1], "-z")) {
+		decomp = true;
+		argc--;
+		argv++;
+	}
 	if (argc < 2)
 		return CMD_RET_USAGE;
 	if (argc > 7)
@@ -717,7 +1083,16 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 			(argc > 4) ? argv[4] : "");
 #endif
 	time = get_timer(0);
-	ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
+	if (decomp) {
+		size = fs_get_free_size(addr);
+		if (bytes && bytes < size)
+			size = bytes;
+		ret = fs_read_decomp(filename, addr, pos, size, &size,
+				     &len_read);
+	} else {
+		ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
+		size = len_read;
+	}
 	time = get_timer(time);
 	if (ret < 0)
 		return 1;
@@ -731,7 +1106,7 @@ int do_load(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	puts("\n");
 
 	env_set_hex("fileaddr", addr);
-	env_set_hex("filesize", len_read);
+	env_set_hex("filesize", size);
 
 	return 0;
 }
@@ -67,6 +67,9 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+	struct dm_compat_index *dm_compat_index; /* Driver compatible index */
+	struct uclass	**uclass_by_id;	/* Uclasses indexed by uclass ID */
+	struct dm_stats	*dm_stats;	/* Driver model lookup counts */
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;		/* Timer instance for Driver Model */
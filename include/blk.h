@@ -8,6 +8,7 @@
 #define BLK_H
 
 #include <efi.h>
+#include <linux/errno.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -114,41 +115,54 @@ struct blk_desc {
 
 #if CONFIG_IS_ENABLED(BLOCK_CACHE)
 /**
- * blkcache_read() - attempt to read a set of blocks from cache
+ * blkcache_dread() - read a set of blocks through the block cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * Small reads are served from the cache, reading whole cache lines (and
+ * possibly some lines ahead) from the device on a miss. Large reads go
+ * straight to the device.
+ *
+ * @param desc - block device descriptor
  * @param start - starting block number
  * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
- * @param buf - buffer to contain cached data
+ * @param buffer - buffer to contain the data
  *
- * @return - '1' if block returned from cache, '0' otherwise.
+ * @return - number of blocks read, or -ve error number
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+ulong blkcache_dread(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		     void *buffer);
 
 /**
- * blkcache_fill() - make data read from a block device available
- * to the block cache
+ * blkcache_dwrite() - write a set of blocks through the block cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * In write-through mode the data is written to the device and any cached
+ * copy is updated. In write-back mode small writes only update the cache
+ * and are written to the device later by blkcache_flush().
+ *
+ * @param desc - block device descriptor
  * @param start - starting block number
- * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
- * @param buf - buffer containing data to cache
+ * @param blkcnt - number of blocks to write
+ * @param buffer - buffer containing the data
  *
+ * @return - number of blocks written, or -ve error number
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+ulong blkcache_dwrite(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		      const void *buffer);
+
+/**
+ * blkcache_flush() - write dirty cache lines back to the device
+ *
+ * @param desc - block device descriptor, or NULL for all devices
+ *
+ * @return - 0 if OK, -EIO if a line could not be written
+ */
+int blkcache_flush(struct blk_desc *desc);
 
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
  *
+ * Dirty lines of the device are written back before being discarded.
+ *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
  */
@@ -157,11 +171,21 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - blocks per cache line, rounded up to a power of two
+ * @param entries - number of cache lines, 0 to disable the cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
+/**
+ * blkcache_set_writeback() - select write-back or write-through mode
+ *
+ * Switching to write-through flushes all dirty lines.
+ *
+ * @param enable - true for write-back, false for write-through
+ * @return - 0 if OK, -EIO if dirty lines could not be flushed
+ */
+int blkcache_set_writeback(bool enable);
+
 /*
  * statistics of the block cache
  */
@@ -171,6 +195,22 @@ struct block_cache_stats {
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned ways; /* entries per set */
+	unsigned writebacks; /* lines written back */
+	unsigned dirty; /* current dirty entry count */
+	bool writeback; /* write-back mode enabled */
+};
+
+/*
+ * per-device statistics of the block cache
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned misses;
+	unsigned readahead; /* blocks read ahead of requests */
+	unsigned bypass; /* reads too large to be cached */
 };
 
 /**
@@ -180,18 +220,33 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_dev_stats() - return statistics of one device and reset
+ *
+ * @param index - index of the device, starting at 0
+ * @param stats - statistics are copied here
+ * @return - 0 if OK, -ENOENT if there is no such device
+ */
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats);
+
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline ulong blkcache_dread(struct blk_desc *desc, lbaint_t start,
+				   lbaint_t blkcnt, void *buffer)
 {
-	return 0;
+	return -ENOSYS;
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
+static inline ulong blkcache_dwrite(struct blk_desc *desc, lbaint_t start,
+				    lbaint_t blkcnt, const void *buffer)
+{
+	return -ENOSYS;
+}
+
+static inline int blkcache_flush(struct blk_desc *desc)
+{
+	return 0;
+}
 
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
@@ -428,28 +483,23 @@ struct blk_desc *blk_get_by_device(struct udevice *dev);
 static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
-	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-
 	/*
 	 * We could check if block_read is NULL and return -ENOSYS. But this
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
-	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
+	if (CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return blkcache_dread(block_dev, start, blkcnt, buffer);
 
-	return blks_read;
+	return block_dev->block_read(block_dev, start, blkcnt, buffer);
 }
 
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	if (CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return blkcache_dwrite(block_dev, start, blkcnt, buffer);
+
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
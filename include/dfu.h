@@ -104,6 +104,9 @@ struct virt_internal_data {
 #ifndef CONFIG_SYS_DFU_MAX_FILE_SIZE
 #define CONFIG_SYS_DFU_MAX_FILE_SIZE CONFIG_SYS_DFU_DATA_BUF_SIZE
 #endif
+#ifndef CONFIG_DFU_WRITE_BUFFERS
+#define CONFIG_DFU_WRITE_BUFFERS	1
+#endif
 #ifndef DFU_DEFAULT_POLL_TIMEOUT
 #define DFU_DEFAULT_POLL_TIMEOUT 0
 #endif
@@ -152,6 +155,7 @@ struct dfu_entity {
 	u8 *i_buf_end;
 	u64 r_left;
 	long b_left;
+	ulong start_time;
 
 	u32 bad_skip;	/* for nand use */
 
@@ -183,6 +187,18 @@ int dfu_read(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_write_poll - write out one buffer queued by dfu_write()
+ *
+ * With CONFIG_DFU_WRITE_BUFFERS > 1, dfu_write() queues full buffers instead
+ * of writing them to the medium straight away. Transports call this from
+ * their polling loop so that the medium is written between incoming packets.
+ * An error is also reported by the next dfu_write() or dfu_flush().
+ *
+ * @return - 0 on success or if nothing was queued, other value on failure
+ */
+int dfu_write_poll(void);
+
 /**
  * dfu_initiated_callback - weak callback called on DFU transaction start
  *
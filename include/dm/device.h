@@ -126,6 +126,8 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @seq_hnode: Used by uclass to map @seq to this device
+ * @node_hnode: Used by uclass to map @node to this device
  */
 struct udevice {
 	const struct driver *driver;
@@ -149,6 +151,10 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	struct hlist_node seq_hnode;
+	struct hlist_node node_hnode;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -165,9 +171,26 @@ static inline int dev_of_offset(const struct udevice *dev)
 	return ofnode_to_offset(dev->node);
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+/**
+ * dev_set_ofnode() - Change the device tree node of a bound device
+ *
+ * This keeps the uclass's map of devices by node up to date
+ *
+ * @dev: Device to update
+ * @node: New node for the device
+ */
+void dev_set_ofnode(struct udevice *dev, ofnode node);
+#else
+static inline void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dev->node = node;
+}
+#endif
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
@@ -61,6 +61,34 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * This returns the first driver in the driver list which has @compat in its
+ * of_match table. With CONFIG_DM_COMPAT_INDEX this is a single lookup in a
+ * hash table, which is built on first use.
+ *
+ * @compat: Compatible string to look up
+ * @of_idp: Returns the matching entry of the driver's of_match table
+ * @return pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **of_idp);
+
+/**
+ * lists_compat_index_free() - Free the compatible-string index
+ *
+ * The index is built again on the next lookup. This is called when driver
+ * model is shut down.
+ */
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+void lists_compat_index_free(void);
+#else
+static inline void lists_compat_index_free(void)
+{
+}
+#endif
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
@@ -258,6 +258,35 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
  */
 struct device_node *of_find_node_by_phandle(phandle handle);
 
+/**
+ * of_populate_phandle_cache() - Build the cache used by
+ *	of_find_node_by_phandle()
+ *
+ * Without the cache each lookup walks the whole tree. The cache is only
+ * used for the tree it was built for, i.e. the one at gd->of_root when this
+ * is called.
+ *
+ * @return 0 if OK, -ENOMEM if not enough memory
+ */
+int of_populate_phandle_cache(void);
+
+/**
+ * of_free_phandle_cache() - Free the cache used by of_find_node_by_phandle()
+ *
+ * Lookups walk the whole tree until the cache is built again.
+ */
+void of_free_phandle_cache(void);
+
+/**
+ * of_phandle_walk_count() - Get the number of nodes visited by
+ *	of_find_node_by_phandle()
+ *
+ * Only lookups that miss the cache visit nodes. This is used for testing.
+ *
+ * @return total number of nodes visited so far
+ */
+ulong of_phandle_walk_count(void);
+
 /**
  * of_read_u32() - Find and read a 32-bit integer from a property
  *
@@ -196,6 +196,24 @@ int uclass_unbind_device(struct udevice *dev);
 static inline int uclass_unbind_device(struct udevice *dev) { return 0; }
 #endif
 
+/**
+ * uclass_set_seq() - Set the sequence number of a device
+ *
+ * This sets dev->seq, keeping the uclass's map of devices by sequence
+ * number up to date.
+ *
+ * @dev:	Pointer to the device
+ * @seq:	New sequence number, or -1 if none
+ */
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+void uclass_set_seq(struct udevice *dev, int seq);
+#else
+static inline void uclass_set_seq(struct udevice *dev, int seq)
+{
+	dev->seq = seq;
+}
+#endif
+
 /**
  * uclass_pre_probe_device() - Deal with a device that is about to be probed
  *
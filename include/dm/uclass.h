@@ -14,6 +14,10 @@
 #include <linker_lists.h>
 #include <linux/list.h>
 
+/* Number of buckets in each of a uclass's device maps, a power of two */
+#define DM_UCLASS_MAP_BITS	3
+#define DM_UCLASS_MAP_SIZE	(1 << DM_UCLASS_MAP_BITS)
+
 /**
  * struct uclass - a U-Boot drive class, collecting together similar drivers
  *
@@ -30,12 +34,18 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @seq_map: Hash map of probed devices, by sequence number
+ * @node_map: Hash map of devices with a device tree node, by node
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS)
+	struct hlist_head seq_map[DM_UCLASS_MAP_SIZE];
+	struct hlist_head node_map[DM_UCLASS_MAP_SIZE];
+#endif
 };
 
 struct driver;
@@ -30,6 +30,37 @@ void dm_dump_all(void);
 /* Dump out a list of uclasses and their devices */
 void dm_dump_uclass(void);
 
+/**
+ * struct dm_stats - counts of driver model lookups
+ *
+ * These are collected when CONFIG_DM_STATS is enabled, and cleared by
+ * dm_init().
+ *
+ * @uclass_find: Number of uclasses looked up by ID
+ * @uclass_walk: Number of uclasses compared while doing that
+ * @seq_find: Number of devices looked up by sequence number
+ * @seq_walk: Number of devices compared while doing that
+ * @ofnode_find: Number of devices looked up by device tree node
+ * @ofnode_walk: Number of devices compared while doing that
+ */
+struct dm_stats {
+	ulong uclass_find;
+	ulong uclass_walk;
+	ulong seq_find;
+	ulong seq_walk;
+	ulong ofnode_find;
+	ulong ofnode_walk;
+};
+
+#if CONFIG_IS_ENABLED(DM_STATS)
+/* Dump out the driver model lookup counts */
+void dm_dump_stats(void);
+#else
+static inline void dm_dump_stats(void)
+{
+}
+#endif
+
 #ifdef CONFIG_DEBUG_DEVRES
 /* Dump out a list of device resources */
 void dm_dump_devres(void);
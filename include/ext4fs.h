@@ -58,6 +58,9 @@ struct ext4_extent {
 	__le32	ee_start_lo;	/* low 32 bits of physical block */
 };
 
+/* Longer extents are unwritten, and cover ee_len - EXT_INIT_MAX_LEN blocks */
+#define EXT_INIT_MAX_LEN	(1U << 15)
+
 /*
  * This is index on-disk structure.
  * It's used at all the levels except the bottom.
@@ -121,6 +124,9 @@ struct ext_block_cache {
 	char *buf;
 	lbaint_t block;
 	int size;
+	/* File blocks covered by buf, when it holds an extent tree leaf */
+	uint32_t leaf_first;
+	uint32_t leaf_end;
 };
 
 extern struct ext2_data *ext4fs_root;
@@ -141,6 +147,8 @@ int ext4_write_file(const char *filename, void *buf, loff_t offset, loff_t len,
 int ext4fs_create_link(const char *target, const char *fname);
 #endif
 
+struct fs_file;
+
 struct ext_filesystem *get_fs(void);
 int ext4fs_open(const char *filename, loff_t *len);
 int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread);
@@ -155,12 +163,19 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, disk_partition_t *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+long int ext4fs_map_extent(struct ext2_inode *inode, uint32_t fileblock,
+			   struct ext_block_cache *cache, long int *blknr,
+			   bool *unwrittenp);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 disk_partition_t *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actread);
 int ext4_read_superblock(char *buffer);
 int ext4fs_uuid(char *uuid_str);
+int ext4fs_file_open(const char *filename, struct fs_file *file);
+int ext4fs_file_read(struct fs_file *file, void *buf, loff_t offset,
+		     loff_t len, loff_t *actread);
+void ext4fs_file_close(struct fs_file *file);
 void ext_cache_init(struct ext_block_cache *cache);
 void ext_cache_fini(struct ext_block_cache *cache);
 int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size);
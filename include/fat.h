@@ -25,6 +25,11 @@
 
 #define FATBUFBLOCKS	6
 #define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
+#if defined(CONFIG_FS_FAT_CACHE_WINDOWS) && !defined(CONFIG_SPL_BUILD)
+#define FATBUFWINDOWS	CONFIG_FS_FAT_CACHE_WINDOWS
+#else
+#define FATBUFWINDOWS	1
+#endif
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
@@ -161,20 +166,26 @@ typedef struct dir_slot {
  * (see FAT32 accesses)
  */
 typedef struct {
-	__u8	*fatbuf;	/* Current FAT buffer */
+	__u8	*fatbuf;	/* FAT cache of FATBUFWINDOWS windows */
 	int	fatsize;	/* Size of FAT in bits */
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
-	__u8	fat_dirty;      /* Set if fatbuf has been modified */
+	__u32	fat_dirty;      /* Bitmask of modified windows in fatbuf */
 	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
 	int	data_begin;	/* The sector of the first cluster, can be negative */
-	int	fatbufnum;	/* Used by get_fatent, init to -1 */
+	int	fatbufnum[FATBUFWINDOWS]; /* FAT window held, init to -1 */
+	__u32	fatbufage[FATBUFWINDOWS]; /* Last use, for LRU eviction */
+	__u32	fatbufclock;	/* Incremented on each use of a window */
 	int	rootdir_size;	/* Size of root dir for non-FAT32 */
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
 	int	fats;		/* Number of FATs */
+	__u32	*free_map;	/* Bitmap of clusters in use */
+	__u32	free_map_size;	/* Number of FAT entries in free_map */
+	__u32	free_map_valid;	/* Number of entries decoded into free_map */
+	__u32	free_hint;	/* No free cluster before this one */
 } fsdata;
 
 static inline u32 clust_to_sect(fsdata *fsdata, u32 clust)
@@ -203,6 +214,10 @@ int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 int fat_opendir(const char *filename, struct fs_dir_stream **dirsp);
 int fat_readdir(struct fs_dir_stream *dirs, struct fs_dirent **dentp);
 void fat_closedir(struct fs_dir_stream *dirs);
+int fat_file_open(const char *filename, struct fs_file *file);
+int fat_file_read(struct fs_file *file, void *buf, loff_t offset, loff_t len,
+		  loff_t *actread);
+void fat_file_close(struct fs_file *file);
 int fat_unlink(const char *filename);
 int fat_mkdir(const char *dirname);
 void fat_close(void);
@@ -648,6 +648,26 @@ int fdtdec_get_chosen_node(const void *blob, const char *name);
  */
 const char *fdtdec_get_compatible(enum fdt_compat_id id);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find a node given its phandle
+ *
+ * This is fdt_node_offset_by_phandle(), except that lookups in the control
+ * FDT (gd->fdt_blob) go through a cache after relocation, rather than
+ * walking the whole tree each time. The cache is built on first use.
+ *
+ * @blob: FDT blob
+ * @phandle: phandle of the node to find
+ * @return node offset if found, -ve FDT error code on error
+ */
+#ifndef CONFIG_SPL_BUILD
+int fdtdec_node_offset_by_phandle(const void *blob, u32 phandle);
+#else
+static inline int fdtdec_node_offset_by_phandle(const void *blob, u32 phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+#endif
+
 /* Look up a phandle and follow it to its node. Then return the offset
  * of that node.
  *
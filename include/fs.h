@@ -124,6 +124,109 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite);
 
+/**
+ * struct fs_file - A file opened with fs_open()
+ *
+ * @desc:	Block device holding the filesystem (NULL for hostfs, etc.)
+ * @part:	Partition number on @desc
+ * @fstype:	Filesystem type (FS_TYPE_...)
+ * @gen:	Mount generation the file was opened with, so that it can be
+ *		opened again if the filesystem has been mounted since
+ * @size:	Size of the file in bytes
+ * @pos:	Position of the next fs_file_read() in the file
+ * @priv:	Private data of the filesystem driver
+ * @name:	Full path of the file
+ */
+struct fs_file {
+	struct blk_desc *desc;
+	int part;
+	int fstype;
+	uint gen;
+	loff_t size;
+	loff_t pos;
+	void *priv;
+	char name[];
+};
+
+/**
+ * fs_open() - Open a file on the partition set by fs_set_blk_dev()
+ *
+ * The file stays open after the filesystem is closed and can be read with
+ * fs_file_read() without calling fs_set_blk_dev() again. The filesystem
+ * is mounted again for reading only if something else has been mounted in
+ * the meantime.
+ *
+ * @filename:	Full path of the file to open
+ * @filep:	Returns the open file
+ * Return:	0 if OK, -ve on error
+ */
+int fs_open(const char *filename, struct fs_file **filep);
+
+/**
+ * fs_file_read() - Read from a file opened with fs_open()
+ *
+ * This reads from the current position of the file and moves the position
+ * past the data read.
+ *
+ * @file:	File to read
+ * @buf:	Buffer to read into
+ * @len:	Maximum number of bytes to read
+ * @actread:	Returns the number of bytes read, 0 at the end of the file
+ * Return:	0 if OK, -ve on error
+ */
+int fs_file_read(struct fs_file *file, void *buf, loff_t len,
+		 loff_t *actread);
+
+/**
+ * fs_file_seek() - Set the position of the next read in a file
+ *
+ * @file:	File to update
+ * @pos:	New position, which may be past the end of the file
+ * Return:	0 if OK, -EINVAL if @pos is negative
+ */
+int fs_file_seek(struct fs_file *file, loff_t pos);
+
+/**
+ * fs_file_close() - Close a file opened with fs_open()
+ *
+ * @file:	File to close (may be NULL)
+ */
+void fs_file_close(struct fs_file *file);
+
+/**
+ * fs_get_mount_count() - Get the number of times a filesystem was mounted
+ *
+ * This counts the successful probes of a filesystem by fs_set_blk_dev()
+ * and friends, which are avoided when the filesystem is still mounted.
+ *
+ * Return: number of mounts since U-Boot started
+ */
+ulong fs_get_mount_count(void);
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_unmount() - Close the filesystem kept mounted by the fs layer
+ *
+ * This must be called before using a filesystem driver directly, e.g.
+ * fat_set_blk_dev(), so that the fs layer does not reuse the driver's
+ * state afterwards.
+ */
+void fs_unmount(void);
+
+/**
+ * fs_invalidate() - Note that a block device has been changed or removed
+ *
+ * If a filesystem on @desc is mounted, it will be mounted again the next
+ * time it is used.
+ *
+ * @desc:	Block device which was written to or removed
+ */
+void fs_invalidate(struct blk_desc *desc);
+#else
+static inline void fs_unmount(void) {}
+static inline void fs_invalidate(struct blk_desc *desc) {}
+#endif
+
 /*
  * Directory entry types, matches the subset of DT_x in posix readdir()
  * which apply to u-boot.
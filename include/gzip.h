@@ -43,6 +43,44 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 	   int stoponerr, int offset);
 
+struct gunzip_stream;
+
+/**
+ * gunzip_stream_start() - Start decompressing gzipped data in pieces
+ *
+ * The data is then passed in with gunzip_stream_feed() as it becomes
+ * available, e.g. as it is read from a storage device, so that the whole
+ * compressed image never needs to be held in memory.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @return stream context, or NULL if out of memory
+ */
+struct gunzip_stream *gunzip_stream_start(void *dst, ulong dstlen);
+
+/**
+ * gunzip_stream_feed() - Decompress the next piece of gzipped data
+ *
+ * The first piece must contain the complete gzip header. Any data after the
+ * end of the compressed stream (e.g. the gzip trailer) is ignored.
+ *
+ * @gs: Stream context from gunzip_stream_start()
+ * @src: Next piece of compressed data
+ * @len: Length of data at @src
+ * @return 0 if OK, -ENOSPC if the destination buffer is full, other -ve on
+ *	error
+ */
+int gunzip_stream_feed(struct gunzip_stream *gs, const void *src, ulong len);
+
+/**
+ * gunzip_stream_end() - Finish decompressing and free the stream context
+ *
+ * @gs: Stream context from gunzip_stream_start()
+ * @lenp: Returns length of uncompressed data
+ * @return 0 if OK, -EIO if the compressed stream was incomplete
+ */
+int gunzip_stream_end(struct gunzip_stream *gs, ulong *lenp);
+
 /**
  * gzwrite progress indicators: defined weak to allow board-specific
  * overrides:
@@ -110,6 +110,18 @@ int hash_command(const char *algo_name, int flags, cmd_tbl_t *cmdtp, int flag,
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size);
 
+/**
+ * hash_bench() - Measure the speed of each hash algorithm
+ *
+ * Each algorithm hashes the data repeatedly for a second, as
+ * hash_block() would, and its throughput is printed in MB/s.
+ *
+ * @data:		Data to hash
+ * @len:		Length of data to hash in bytes
+ * @return 0 if ok, -EINTR if interrupted by the user
+ */
+int hash_bench(const void *data, unsigned int len);
+
 #endif /* !USE_HOSTCC */
 
 /**
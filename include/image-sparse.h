@@ -23,6 +23,17 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase blocks so that they read back as zero. Used for
+	 * zero FILL chunks, only on runs that start and end on an erase_grp
+	 * block boundary. Returns blkcnt on success, otherwise zeros are
+	 * written instead.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	u32		erase_grp;
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -303,6 +303,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -868,6 +869,81 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+#ifndef USE_HOSTCC
+/**
+ * struct image_decomp_stream - state for decompressing data in pieces
+ *
+ * @comp:	Compression of the data (IH_COMP_...)
+ * @dst:	Destination for the uncompressed data
+ * @dst_size:	Size of the destination buffer
+ * @pos:	Number of bytes copied to @dst so far (IH_COMP_NONE only)
+ * @ctx:	Context of the decompressor
+ */
+struct image_decomp_stream {
+	int comp;
+	void *dst;
+	ulong dst_size;
+	ulong pos;
+	void *ctx;
+};
+
+/**
+ * image_decomp_stream_start() - Start decompressing data in pieces
+ *
+ * The compressed data is then passed to image_decomp_stream_feed(), e.g. as
+ * it is read from storage, so that it is decompressed while it is still in
+ * the cache and never needs to be held in memory as a whole.
+ *
+ * @ds:		Stream state to set up
+ * @comp:	Compression of the data (IH_COMP_...)
+ * @dst:	Destination for the uncompressed data
+ * @dst_size:	Size of the destination buffer
+ * @return 0 if OK, -EPROTONOSUPPORT if the compression cannot be handled
+ *	in pieces, -ENOMEM if out of memory
+ */
+int image_decomp_stream_start(struct image_decomp_stream *ds, int comp,
+			      void *dst, ulong dst_size);
+
+/**
+ * image_decomp_stream_feed() - Decompress the next piece of data
+ *
+ * With IH_COMP_NONE the data is copied to the destination, unless @src
+ * already points to the next byte there. For gzip the first piece must
+ * hold the whole gzip header. Other pieces may be of any size.
+ *
+ * @ds:		Stream state from image_decomp_stream_start()
+ * @src:	Next piece of data
+ * @len:	Length of the data at @src
+ * @return 0 if OK, -ENOSPC if the destination buffer is too small, other
+ *	-ve on error
+ */
+int image_decomp_stream_feed(struct image_decomp_stream *ds, const void *src,
+			     ulong len);
+
+/**
+ * image_decomp_stream_end() - Finish decompressing and free the stream
+ *
+ * This must be called once for each successful image_decomp_stream_start(),
+ * even if image_decomp_stream_feed() failed.
+ *
+ * @ds:		Stream state from image_decomp_stream_start()
+ * @lenp:	Returns the number of bytes written to the destination
+ * @return 0 if OK, -EIO if the compressed data was incomplete
+ */
+int image_decomp_stream_end(struct image_decomp_stream *ds, ulong *lenp);
+
+/**
+ * image_decomp_detect() - Work out the compression of some data
+ *
+ * This looks for the magic number at the start of each compression format.
+ *
+ * @buf:	Start of the data
+ * @len:	Number of bytes available at @buf
+ * @return compression found (IH_COMP_...), or IH_COMP_NONE if none
+ */
+int image_decomp_detect(const void *buf, ulong len);
+#endif
+
 /**
  * Set up properties in the FDT
  *
@@ -1037,10 +1113,13 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
  * @require_keys: Mark all keys as 'required'
  * @engine_id:	Engine to use for signing
  * @cmdname:	Command name used when reporting errors
+ * @jobs:	Number of threads to use to calculate hashes (0 or 1 for one)
  *
  * Adds hash values for all component images in the FIT blob.
  * Hashes are calculated for all component images which have hash subnodes
  * with algorithm property set to one of the supported hash algorithms.
+ * With more than one job, the hashes are calculated in parallel first, but
+ * the FIT is updated in the same order so the result is the same.
  *
  * Also add signatures if signature nodes are present.
  *
@@ -1050,11 +1129,119 @@ int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
  */
 int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 			      const char *comment, int require_keys,
-			      const char *engine_id, const char *cmdname);
+			      const char *engine_id, const char *cmdname,
+			      int jobs);
 
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size);
 int fit_image_verify(const void *fit, int noffset);
+
+#ifndef USE_HOSTCC
+#define FIT_STREAM_MAX_HASHES	4
+
+struct hash_algo;
+
+/**
+ * struct fit_stream - state for loading a FIT sub-image in a single pass
+ *
+ * The image data is passed to fit_stream_feed() in pieces, e.g. as it is
+ * read from storage. Each piece is hashed and copied or decompressed to
+ * the destination while it is still in the cache, so the data is only
+ * traversed once and no temporary buffer for the whole image is needed.
+ *
+ * @fit:	FIT containing the image
+ * @noffset:	Offset of the image node
+ * @hash_count:	Number of hash nodes being checked
+ * @hash_node:	Offset of each hash node
+ * @hash_algo:	Progressive hash algorithm of each hash node
+ * @hash_ctx:	Hash context of each hash node
+ * @ds:		Copies or decompresses the data to the destination
+ * @err:	First error returned by fit_stream_feed(), or 0
+ */
+struct fit_stream {
+	const void *fit;
+	int noffset;
+	int hash_count;
+	int hash_node[FIT_STREAM_MAX_HASHES];
+	struct hash_algo *hash_algo[FIT_STREAM_MAX_HASHES];
+	void *hash_ctx[FIT_STREAM_MAX_HASHES];
+	struct image_decomp_stream ds;
+	int err;
+};
+
+/**
+ * fit_stream_start() - Start loading a FIT sub-image in a single pass
+ *
+ * This fails with -EPROTONOSUPPORT if the image cannot be streamed, e.g.
+ * because it must be checked against a signature, uses a hash algorithm
+ * without progressive support or an unsupported compression. The caller
+ * should then fall back to fit_image_verify_with_data() and decompress
+ * the image itself.
+ *
+ * The hashes are only checked by fit_stream_finish(), after all the data
+ * has been decompressed. So compressed images are not streamed when
+ * @verify is true and the key blob has any required signature, including
+ * configuration signatures. The decompressor then only sees data whose
+ * hashes have already been checked.
+ *
+ * @st:		Stream state to set up
+ * @fit:	FIT containing the image
+ * @noffset:	Offset of the image node
+ * @comp:	Compression of the image data
+ * @dst:	Destination for the (uncompressed) image data
+ * @dst_size:	Size of the destination buffer
+ * @verify:	true to check the image hashes, false to only load the data
+ * @return 0 if OK, -EPROTONOSUPPORT if the image cannot be streamed,
+ *	-ENOMEM if out of memory
+ */
+int fit_stream_start(struct fit_stream *st, const void *fit, int noffset,
+		     int comp, void *dst, ulong dst_size, bool verify);
+
+/**
+ * fit_stream_feed() - Hash and load the next piece of image data
+ *
+ * For uncompressed images the data is copied to the destination, unless
+ * @buf already points to the next byte there (i.e. the data was read
+ * directly to its final location).
+ *
+ * @st:		Stream state from fit_stream_start()
+ * @buf:	Next piece of image data
+ * @len:	Length of the data at @buf
+ * @return 0 if OK, -ve on error (the stream must still be finished)
+ */
+int fit_stream_feed(struct fit_stream *st, const void *buf, ulong len);
+
+/**
+ * fit_stream_finish() - Check the image hashes and release the stream
+ *
+ * This prints the name of each hash checked, in the same way as
+ * fit_image_verify_with_data(). It must be called once for each
+ * successful fit_stream_start(), even if fit_stream_feed() failed.
+ *
+ * @st:		Stream state from fit_stream_start()
+ * @lenp:	Returns the length of the image data written to the
+ *		destination
+ * @return 0 if OK, -EACCES if a hash does not match, -EIO if the image
+ *	data could not be decompressed
+ */
+int fit_stream_finish(struct fit_stream *st, ulong *lenp);
+
+/**
+ * fit_stream_load() - Hash and load image data held in memory
+ *
+ * This feeds the data to the stream in CONFIG_FIT_STREAM_CHUNK_SIZE
+ * pieces and finishes it.
+ *
+ * @st:		Stream state from fit_stream_start()
+ * @data:	Image data
+ * @size:	Size of the image data
+ * @lenp:	Returns the length of the image data written to the
+ *		destination
+ * @return 0 if OK, -ve on error
+ */
+int fit_stream_load(struct fit_stream *st, const void *data, ulong size,
+		    ulong *lenp);
+#endif /* !USE_HOSTCC */
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
 int fit_image_check_os(const void *fit, int noffset, uint8_t os);
@@ -1108,6 +1295,12 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 # define IMAGE_ENABLE_VERIFY	CONFIG_IS_ENABLED(FIT_SIGNATURE)
 #endif
 
+#ifdef USE_HOSTCC
+# define IMAGE_ENABLE_STREAM	0
+#else
+# define IMAGE_ENABLE_STREAM	CONFIG_IS_ENABLED(FIT_STREAM)
+#endif
+
 #ifdef USE_HOSTCC
 void *image_get_host_blob(void);
 void image_set_host_blob(void *host_blob);
@@ -246,6 +246,19 @@ enum spi_nor_option_flags {
  */
 struct flash_info;
 
+/* Number of erase types described by SFDP */
+#define SNOR_ERASE_TYPE_MAX	4
+
+/**
+ * struct spi_nor_erase_type - Structure to describe a SPI NOR erase command
+ * @size:		the number of bytes erased, a power of two; 0 if unused
+ * @opcode:		the opcode for the erase command
+ */
+struct spi_nor_erase_type {
+	u32			size;
+	u8			opcode;
+};
+
 /*
  * TODO: Remove, once all users of spi_flash interface are moved to MTD
  *
@@ -264,6 +277,8 @@ struct flash_info;
  * @page_size:		the page size of the SPI NOR
  * @addr_width:		number of address bytes
  * @erase_opcode:	the opcode for erasing a sector
+ * @erase_types:	the erase commands the flash supports, by increasing
+ *			size; the sector erase command is one of them
  * @read_opcode:	the read opcode
  * @read_dummy:		the dummy needed by the read operation
  * @program_opcode:	the program opcode
@@ -302,6 +317,7 @@ struct spi_nor {
 	u32			page_size;
 	u8			addr_width;
 	u8			erase_opcode;
+	struct spi_nor_erase_type erase_types[SNOR_ERASE_TYPE_MAX];
 	u8			read_opcode;
 	u8			read_dummy;
 	u8			program_opcode;
@@ -426,4 +442,20 @@ struct spi_nor_hwcaps {
  */
 int spi_nor_scan(struct spi_nor *nor);
 
+/**
+ * spi_nor_erase_plan() - pick the erase command for the start of a range
+ * @types:	the erase types, by increasing size
+ * @addr:	start of the range to erase
+ * @len:	length of the range to erase
+ *
+ * Large erase commands are much faster per byte than small ones, so this
+ * picks the largest erase type which is aligned at @addr and fits within
+ * @len. Smaller types are used at the edges of the range until larger ones
+ * can be used.
+ *
+ * Return: the erase type to use, or NULL if none fits
+ */
+const struct spi_nor_erase_type *
+spi_nor_erase_plan(const struct spi_nor_erase_type *types, u32 addr, u64 len);
+
 #endif
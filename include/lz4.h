@@ -21,4 +21,44 @@
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+struct lz4_stream;
+
+/**
+ * lz4_stream_start() - Start decompressing LZ4 data in pieces
+ *
+ * The data is then passed in with lz4_stream_feed() as it becomes
+ * available, e.g. as it is read from storage. Blocks which lie entirely
+ * within one piece are decompressed straight from it. Others are gathered
+ * in a buffer of the maximum block size given in the frame header.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @return stream context, or NULL if out of memory
+ */
+struct lz4_stream *lz4_stream_start(void *dst, ulong dstlen);
+
+/**
+ * lz4_stream_feed() - Decompress the next piece of LZ4 data
+ *
+ * The pieces may be of any size. Several frames may follow one another, as
+ * in concatenated files, and are decompressed one after the other.
+ *
+ * @ls: Stream context from lz4_stream_start()
+ * @src: Next piece of compressed data
+ * @len: Length of the data at @src
+ * @return 0 if OK, -EPROTONOSUPPORT or -EINVAL if the frame header is not
+ *	supported (as ulz4fn()), -ENOMEM if out of memory, -ENOSPC if the
+ *	destination buffer is too small, -EIO if the data is corrupted
+ */
+int lz4_stream_feed(struct lz4_stream *ls, const void *src, ulong len);
+
+/**
+ * lz4_stream_end() - Finish decompressing and free the stream context
+ *
+ * @ls: Stream context from lz4_stream_start()
+ * @lenp: Returns the number of bytes written to the destination
+ * @return 0 if OK, -EIO if the compressed data was incomplete
+ */
+int lz4_stream_end(struct lz4_stream *ls, ulong *lenp);
+
 #endif
@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Memory test engine, shared by the mtest command and DDR test code
+ */
+
+#ifndef _MEMTEST_H
+#define _MEMTEST_H
+
+#include <linux/bitops.h>
+#include <linux/sizes.h>
+
+/* Flush the data cache after writing, so that reads come from memory */
+#define MEMTEST_FLUSH_CACHE	BIT(0)
+/* Print a '.' after each chunk, as the test progresses */
+#define MEMTEST_PROGRESS	BIT(1)
+/* Do not print errors, just count them */
+#define MEMTEST_QUIET		BIT(2)
+
+/* Default number of bytes handled between checks for Ctrl-C */
+#define MEMTEST_CHUNK_SIZE	SZ_1M
+
+/**
+ * struct memtest - State of a memory test
+ *
+ * The test functions work through the memory a chunk at a time, using
+ * several words per loop iteration. The watchdog, Ctrl-C and progress are
+ * only dealt with between chunks.
+ *
+ * @buf:	Start of memory to test, aligned to a word
+ * @size:	Number of bytes to test, a multiple of the word size
+ * @addr:	Address of @buf, as shown in messages
+ * @flags:	MEMTEST_... flags
+ * @chunk:	Number of bytes to handle between checks for Ctrl-C
+ * @errs:	Number of errors found so far
+ * @first_err:	Address of the first error found, if @errs is not 0
+ * @err_bits:	Bits which were wrong in any error found so far
+ * @bytes:	Number of bytes written and read so far
+ * @start_us:	Time the test started, from timer_get_us()
+ */
+struct memtest {
+	ulong *buf;
+	ulong size;
+	ulong addr;
+	uint flags;
+	ulong chunk;
+	ulong errs;
+	ulong first_err;
+	ulong err_bits;
+	u64 bytes;
+	ulong start_us;
+};
+
+/**
+ * memtest_init() - Set up to test a region of memory
+ *
+ * @mt:		Test state to set up
+ * @buf:	Start of memory to test (as a pointer)
+ * @addr:	Address of the memory, as shown in messages
+ * @size:	Number of bytes to test (rounded down to a whole word)
+ * @flags:	MEMTEST_... flags
+ */
+void memtest_init(struct memtest *mt, void *buf, ulong addr, ulong size,
+		  uint flags);
+
+/**
+ * memtest_fill() - Fill memory with a sequence of values
+ *
+ * Word n of the memory is set to @pattern + n * @incr.
+ *
+ * @mt:		Test state
+ * @pattern:	Value for the first word
+ * @incr:	Amount to add for each following word
+ * @return 0 if OK, -EINTR if interrupted by Ctrl-C
+ */
+int memtest_fill(struct memtest *mt, ulong pattern, ulong incr);
+
+/**
+ * memtest_check() - Check memory for a sequence of values
+ *
+ * Word n of the memory should be @pattern + n * @incr. Each error found is
+ * added to @mt->errs.
+ *
+ * @mt:		Test state
+ * @pattern:	Value for the first word
+ * @incr:	Amount to add for each following word
+ * @invert:	true to write the inverse of each value back after checking it
+ * @return 0 if OK (whether or not errors were found), -EINTR if interrupted
+ */
+int memtest_check(struct memtest *mt, ulong pattern, ulong incr, bool invert);
+
+/**
+ * memtest_data_bus() - Test the data lines with walking bit patterns
+ *
+ * This writes bit patterns and their inverse to the first word, writing
+ * the opposite value to @dummy each time to change the state of the bus.
+ *
+ * @mt:		Test state
+ * @dummy:	Scratch word outside the memory under test
+ * @return 0 if OK, -EINTR if interrupted
+ */
+int memtest_data_bus(struct memtest *mt, volatile ulong *dummy);
+
+/**
+ * memtest_addr_bus() - Test the address lines
+ *
+ * This writes to each power-of-two offset in turn and checks that no other
+ * power-of-two offset changes, which finds address lines which are stuck
+ * or shorted. The memory should be aligned to its size, which should be a
+ * power of two.
+ *
+ * @mt:		Test state
+ * @return 0 if OK, -EINTR if interrupted
+ */
+int memtest_addr_bus(struct memtest *mt);
+
+/**
+ * memtest_device() - Test every bit of the memory as a 0 and a 1
+ *
+ * This fills the memory with an incrementing count, then checks and
+ * inverts it, then checks the inverted values.
+ *
+ * @mt:		Test state
+ * @return 0 if OK, -EINTR if interrupted
+ */
+int memtest_device(struct memtest *mt);
+
+/**
+ * memtest_addr_in_addr() - Test the memory with each word holding its address
+ *
+ * @mt:		Test state
+ * @return 0 if OK, -EINTR if interrupted
+ */
+int memtest_addr_in_addr(struct memtest *mt);
+
+/**
+ * memtest_moving_inv() - Moving inversions test
+ *
+ * This fills the memory with @pattern, then checks each word and writes its
+ * inverse, going up through the memory, then does the same going down.
+ *
+ * @mt:		Test state
+ * @pattern:	Pattern to use
+ * @return 0 if OK, -EINTR if interrupted
+ */
+int memtest_moving_inv(struct memtest *mt, ulong pattern);
+
+/**
+ * memtest_show_speed() - Show how much memory was accessed and how fast
+ *
+ * @mt:		Test state
+ */
+void memtest_show_speed(struct memtest *mt);
+
+#endif
@@ -151,6 +151,97 @@ struct eth_ops {
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
 
+/**
+ * struct eth_rx_ring - Ring of receive buffers owned by a driver
+ *
+ * A driver which receives into its own buffers can use this to hand them
+ * straight to the network stack from its recv() method and take them back
+ * in free_pkt(), instead of copying each packet into net_rx_packets[].
+ * Buffers are filled at @tail and handed to the stack from @head, in order.
+ *
+ * @mem: Memory for the buffers, @count * PKTSIZE_ALIGN bytes
+ * @lens: Length of the packet in each buffer
+ * @count: Number of buffers
+ * @head: Index of the next buffer to hand to the stack
+ * @tail: Index of the next buffer to fill
+ * @used: Number of buffers which are filled and not yet freed
+ */
+struct eth_rx_ring {
+	uchar *mem;
+	int *lens;
+	int count;
+	int head;
+	int tail;
+	int used;
+};
+
+/**
+ * eth_rx_ring_init() - Allocate the buffers of a receive ring
+ *
+ * Each buffer holds PKTSIZE_ALIGN bytes and is aligned to PKTALIGN, so it
+ * can be used for DMA.
+ *
+ * @ring: Ring to set up
+ * @count: Number of buffers
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int eth_rx_ring_init(struct eth_rx_ring *ring, int count);
+
+/**
+ * eth_rx_ring_uninit() - Free the buffers of a receive ring
+ *
+ * @ring: Ring to free
+ */
+void eth_rx_ring_uninit(struct eth_rx_ring *ring);
+
+/**
+ * eth_rx_ring_reset() - Drop all packets in a receive ring
+ *
+ * @ring: Ring to reset
+ */
+void eth_rx_ring_reset(struct eth_rx_ring *ring);
+
+/**
+ * eth_rx_ring_get_buf() - Get the next buffer to receive a packet into
+ *
+ * The buffer is not added to the ring until eth_rx_ring_push() is called.
+ *
+ * @ring: Ring to use
+ * @return buffer, or NULL if all buffers are in use
+ */
+uchar *eth_rx_ring_get_buf(struct eth_rx_ring *ring);
+
+/**
+ * eth_rx_ring_push() - Add a received packet to a ring
+ *
+ * @ring: Ring to use
+ * @len: Length of the packet written to the buffer from
+ *	eth_rx_ring_get_buf()
+ */
+void eth_rx_ring_push(struct eth_rx_ring *ring, int len);
+
+/**
+ * eth_rx_ring_recv() - Get the next packet to pass to the network stack
+ *
+ * This is intended to be called from a driver's recv() method.
+ *
+ * @ring: Ring to use
+ * @packetp: Returns a pointer to the packet, in the ring's buffer
+ * @return length of the packet, or -EAGAIN if there is none
+ */
+int eth_rx_ring_recv(struct eth_rx_ring *ring, uchar **packetp);
+
+/**
+ * eth_rx_ring_free_pkt() - Give a packet's buffer back to a ring
+ *
+ * This is intended to be called from a driver's free_pkt() method.
+ *
+ * @ring: Ring to use
+ * @packet: Packet returned by eth_rx_ring_recv()
+ * @return 0 if OK, -EINVAL if @packet is not the oldest packet in the ring
+ */
+int eth_rx_ring_free_pkt(struct eth_rx_ring *ring, uchar *packet);
+
 struct udevice *eth_get_dev(void); /* get the current device */
 /*
  * The devname can be either an exact name given by the driver or device tree
@@ -681,6 +772,31 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport,
 /* Processes a received packet */
 void net_process_received_packet(uchar *in_packet, int len);
 
+/**
+ * struct net_rx_stats - Statistics for received packets
+ *
+ * These show how many times the received data is copied by the network
+ * stack on its way to its destination, e.g. the TFTP load address.
+ *
+ * @frames: Number of frames passed to net_process_received_packet()
+ * @bytes: Number of bytes in those frames
+ * @copied: Number of bytes copied out of received frames
+ */
+struct net_rx_stats {
+	ulong frames;
+	ulong bytes;
+	ulong copied;
+};
+
+extern struct net_rx_stats net_rx_stats;
+
+/* Record that @len bytes of a received frame have been copied */
+static inline void net_rx_copied(int len)
+{
+	if (IS_ENABLED(CONFIG_NET_RX_STATS))
+		net_rx_stats.copied += len;
+}
+
 #if defined(CONFIG_NETCONSOLE) && !defined(CONFIG_SPL_BUILD)
 void nc_start(void);
 int nc_input_packet(uchar *pkt, struct in_addr src_ip, unsigned dest_port,
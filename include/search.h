@@ -45,6 +45,17 @@ struct hsearch_data {
 	struct env_entry_node *table;
 	unsigned int size;
 	unsigned int filled;
+	unsigned int deleted;
+/*
+ * Indexes of the used entries in the table, sorted by key. This has
+ * "filled" elements.
+ */
+	unsigned int *sorted;
+/*
+ * Non-zero while a change_ok() or callback() function is running. The
+ * table is not resized then, since the caller still holds an entry.
+ */
+	int in_callback;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -56,7 +67,10 @@ struct hsearch_data {
 			 enum env_op, int flag);
 };
 
-/* Create a new hash table which will contain at most "nel" elements.  */
+/*
+ * Create a new hash table with room for "nel" elements. The table grows
+ * as needed when more elements are added.
+ */
 int hcreate_r(size_t nel, struct hsearch_data *htab);
 
 /* Destroy current internal hash table.  */
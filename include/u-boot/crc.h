@@ -52,6 +52,21 @@ void crc16_ccitt_wd_buf(const uint8_t *in, uint len,
  */
 uint32_t crc32(uint32_t crc, const unsigned char *buf, uint len);
 
+/**
+ * crc32_runtime - Calculate the CRC32 for the EFI runtime services
+ *
+ * This gives the same result as crc32(), using only the single table, which
+ * is in the EFI runtime data. The faster versions used by crc32() are not
+ * available to the EFI runtime.
+ *
+ * @crc: Input crc to chain from a previous calculution (use 0 to start a new
+ *	calculation)
+ * @buf: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * @return checksum value
+ */
+uint32_t crc32_runtime(uint32_t crc, const unsigned char *buf, uint len);
+
 /**
  * crc32_wd - Calculate the CRC32 for a block of data (watchdog version)
  *
@@ -82,6 +97,55 @@ uint32_t crc32_wd(uint32_t crc, const unsigned char *buf, uint len,
  */
 uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 
+/**
+ * enum crc32_impl - implementations of crc32_no_comp()
+ *
+ * crc32_no_comp() uses the fastest one available, the others are there to
+ * check it against
+ *
+ * @CRC32_IMPL_BYTE: reference version, a byte at a time
+ * @CRC32_IMPL_WORD: a 32-bit word at a time, with a single table
+ * @CRC32_IMPL_SLICE8: eight bytes at a time, with eight tables
+ *	(CONFIG_CRC32_SLICE_BY_8, little-endian only)
+ * @CRC32_IMPL_ARMV8: ARMv8 CRC32 instructions (CONFIG_ARMV8_CRC32)
+ */
+enum crc32_impl {
+	CRC32_IMPL_BYTE,
+	CRC32_IMPL_WORD,
+	CRC32_IMPL_SLICE8,
+	CRC32_IMPL_ARMV8,
+
+	CRC32_IMPL_COUNT,
+};
+
+/**
+ * crc32_impl_name() - Get the name of a crc32_no_comp() implementation
+ *
+ * @impl: Implementation
+ * @return name, or NULL if @impl is invalid
+ */
+const char *crc32_impl_name(enum crc32_impl impl);
+
+/**
+ * crc32_impl_no_comp() - Calculate the CRC32 using a given implementation
+ *
+ * This is crc32_no_comp(), using @impl rather than the fastest
+ * implementation.
+ *
+ * @impl: Implementation to use
+ * @crcp: Input crc to chain from, updated with the checksum value
+ * @buf: Bytes to checksum
+ * @len: Number of bytes to checksum
+ * @return 0 if OK, -ENOSYS if @impl is not built in or not supported by
+ *	this CPU
+ */
+int crc32_impl_no_comp(enum crc32_impl impl, uint32_t *crcp,
+		       const unsigned char *buf, uint len);
+
+/* arch/arm/cpu/armv8/crc32.c */
+int crc32_armv8_available(void);
+uint32_t crc32_armv8_no_comp(uint32_t crc, const unsigned char *buf, uint len);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -52,6 +52,20 @@ void sha1_starts( sha1_context *ctx );
 void sha1_update(sha1_context *ctx, const unsigned char *input,
 		 unsigned int ilen);
 
+/**
+ * sha1_update_wd() - Add data to a SHA-1 hash, resetting the watchdog
+ *
+ * This is sha1_update(), triggering the watchdog after every @chunk_sz
+ * bytes, so that large buffers can be hashed progressively.
+ *
+ * @ctx: Hash context
+ * @input: Data to hash
+ * @ilen: Number of bytes to hash
+ * @chunk_sz: Number of bytes to hash between watchdog resets
+ */
+void sha1_update_wd(sha1_context *ctx, const unsigned char *input,
+		    unsigned int ilen, unsigned int chunk_sz);
+
 /**
  * \brief	   SHA-1 final digest
  *
@@ -101,6 +115,50 @@ void sha1_hmac(const unsigned char *key, int keylen,
  */
 int sha1_self_test( void );
 
+/**
+ * enum sha1_impl - implementations of the SHA-1 block function
+ *
+ * sha1_update() uses the fastest one available, the others are there to
+ * check it against
+ *
+ * @SHA1_IMPL_GENERIC: portable C version
+ * @SHA1_IMPL_ARMV8_CE: ARMv8 Crypto Extensions (CONFIG_ARMV8_CE_SHA)
+ */
+enum sha1_impl {
+	SHA1_IMPL_GENERIC,
+	SHA1_IMPL_ARMV8_CE,
+
+	SHA1_IMPL_COUNT,
+};
+
+/**
+ * sha1_impl_name() - Get the name of a SHA-1 implementation
+ *
+ * @impl: Implementation
+ * @return name, or NULL if @impl is invalid
+ */
+const char *sha1_impl_name(enum sha1_impl impl);
+
+/**
+ * sha1_impl_update() - Add data to a SHA-1 hash using a given implementation
+ *
+ * This is sha1_update(), using @impl rather than the fastest implementation.
+ *
+ * @impl: Implementation to use
+ * @ctx: Hash context
+ * @input: Data to hash
+ * @ilen: Number of bytes to hash
+ * @return 0 if OK, -ENOSYS if @impl is not built in or not supported by
+ *	this CPU
+ */
+int sha1_impl_update(enum sha1_impl impl, sha1_context *ctx,
+		     const unsigned char *input, unsigned int ilen);
+
+/* arch/arm/cpu/armv8/sha_ce.c */
+int sha1_armv8_ce_available(void);
+void sha1_armv8_ce_process(sha1_context *ctx, const unsigned char *data,
+			   unsigned int blocks);
+
 #ifdef __cplusplus
 }
 #endif
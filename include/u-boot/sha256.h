@@ -19,7 +19,67 @@ void sha256_starts(sha256_context * ctx);
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length);
 void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 
+/**
+ * sha256_update_wd() - Add data to a SHA-256 hash, resetting the watchdog
+ *
+ * This is sha256_update(), triggering the watchdog after every @chunk_sz
+ * bytes, so that large buffers can be hashed progressively.
+ *
+ * @ctx: Hash context
+ * @input: Data to hash
+ * @length: Number of bytes to hash
+ * @chunk_sz: Number of bytes to hash between watchdog resets
+ */
+void sha256_update_wd(sha256_context *ctx, const uint8_t *input,
+		      uint32_t length, unsigned int chunk_sz);
+
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/**
+ * enum sha256_impl - implementations of the SHA-256 block function
+ *
+ * sha256_update() uses the fastest one available, the others are there to
+ * check it against
+ *
+ * @SHA256_IMPL_GENERIC: portable C version
+ * @SHA256_IMPL_ARMV8_CE: ARMv8 Crypto Extensions (CONFIG_ARMV8_CE_SHA)
+ */
+enum sha256_impl {
+	SHA256_IMPL_GENERIC,
+	SHA256_IMPL_ARMV8_CE,
+
+	SHA256_IMPL_COUNT,
+};
+
+/**
+ * sha256_impl_name() - Get the name of a SHA-256 implementation
+ *
+ * @impl: Implementation
+ * @return name, or NULL if @impl is invalid
+ */
+const char *sha256_impl_name(enum sha256_impl impl);
+
+/**
+ * sha256_impl_update() - Add data to a SHA-256 hash using a given
+ *	implementation
+ *
+ * This is sha256_update(), using @impl rather than the fastest
+ * implementation.
+ *
+ * @impl: Implementation to use
+ * @ctx: Hash context
+ * @input: Data to hash
+ * @length: Number of bytes to hash
+ * @return 0 if OK, -ENOSYS if @impl is not built in or not supported by
+ *	this CPU
+ */
+int sha256_impl_update(enum sha256_impl impl, sha256_context *ctx,
+		       const uint8_t *input, uint32_t length);
+
+/* arch/arm/cpu/armv8/sha_ce.c */
+int sha256_armv8_ce_available(void);
+void sha256_armv8_ce_process(sha256_context *ctx, const uint8_t *data,
+			     unsigned int blocks);
+
 #endif /* _SHA256_H */
@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Zstandard decompression of a buffer held in memory
+ */
+
+#ifndef __UBOOT_ZSTD_H
+#define __UBOOT_ZSTD_H
+
+/**
+ * zstd_decompress() - Decompress Zstandard data
+ *
+ * The data may hold several frames, which are decompressed one after the
+ * other. Only a decompression context is allocated, since the whole output
+ * is available as the window, so this needs much less memory than the
+ * streaming API.
+ *
+ * @src:	Source data to decompress
+ * @srcn:	Length of source data
+ * @dst:	Destination for uncompressed data
+ * @dstn:	Size of the destination buffer on entry, length of the
+ *		uncompressed data on exit (0 on error)
+ * @return 0 if OK, -ENOMEM if out of memory, -ENOSPC if the destination
+ *	buffer is too small, -EPROTONOSUPPORT if the data uses an unsupported
+ *	feature, -EINVAL if the data is corrupted
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+struct zstd_stream;
+
+/**
+ * zstd_stream_start() - Start decompressing Zstandard data in pieces
+ *
+ * The data is then passed in with zstd_stream_feed() as it becomes
+ * available. The data may hold several frames, as written by pzstd or
+ * found in concatenated files, which are decompressed one after the other.
+ * The streaming API needs a window buffer, which is allocated once the
+ * header of each frame is seen.
+ *
+ * @dst:	Destination for uncompressed data
+ * @dstlen:	Size of the destination buffer
+ * @return stream context, or NULL if out of memory
+ */
+struct zstd_stream *zstd_stream_start(void *dst, ulong dstlen);
+
+/**
+ * zstd_stream_feed() - Decompress the next piece of Zstandard data
+ *
+ * The pieces may be of any size. Data after the end of a frame must be
+ * another frame.
+ *
+ * @zs:		Stream context from zstd_stream_start()
+ * @src:	Next piece of compressed data
+ * @len:	Length of the data at @src
+ * @return 0 if OK, -ENOMEM if out of memory, -ENOSPC if the destination
+ *	buffer is too small, -EPROTONOSUPPORT if the data uses an unsupported
+ *	feature, -EIO if the data is corrupted
+ */
+int zstd_stream_feed(struct zstd_stream *zs, const void *src, ulong len);
+
+/**
+ * zstd_stream_end() - Finish decompressing and free the stream context
+ *
+ * @zs:		Stream context from zstd_stream_start()
+ * @lenp:	Returns the number of bytes written to the destination
+ * @return 0 if OK, -EIO if the compressed data was incomplete
+ */
+int zstd_stream_end(struct zstd_stream *zs, ulong *lenp);
+
+#endif
@@ -49,6 +49,23 @@ enum video_log2_bpp {
 
 #define VNBITS(bpix)	(1 << (bpix))
 
+/**
+ * struct video_damage - Area of the display that has changed
+ *
+ * This is a rectangle in pixels, which is empty if @xend is 0.
+ *
+ * @xstart:	X start position in pixels from the left
+ * @ystart:	Y start position in pixels from the top
+ * @xend:	X end position in pixels from the left (exclusive)
+ * @yend:	Y end position in pixels from the top (exclusive)
+ */
+struct video_damage {
+	int xstart;
+	int ystart;
+	int xend;
+	int yend;
+};
+
 /**
  * struct video_priv - Device information used by the video uclass
  *
@@ -71,6 +88,7 @@ enum video_log2_bpp {
  * @cmap:	Colour map for 8-bit-per-pixel displays
  * @fg_col_idx:	Foreground color code (bit 3 = bold, bit 0-2 = color)
  * @bg_col_idx:	Background color code (bit 3 = bold, bit 0-2 = color)
+ * @damage:	Area of the display that has changed since the last sync
  */
 struct video_priv {
 	/* Things set up by the driver: */
@@ -94,6 +112,7 @@ struct video_priv {
 	ushort *cmap;
 	u8 fg_col_idx;
 	u8 bg_col_idx;
+	struct video_damage damage;
 };
 
 /* Placeholder - there are no video operations at present */
@@ -133,7 +152,9 @@ int video_clear(struct udevice *dev);
  *
  * Some frame buffers are cached or have a secondary frame buffer. This
  * function syncs these up so that the current contents of the U-Boot frame
- * buffer are displayed to the user.
+ * buffer are displayed to the user. Only the area passed to video_damage()
+ * since the last sync is flushed from the data cache, unless @force is
+ * true.
  *
  * @dev:	Device to sync
  * @force:	True to force a sync even if there was one recently (this is
@@ -141,6 +162,21 @@ int video_clear(struct udevice *dev);
  */
 void video_sync(struct udevice *vid, bool force);
 
+/**
+ * video_damage() - Record that part of the display has changed
+ *
+ * The next call to video_sync() flushes the data cache for this area. The
+ * area is clipped to the display, and combined with any other area that
+ * has changed since the last sync.
+ *
+ * @vid:	Device that was drawn on
+ * @x:		X position in pixels from the left
+ * @y:		Y position in pixels from the top
+ * @width:	Width of the area in pixels
+ * @height:	Height of the area in pixels
+ */
+void video_damage(struct udevice *vid, int x, int y, int width, int height);
+
 /**
  * video_sync_all() - Sync all devices' frame buffers with there hardware
  *
@@ -33,6 +33,9 @@ struct file_handle {
 	int isdir;
 	u64 open_mode;
 
+	/* for reading a file, opened on the first read: */
+	struct fs_file *file;
+
 	/* for reading a directory: */
 	struct fs_dir_stream *dirs;
 	struct fs_dirent *dent;
@@ -295,6 +298,7 @@ out:
 
 static efi_status_t file_close(struct file_handle *fh)
 {
+	fs_file_close(fh->file);
 	fs_closedir(fh->dirs);
 	free(fh);
 	return EFI_SUCCESS;
@@ -331,6 +335,11 @@ static efi_status_t EFIAPI efi_file_delete(struct efi_file_handle *file)
 static efi_status_t efi_get_file_size(struct file_handle *fh,
 				      loff_t *file_size)
 {
+	if (fh->file) {
+		*file_size = fh->file->size;
+		return EFI_SUCCESS;
+	}
+
 	if (set_blk_dev(fh))
 		return EFI_DEVICE_ERROR;
 
@@ -344,21 +353,18 @@ static efi_status_t file_read(struct file_handle *fh, u64 *buffer_size,
 		void *buffer)
 {
 	loff_t actread;
-	efi_status_t ret;
-	loff_t file_size;
 
-	ret = efi_get_file_size(fh, &file_size);
-	if (ret != EFI_SUCCESS)
-		return ret;
-	if (file_size < fh->offset) {
-		ret = EFI_DEVICE_ERROR;
-		return ret;
-	}
-
-	if (set_blk_dev(fh))
+	/*
+	 * Keep the file open, so that reading it in small chunks does not
+	 * look it up each time
+	 */
+	if (!fh->file && (set_blk_dev(fh) || fs_open(fh->path, &fh->file)))
 		return EFI_DEVICE_ERROR;
-	if (fs_read(fh->path, map_to_sysmem(buffer), fh->offset,
-		    *buffer_size, &actread))
+	if (fh->file->size < fh->offset)
+		return EFI_DEVICE_ERROR;
+
+	fs_file_seek(fh->file, fh->offset);
+	if (fs_file_read(fh->file, buffer, *buffer_size, &actread))
 		return EFI_DEVICE_ERROR;
 
 	*buffer_size = actread;
@@ -499,6 +505,10 @@ static efi_status_t EFIAPI efi_file_write(struct efi_file_handle *file,
 	if (!*buffer_size)
 		goto out;
 
+	/* The file is opened again for reading, to get the new size */
+	fs_file_close(fh->file);
+	fh->file = NULL;
+
 	if (set_blk_dev(fh)) {
 		ret = EFI_DEVICE_ERROR;
 		goto out;
@@ -123,8 +123,8 @@ efi_status_t efi_init_runtime_supported(void)
 void __efi_runtime efi_update_table_header_crc32(struct efi_table_hdr *table)
 {
 	table->crc32 = 0;
-	table->crc32 = crc32(0, (const unsigned char *)table,
-			     table->headersize);
+	table->crc32 = crc32_runtime(0, (const unsigned char *)table,
+				     table->headersize);
 }
 
 /**
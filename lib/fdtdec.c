@@ -13,11 +13,13 @@
 #include <fdtdec.h>
 #include <fdt_support.h>
 #include <gzip.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <linux/libfdt.h>
 #include <serial.h>
 #include <asm/sections.h>
 #include <linux/ctype.h>
+#include <linux/log2.h>
 #include <linux/lzo.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -581,6 +583,80 @@ int fdtdec_prepare_fdt(void)
 	return 0;
 }
 
+#ifndef CONFIG_SPL_BUILD
+/*
+ * phandle -> node offset cache for the control FDT, indexed by the phandle
+ * masked with @mask. Empty slots hold -1. Offsets are checked before use,
+ * since they change if the FDT is modified.
+ */
+static struct {
+	const void *blob;
+	int *offsets;
+	u32 mask;
+} fdt_phandle_cache;
+
+static int fdtdec_populate_phandle_cache(const void *blob)
+{
+	int offset, count = 0;
+	u32 phandle;
+
+	free(fdt_phandle_cache.offsets);
+	fdt_phandle_cache.offsets = NULL;
+	fdt_phandle_cache.blob = NULL;
+
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL))
+		if (fdt_get_phandle(blob, offset))
+			count++;
+	if (!count)
+		return -ENOENT;
+
+	count = roundup_pow_of_two(count);
+	fdt_phandle_cache.offsets = malloc(count * sizeof(int));
+	if (!fdt_phandle_cache.offsets)
+		return -ENOMEM;
+	memset(fdt_phandle_cache.offsets, 0xff, count * sizeof(int));
+	fdt_phandle_cache.mask = count - 1;
+	fdt_phandle_cache.blob = blob;
+
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle)
+			fdt_phandle_cache.offsets[phandle &
+						  fdt_phandle_cache.mask] =
+				offset;
+	}
+
+	return 0;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, u32 phandle)
+{
+	int *slot;
+	int offset;
+
+	/* Only the control FDT is cached, and BSS is not usable before reloc */
+	if (blob != gd->fdt_blob || !(gd->flags & GD_FLG_RELOC) ||
+	    !phandle || phandle == (u32)-1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	if (fdt_phandle_cache.blob != blob &&
+	    fdtdec_populate_phandle_cache(blob))
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	slot = &fdt_phandle_cache.offsets[phandle & fdt_phandle_cache.mask];
+	if (*slot >= 0 && fdt_get_phandle(blob, *slot) == phandle)
+		return *slot;
+
+	offset = fdt_node_offset_by_phandle(blob, phandle);
+	if (offset >= 0)
+		*slot = offset;
+
+	return offset;
+}
+#endif
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -591,7 +667,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -722,8 +798,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1406,7 +1482,7 @@ int fdtdec_get_carveout(const void *blob, const char *node, const char *name,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = fdtdec_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
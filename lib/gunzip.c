@@ -81,6 +81,85 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+struct gunzip_stream {
+	z_stream s;
+	bool header;	/* gzip header still to be parsed */
+	bool done;	/* end of compressed stream seen */
+};
+
+struct gunzip_stream *gunzip_stream_start(void *dst, ulong dstlen)
+{
+	struct gunzip_stream *gs;
+	int r;
+
+	gs = calloc(1, sizeof(*gs));
+	if (!gs)
+		return NULL;
+	gs->s.zalloc = gzalloc;
+	gs->s.zfree = gzfree;
+
+	r = inflateInit2(&gs->s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		free(gs);
+		return NULL;
+	}
+	gs->s.next_out = dst;
+	gs->s.avail_out = dstlen;
+	gs->header = true;
+
+	return gs;
+}
+
+int gunzip_stream_feed(struct gunzip_stream *gs, const void *src, ulong len)
+{
+	const unsigned char *in = src;
+	int r;
+
+	if (gs->done)
+		return 0;
+	if (gs->header) {
+		int offset = gzip_parse_header(in, len);
+
+		if (offset < 0)
+			return -EINVAL;
+		in += offset;
+		len -= offset;
+		gs->header = false;
+	}
+
+	gs->s.next_in = (unsigned char *)in;
+	gs->s.avail_in = len;
+	while (gs->s.avail_in) {
+		r = inflate(&gs->s, Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+			gs->done = true;
+			break;
+		}
+		if (r == Z_BUF_ERROR && !gs->s.avail_out) {
+			puts("Error: uncompressed data too large\n");
+			return -ENOSPC;
+		}
+		if (r != Z_OK) {
+			printf("Error: inflate() returned %d\n", r);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+int gunzip_stream_end(struct gunzip_stream *gs, ulong *lenp)
+{
+	int ret = gs->done ? 0 : -EIO;
+
+	*lenp = gs->s.total_out;
+	inflateEnd(&gs->s);
+	free(gs);
+
+	return ret;
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(u64 expectedsize)
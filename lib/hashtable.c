@@ -14,7 +14,6 @@
 
 #include <errno.h>
 #include <malloc.h>
-#include <sort.h>
 
 #ifdef USE_HOSTCC		/* HOST build */
 # include <string.h>
@@ -34,10 +33,10 @@
 # include <linux/ctype.h>
 #endif
 
-#ifndef	CONFIG_ENV_MIN_ENTRIES	/* minimum number of entries */
+#ifndef	CONFIG_ENV_MIN_ENTRIES	/* minimum initial number of entries */
 #define	CONFIG_ENV_MIN_ENTRIES 64
 #endif
-#ifndef	CONFIG_ENV_MAX_ENTRIES	/* maximum number of entries */
+#ifndef	CONFIG_ENV_MAX_ENTRIES	/* maximum initial number of entries */
 #define	CONFIG_ENV_MAX_ENTRIES 512
 #endif
 
@@ -65,6 +64,8 @@ struct env_entry_node {
 	struct env_entry entry;
 };
 
+/* Smallest table size; the size is always a power of two */
+#define HTAB_MIN_SIZE	8
 
 static void _hdelete(const char *key, struct hsearch_data *htab,
 		     struct env_entry *ep, int idx);
@@ -74,30 +75,52 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
  */
 
 /*
- * For the used double hash method the table size has to be a prime. To
- * correct the user given table size we need a prime test.  This trivial
- * algorithm is adequate because
- * a)  the code is (most probably) called a few times per program run and
- * b)  the number is small because the table must fit in the core
- * */
-static int isprime(unsigned int number)
+ * The table size is a power of two and the table is kept no more than 3/4
+ * full (counting deleted entries), so that the probe sequence used by
+ * hsearch_r() stays short. Return the size needed for "nel" entries.
+ */
+static unsigned int htab_size_for(size_t nel)
+{
+	unsigned int size = HTAB_MIN_SIZE;
+
+	while (size / 4 * 3 < nel)
+		size <<= 1;
+
+	return size;
+}
+
+static int htab_full(struct hsearch_data *htab)
 {
-	/* no even number will be passed */
-	unsigned int div = 3;
+	return htab->filled + htab->deleted >= htab->size / 4 * 3;
+}
 
-	while (div * div < number && number % div != 0)
-		div += 2;
+/*
+ * Allocate a table of "size" entries, plus its sorted view. We allocate
+ * one element more than the size, as explained in the comment for the
+ * hsearch function. The contents of the table is zeroed, especially the
+ * field used becomes zero.
+ */
+static struct env_entry_node *htab_alloc(unsigned int size,
+					 unsigned int **sortedp)
+{
+	struct env_entry_node *table;
+
+	table = calloc(size + 1, sizeof(struct env_entry_node));
+	*sortedp = malloc(size * sizeof(unsigned int));
+	if (table == NULL || *sortedp == NULL) {
+		free(table);
+		free(*sortedp);
+		__set_errno(ENOMEM);
+		return NULL;
+	}
 
-	return number % div != 0;
+	return table;
 }
 
 /*
  * Before using the hash table we must allocate memory for it.
- * Test for an existing table are done. We allocate one element
- * more as the found prime number says. This is done for more effective
- * indexing as explained in the comment for the hsearch function.
- * The contents of the table is zeroed, especially the field used
- * becomes zero.
+ * Test for an existing table are done. The table is sized to hold "nel"
+ * entries, but grows later if more are added.
  */
 
 int hcreate_r(size_t nel, struct hsearch_data *htab)
@@ -112,17 +135,10 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 	if (htab->table != NULL)
 		return 0;
 
-	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
-
-	htab->size = nel;
+	htab->size = htab_size_for(nel);
 	htab->filled = 0;
-
-	/* allocate memory and zero out */
-	htab->table = (struct env_entry_node *)calloc(htab->size + 1,
-						sizeof(struct env_entry_node));
+	htab->deleted = 0;
+	htab->table = htab_alloc(htab->size, &htab->sorted);
 	if (htab->table == NULL)
 		return 0;
 
@@ -160,9 +176,65 @@ void hdestroy_r(struct hsearch_data *htab)
 		}
 	}
 	free(htab->table);
+	free(htab->sorted);
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	htab->sorted = NULL;
+	htab->size = 0;
+	htab->filled = 0;
+	htab->deleted = 0;
+}
+
+/*
+ * Sorted view
+ */
+
+/*
+ * Besides the hash table we keep the indexes of all entries sorted by
+ * key, so that hexport_r() does not need to sort the whole table every
+ * time. The view is updated with a binary search and a memmove() as
+ * entries are added and deleted. Return the position of "key" in the
+ * view, or the position where it should be added if it is not there.
+ */
+static unsigned int hsorted_pos(struct hsearch_data *htab, const char *key)
+{
+	unsigned int lo = 0, hi = htab->filled;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(htab->table[htab->sorted[mid]].entry.key, key);
+
+		if (cmp == 0)
+			return mid;
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Add a new entry to the table's count and to the sorted view */
+static void hsorted_add(struct hsearch_data *htab, unsigned int idx)
+{
+	unsigned int pos = hsorted_pos(htab, htab->table[idx].entry.key);
+
+	memmove(&htab->sorted[pos + 1], &htab->sorted[pos],
+		(htab->filled - pos) * sizeof(htab->sorted[0]));
+	htab->sorted[pos] = idx;
+	++htab->filled;
+}
+
+/* Remove an entry from the table's count and from the sorted view */
+static void hsorted_del(struct hsearch_data *htab, unsigned int idx)
+{
+	unsigned int pos = hsorted_pos(htab, htab->table[idx].entry.key);
+
+	--htab->filled;
+	memmove(&htab->sorted[pos], &htab->sorted[pos + 1],
+		(htab->filled - pos) * sizeof(htab->sorted[0]));
 }
 
 /*
@@ -170,20 +242,90 @@ void hdestroy_r(struct hsearch_data *htab)
  */
 
 /*
- * This is the search function. It uses double hashing with open addressing.
- * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
+ * Compute the hash of a key (FNV-1a), which is stored in the field used
+ * of its entry. The result is always positive, so it never matches
+ * USED_FREE or USED_DELETED.
+ */
+static unsigned int hash_key(const char *key)
+{
+	unsigned int hval = 2166136261U;
+
+	while (*key) {
+		hval ^= (unsigned char)*key++;
+		hval *= 16777619;
+	}
+	hval &= 0x7fffffff;
+
+	return hval ? hval : 1;
+}
+
+/* Find the first free entry for a key in a table with no deleted entries */
+static unsigned int hfind_free(struct hsearch_data *htab, unsigned int hval)
+{
+	unsigned int pos = hval & (htab->size - 1);
+	unsigned int i;
+
+	for (i = 1; htab->table[pos + 1].used != USED_FREE; i++)
+		pos = (pos + i) & (htab->size - 1);
+
+	return pos + 1;
+}
+
+/*
+ * Move all entries to a new table of "size" entries, dropping any deleted
+ * entries. The entries are moved in key order, which keeps the sorted
+ * view. Pointers to entries returned earlier are no longer valid after
+ * this, so this is never done from a change_ok() or callback() function.
+ */
+static int hresize(struct hsearch_data *htab, unsigned int size)
+{
+	struct env_entry_node *table, *old_table = htab->table;
+	unsigned int *sorted, *old_sorted = htab->sorted;
+	unsigned int i;
+
+	debug("%s: %d/%d entries (%d deleted) -> size %d\n", __func__,
+	      htab->filled, htab->size, htab->deleted, size);
+	table = htab_alloc(size, &sorted);
+	if (table == NULL)
+		return 0;
+
+	htab->table = table;
+	htab->sorted = sorted;
+	htab->size = size;
+	htab->deleted = 0;
+	for (i = 0; i < htab->filled; i++) {
+		struct env_entry_node *node = &old_table[old_sorted[i]];
+		unsigned int idx = hfind_free(htab, node->used);
+
+		table[idx] = *node;
+		sorted[i] = idx;
+	}
+	free(old_table);
+	free(old_sorted);
+
+	return 1;
+}
+
+/*
+ * This is the search function. It uses open addressing in a table whose
+ * size is a power of two. The argument item.key has to be a pointer to an
+ * zero terminated, most probably strings of chars. The first index tried
+ * comes from a FNV-1a hash of the key; after that the probe moves on by
+ * 1, 2, 3, ... entries, which visits every entry of the table once.
  *
  * We use an trick to speed up the lookup. The table is created by hcreate
  * with one more element available. This enables us to use the index zero
- * special. This index will never be used because we store the first hash
- * index in the field used where zero means not used. Every other value
+ * special. This index will never be used because we store the hash of
+ * the key in the field used where zero means not used. Every other value
  * means used. The used field can be used as a first fast comparison for
  * equality of the stored and the parameter value. This helps to prevent
  * unnecessary expensive calls of strcmp.
  *
+ * When a new entry would make the table more than 3/4 full (counting
+ * deleted entries), the table is rebuilt first: at double the size if it
+ * is more than half full of live entries, or at the same size otherwise,
+ * which drops the deleted entries.
+ *
  * This implementation differs from the standard library version of
  * this function in a number of ways:
  *
@@ -208,7 +350,7 @@ int hmatch_r(const char *match, int last_idx, struct env_entry **retval,
 	unsigned int idx;
 	size_t key_len = strlen(match);
 
-	for (idx = last_idx + 1; idx < htab->size; ++idx) {
+	for (idx = last_idx + 1; idx <= htab->size; ++idx) {
 		if (htab->table[idx].used <= 0)
 			continue;
 		if (!strncmp(match, htab->table[idx].entry.key, key_len)) {
@@ -235,10 +377,15 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
 		/* Overwrite existing value? */
 		if (action == ENV_ENTER && item.data) {
+			int ret;
+
 			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
+			htab->in_callback++;
+			ret = htab->change_ok != NULL && htab->change_ok(
+			      &htab->table[idx].entry, item.data,
+			      env_op_overwrite, flag);
+			htab->in_callback--;
+			if (ret) {
 				debug("change_ok() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EPERM);
@@ -247,9 +394,12 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 			}
 
 			/* If there is a callback, call it */
-			if (htab->table[idx].entry.callback &&
-			    htab->table[idx].entry.callback(item.key,
-			    item.data, env_op_overwrite, flag)) {
+			htab->in_callback++;
+			ret = htab->table[idx].entry.callback &&
+			      htab->table[idx].entry.callback(item.key,
+			      item.data, env_op_overwrite, flag);
+			htab->in_callback--;
+			if (ret) {
 				debug("callback() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EINVAL);
@@ -276,91 +426,50 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 int hsearch_r(struct env_entry item, enum env_action action,
 	      struct env_entry **retval, struct hsearch_data *htab, int flag)
 {
-	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
-	unsigned int idx;
+	unsigned int hval = hash_key(item.key);
+	unsigned int mask = htab->size - 1;
+	unsigned int pos = hval & mask;
+	unsigned int idx = 0;
 	unsigned int first_deleted = 0;
+	unsigned int i;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
-
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
-
-	/* The first index tried. */
-	idx = hval;
-
-	if (htab->table[idx].used) {
-		/*
-		 * Further action might be required according to the
-		 * action value.
-		 */
-		unsigned hval2;
-
-		if (htab->table[idx].used == USED_DELETED
-		    && !first_deleted)
-			first_deleted = idx;
-
-		ret = _compare_and_overwrite_entry(item, action, retval, htab,
-			flag, hval, idx);
-		if (ret != -1)
-			return ret;
-
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
-		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
-
-			/*
-			 * If we visited all entries leave the loop
-			 * unsuccessfully.
-			 */
-			if (idx == hval)
-				break;
+	for (i = 1; i <= htab->size; i++) {
+		idx = pos + 1;
+		if (htab->table[idx].used == USED_FREE)
+			break;
 
-			if (htab->table[idx].used == USED_DELETED
-			    && !first_deleted)
+		if (htab->table[idx].used == USED_DELETED) {
+			if (!first_deleted)
 				first_deleted = idx;
-
+		} else {
 			/* If entry is found use it. */
 			ret = _compare_and_overwrite_entry(item, action, retval,
 				htab, flag, hval, idx);
 			if (ret != -1)
 				return ret;
 		}
-		while (htab->table[idx].used != USED_FREE);
+		pos = (pos + i) & mask;
+		idx = 0;
 	}
 
 	/* An empty bucket has been found. */
 	if (action == ENV_ENTER) {
+		struct env_entry_node *node;
+
+		if (first_deleted) {
+			idx = first_deleted;
+		} else if (htab_full(htab) && !htab->in_callback &&
+			   hresize(htab, htab->filled + 1 > htab->size / 2 ?
+				   htab->size * 2 : htab->size)) {
+			idx = hfind_free(htab, hval);
+		}
+
 		/*
 		 * If table is full and another entry should be
 		 * entered return with error.
 		 */
-		if (htab->filled == htab->size) {
+		if (!idx) {
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
@@ -370,51 +479,60 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		 * Create new entry;
 		 * create copies of item.key and item.data
 		 */
-		if (first_deleted)
-			idx = first_deleted;
-
-		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
-		if (!htab->table[idx].entry.key ||
-		    !htab->table[idx].entry.data) {
+		node = &htab->table[idx];
+		if (node->used == USED_DELETED)
+			--htab->deleted;
+		node->used = hval;
+		node->entry.key = strdup(item.key);
+		node->entry.data = strdup(item.data);
+		if (!node->entry.key || !node->entry.data) {
+			free((void *)node->entry.key);
+			free(node->entry.data);
+			node->used = USED_DELETED;
+			++htab->deleted;
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
 		}
 
-		++htab->filled;
+		hsorted_add(htab, idx);
 
 		/* This is a new entry, so look up a possible callback */
-		env_callback_init(&htab->table[idx].entry);
+		env_callback_init(&node->entry);
 		/* Also look for flags */
-		env_flags_init(&htab->table[idx].entry);
+		env_flags_init(&node->entry);
 
 		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		htab->in_callback++;
+		ret = htab->change_ok != NULL && htab->change_ok(
+		      &node->entry, item.data, env_op_create, flag);
+		htab->in_callback--;
+		if (ret) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, &node->entry, idx);
 			__set_errno(EPERM);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* If there is a callback, call it */
-		if (htab->table[idx].entry.callback &&
-		    htab->table[idx].entry.callback(item.key, item.data,
-		    env_op_create, flag)) {
+		htab->in_callback++;
+		ret = node->entry.callback &&
+		      node->entry.callback(item.key, item.data,
+					   env_op_create, flag);
+		htab->in_callback--;
+		if (ret) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, &node->entry, idx);
 			__set_errno(EINVAL);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* return new entry */
-		*retval = &htab->table[idx].entry;
+		*retval = &node->entry;
 		return 1;
 	}
 
@@ -439,19 +557,21 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 {
 	/* free used entry */
 	debug("hdelete: DELETING key \"%s\"\n", key);
+	hsorted_del(htab, idx);
 	free((void *)ep->key);
 	free(ep->data);
 	ep->callback = NULL;
 	ep->flags = 0;
 	htab->table[idx].used = USED_DELETED;
 
-	--htab->filled;
+	++htab->deleted;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 {
 	struct env_entry e, *ep;
 	int idx;
+	int ret;
 
 	debug("hdelete: DELETE key \"%s\"\n", key);
 
@@ -464,8 +584,11 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* Check for permission */
-	if (htab->change_ok != NULL &&
-	    htab->change_ok(ep, NULL, env_op_delete, flag)) {
+	htab->in_callback++;
+	ret = htab->change_ok != NULL &&
+	      htab->change_ok(ep, NULL, env_op_delete, flag);
+	htab->in_callback--;
+	if (ret) {
 		debug("change_ok() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EPERM);
@@ -473,8 +596,11 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (htab->table[idx].entry.callback &&
-	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag)) {
+	htab->in_callback++;
+	ret = htab->table[idx].entry.callback &&
+	      htab->table[idx].entry.callback(key, NULL, env_op_delete, flag);
+	htab->in_callback--;
+	if (ret) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
@@ -529,14 +655,6 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
  *		bytes in the string will be '\0'-padded.
  */
 
-static int cmpkey(const void *p1, const void *p2)
-{
-	struct env_entry *e1 = *(struct env_entry **)p1;
-	struct env_entry *e2 = *(struct env_entry **)p2;
-
-	return (strcmp(e1->key, e2->key));
-}
-
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
 	switch (flag & H_MATCH_METHOD) {
@@ -599,7 +717,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char * const argv[])
 {
-	struct env_entry *list[htab->size];
+	struct env_entry **list;
 	char *res, *p;
 	size_t totlen;
 	int i, n;
@@ -612,61 +730,62 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 
 	debug("EXPORT  table = %p, htab.size = %d, htab.filled = %d, size = %lu\n",
 	      htab, htab->size, htab->filled, (ulong)size);
+	list = malloc(htab->filled * sizeof(struct env_entry *) + 1);
+	if (list == NULL) {
+		__set_errno(ENOMEM);
+		return (-1);
+	}
+
 	/*
 	 * Pass 1:
-	 * search used entries,
+	 * search used entries in the sorted view,
 	 * save addresses and compute total length
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
+	for (i = 0, n = 0, totlen = 0; i < htab->filled; ++i) {
+		struct env_entry *ep = &htab->table[htab->sorted[i]].entry;
+		int found = match_entry(ep, flag, argc, argv);
 
-		if (htab->table[i].used > 0) {
-			struct env_entry *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
-
-			if ((argc > 0) && (found == 0))
-				continue;
+		if ((argc > 0) && (found == 0))
+			continue;
 
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+		if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+			continue;
 
-			list[n++] = ep;
+		list[n++] = ep;
 
-			totlen += strlen(ep->key);
+		totlen += strlen(ep->key);
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
 #ifdef DEBUG
-	/* Pass 1a: print unsorted list */
-	printf("Unsorted: n=%d\n", n);
+	/* Pass 1a: print list */
+	printf("Sorted: n=%d\n", n);
 	for (i = 0; i < n; ++i) {
 		printf("\t%3d: %p ==> %-10s => %s\n",
 		       i, list[i], list[i]->key, list[i]->data);
 	}
 #endif
 
-	/* Sort list by keys */
-	qsort(list, n, sizeof(struct env_entry *), cmpkey);
-
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
 		if (size < totlen + 1) {	/* provided buffer too small */
 			printf("Env export buffer too small: %lu, but need %lu\n",
 			       (ulong)size, (ulong)totlen + 1);
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -683,6 +802,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		/* no, allocate and clear one */
 		*resp = res = calloc(1, size);
 		if (res == NULL) {
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -709,6 +829,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		*p++ = sep;
 	}
 	*p = '\0';		/* terminate result */
+	free(list);
 
 	return size;
 }
@@ -836,7 +957,8 @@ int himport_r(struct hsearch_data *htab,
 	 * environment size), so we clip it to a reasonable value.
 	 * On the other hand we need to add some more entries for free
 	 * space when importing very small buffers. Both boundaries can
-	 * be overwritten in the board config file if needed.
+	 * be overwritten in the board config file if needed. This is only
+	 * the initial size: the table grows if more entries are added.
 	 */
 
 	if (!htab->table) {
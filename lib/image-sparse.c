@@ -46,26 +46,233 @@
 
 static void default_log(const char *ignored, char *response) {}
 
+/**
+ * struct sparse_ctx - state of a sparse image write
+ *
+ * Output blocks are not written chunk by chunk: a RAW or FILL chunk is kept
+ * pending in @run until the next chunk shows it cannot be merged with it.
+ * Small adjacent RAW chunks are gathered in @buf so they go out in a single
+ * write; @buf otherwise holds the FILL pattern and is reused for every FILL
+ * chunk with the same value.
+ *
+ * @info:	Storage to write to
+ * @response:	Response buffer for @info->mssg
+ * @buf:	Fill pattern or merge buffer
+ * @buf_blks:	Size of @buf in storage blocks
+ * @buf_val:	Fill value @buf holds, if @buf_is_fill
+ * @buf_is_fill: true if @buf holds a fill pattern
+ * @run_blk:	First block of the pending run
+ * @run_blkcnt:	Size of the pending run in blocks, 0 if nothing is pending
+ * @run_data:	Data of a pending RAW run, NULL for a FILL run
+ * @run_val:	Fill value of a pending FILL run
+ * @raw_blks:	Statistics: RAW blocks written
+ * @fill_blks:	Statistics: FILL blocks written from @buf
+ * @erase_blks:	Statistics: zero FILL blocks erased instead
+ * @skip_blks:	Statistics: DONT_CARE blocks skipped
+ * @writes:	Statistics: calls to @info->write
+ * @erases:	Statistics: calls to @info->erase
+ */
+struct sparse_ctx {
+	struct sparse_storage *info;
+	char *response;
+	void *buf;
+	lbaint_t buf_blks;
+	uint32_t buf_val;
+	bool buf_is_fill;
+	lbaint_t run_blk;
+	lbaint_t run_blkcnt;
+	const void *run_data;
+	uint32_t run_val;
+	u64 raw_blks;
+	u64 fill_blks;
+	u64 erase_blks;
+	u64 skip_blks;
+	uint writes;
+	uint erases;
+};
+
+static long sparse_write(struct sparse_ctx *ctx, lbaint_t blk,
+			 lbaint_t blkcnt, const void *data)
+{
+	struct sparse_storage *info = ctx->info;
+	lbaint_t blks;
+
+	ctx->writes++;
+	blks = info->write(info, blk, blkcnt, data);
+	/* blks might be > blkcnt (eg. NAND bad-blocks) */
+	if (blks < blkcnt) {
+		printf("%s: %s " LBAFU " [" LBAFU "]\n", __func__,
+		       "Write failed, block #", blk, blks);
+		info->mssg("flash write failure", ctx->response);
+		return -1;
+	}
+
+	return blks;
+}
+
+static long sparse_fill_blocks(struct sparse_ctx *ctx, lbaint_t blk,
+			       lbaint_t blkcnt, uint32_t fill_val)
+{
+	struct sparse_storage *info = ctx->info;
+	uint32_t *fill_buf = ctx->buf;
+	lbaint_t i, j;
+	long blks, done = 0;
+
+	if (!ctx->buf_is_fill || ctx->buf_val != fill_val) {
+		for (i = 0; i < info->blksz * ctx->buf_blks / sizeof(fill_val);
+		     i++)
+			fill_buf[i] = fill_val;
+		ctx->buf_val = fill_val;
+		ctx->buf_is_fill = true;
+	}
+
+	for (i = 0; i < blkcnt; i += j) {
+		j = min(blkcnt - i, ctx->buf_blks);
+		blks = sparse_write(ctx, blk + done, j, fill_buf);
+		if (blks < 0)
+			return blks;
+		done += blks;
+	}
+	ctx->fill_blks += blkcnt;
+
+	return done;
+}
+
+/*
+ * Write a FILL run, erasing the part of a zero run which covers whole erase
+ * groups when the storage can erase to zero.
+ */
+static long sparse_fill(struct sparse_ctx *ctx, lbaint_t blk,
+			lbaint_t blkcnt, uint32_t fill_val)
+{
+	struct sparse_storage *info = ctx->info;
+	u32 grp = max(info->erase_grp, 1U);
+	lbaint_t start, end, erased;
+	long blks, done;
+
+	start = lldiv(blk + grp - 1, grp) * grp;
+	end = lldiv(blk + blkcnt, grp) * grp;
+	if (fill_val || !info->erase || start >= end)
+		return sparse_fill_blocks(ctx, blk, blkcnt, fill_val);
+
+	done = sparse_fill_blocks(ctx, blk, start - blk, 0);
+	if (done < 0)
+		return done;
+
+	ctx->erases++;
+	erased = info->erase(info, start, end - start);
+	if (erased == end - start) {
+		ctx->erase_blks += erased;
+		done += erased;
+	} else {
+		debug("%s: Erase failed, writing zeros instead\n", __func__);
+		blks = sparse_fill_blocks(ctx, start, end - start, 0);
+		if (blks < 0)
+			return blks;
+		done += blks;
+	}
+
+	blks = sparse_fill_blocks(ctx, end, blk + blkcnt - end, 0);
+	if (blks < 0)
+		return blks;
+
+	return done + blks;
+}
+
+/*
+ * Write out the pending run. Returns the number of blocks the run took on
+ * the storage beyond its size (eg. NAND bad-blocks), or -1 on error.
+ */
+static long sparse_flush(struct sparse_ctx *ctx)
+{
+	lbaint_t pending = ctx->run_blkcnt;
+	long blks;
+
+	if (!ctx->run_blkcnt)
+		return 0;
+
+	if (ctx->run_data) {
+		blks = sparse_write(ctx, ctx->run_blk, ctx->run_blkcnt,
+				    ctx->run_data);
+		if (blks >= 0)
+			ctx->raw_blks += ctx->run_blkcnt;
+	} else {
+		blks = sparse_fill(ctx, ctx->run_blk, ctx->run_blkcnt,
+				   ctx->run_val);
+	}
+	ctx->run_blkcnt = 0;
+
+	return blks < 0 ? blks : blks - pending;
+}
+
+static bool sparse_run_follows(struct sparse_ctx *ctx, lbaint_t blk)
+{
+	return ctx->run_blkcnt && ctx->run_blk + ctx->run_blkcnt == blk;
+}
+
+/*
+ * Queue a RAW or FILL (@data == NULL) run of blocks starting at @blk, merging
+ * it with the pending run where possible. Returns the number of extra blocks
+ * taken on the storage by a run written out meanwhile, or -1 on error.
+ */
+static long sparse_queue(struct sparse_ctx *ctx, lbaint_t blk,
+			 lbaint_t blkcnt, const void *data, uint32_t fill_val)
+{
+	lbaint_t blksz = ctx->info->blksz;
+	lbaint_t pending = ctx->run_blkcnt;
+	long blks;
+
+	if (data && ctx->run_data && sparse_run_follows(ctx, blk) &&
+	    pending + blkcnt <= ctx->buf_blks) {
+		if (ctx->run_data != ctx->buf) {
+			memcpy(ctx->buf, ctx->run_data, pending * blksz);
+			ctx->run_data = ctx->buf;
+			ctx->buf_is_fill = false;
+		}
+		memcpy(ctx->buf + pending * blksz, data, blkcnt * blksz);
+		ctx->run_blkcnt += blkcnt;
+		return 0;
+	}
+
+	if (!data && !ctx->run_data && sparse_run_follows(ctx, blk) &&
+	    ctx->run_val == fill_val) {
+		ctx->run_blkcnt += blkcnt;
+		return 0;
+	}
+
+	blks = sparse_flush(ctx);
+	if (blks < 0)
+		return blks;
+
+	/* A run written out above may have moved this one along */
+	ctx->run_blk = blk + blks;
+	ctx->run_blkcnt = blkcnt;
+	ctx->run_data = data;
+	ctx->run_val = fill_val;
+
+	return blks;
+}
+
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
+	struct sparse_ctx ctx = {
+		.info = info,
+		.response = response,
+	};
 	lbaint_t blk;
 	lbaint_t blkcnt;
-	lbaint_t blks;
-	uint32_t bytes_written = 0;
+	long blks;
+	u64 bytes_written = 0;
 	unsigned int chunk;
 	unsigned int offset;
 	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	ulong start_time;
+	int ret = -1;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -104,7 +311,18 @@ int write_sparse_image(struct sparse_storage *info,
 		return -1;
 	}
 
+	ctx.buf_blks = max(CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz,
+			   (lbaint_t)1);
+	ctx.buf = memalign(ARCH_DMA_MINALIGN,
+			   ROUNDUP(info->blksz * ctx.buf_blks,
+				   ARCH_DMA_MINALIGN));
+	if (!ctx.buf) {
+		info->mssg("Malloc failed for sparse image buffer", response);
+		return -1;
+	}
+
 	puts("Flashing Sparse Image\n");
+	start_time = get_timer(0);
 
 	/* Start processing chunks */
 	blk = info->start;
@@ -137,7 +355,7 @@ int write_sparse_image(struct sparse_storage *info,
 			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
 				info->mssg("Bogus chunk size for chunk type Raw",
 					   response);
-				return -1;
+				goto out;
 			}
 
 			if (blk + blkcnt > info->start + info->size) {
@@ -146,20 +364,14 @@ int write_sparse_image(struct sparse_storage *info,
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			blks = info->write(info, blk, blkcnt, data);
-			/* blks might be > blkcnt (eg. NAND bad-blocks) */
-			if (blks < blkcnt) {
-				printf("%s: %s" LBAFU " [" LBAFU "]\n",
-				       __func__, "Write failed, block #",
-				       blk, blks);
-				info->mssg("flash write failure", response);
-				return -1;
-			}
-			blk += blks;
-			bytes_written += blkcnt * info->blksz;
+			blks = sparse_queue(&ctx, blk, blkcnt, data, 0);
+			if (blks < 0)
+				goto out;
+			blk += blks + blkcnt;
+			bytes_written += (u64)blkcnt * info->blksz;
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
 			break;
@@ -168,64 +380,36 @@ int write_sparse_image(struct sparse_storage *info,
 			if (chunk_header->total_sz !=
 			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
 				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
+				goto out;
 			}
 
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
 			if (blk + blkcnt > info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
-			bytes_written += blkcnt * info->blksz;
+			blks = sparse_queue(&ctx, blk, blkcnt, NULL, fill_val);
+			if (blks < 0)
+				goto out;
+			blk += blks + blkcnt;
+			bytes_written += (u64)blkcnt * info->blksz;
 			total_blocks += chunk_data_sz / sparse_header->blk_sz;
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
+			blks = sparse_flush(&ctx);
+			if (blks < 0)
+				goto out;
+			blk += blks;
 			blk += info->reserve(info, blk, blkcnt);
+			ctx.skip_blks += blkcnt;
 			total_blocks += chunk_header->chunk_sz;
 			break;
 
@@ -234,7 +418,7 @@ int write_sparse_image(struct sparse_storage *info,
 			    sparse_header->chunk_hdr_sz) {
 				info->mssg("Bogus chunk size for chunk type Dont Care",
 					   response);
-				return -1;
+				goto out;
 			}
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
@@ -244,18 +428,28 @@ int write_sparse_image(struct sparse_storage *info,
 			printf("%s: Unknown chunk type: %x\n", __func__,
 			       chunk_header->chunk_type);
 			info->mssg("Unknown chunk type", response);
-			return -1;
+			goto out;
 		}
 	}
 
+	if (sparse_flush(&ctx) < 0)
+		goto out;
+
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
-	printf("........ wrote %u bytes to '%s'\n", bytes_written, part_name);
+	printf("........ wrote %llu bytes to '%s'\n", bytes_written, part_name);
+	printf("........ %llu raw, %llu fill, %llu erased, %llu skipped blocks: %u writes, %u erases in %lu ms\n",
+	       ctx.raw_blks, ctx.fill_blks, ctx.erase_blks, ctx.skip_blks,
+	       ctx.writes, ctx.erases, get_timer(start_time));
 
 	if (total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
-		return -1;
+		goto out;
 	}
 
-	return 0;
+	ret = 0;
+out:
+	free(ctx.buf);
+
+	return ret;
 }
@@ -7,6 +7,8 @@
 #include <compiler.h>
 #include <image.h>
 #include <lz4.h>
+#include <malloc.h>
+#include <asm/unaligned.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -136,3 +138,225 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+enum lz4_stream_state {
+	LZ4S_FRAME,		/* gathering the frame header */
+	LZ4S_SKIP,		/* skipping data which is not needed */
+	LZ4S_BLOCK_HEADER,	/* gathering a block header */
+	LZ4S_BLOCK,		/* gathering block data */
+	LZ4S_CHECKSUM,		/* skipping the content checksum */
+	LZ4S_DONE,		/* end of the frame seen */
+};
+
+struct lz4_stream {
+	void *dst;
+	void *out;		/* next byte to write */
+	void *end;		/* end of the destination buffer */
+	enum lz4_stream_state state;
+	bool has_block_checksum;
+	bool has_content_checksum;
+	ulong block_max;	/* maximum block size, from the frame header */
+	struct lz4_block_header b;	/* block being handled */
+	u8 hdr[sizeof(struct lz4_frame_header)];
+	u8 *buf;		/* holds a block which spans several pieces */
+	ulong have;		/* bytes gathered so far */
+	ulong need;		/* bytes needed to move to the next state */
+};
+
+struct lz4_stream *lz4_stream_start(void *dst, ulong dstlen)
+{
+	struct lz4_stream *ls;
+
+	ls = calloc(1, sizeof(*ls));
+	if (!ls)
+		return NULL;
+	ls->dst = dst;
+	ls->out = dst;
+	ls->end = dst + dstlen;
+	ls->state = LZ4S_FRAME;
+	ls->need = sizeof(struct lz4_frame_header);
+
+	return ls;
+}
+
+/*
+ * Copy up to ls->need bytes from the input to @buf (or drop them if @buf is
+ * NULL). Returns true once all ls->need bytes have been gathered.
+ */
+static bool lz4_stream_gather(struct lz4_stream *ls, void *buf,
+			      const u8 **inp, ulong *lenp)
+{
+	ulong n = min(*lenp, ls->need - ls->have);
+
+	if (buf)
+		memcpy(buf + ls->have, *inp, n);
+	ls->have += n;
+	*inp += n;
+	*lenp -= n;
+	if (ls->have < ls->need)
+		return false;
+	ls->have = 0;
+
+	return true;
+}
+
+static int lz4_stream_frame(struct lz4_stream *ls)
+{
+	const struct lz4_frame_header *h = (void *)ls->hdr;
+	ulong block_max;
+
+	if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
+		return -EPROTONOSUPPORT;
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return -EINVAL;
+	if (!h->independent_blocks || h->max_block_size < 4)
+		return -EPROTONOSUPPORT;
+	ls->has_block_checksum = h->has_block_checksum;
+	ls->has_content_checksum = h->has_content_checksum;
+	block_max = 1 << (8 + 2 * h->max_block_size);
+	/* A later frame may use larger blocks than the buffer holds */
+	if (block_max > ls->block_max) {
+		free(ls->buf);
+		ls->buf = NULL;
+	}
+	ls->block_max = block_max;
+
+	/* Skip the content size and header checksum */
+	ls->need = (h->has_content_size ? sizeof(u64) : 0) + sizeof(u8);
+	ls->state = LZ4S_SKIP;
+
+	return 0;
+}
+
+static int lz4_stream_decode(const void *in, void *out, int in_len,
+			     int out_len)
+{
+	/* constant folding essential, do not touch params! */
+	return LZ4_decompress_generic(in, out, in_len, out_len,
+				      endOnInputSize, full, 0, noDict, out,
+				      NULL, 0);
+}
+
+/*
+ * LZ4_decompress_generic() fails in the same way whether the block is
+ * corrupted or does not fit in the space left. If the space left is less
+ * than the maximum block size, decode the block again into a buffer which
+ * is large enough to tell the two apart.
+ */
+static int lz4_stream_block_error(struct lz4_stream *ls, const void *in)
+{
+	void *buf;
+	int ret;
+
+	if (ls->end - ls->out >= ls->block_max)
+		return -EIO;
+	buf = malloc(ls->block_max);
+	if (!buf)
+		return -ENOMEM;
+	ret = lz4_stream_decode(in, buf, ls->b.size, ls->block_max);
+	free(buf);
+
+	return ret < 0 ? -EIO : -ENOSPC;
+}
+
+static int lz4_stream_block(struct lz4_stream *ls, const void *in)
+{
+	int ret;
+
+	if (ls->b.not_compressed) {
+		if (ls->b.size > ls->end - ls->out)
+			return -ENOSPC;
+		memcpy(ls->out, in, ls->b.size);
+		ls->out += ls->b.size;
+	} else {
+		ret = lz4_stream_decode(in, ls->out, ls->b.size,
+					ls->end - ls->out);
+		if (ret < 0)
+			return lz4_stream_block_error(ls, in);
+		ls->out += ret;
+	}
+	if (ls->has_block_checksum) {
+		ls->need = sizeof(u32);
+		ls->state = LZ4S_SKIP;
+	} else {
+		ls->need = sizeof(struct lz4_block_header);
+		ls->state = LZ4S_BLOCK_HEADER;
+	}
+
+	return 0;
+}
+
+int lz4_stream_feed(struct lz4_stream *ls, const void *src, ulong len)
+{
+	const u8 *in = src;
+	int ret = 0;
+
+	while (len && !ret) {
+		switch (ls->state) {
+		case LZ4S_FRAME:
+			if (lz4_stream_gather(ls, ls->hdr, &in, &len))
+				ret = lz4_stream_frame(ls);
+			break;
+		case LZ4S_SKIP:
+			if (lz4_stream_gather(ls, NULL, &in, &len)) {
+				ls->need = sizeof(struct lz4_block_header);
+				ls->state = LZ4S_BLOCK_HEADER;
+			}
+			break;
+		case LZ4S_BLOCK_HEADER:
+			if (!lz4_stream_gather(ls, ls->hdr, &in, &len))
+				break;
+			ls->b.raw = get_unaligned_le32(ls->hdr);
+			if (!ls->b.size && ls->has_content_checksum) {
+				ls->need = sizeof(u32);
+				ls->state = LZ4S_CHECKSUM;
+			} else if (!ls->b.size) {
+				ls->state = LZ4S_DONE;
+			} else if (ls->b.size > ls->block_max) {
+				ret = -EIO;
+			} else {
+				ls->need = ls->b.size;
+				ls->state = LZ4S_BLOCK;
+			}
+			break;
+		case LZ4S_BLOCK:
+			/* Decompress straight from the input if possible */
+			if (!ls->have && len >= ls->need) {
+				ret = lz4_stream_block(ls, in);
+				in += ls->b.size;
+				len -= ls->b.size;
+				break;
+			}
+			if (!ls->buf) {
+				ls->buf = malloc(ls->block_max);
+				if (!ls->buf)
+					return -ENOMEM;
+			}
+			if (lz4_stream_gather(ls, ls->buf, &in, &len))
+				ret = lz4_stream_block(ls, ls->buf);
+			break;
+		case LZ4S_CHECKSUM:
+			if (lz4_stream_gather(ls, NULL, &in, &len))
+				ls->state = LZ4S_DONE;
+			break;
+		case LZ4S_DONE:
+			/* Another frame follows, e.g. in concatenated files */
+			ls->need = sizeof(struct lz4_frame_header);
+			ls->state = LZ4S_FRAME;
+			break;
+		}
+	}
+
+	return ret;
+}
+
+int lz4_stream_end(struct lz4_stream *ls, ulong *lenp)
+{
+	int ret = ls->state == LZ4S_DONE ? 0 : -EIO;
+
+	*lenp = ls->out - ls->dst;
+	free(ls->buf);
+	free(ls);
+
+	return ret;
+}
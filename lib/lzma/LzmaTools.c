@@ -32,6 +32,7 @@
 
 #include <linux/string.h>
 #include <malloc.h>
+#include <asm/unaligned.h>
 
 static void *SzAlloc(void *p, size_t size) { return malloc(size); }
 static void SzFree(void *p, void *address) { free(address); }
@@ -120,4 +121,106 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     return res;
 }
 
+struct lzma_stream {
+	CLzmaDec dec;
+	ISzAlloc alloc;
+	SizeT limit;		/* number of bytes to decompress */
+	bool size_known;	/* the header gives the uncompressed size */
+	bool started;		/* the header has been handled */
+	bool done;		/* end of the compressed stream seen */
+	uint have;		/* bytes of header gathered so far */
+	Byte header[LZMA_DATA_OFFSET];
+};
+
+struct lzma_stream *lzma_stream_start(void *dst, ulong dstlen)
+{
+	struct lzma_stream *ls;
+
+	ls = calloc(1, sizeof(*ls));
+	if (!ls)
+		return NULL;
+	ls->alloc.Alloc = SzAlloc;
+	ls->alloc.Free = SzFree;
+	LzmaDec_Construct(&ls->dec);
+	ls->dec.dic = dst;
+	ls->dec.dicBufSize = dstlen;
+	ls->limit = dstlen;
+
+	return ls;
+}
+
+static int lzma_stream_header(struct lzma_stream *ls)
+{
+	u64 size = get_unaligned_le64(ls->header + LZMA_SIZE_OFFSET);
+	SRes res;
+
+	/* All ones means that the stream has an end mark instead */
+	if (size != (u64)-1) {
+		if (size > ls->dec.dicBufSize)
+			return -ENOSPC;
+		ls->limit = size;
+		ls->size_known = true;
+	}
+	res = LzmaDec_AllocateProbs(&ls->dec, ls->header, LZMA_PROPS_SIZE,
+				    &ls->alloc);
+	if (res == SZ_ERROR_MEM)
+		return -ENOMEM;
+	else if (res != SZ_OK)
+		return -EPROTONOSUPPORT;
+	LzmaDec_Init(&ls->dec);
+	ls->started = true;
+
+	return 0;
+}
+
+int lzma_stream_feed(struct lzma_stream *ls, const void *src, ulong len)
+{
+	const Byte *in = src;
+	ELzmaStatus status;
+	SizeT in_len;
+	SRes res;
+	int ret;
+
+	if (ls->done)
+		return 0;
+	if (!ls->started) {
+		uint n = min_t(ulong, len, sizeof(ls->header) - ls->have);
+
+		memcpy(ls->header + ls->have, in, n);
+		ls->have += n;
+		in += n;
+		len -= n;
+		if (ls->have < sizeof(ls->header))
+			return 0;
+		ret = lzma_stream_header(ls);
+		if (ret)
+			return ret;
+	}
+
+	/* The decoder keeps any incomplete input for the next call */
+	in_len = len;
+	res = LzmaDec_DecodeToDic(&ls->dec, ls->limit, in, &in_len,
+				  LZMA_FINISH_ANY, &status);
+	if (res != SZ_OK)
+		return -EIO;
+	if (status == LZMA_STATUS_FINISHED_WITH_MARK ||
+	    (ls->size_known && ls->dec.dicPos == ls->limit))
+		ls->done = true;
+	else if (in_len < len)
+		return -ENOSPC;
+
+	return 0;
+}
+
+int lzma_stream_end(struct lzma_stream *ls, ulong *lenp)
+{
+	int ret = ls->done ? 0 : -EIO;
+
+	*lenp = ls->dec.dicPos;
+	LzmaDec_FreeProbs(&ls->dec, &ls->alloc);
+	free(ls);
+
+	return ret;
+}
+
 #endif
@@ -15,4 +15,44 @@
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+struct lzma_stream;
+
+/**
+ * lzma_stream_start() - Start decompressing LZMA data in pieces
+ *
+ * The data must be in the LZMA_Alone format, as for
+ * lzmaBuffToBuffDecompress(). It is passed in with lzma_stream_feed() as
+ * it becomes available. The destination buffer is used as the dictionary,
+ * so no other large buffer is needed.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @return stream context, or NULL if out of memory
+ */
+struct lzma_stream *lzma_stream_start(void *dst, ulong dstlen);
+
+/**
+ * lzma_stream_feed() - Decompress the next piece of LZMA data
+ *
+ * The pieces may be of any size. Anything after the end of the compressed
+ * stream is ignored.
+ *
+ * @ls: Stream context from lzma_stream_start()
+ * @src: Next piece of compressed data
+ * @len: Length of the data at @src
+ * @return 0 if OK, -ENOSPC if the destination buffer is too small, -ENOMEM
+ *	if out of memory, -EPROTONOSUPPORT if the properties are not
+ *	supported, -EIO if the data is corrupted
+ */
+int lzma_stream_feed(struct lzma_stream *ls, const void *src, ulong len);
+
+/**
+ * lzma_stream_end() - Finish decompressing and free the stream context
+ *
+ * @ls: Stream context from lzma_stream_start()
+ * @lenp: Returns the number of bytes written to the destination
+ * @return 0 if OK, -EIO if the compressed data was incomplete
+ */
+int lzma_stream_end(struct lzma_stream *ls, ulong *lenp);
 #endif
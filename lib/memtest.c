@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Memory test engine
+ *
+ * The data line, address line and device tests are based on code whose
+ * Original Author and Copyright information follows: Copyright (c) 1998 by
+ * Michael Barr. This software is placed into the public domain and may be
+ * used for any purpose. However, this notice must not be changed or removed
+ * and no warranty is either expressed or implied by its publication or
+ * distribution.
+ */
+
+#include <common.h>
+#include <console.h>
+#include <cpu_func.h>
+#include <div64.h>
+#include <memtest.h>
+#include <watchdog.h>
+
+void memtest_init(struct memtest *mt, void *buf, ulong addr, ulong size,
+		  uint flags)
+{
+	memset(mt, '\0', sizeof(*mt));
+	mt->buf = buf;
+	mt->addr = addr;
+	mt->size = size & ~(sizeof(ulong) - 1);
+	mt->flags = flags;
+	mt->chunk = MEMTEST_CHUNK_SIZE;
+	mt->start_us = timer_get_us();
+}
+
+/* Record an error, returning -EINTR if the user wants to stop */
+static int memtest_error(struct memtest *mt, const ulong *ptr, ulong expect,
+			 ulong actual)
+{
+	ulong addr = mt->addr + ((ulong)ptr - (ulong)mt->buf);
+
+	if (!mt->errs)
+		mt->first_err = addr;
+	mt->errs++;
+	mt->err_bits |= expect ^ actual;
+	if (!(mt->flags & MEMTEST_QUIET)) {
+		ulong again = *(volatile ulong *)ptr;
+
+		printf("\nMem error @ 0x%08lx: found %08lx, expected %08lx",
+		       addr, actual, expect);
+		printf(" (%s error)\n", again == expect ? "read" : "write");
+	}
+
+	return ctrlc() ? -EINTR : 0;
+}
+
+/* Get the number of words in the next chunk, starting at @ptr */
+static ulong memtest_chunk_words(struct memtest *mt, ulong *ptr, ulong *end)
+{
+	return min((ulong)(end - ptr), mt->chunk / sizeof(ulong));
+}
+
+/*
+ * Finish a chunk: make sure that its writes are visible in memory if
+ * requested, then deal with the watchdog, progress and Ctrl-C.
+ */
+static int memtest_chunk_done(struct memtest *mt, ulong *start, ulong *end,
+			      bool written, uint passes)
+{
+	ulong bytes = (ulong)end - (ulong)start;
+
+	barrier();
+	if (written && (mt->flags & MEMTEST_FLUSH_CACHE)) {
+		flush_dcache_range(ALIGN_DOWN((ulong)start, ARCH_DMA_MINALIGN),
+				   ALIGN((ulong)end, ARCH_DMA_MINALIGN));
+	}
+	mt->bytes += (u64)bytes * passes;
+	WATCHDOG_RESET();
+	if (mt->flags & MEMTEST_PROGRESS)
+		putc('.');
+	if (ctrlc())
+		return -EINTR;
+
+	return 0;
+}
+
+int memtest_fill(struct memtest *mt, ulong pattern, ulong incr)
+{
+	ulong *end = mt->buf + mt->size / sizeof(ulong);
+	ulong *ptr, *start, *chunk_end;
+	ulong val = pattern;
+
+	for (ptr = mt->buf; ptr < end;) {
+		start = ptr;
+		chunk_end = ptr + memtest_chunk_words(mt, ptr, end);
+		for (; ptr + 4 <= chunk_end; ptr += 4, val += 4 * incr) {
+			ptr[0] = val;
+			ptr[1] = val + incr;
+			ptr[2] = val + 2 * incr;
+			ptr[3] = val + 3 * incr;
+		}
+		for (; ptr < chunk_end; ptr++, val += incr)
+			*ptr = val;
+		if (memtest_chunk_done(mt, start, ptr, true, 1))
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+int memtest_check(struct memtest *mt, ulong pattern, ulong incr, bool invert)
+{
+	ulong *end = mt->buf + mt->size / sizeof(ulong);
+	ulong *ptr, *start, *chunk_end;
+	ulong val = pattern;
+	int i;
+
+	for (ptr = mt->buf; ptr < end;) {
+		start = ptr;
+		chunk_end = ptr + memtest_chunk_words(mt, ptr, end);
+		barrier();
+		for (; ptr + 4 <= chunk_end; ptr += 4, val += 4 * incr) {
+			ulong actual[4] = { ptr[0], ptr[1], ptr[2], ptr[3] };
+
+			if ((actual[0] ^ val) | (actual[1] ^ (val + incr)) |
+			    (actual[2] ^ (val + 2 * incr)) |
+			    (actual[3] ^ (val + 3 * incr))) {
+				for (i = 0; i < 4; i++) {
+					ulong expect = val + i * incr;
+
+					if (actual[i] != expect &&
+					    memtest_error(mt, &ptr[i], expect,
+							  actual[i]))
+						return -EINTR;
+				}
+			}
+			if (invert) {
+				ptr[0] = ~val;
+				ptr[1] = ~(val + incr);
+				ptr[2] = ~(val + 2 * incr);
+				ptr[3] = ~(val + 3 * incr);
+			}
+		}
+		for (; ptr < chunk_end; ptr++, val += incr) {
+			ulong actual = *ptr;
+
+			if (actual != val &&
+			    memtest_error(mt, ptr, val, actual))
+				return -EINTR;
+			if (invert)
+				*ptr = ~val;
+		}
+		if (memtest_chunk_done(mt, start, ptr, invert, invert ? 2 : 1))
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+/* Check memory for @pattern from the top down, writing its inverse back */
+static int memtest_check_down(struct memtest *mt, ulong pattern)
+{
+	ulong *ptr = mt->buf + mt->size / sizeof(ulong);
+	ulong *top, *chunk_start;
+
+	while (ptr > mt->buf) {
+		top = ptr;
+		chunk_start = ptr - memtest_chunk_words(mt, mt->buf, ptr);
+		barrier();
+		while (ptr > chunk_start) {
+			ulong actual = *--ptr;
+
+			if (actual != pattern &&
+			    memtest_error(mt, ptr, pattern, actual))
+				return -EINTR;
+			*ptr = ~pattern;
+		}
+		if (memtest_chunk_done(mt, chunk_start, top, true, 2))
+			return -EINTR;
+	}
+
+	return 0;
+}
+
+int memtest_data_bus(struct memtest *mt, volatile ulong *dummy)
+{
+	static const ulong bitpattern[] = {
+		0x00000001,	/* single bit */
+		0x00000003,	/* two adjacent bits */
+		0x00000007,	/* three adjacent bits */
+		0x0000000F,	/* four adjacent bits */
+		0x00000005,	/* two non-adjacent bits */
+		0x00000015,	/* three non-adjacent bits */
+		0x00000055,	/* four non-adjacent bits */
+		0xaaaaaaaa,	/* alternating 1/0 */
+	};
+	volatile ulong *addr = mt->buf;
+	ulong val, readback;
+	int j;
+
+	/*
+	 * Write a pattern to the first location, write the 1's complement to
+	 * a 'parking' address (changes the state of the data bus so a
+	 * floating bus doesn't give a false OK), and then read the value
+	 * back. We test some patterns by shifting '1' bits through a field of
+	 * '0's and '0' bits through a field of '1's (i.e. pattern and
+	 * ~pattern).
+	 */
+	for (j = 0; j < ARRAY_SIZE(bitpattern); j++) {
+		for (val = bitpattern[j]; val != 0; val <<= 1) {
+			*addr = val;
+			if (dummy)
+				*dummy = ~val;
+			readback = *addr;
+			if (readback != val &&
+			    memtest_error(mt, mt->buf, val, readback))
+				return -EINTR;
+
+			*addr = ~val;
+			if (dummy)
+				*dummy = val;
+			readback = *addr;
+			if (readback != ~val &&
+			    memtest_error(mt, mt->buf, ~val, readback))
+				return -EINTR;
+		}
+	}
+
+	return 0;
+}
+
+int memtest_addr_bus(struct memtest *mt)
+{
+	volatile ulong *addr = mt->buf;
+	ulong num_words = mt->size / sizeof(ulong);
+	ulong pattern = 0xaaaaaaaa;
+	ulong anti_pattern = 0x55555555;
+	ulong offset, test_offset;
+	ulong temp;
+
+	/* Write the default pattern at each of the power-of-two offsets */
+	for (offset = 1; offset < num_words; offset <<= 1)
+		addr[offset] = pattern;
+
+	/* Check for address bits stuck high */
+	addr[0] = anti_pattern;
+	for (offset = 1; offset < num_words; offset <<= 1) {
+		temp = addr[offset];
+		if (temp != pattern &&
+		    memtest_error(mt, mt->buf + offset, pattern, temp))
+			return -EINTR;
+	}
+	addr[0] = pattern;
+	WATCHDOG_RESET();
+
+	/* Check for address bits stuck low or shorted */
+	for (test_offset = 1; test_offset < num_words; test_offset <<= 1) {
+		addr[test_offset] = anti_pattern;
+		temp = addr[0];
+		if (temp != pattern &&
+		    memtest_error(mt, mt->buf, pattern, temp))
+			return -EINTR;
+
+		for (offset = 1; offset < num_words; offset <<= 1) {
+			temp = addr[offset];
+			if (temp != pattern && offset != test_offset &&
+			    memtest_error(mt, mt->buf + offset, pattern, temp))
+				return -EINTR;
+		}
+		addr[test_offset] = pattern;
+	}
+
+	return 0;
+}
+
+/*
+ * The inverse of an incrementing sequence is a decrementing one:
+ * ~(pattern + n * incr) == ~pattern - n * incr
+ */
+int memtest_device(struct memtest *mt)
+{
+	if (memtest_fill(mt, 1, 1) ||
+	    memtest_check(mt, 1, 1, true) ||
+	    memtest_check(mt, ~1UL, -1UL, false))
+		return -EINTR;
+
+	return 0;
+}
+
+int memtest_addr_in_addr(struct memtest *mt)
+{
+	ulong addr = mt->addr;
+
+	if (memtest_fill(mt, addr, sizeof(ulong)) ||
+	    memtest_check(mt, addr, sizeof(ulong), true) ||
+	    memtest_check(mt, ~addr, -sizeof(ulong), false))
+		return -EINTR;
+
+	return 0;
+}
+
+int memtest_moving_inv(struct memtest *mt, ulong pattern)
+{
+	if (memtest_fill(mt, pattern, 0) ||
+	    memtest_check(mt, pattern, 0, true) ||
+	    memtest_check_down(mt, ~pattern))
+		return -EINTR;
+
+	return 0;
+}
+
+void memtest_show_speed(struct memtest *mt)
+{
+	ulong us = timer_get_us() - mt->start_us;
+
+	print_size(mt->bytes, "");
+	printf(" in %lu ms", us / 1000);
+	if (us)
+		printf(", %llu MB/s", lldiv(mt->bytes, us));
+	printf("\n");
+}
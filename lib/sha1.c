@@ -18,6 +18,7 @@
 
 #ifndef USE_HOSTCC
 #include <common.h>
+#include <linux/errno.h>
 #include <linux/string.h>
 #else
 #include <string.h>
@@ -25,6 +26,10 @@
 #include <watchdog.h>
 #include <u-boot/sha1.h>
 
+#if defined(CONFIG_ARMV8_CE_SHA) && !defined(USE_HOSTCC)
+#define SHA1_ARMV8_CE
+#endif
+
 const uint8_t sha1_der_prefix[SHA1_DER_LEN] = {
 	0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2b, 0x0e,
 	0x03, 0x02, 0x1a, 0x05, 0x00, 0x04, 0x14
@@ -65,7 +70,7 @@ void sha1_starts (sha1_context * ctx)
 	ctx->state[4] = 0xC3D2E1F0;
 }
 
-static void sha1_process(sha1_context *ctx, const unsigned char data[64])
+static void sha1_process_one(sha1_context *ctx, const unsigned char data[64])
 {
 	unsigned long temp, W[16], A, B, C, D, E;
 
@@ -219,11 +224,31 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	ctx->state[4] += E;
 }
 
-/*
- * SHA-1 process buffer
- */
-void sha1_update(sha1_context *ctx, const unsigned char *input,
-		 unsigned int ilen)
+static void sha1_process_generic(sha1_context *ctx, const unsigned char *data,
+				 unsigned int blocks)
+{
+	for (; blocks; blocks--, data += 64)
+		sha1_process_one(ctx, data);
+}
+
+/* Process @blocks 64-byte blocks with the fastest implementation available */
+static void sha1_process(sha1_context *ctx, const unsigned char *data,
+			 unsigned int blocks)
+{
+#ifdef SHA1_ARMV8_CE
+	if (sha1_armv8_ce_available()) {
+		sha1_armv8_ce_process(ctx, data, blocks);
+		return;
+	}
+#endif
+	sha1_process_generic(ctx, data, blocks);
+}
+
+static void sha1_do_update(sha1_context *ctx, const unsigned char *input,
+			   unsigned int ilen,
+			   void (*process)(sha1_context *ctx,
+					   const unsigned char *data,
+					   unsigned int blocks))
 {
 	int fill;
 	unsigned long left;
@@ -242,16 +267,17 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		process(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	/* Hand all the whole blocks over at once */
+	if (ilen >= 64) {
+		process(ctx, input, ilen / 64);
+		input += ilen & ~0x3F;
+		ilen &= 0x3F;
 	}
 
 	if (ilen > 0) {
@@ -259,6 +285,71 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 	}
 }
 
+/*
+ * SHA-1 process buffer
+ */
+void sha1_update(sha1_context *ctx, const unsigned char *input,
+		 unsigned int ilen)
+{
+	sha1_do_update(ctx, input, ilen, sha1_process);
+}
+
+/*
+ * SHA-1 process buffer. Trigger the watchdog every 'chunk_sz' bytes of input
+ * processed.
+ */
+void sha1_update_wd(sha1_context *ctx, const unsigned char *input,
+		    unsigned int ilen, unsigned int chunk_sz)
+{
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+	unsigned int chunk;
+
+	while (ilen) {
+		chunk = ilen > chunk_sz ? chunk_sz : ilen;
+		sha1_update(ctx, input, chunk);
+		input += chunk;
+		ilen -= chunk;
+		WATCHDOG_RESET();
+	}
+#else
+	sha1_update(ctx, input, ilen);
+#endif
+}
+
+#ifndef USE_HOSTCC
+static const char *const sha1_impl_names[SHA1_IMPL_COUNT] = {
+	[SHA1_IMPL_GENERIC]	= "generic",
+	[SHA1_IMPL_ARMV8_CE]	= "armv8-ce",
+};
+
+const char *sha1_impl_name(enum sha1_impl impl)
+{
+	if (impl < 0 || impl >= SHA1_IMPL_COUNT)
+		return NULL;
+
+	return sha1_impl_names[impl];
+}
+
+int sha1_impl_update(enum sha1_impl impl, sha1_context *ctx,
+		     const unsigned char *input, unsigned int ilen)
+{
+	switch (impl) {
+	case SHA1_IMPL_GENERIC:
+		sha1_do_update(ctx, input, ilen, sha1_process_generic);
+		return 0;
+#ifdef SHA1_ARMV8_CE
+	case SHA1_IMPL_ARMV8_CE:
+		if (!sha1_armv8_ce_available())
+			return -ENOSYS;
+		sha1_do_update(ctx, input, ilen, sha1_armv8_ce_process);
+		return 0;
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+#endif
+
 static const unsigned char sha1_padding[64] = {
 	0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 	   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -316,28 +407,9 @@ void sha1_csum_wd(const unsigned char *input, unsigned int ilen,
 		  unsigned char *output, unsigned int chunk_sz)
 {
 	sha1_context ctx;
-#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
-	const unsigned char *end, *curr;
-	int chunk;
-#endif
 
 	sha1_starts (&ctx);
-
-#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
-	curr = input;
-	end = input + ilen;
-	while (curr < end) {
-		chunk = end - curr;
-		if (chunk > chunk_sz)
-			chunk = chunk_sz;
-		sha1_update (&ctx, curr, chunk);
-		curr += chunk;
-		WATCHDOG_RESET ();
-	}
-#else
-	sha1_update (&ctx, input, ilen);
-#endif
-
+	sha1_update_wd(&ctx, input, ilen, chunk_sz);
 	sha1_finish (&ctx, output);
 }
 
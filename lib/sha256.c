@@ -7,6 +7,7 @@
 
 #ifndef USE_HOSTCC
 #include <common.h>
+#include <linux/errno.h>
 #include <linux/string.h>
 #else
 #include <string.h>
@@ -14,6 +15,10 @@
 #include <watchdog.h>
 #include <u-boot/sha256.h>
 
+#if defined(CONFIG_ARMV8_CE_SHA) && !defined(USE_HOSTCC)
+#define SHA256_ARMV8_CE
+#endif
+
 const uint8_t sha256_der_prefix[SHA256_DER_LEN] = {
 	0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
 	0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05,
@@ -55,7 +60,7 @@ void sha256_starts(sha256_context * ctx)
 	ctx->state[7] = 0x5BE0CD19;
 }
 
-static void sha256_process(sha256_context *ctx, const uint8_t data[64])
+static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
 {
 	uint32_t temp1, temp2;
 	uint32_t W[64];
@@ -186,7 +191,31 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
-void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
+static void sha256_process_generic(sha256_context *ctx, const uint8_t *data,
+				   unsigned int blocks)
+{
+	for (; blocks; blocks--, data += 64)
+		sha256_process_one(ctx, data);
+}
+
+/* Process @blocks 64-byte blocks with the fastest implementation available */
+static void sha256_process(sha256_context *ctx, const uint8_t *data,
+			   unsigned int blocks)
+{
+#ifdef SHA256_ARMV8_CE
+	if (sha256_armv8_ce_available()) {
+		sha256_armv8_ce_process(ctx, data, blocks);
+		return;
+	}
+#endif
+	sha256_process_generic(ctx, data, blocks);
+}
+
+static void sha256_do_update(sha256_context *ctx, const uint8_t *input,
+			     uint32_t length,
+			     void (*process)(sha256_context *ctx,
+					     const uint8_t *data,
+					     unsigned int blocks))
 {
 	uint32_t left, fill;
 
@@ -204,22 +233,80 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		process(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	/* Hand all the whole blocks over at once */
+	if (length >= 64) {
+		process(ctx, input, length / 64);
+		input += length & ~0x3F;
+		length &= 0x3F;
 	}
 
 	if (length)
 		memcpy((void *) (ctx->buffer + left), (void *) input, length);
 }
 
+void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
+{
+	sha256_do_update(ctx, input, length, sha256_process);
+}
+
+void sha256_update_wd(sha256_context *ctx, const uint8_t *input,
+		      uint32_t length, unsigned int chunk_sz)
+{
+#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
+	uint32_t chunk;
+
+	while (length) {
+		chunk = length > chunk_sz ? chunk_sz : length;
+		sha256_update(ctx, input, chunk);
+		input += chunk;
+		length -= chunk;
+		WATCHDOG_RESET();
+	}
+#else
+	sha256_update(ctx, input, length);
+#endif
+}
+
+#ifndef USE_HOSTCC
+static const char *const sha256_impl_names[SHA256_IMPL_COUNT] = {
+	[SHA256_IMPL_GENERIC]	= "generic",
+	[SHA256_IMPL_ARMV8_CE]	= "armv8-ce",
+};
+
+const char *sha256_impl_name(enum sha256_impl impl)
+{
+	if (impl < 0 || impl >= SHA256_IMPL_COUNT)
+		return NULL;
+
+	return sha256_impl_names[impl];
+}
+
+int sha256_impl_update(enum sha256_impl impl, sha256_context *ctx,
+		       const uint8_t *input, uint32_t length)
+{
+	switch (impl) {
+	case SHA256_IMPL_GENERIC:
+		sha256_do_update(ctx, input, length, sha256_process_generic);
+		return 0;
+#ifdef SHA256_ARMV8_CE
+	case SHA256_IMPL_ARMV8_CE:
+		if (!sha256_armv8_ce_available())
+			return -ENOSYS;
+		sha256_do_update(ctx, input, length, sha256_armv8_ce_process);
+		return 0;
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+#endif
+
 static uint8_t sha256_padding[64] = {
 	0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 	   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -264,28 +351,8 @@ void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz)
 {
 	sha256_context ctx;
-#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
-	const unsigned char *end;
-	unsigned char *curr;
-	int chunk;
-#endif
 
 	sha256_starts(&ctx);
-
-#if defined(CONFIG_HW_WATCHDOG) || defined(CONFIG_WATCHDOG)
-	curr = (unsigned char *)input;
-	end = input + ilen;
-	while (curr < end) {
-		chunk = end - curr;
-		if (chunk > chunk_sz)
-			chunk = chunk_sz;
-		sha256_update(&ctx, curr, chunk);
-		curr += chunk;
-		WATCHDOG_RESET();
-	}
-#else
-	sha256_update(&ctx, input, ilen);
-#endif
-
+	sha256_update_wd(&ctx, input, ilen, chunk_sz);
 	sha256_finish(&ctx, output);
 }
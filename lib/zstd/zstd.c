@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Zstandard decompression of a buffer held in memory
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/zstd.h>
+#include <u-boot/zstd.h>
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	size_t wsize, ret;
+	void *workspace;
+	size_t dst_size = *dstn;
+
+	/* Nothing is reported as decompressed unless it all succeeds */
+	*dstn = 0;
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace) {
+		debug("%s: cannot allocate workspace of size %zu\n", __func__,
+		      wsize);
+		return -ENOMEM;
+	}
+
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	ret = dctx ? ZSTD_decompressDCtx(dctx, dst, dst_size, src, srcn) :
+		(size_t)-ZSTD_error_init_missing;
+	free(workspace);
+
+	if (ZSTD_isError(ret)) {
+		debug("%s: error %d\n", __func__, ZSTD_getErrorCode(ret));
+		switch (ZSTD_getErrorCode(ret)) {
+		case ZSTD_error_dstSize_tooSmall:
+			return -ENOSPC;
+		case ZSTD_error_version_unsupported:
+		case ZSTD_error_frameParameter_unsupported:
+		case ZSTD_error_frameParameter_windowTooLarge:
+			return -EPROTONOSUPPORT;
+		default:
+			return -EINVAL;
+		}
+	}
+	*dstn = ret;
+
+	return 0;
+}
+
+struct zstd_stream {
+	ZSTD_DStream *zds;
+	ZSTD_outBuffer out;
+	void *workspace;
+	bool done;		/* end of a frame seen, and nothing after it */
+	uint have;		/* bytes of frame header gathered so far */
+	u8 header[ZSTD_FRAMEHEADERSIZE_MAX];
+};
+
+struct zstd_stream *zstd_stream_start(void *dst, ulong dstlen)
+{
+	struct zstd_stream *zs;
+
+	zs = calloc(1, sizeof(*zs));
+	if (!zs)
+		return NULL;
+	zs->out.dst = dst;
+	zs->out.size = dstlen;
+
+	return zs;
+}
+
+static int zstd_stream_error(size_t ret)
+{
+	debug("%s: error %d\n", __func__, ZSTD_getErrorCode(ret));
+	switch (ZSTD_getErrorCode(ret)) {
+	case ZSTD_error_memory_allocation:
+		return -ENOMEM;
+	case ZSTD_error_version_unsupported:
+	case ZSTD_error_frameParameter_unsupported:
+	case ZSTD_error_frameParameter_windowTooLarge:
+		return -EPROTONOSUPPORT;
+	default:
+		return -EIO;
+	}
+}
+
+/*
+ * Decompress data up to the end of the current frame. Returns the number of
+ * bytes used, which is less than @len only if the frame has ended, or
+ * -ENOSPC if the output does not all fit, or another negative error
+ */
+static long zstd_stream_decomp(struct zstd_stream *zs, const void *src,
+			       ulong len)
+{
+	ZSTD_inBuffer in = { .src = src, .size = len };
+	size_t ret;
+
+	while (in.pos < in.size) {
+		size_t pos = in.pos;
+
+		ret = ZSTD_decompressStream(zs->zds, &zs->out, &in);
+		if (ZSTD_isError(ret))
+			return zstd_stream_error(ret);
+		if (!ret) {
+			zs->done = true;
+			break;
+		}
+		if (zs->out.pos == zs->out.size && in.pos == pos)
+			return -ENOSPC;
+	}
+
+	return in.pos;
+}
+
+/*
+ * Gather the header of the next frame from the input and set up a
+ * decompression context with the window size of the frame. Returns -EAGAIN
+ * if more input is needed.
+ */
+static int zstd_stream_init(struct zstd_stream *zs, const void **srcp,
+			    ulong *lenp)
+{
+	ZSTD_frameParams params;
+	size_t wsize, window, ret;
+	long used;
+	ulong n;
+
+	/* This returns the header size while it has not all been gathered */
+	while ((ret = ZSTD_getFrameParams(&params, zs->header, zs->have))) {
+		if (ZSTD_isError(ret))
+			return zstd_stream_error(ret);
+		n = min_t(ulong, *lenp, ret - zs->have);
+		if (!n)
+			return -EAGAIN;
+		memcpy(zs->header + zs->have, *srcp, n);
+		zs->have += n;
+		*srcp += n;
+		*lenp -= n;
+	}
+
+	/* The decoder never uses a window smaller than the minimum */
+	window = max_t(size_t, params.windowSize, 1 << ZSTD_WINDOWLOG_MIN);
+	wsize = ZSTD_DStreamWorkspaceBound(window);
+	zs->workspace = malloc(wsize);
+	if (!zs->workspace) {
+		debug("%s: cannot allocate workspace of size %zu\n", __func__,
+		      wsize);
+		return -ENOMEM;
+	}
+	zs->zds = ZSTD_initDStream(window, zs->workspace, wsize);
+	if (!zs->zds)
+		return -ENOMEM;
+
+	used = zstd_stream_decomp(zs, zs->header, zs->have);
+
+	return used < 0 ? used : 0;
+}
+
+/* Free the context of a frame which has ended, ready for the next one */
+static void zstd_stream_next(struct zstd_stream *zs)
+{
+	free(zs->workspace);
+	zs->workspace = NULL;
+	zs->zds = NULL;
+	zs->have = 0;
+	zs->done = false;
+}
+
+int zstd_stream_feed(struct zstd_stream *zs, const void *src, ulong len)
+{
+	long used;
+	int ret;
+
+	while (len) {
+		/* Another frame may follow, e.g. in concatenated files */
+		if (zs->done)
+			zstd_stream_next(zs);
+		if (!zs->zds) {
+			ret = zstd_stream_init(zs, &src, &len);
+			if (ret == -EAGAIN)
+				return 0;
+			else if (ret)
+				return ret;
+			continue;
+		}
+		used = zstd_stream_decomp(zs, src, len);
+		if (used < 0)
+			return used;
+		src += used;
+		len -= used;
+	}
+
+	return 0;
+}
+
+int zstd_stream_end(struct zstd_stream *zs, ulong *lenp)
+{
+	int ret = zs->done ? 0 : -EIO;
+
+	*lenp = zs->out.pos;
+	free(zs->workspace);
+	free(zs);
+
+	return ret;
+}
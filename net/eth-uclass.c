@@ -8,6 +8,7 @@
 #include <common.h>
 #include <dm.h>
 #include <env.h>
+#include <malloc.h>
 #include <net.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
@@ -388,6 +389,70 @@ int eth_rx(void)
 	return ret;
 }
 
+int eth_rx_ring_init(struct eth_rx_ring *ring, int count)
+{
+	memset(ring, '\0', sizeof(*ring));
+	ring->mem = memalign(PKTALIGN, count * PKTSIZE_ALIGN);
+	ring->lens = calloc(count, sizeof(*ring->lens));
+	if (!ring->mem || !ring->lens) {
+		eth_rx_ring_uninit(ring);
+		return -ENOMEM;
+	}
+	ring->count = count;
+
+	return 0;
+}
+
+void eth_rx_ring_uninit(struct eth_rx_ring *ring)
+{
+	free(ring->mem);
+	free(ring->lens);
+	memset(ring, '\0', sizeof(*ring));
+}
+
+void eth_rx_ring_reset(struct eth_rx_ring *ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->used = 0;
+}
+
+uchar *eth_rx_ring_get_buf(struct eth_rx_ring *ring)
+{
+	if (ring->used == ring->count)
+		return NULL;
+
+	return ring->mem + ring->tail * PKTSIZE_ALIGN;
+}
+
+void eth_rx_ring_push(struct eth_rx_ring *ring, int len)
+{
+	ring->lens[ring->tail] = len;
+	if (++ring->tail == ring->count)
+		ring->tail = 0;
+	ring->used++;
+}
+
+int eth_rx_ring_recv(struct eth_rx_ring *ring, uchar **packetp)
+{
+	if (!ring->used)
+		return -EAGAIN;
+	*packetp = ring->mem + ring->head * PKTSIZE_ALIGN;
+
+	return ring->lens[ring->head];
+}
+
+int eth_rx_ring_free_pkt(struct eth_rx_ring *ring, uchar *packet)
+{
+	if (!ring->used || packet != ring->mem + ring->head * PKTSIZE_ALIGN)
+		return -EINVAL;
+	if (++ring->head == ring->count)
+		ring->head = 0;
+	ring->used--;
+
+	return 0;
+}
+
 int eth_initialize(void)
 {
 	int num_devices = 0;
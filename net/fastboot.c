@@ -25,7 +25,6 @@ struct __packed fastboot_header {
 };
 
 #define PACKET_SIZE 1024
-#define DATA_SIZE (PACKET_SIZE - sizeof(struct fastboot_header))
 
 /* Sequence number sent for every packet */
 static unsigned short sequence_number = 1;
@@ -112,11 +111,12 @@ static void fastboot_timed_send_info(const char *msg)
  * fastboot_send() - Sends a packet in response to received fastboot packet
  *
  * @header: Header for response packet
- * @fastboot_data: Pointer to received fastboot data
+ * @fastboot_data: Pointer to received fastboot data, in the received packet
  * @fastboot_data_len: Length of received fastboot data
  * @retransmit: Nonzero if sending last sent packet
  */
-static void fastboot_send(struct fastboot_header header, char *fastboot_data,
+static void fastboot_send(struct fastboot_header header,
+			  const char *fastboot_data,
 			  unsigned int fastboot_data_len, uchar retransmit)
 {
 	uchar *packet;
@@ -176,11 +176,14 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 				fastboot_data_download(fastboot_data,
 						       fastboot_data_len,
 						       response);
+				net_rx_copied(fastboot_data_len);
 			}
 		} else if (!pending_command) {
-			strlcpy(command, fastboot_data,
-				min((size_t)fastboot_data_len + 1,
-				    sizeof(command)));
+			/* The command is not nul-terminated in the packet */
+			len = min((size_t)fastboot_data_len,
+				  sizeof(command) - 1);
+			memcpy(command, fastboot_data, len);
+			command[len] = '\0';
 			pending_command = true;
 		} else {
 			cmd = fastboot_handle_command(command, response);
@@ -258,8 +261,6 @@ static void fastboot_handler(uchar *packet, unsigned int dport,
 			     unsigned int len)
 {
 	struct fastboot_header header;
-	char fastboot_data[DATA_SIZE] = {0};
-	unsigned int fastboot_data_len = 0;
 
 	if (dport != fastboot_our_port)
 		return;
@@ -277,27 +278,26 @@ static void fastboot_handler(uchar *packet, unsigned int dport,
 
 	switch (header.id) {
 	case FASTBOOT_QUERY:
-		fastboot_send(header, fastboot_data, 0, 0);
+		fastboot_send(header, NULL, 0, 0);
 		break;
 	case FASTBOOT_INIT:
 	case FASTBOOT_FASTBOOT:
-		fastboot_data_len = len;
-		if (len > 0)
-			memcpy(fastboot_data, packet, len);
+		/*
+		 * The data is used straight from the packet, so that a
+		 * download is only copied once, into the download buffer
+		 */
 		if (header.seq == sequence_number) {
-			fastboot_send(header, fastboot_data,
-				      fastboot_data_len, 0);
+			fastboot_send(header, (const char *)packet, len, 0);
 			sequence_number++;
 		} else if (header.seq == sequence_number - 1) {
 			/* Retransmit last sent packet */
-			fastboot_send(header, fastboot_data,
-				      fastboot_data_len, 1);
+			fastboot_send(header, (const char *)packet, len, 1);
 		}
 		break;
 	default:
 		pr_err("ID %d not implemented.\n", header.id);
 		header.id = FASTBOOT_ERROR;
-		fastboot_send(header, fastboot_data, 0, 0);
+		fastboot_send(header, NULL, 0, 0);
 		break;
 	}
 }
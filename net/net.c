@@ -191,6 +191,10 @@ int		net_ntp_time_offset;
 static uchar net_pkt_buf[(PKTBUFSRX+1) * PKTSIZE_ALIGN + PKTALIGN];
 /* Receive packets */
 uchar *net_rx_packets[PKTBUFSRX];
+/* Statistics for received packets */
+#ifdef CONFIG_NET_RX_STATS
+struct net_rx_stats net_rx_stats;
+#endif
 /* Current UDP RX packet handler */
 static rxhand_f *udp_packet_handler;
 /* Current ARP RX packet handler */
@@ -1013,6 +1017,7 @@ static struct ip_udp_hdr *__net_defragment(struct ip_udp_hdr *ip, int *lenp)
 
 	/* finally copy this fragment and possibly return whole packet */
 	memcpy((uchar *)thisfrag, indata + IP_HDR_SIZE, len);
+	net_rx_copied(len);
 	if (!done)
 		return NULL;
 
@@ -1095,6 +1100,10 @@ void net_process_received_packet(uchar *in_packet, int len)
 	net_rx_packet = in_packet;
 	net_rx_packet_len = len;
 	et = (struct ethernet_hdr *)in_packet;
+	if (IS_ENABLED(CONFIG_NET_RX_STATS)) {
+		net_rx_stats.frames++;
+		net_rx_stats.bytes += len;
+	}
 
 	/* too small packet? */
 	if (len < ETHER_HDR_SIZE)
@@ -34,8 +34,10 @@
 #include "nfs.h"
 #include "bootp.h"
 #include <time.h>
+#include <div64.h>
 
 #define HASHES_PER_LINE 65	/* Number of "loading" hashes per line	*/
+#define HASH_BYTES	5120	/* Number of bytes loaded per hash	*/
 #define NFS_RETRY_COUNT 30
 #ifndef CONFIG_NFS_TIMEOUT
 # define NFS_TIMEOUT 2000UL
@@ -46,10 +48,40 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+#ifdef CONFIG_NFS_READ_WINDOW
+#define NFS_READ_WINDOW	CONFIG_NFS_READ_WINDOW
+#else
+#define NFS_READ_WINDOW	1
+#endif
+#define NFS_READ_WINDOW_MAX	16
+
+/**
+ * struct nfs_read_call - an NFS READ call which is in flight
+ *
+ * @id: RPC transaction ID (XID) of the call, kept when retransmitting it
+ * @offset: file offset asked for
+ * @len: number of bytes asked for, 0 if this entry is not in use
+ * @sent: time the call was last sent, in ms
+ * @retries: number of times the call has been retransmitted
+ */
+struct nfs_read_call {
+	ulong id;
+	int offset;
+	int len;
+	ulong sent;
+	int retries;
+};
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
+static int nfs_offset = -1;	/* file offset of the next READ call */
+static int nfs_rsize;		/* bytes asked for by each READ call */
+static int nfs_window;		/* READ calls allowed in flight */
+static bool nfs_read_eof;	/* true once the end of the file is known */
+static ulong nfs_read_start;	/* time the first READ call was sent */
+static ulong nfs_read_calls;	/* statistics */
+static ulong nfs_read_retransmits;
+static struct nfs_read_call nfs_read_pending[NFS_READ_WINDOW_MAX];
 static ulong nfs_timeout = NFS_TIMEOUT;
 
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
@@ -71,6 +103,8 @@ static int nfs_state;
 #define STATE_READ_REQ			6
 #define STATE_READLINK_REQ		7
 
+static void nfs_timeout_handler(void);
+
 static char *nfs_filename;
 static char *nfs_path;
 static char nfs_path_buff[2048];
@@ -106,6 +140,7 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 
 		memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
+		net_rx_copied(len);
 	}
 
 	if (net_boot_file_size < (offset + len))
@@ -171,15 +206,14 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static void rpc_req_id(unsigned long id, int rpc_prog, int rpc_proc,
+		       uint32_t *data, int datalen)
 {
 	struct rpc_t rpc_pkt;
-	unsigned long id;
 	uint32_t *p;
 	int pktlen;
 	int sport;
 
-	id = ++rpc_id;
 	rpc_pkt.u.call.id = htonl(id);
 	rpc_pkt.u.call.type = htonl(MSG_CALL);
 	rpc_pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
@@ -218,6 +252,11 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 			    nfs_our_port, pktlen);
 }
 
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_req_id(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
@@ -357,7 +396,7 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(struct nfs_read_call *call)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -369,22 +408,57 @@ static void nfs_read_req(int offset, int readlen)
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		memcpy(p, filefh, NFS_FHSIZE);
 		p += (NFS_FHSIZE / 4);
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(call->offset);
+		*p++ = htonl(call->len);
 		*p++ = 0;
 	} else { /* NFSV3_FLAG */
 		*p++ = htonl(filefh3_length);
 		memcpy(p, filefh, filefh3_length);
 		p += (filefh3_length / 4);
 		*p++ = htonl(0); /* offset is 64-bit long, so fill with 0 */
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(call->offset);
+		*p++ = htonl(call->len);
 		*p++ = 0;
 	}
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	call->sent = get_timer(0);
+	rpc_req_id(call->id, PROG_NFS, NFS_READ, data, len);
+}
+
+/*
+ * Send READ calls for the following parts of the file until the window is
+ * full or the end of the file is known
+ */
+static void nfs_read_fill_window(void)
+{
+	struct nfs_read_call *call;
+	int i;
+
+	for (i = 0; i < nfs_window && !nfs_read_eof; i++) {
+		call = &nfs_read_pending[i];
+		if (call->len)
+			continue;
+		call->id = ++rpc_id;
+		call->offset = nfs_offset;
+		call->len = nfs_rsize;
+		call->retries = 0;
+		nfs_offset += nfs_rsize;
+		nfs_read_calls++;
+		nfs_read_req(call);
+	}
+}
+
+/* Start reading the file from the beginning */
+static void nfs_read_start_file(void)
+{
+	memset(nfs_read_pending, '\0', sizeof(nfs_read_pending));
+	nfs_offset = 0;
+	nfs_read_eof = false;
+	nfs_read_calls = 0;
+	nfs_read_retransmits = 0;
+	nfs_read_start = get_timer(0);
 }
 
 /**************************************************************************
@@ -417,7 +491,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_fill_window();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -434,6 +508,7 @@ static int rpc_lookup_reply(int prog, uchar *pkt, unsigned len)
 	struct rpc_t rpc_pkt;
 
 	memcpy(&rpc_pkt.u.data[0], pkt, len);
+	net_rx_copied(len);
 
 	debug("%s\n", __func__);
 
@@ -466,6 +541,7 @@ static int nfs_mount_reply(uchar *pkt, unsigned len)
 	debug("%s\n", __func__);
 
 	memcpy(&rpc_pkt.u.data[0], pkt, len);
+	net_rx_copied(len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
@@ -492,6 +568,7 @@ static int nfs_umountall_reply(uchar *pkt, unsigned len)
 	debug("%s\n", __func__);
 
 	memcpy(&rpc_pkt.u.data[0], pkt, len);
+	net_rx_copied(len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
@@ -516,6 +593,7 @@ static int nfs_lookup_reply(uchar *pkt, unsigned len)
 	debug("%s\n", __func__);
 
 	memcpy(&rpc_pkt.u.data[0], pkt, len);
+	net_rx_copied(len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
@@ -619,6 +697,7 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	debug("%s\n", __func__);
 
 	memcpy((unsigned char *)&rpc_pkt, pkt, len);
+	net_rx_copied(len);
 
 	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
 		return -NFS_RPC_ERR;
@@ -660,19 +739,73 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
+/* Print a hash for each HASH_BYTES of the file that has been loaded */
+static void nfs_show_progress(ulong before, ulong after)
+{
+	ulong hash;
+
+	for (hash = DIV_ROUND_UP(before, HASH_BYTES);
+	     hash * HASH_BYTES < after; hash++) {
+		if (hash && !(hash % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+	}
+}
+
+static struct nfs_read_call *nfs_read_find_call(ulong id)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW_MAX; i++) {
+		if (nfs_read_pending[i].len && nfs_read_pending[i].id == id)
+			return &nfs_read_pending[i];
+	}
+
+	return NULL;
+}
+
+/* Note where the file ends and drop any READ calls beyond it */
+static void nfs_read_set_eof(int size)
+{
+	int i;
+
+	nfs_read_eof = true;
+	for (i = 0; i < NFS_READ_WINDOW_MAX; i++) {
+		if (nfs_read_pending[i].offset >= size)
+			nfs_read_pending[i].len = 0;
+	}
+}
+
+static bool nfs_read_busy(void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW_MAX; i++) {
+		if (nfs_read_pending[i].len)
+			return true;
+	}
+
+	return false;
+}
+
 static int nfs_read_reply(uchar *pkt, unsigned len)
 {
+	struct nfs_read_call *call;
 	struct rpc_t rpc_pkt;
-	int rlen;
-	uchar *data_ptr;
+	int rlen, hlen;
+	bool eof;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	/* Only the header is copied; the data is stored from the packet */
+	hlen = (uchar *)&rpc_pkt.u.reply.data[NFS_MAX_ATTRS] -
+		(uchar *)&rpc_pkt;
+	memcpy(&rpc_pkt.u.data[0], pkt, min_t(int, len, hlen));
+	net_rx_copied(min_t(int, len, hlen));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	/* Replies may arrive in any order, so match them by XID */
+	call = nfs_read_find_call(ntohl(rpc_pkt.u.reply.id));
+	if (!call)
 		return -NFS_RPC_DROP;
 
 	if (rpc_pkt.u.reply.rstatus  ||
@@ -686,43 +819,116 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
-		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		hlen = (uchar *)&rpc_pkt.u.reply.data[19] - (uchar *)&rpc_pkt;
+		/* NFSv2 only returns a short read at the end of the file */
+		eof = rlen < call->len;
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		eof = rpc_pkt.u.reply.data[2 + nfsv3_data_offset] != 0;
 		/* Skip unused values :
 			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
-		data_ptr = (uchar *)
-			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
+		hlen = (uchar *)&rpc_pkt.u.reply.data[4 + nfsv3_data_offset] -
+			(uchar *)&rpc_pkt;
 	}
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
-
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	if (rlen < 0 || rlen > call->len || hlen + rlen > len)
+		return -9999;
+
+	nfs_show_progress(net_boot_file_size, call->offset + rlen);
+	if (store_block(pkt + hlen, call->offset, rlen))
+		return -9999;
+
+	if (eof || !rlen) {
+		call->len = 0;
+		nfs_read_set_eof(call->offset + rlen);
+	} else if (rlen < call->len) {
+		/* Ask again for the rest of a short read */
+		call->offset += rlen;
+		call->len -= rlen;
+		call->id = ++rpc_id;
+		call->retries = 0;
+		nfs_read_calls++;
+		nfs_read_req(call);
+	} else {
+		call->len = 0;
+	}
 
 	return rlen;
 }
 
+/* Print the speed of the transfer */
+static void nfs_read_complete(void)
+{
+	ulong time_taken = get_timer(nfs_read_start);
+
+	puts("\n\t ");	/* Line up with "Loading: " */
+	if (time_taken)
+		print_size(lldiv((u64)net_boot_file_size * 1000, time_taken),
+			   "/s");
+	printf(" (rsize %d, window %d, %lu calls, %lu retransmits)",
+	       nfs_rsize, nfs_window, nfs_read_calls, nfs_read_retransmits);
+}
+
+/* Set the timeout for the READ call which has waited the longest */
+static void nfs_read_set_timeout(void)
+{
+	ulong delay = ~0UL;
+	ulong wait, elapsed;
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW_MAX; i++) {
+		struct nfs_read_call *call = &nfs_read_pending[i];
+
+		if (!call->len)
+			continue;
+		wait = nfs_timeout + NFS_TIMEOUT * call->retries;
+		elapsed = get_timer(call->sent);
+		delay = min(delay, elapsed < wait ? wait - elapsed : 0);
+	}
+	if (delay != ~0UL)
+		net_set_timeout_handler(max(delay, 1UL), nfs_timeout_handler);
+}
+
+/* Retransmit each READ call whose reply has not arrived in time */
+static void nfs_read_timeout(void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_WINDOW_MAX; i++) {
+		struct nfs_read_call *call = &nfs_read_pending[i];
+
+		if (!call->len || get_timer(call->sent) <
+		    nfs_timeout + NFS_TIMEOUT * call->retries)
+			continue;
+		if (++call->retries > NFS_RETRY_COUNT) {
+			puts("\nRetry count exceeded; starting again\n");
+			net_start_again();
+			return;
+		}
+		puts("T ");
+		nfs_read_retransmits++;
+		nfs_read_req(call);
+	}
+	nfs_read_set_timeout();
+}
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
 static void nfs_timeout_handler(void)
 {
+	if (nfs_state == STATE_READ_REQ) {
+		nfs_read_timeout();
+		return;
+	}
 	if (++nfs_timeout_count > NFS_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
 		net_start_again();
@@ -810,9 +1016,9 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
+			nfs_read_start_file();
 			nfs_send();
+			nfs_read_set_timeout();
 		}
 		break;
 
@@ -839,16 +1045,18 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
+		if (rlen >= 0 && (!nfs_read_eof || nfs_read_busy())) {
 			nfs_send();
+			nfs_read_set_timeout();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
+			if (rlen >= 0) {
+				nfs_read_complete();
 				nfs_download_state = NETLOOP_SUCCESS;
+			}
 			if (rlen < 0)
 				debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
@@ -861,9 +1069,24 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 void nfs_start(void)
 {
+	char *ep;
+
 	debug("%s\n", __func__);
 	nfs_download_state = NETLOOP_FAIL;
 
+	nfs_rsize = NFS_READ_SIZE;
+	ep = env_get("nfsrsize");
+	if (ep && simple_strtol(ep, NULL, 10) > 0)
+		nfs_rsize = min_t(int, simple_strtol(ep, NULL, 10),
+				  NFS_READ_SIZE);
+
+	nfs_window = NFS_READ_WINDOW;
+	ep = env_get("nfswindowsize");
+	if (ep)
+		nfs_window = clamp_t(int, simple_strtol(ep, NULL, 10), 1,
+				     NFS_READ_WINDOW_MAX);
+	debug("NFS rsize = %d, window = %d\n", nfs_rsize, nfs_window);
+
 	nfs_server_ip = net_server_ip;
 	nfs_path = (char *)nfs_path_buff;
 
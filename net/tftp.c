@@ -79,6 +79,12 @@ static int	timeout_count;
 static ulong	tftp_cur_block;
 /* last packet sequence number received */
 static ulong	tftp_prev_block;
+/* block number after which the next acknowledgment is due */
+static ushort	tftp_next_ack;
+/* last in-order block acknowledged because of a lost block, if any */
+static int	tftp_last_nack;
+/* number of times a lost or reordered block restarted the window */
+static ulong	tftp_window_restarts;
 /* count of sequence number wraparounds */
 static ulong	tftp_block_wrap;
 /* memory offset due to wrapping */
@@ -141,6 +147,18 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/* default TFTP window size (RFC 7440) */
+#define TFTP_WINDOW_SIZE	1
+
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_MTU_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_MTU_WINDOWSIZE TFTP_WINDOW_SIZE
+#endif
+
+static unsigned short tftp_window_size = TFTP_WINDOW_SIZE;
+static unsigned short tftp_window_size_option = TFTP_MTU_WINDOWSIZE;
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset;
@@ -186,6 +204,7 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		ptr = map_sysmem(store_addr, len);
 		memcpy(ptr, src, len);
 		unmap_sysmem(ptr);
+		net_rx_copied(len);
 	}
 
 	if (net_boot_file_size < newsize)
@@ -198,6 +217,9 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 static void new_transfer(void)
 {
 	tftp_prev_block = 0;
+	tftp_next_ack = tftp_window_size;
+	tftp_last_nack = -1;
+	tftp_window_restarts = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
 #ifdef CONFIG_CMD_TFTPPUT
@@ -306,6 +328,9 @@ static void tftp_complete(void)
 		puts("\n\t ");	/* Line up with "Loading: " */
 		print_size(net_boot_file_size /
 			time_start * 1000, "/s");
+		if (tftp_window_size > 1)
+			printf(" (window %d, %lu restarts)", tftp_window_size,
+			       tftp_window_restarts);
 	}
 	puts("\ndone\n");
 	net_set_state(NETLOOP_SUCCESS);
@@ -352,6 +377,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* ask for several blocks to be sent per acknowledgment */
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+				       0, tftp_window_size_option, 0);
 		len = pkt - xp;
 		break;
 
@@ -364,6 +393,8 @@ static void tftp_send(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(tftp_cur_block);
 		pkt = (uchar *)(s + 2);
+		/* The server sends a new window after each acknowledgment */
+		tftp_next_ack = tftp_cur_block + tftp_window_size;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			int toload = tftp_block_size;
@@ -496,6 +527,15 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_window_size = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				if (!tftp_window_size)
+					tftp_window_size = 1;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_window_size);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -520,8 +560,6 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
-		update_block_number();
-
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
 
@@ -542,12 +580,33 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 		}
 
-		if (tftp_cur_block == tftp_prev_block) {
-			/* Same block again; ignore it. */
+		if ((ushort)(tftp_cur_block - tftp_prev_block - 1) >= 0x8000) {
+			/* Same or older block again; ignore it. */
+			tftp_cur_block = tftp_prev_block;
 			break;
 		}
 
+		if (tftp_cur_block != (ushort)(tftp_prev_block + 1)) {
+			/*
+			 * A block was lost or reordered. Acknowledge the last
+			 * block received in order, once, so that the server
+			 * restarts the window from the missing block.
+			 */
+			debug("Unexpected block %lu, expected %lu\n",
+			      tftp_cur_block,
+			      (ulong)(ushort)(tftp_prev_block + 1));
+			tftp_cur_block = tftp_prev_block;
+			if (tftp_last_nack != tftp_prev_block) {
+				tftp_last_nack = tftp_prev_block;
+				tftp_window_restarts++;
+				tftp_send();
+			}
+			break;
+		}
+
+		update_block_number();
 		tftp_prev_block = tftp_cur_block;
+		tftp_last_nack = -1;
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
@@ -558,10 +617,11 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 
 		/*
-		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	Acknowledge the last block of each window, which will
+		 *	prompt the remote for the next window.
 		 */
-		tftp_send();
+		if (len < tftp_block_size || tftp_cur_block == tftp_next_ack)
+			tftp_send();
 
 		if (len < tftp_block_size)
 			tftp_complete();
@@ -638,6 +698,10 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -659,8 +723,8 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -759,8 +823,9 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_window_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = TFTP_WINDOW_SIZE;
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
@@ -791,8 +856,9 @@ void tftp_start_server(void)
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_window_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = TFTP_WINDOW_SIZE;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
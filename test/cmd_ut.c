@@ -64,6 +64,9 @@ static cmd_tbl_t cmd_ut_sub[] = {
 	U_BOOT_CMD_MKENT(bloblist, CONFIG_SYS_MAXARGS, 1, do_ut_bloblist,
 			 "", ""),
 #endif
+#if defined(CONFIG_SANDBOX) && defined(CONFIG_DFU_RAM)
+	U_BOOT_CMD_MKENT(dfu, CONFIG_SYS_MAXARGS, 1, do_ut_dfu, "", ""),
+#endif
 };
 
 static int do_ut_all(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -108,6 +111,9 @@ static char ut_help_text[] =
 	"ut bloblist - Test bloblist implementation\n"
 	"ut compression - Test compressors and bootm decompression\n"
 #endif
+#if defined(CONFIG_SANDBOX) && defined(CONFIG_DFU_RAM)
+	"ut dfu - Test the DFU write path\n"
+#endif
 #ifdef CONFIG_UT_DM
 	"ut dm [test-name]\n"
 #endif
@@ -7,11 +7,85 @@
 
 #include <common.h>
 #include <command.h>
+#include <env.h>
+#include <malloc.h>
 
 static const char test_cmd[] = "setenv list 1\n setenv list ${list}2; "
 		"setenv list ${list}3\0"
 		"setenv list ${list}4";
 
+/* Number of statements in the script run by ut_cmd_bench() */
+#define BENCH_STATEMENTS	10000
+
+/* Check that find_cmd() gives the same result as a search of the table */
+static void ut_cmd_index(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	cmd_tbl_t *cmdtp;
+	char name[40];
+	int len;
+
+	for (cmdtp = start; cmdtp != start + count; cmdtp++) {
+		/* The full name and every abbreviation of it */
+		for (len = strlen(cmdtp->name); len > 0; len--) {
+			strlcpy(name, cmdtp->name, min(len + 1,
+						       (int)sizeof(name)));
+			assert(find_cmd(name) ==
+			       find_cmd_tbl(name, start, count));
+		}
+
+		/* With a size, like "md.b" */
+		snprintf(name, sizeof(name), "%s.b", cmdtp->name);
+		assert(find_cmd(name) == find_cmd_tbl(name, start, count));
+	}
+	assert(find_cmd("setenv") == find_cmd("seten"));
+	assert(!find_cmd("nosuchcommand"));
+	assert(!find_cmd(""));
+}
+
+/* Time a long script, as well as looking up a command on its own */
+static void ut_cmd_bench(void)
+{
+	static const char *const stmts[] = {
+		"true; ", "test a = a; ", "setexpr bench ${bench} + 1; ",
+		"itest 1 == 1; ",
+	};
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	ulong base, script_us, index_us, table_us;
+	char *script, *p;
+	int i;
+
+	script = malloc(BENCH_STATEMENTS * 16 + 1);
+	assert(script);
+	for (i = 0, p = script; i < BENCH_STATEMENTS; i++)
+		p += sprintf(p, "%s", stmts[i % ARRAY_SIZE(stmts)]);
+
+	env_set_hex("bench", 0);
+	base = timer_get_us();
+	assert(run_command_list(script, p - script, 0) == 0);
+	script_us = timer_get_us() - base;
+	assert(env_get_hex("bench", 0) == BENCH_STATEMENTS / ARRAY_SIZE(stmts));
+	free(script);
+
+	base = timer_get_us();
+	for (i = 0; i < BENCH_STATEMENTS; i++)
+		assert(find_cmd("setenv"));
+	index_us = timer_get_us() - base;
+
+	base = timer_get_us();
+	for (i = 0; i < BENCH_STATEMENTS; i++)
+		assert(find_cmd_tbl("setenv", start, count));
+	table_us = timer_get_us() - base;
+
+	printf("%s: %d statements in %lu us\n", __func__, BENCH_STATEMENTS,
+	       script_us);
+	printf("%s: lookup %lu ns with index, %lu ns with table search\n",
+	       __func__, index_us * 1000 / BENCH_STATEMENTS,
+	       table_us * 1000 / BENCH_STATEMENTS);
+}
+
 static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	printf("%s: Testing commands\n", __func__);
@@ -57,6 +131,9 @@ static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	assert(run_command("'", 0) == 1);
 
+	ut_cmd_index();
+	ut_cmd_bench();
+
 	printf("%s: Everything went swimmingly\n", __func__);
 	return 0;
 }
@@ -6,13 +6,17 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <env.h>
 #include <gzip.h>
+#include <image.h>
 #include <lz4.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <os.h>
 #include <asm/io.h>
 
 #include <u-boot/zlib.h>
+#include <u-boot/zstd.h>
 #include <bzlib.h>
 
 #include <lzma/LzmaTypes.h>
@@ -24,6 +28,8 @@
 #include <test/suites.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static const char plain[] =
 	"I am a highly compressable bit of text.\n"
 	"I am a highly compressable bit of text.\n"
@@ -119,6 +125,44 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 -c /tmp/plain.txt > /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
+/*
+ * The plain text repeated to fill 256KiB:
+ * zstd -19 -c /tmp/big.txt > /tmp/big.zst
+ */
+static const char zstd_big_compressed[] =
+	"\x28\xb5\x2f\xfd\xa4\x00\x00\x04\x00\xd4\x05\x00\x52\x4e\x26\x17"
+	"\x80\x6d\x0e\x00\x10\x12\x93\xa0\xe5\x3f\xd1\x9e\x20\xf2\xc4\x30"
+	"\xe6\x6f\x74\x95\x0d\xd7\x03\xc0\xa0\x5f\x50\xf5\x0c\x50\x9c\x8f"
+	"\xa0\xb4\x9e\x73\x8d\xff\xa0\xfa\x61\xb7\xd6\x87\x6f\x1a\xb4\x42"
+	"\x52\x41\x80\x20\x21\x24\xb8\x69\x59\x6d\x42\x5e\xc5\x2f\x2f\xe1"
+	"\xe1\x08\xae\xc6\xab\x2f\x15\x5f\xad\x5b\xfa\xcc\x4b\x4b\xa0\xa5"
+	"\xaf\xed\x6a\x85\x38\xcc\x3f\xbc\x41\x4b\x96\xe3\xa0\xb5\xf0\xbe"
+	"\xcf\x29\xf5\xdf\x21\x17\x56\x0a\x60\x78\x4b\x66\x4d\xbf\x39\x6b"
+	"\xaa\xf5\x3a\x87\x85\x33\x9f\xc9\x65\xa9\x21\xf3\x1f\xfa\xef\xca"
+	"\x00\x86\x8d\xbe\x56\x9c\x37\x0f\x7f\x1d\xa8\xfa\xd7\x30\x87\x58"
+	"\x5a\x6a\x49\x65\x34\x43\x17\x01\x09\x00\x9f\xfe\x61\x9b\x1d\x6c"
+	"\x22\x60\x6c\x94\x45\x51\xaf\x66\x84\xa2\xc0\x08\x23\xe1\x3a\x42"
+	"\x65\x41\xf4\x42\x55\x19\x55\x00\x00\x00\x01\x00\xfd\xff\x57\xff"
+	"\xb9\x06\x02\x45\x42\x13\x8f";
+static const unsigned long zstd_big_compressed_size = 215;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -294,6 +338,40 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq(0, memcmp(plain, in, in_size));
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	size_t output_size = out_max;
+	int ret;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -438,6 +516,91 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
+#define SPEED_TEST_SIZE		(256 * 1024)
+#define SPEED_TEST_LOOPS	8
+
+/*
+ * Compare the decompression speed of gzip and zstd. The data is very
+ * repetitive, so this mostly measures how fast matches are copied; real
+ * kernels give a smaller but similar difference.
+ */
+static int compression_test_zstd_speed(struct unit_test_state *uts)
+{
+	ulong gzip_us, zstd_us, start, comp_size;
+	char *plain_buf, *comp_buf, *out_buf;
+	size_t out_size;
+	int i;
+
+	plain_buf = malloc(SPEED_TEST_SIZE);
+	comp_buf = malloc(SPEED_TEST_SIZE);
+	out_buf = malloc(SPEED_TEST_SIZE);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(comp_buf);
+	ut_assertnonnull(out_buf);
+	for (i = 0; i < SPEED_TEST_SIZE; i++)
+		plain_buf[i] = plain[i % strlen(plain)];
+	comp_size = SPEED_TEST_SIZE;
+	ut_assertok(gzip(comp_buf, &comp_size, (uchar *)plain_buf,
+			 SPEED_TEST_SIZE));
+
+	start = timer_get_us();
+	for (i = 0; i < SPEED_TEST_LOOPS; i++) {
+		ulong len = comp_size;
+
+		memset(out_buf, '\0', SPEED_TEST_SIZE);
+		ut_assertok(gunzip(out_buf, SPEED_TEST_SIZE, (uchar *)comp_buf,
+				   &len));
+		ut_assertok(memcmp(plain_buf, out_buf, SPEED_TEST_SIZE));
+	}
+	gzip_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < SPEED_TEST_LOOPS; i++) {
+		out_size = SPEED_TEST_SIZE;
+		memset(out_buf, '\0', SPEED_TEST_SIZE);
+		ut_assertok(zstd_decompress(zstd_big_compressed,
+					    zstd_big_compressed_size, out_buf,
+					    &out_size));
+		ut_asserteq(SPEED_TEST_SIZE, out_size);
+		ut_assertok(memcmp(plain_buf, out_buf, SPEED_TEST_SIZE));
+	}
+	zstd_us = timer_get_us() - start;
+
+	printf("\tgzip: %lu bytes, %lu us\n", comp_size, gzip_us);
+	printf("\tzstd: %lu bytes, %lu us\n", zstd_big_compressed_size,
+	       zstd_us);
+
+	/* The destination must be large enough */
+	out_size = SPEED_TEST_SIZE - 1;
+	ut_asserteq(-ENOSPC, zstd_decompress(zstd_big_compressed,
+					     zstd_big_compressed_size, out_buf,
+					     &out_size));
+	ut_asserteq(0, out_size);
+
+	/* Corrupted data is reported, without any uncompressed data */
+	memcpy(comp_buf, zstd_big_compressed, zstd_big_compressed_size);
+	memset(comp_buf + 20, '\x49', zstd_big_compressed_size - 40);
+	out_size = SPEED_TEST_SIZE;
+	ut_asserteq(-EINVAL, zstd_decompress(comp_buf,
+					     zstd_big_compressed_size, out_buf,
+					     &out_size));
+	ut_asserteq(0, out_size);
+
+	free(out_buf);
+	free(comp_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_speed, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -494,6 +657,8 @@ static int run_bootm_test(struct unit_test_state *uts, int comp_type,
 			   compress_buff, compress_size, 0x10000,
 			   &load_end);
 	ut_assert(err);
+	/* This must not look as if the image were too large */
+	ut_assert(load_end < load_addr + 0x10000);
 
 	return 0;
 }
@@ -528,12 +693,384 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/**
+ * run_stream_test() - Run tests on decompressing data in pieces
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_stream_test(struct unit_test_state *uts, int comp_type,
+			   mutate_func compress)
+{
+	static const ulong piece_sizes[] = { 13, 100, 1024 };
+	struct image_decomp_stream ds;
+	ulong compress_size = 1024;
+	char *compress_buff, *out;
+	ulong len, pos, piece;
+	int unc_len, ret;
+	int i;
+
+	printf("Testing: %s\n", genimg_get_comp_name(comp_type));
+	compress_buff = malloc(compress_size);
+	ut_assertnonnull(compress_buff);
+	out = malloc(TEST_BUFFER_SIZE);
+	ut_assertnonnull(out);
+	unc_len = strlen(plain);
+	compress(uts, (void *)plain, unc_len, compress_buff, compress_size,
+		 &compress_size);
+	ut_asserteq(comp_type, image_decomp_detect(compress_buff,
+						   compress_size));
+
+	for (i = 0; i < ARRAY_SIZE(piece_sizes); i++) {
+		memset(out, '\0', TEST_BUFFER_SIZE);
+		ut_assertok(image_decomp_stream_start(&ds, comp_type, out,
+						      TEST_BUFFER_SIZE));
+		for (pos = 0; pos < compress_size; pos += piece) {
+			piece = min(compress_size - pos, piece_sizes[i]);
+			ret = image_decomp_stream_feed(&ds, compress_buff + pos,
+						       piece);
+			ut_assertok(ret);
+		}
+		ut_assertok(image_decomp_stream_end(&ds, &len));
+		ut_asserteq(unc_len, len);
+		ut_assertok(memcmp(plain, out, len));
+	}
+
+	/* Not enough space for the uncompressed data */
+	ut_assertok(image_decomp_stream_start(&ds, comp_type, out,
+					      unc_len - 1));
+	ut_asserteq(-ENOSPC, image_decomp_stream_feed(&ds, compress_buff,
+						      compress_size));
+	image_decomp_stream_end(&ds, &len);
+
+	/* We can't detect truncation when not decompressing */
+	if (comp_type == IH_COMP_NONE)
+		goto done;
+	ut_assertok(image_decomp_stream_start(&ds, comp_type, out,
+					      TEST_BUFFER_SIZE));
+	ut_assertok(image_decomp_stream_feed(&ds, compress_buff,
+					     compress_size / 2));
+	ut_asserteq(-EIO, image_decomp_stream_end(&ds, &len));
+
+done:
+	free(out);
+	free(compress_buff);
+
+	return 0;
+}
+
+/* A zstd skippable frame, as pzstd writes in front of each frame */
+static const char zstd_skippable[] =
+	"\x50\x2a\x4d\x18\x04\x00\x00\x00\x01\x02\x03\x04";
+
+/**
+ * run_stream_concat_test() - Test decompressing frames which follow one
+ * another, as in concatenated files
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @skip:	Data to put between the frames
+ * @skip_len:	Length of @skip
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_stream_concat_test(struct unit_test_state *uts, int comp_type,
+				  mutate_func compress, const char *skip,
+				  int skip_len)
+{
+	struct image_decomp_stream ds;
+	ulong compress_size = 1024;
+	char *compress_buff, *out;
+	ulong len, pos, piece;
+	int unc_len, size;
+
+	printf("Testing: %s concatenated\n", genimg_get_comp_name(comp_type));
+	compress_buff = malloc(compress_size);
+	ut_assertnonnull(compress_buff);
+	unc_len = strlen(plain);
+	out = malloc(unc_len * 2);
+	ut_assertnonnull(out);
+	compress(uts, (void *)plain, unc_len, compress_buff, compress_size,
+		 &compress_size);
+	size = compress_size;
+	memcpy(compress_buff + size, skip, skip_len);
+	size += skip_len;
+	memcpy(compress_buff + size, compress_buff, compress_size);
+	size += compress_size;
+
+	ut_assertok(image_decomp_stream_start(&ds, comp_type, out,
+					      unc_len * 2));
+	for (pos = 0; pos < size; pos += piece) {
+		piece = min(size - pos, 13UL);
+		ut_assertok(image_decomp_stream_feed(&ds, compress_buff + pos,
+						     piece));
+	}
+	ut_assertok(image_decomp_stream_end(&ds, &len));
+	ut_asserteq(unc_len * 2, len);
+	ut_assertok(memcmp(plain, out, unc_len));
+	ut_assertok(memcmp(plain, out + unc_len, unc_len));
+
+	/* A second frame which is cut short is reported */
+	ut_assertok(image_decomp_stream_start(&ds, comp_type, out,
+					      unc_len * 2));
+	ut_assertok(image_decomp_stream_feed(&ds, compress_buff, size - 1));
+	ut_asserteq(-EIO, image_decomp_stream_end(&ds, &len));
+
+	free(out);
+	free(compress_buff);
+
+	return 0;
+}
+
+static int compression_test_stream(struct unit_test_state *uts)
+{
+	struct image_decomp_stream ds;
+
+	ut_assertok(run_stream_test(uts, IH_COMP_GZIP, compress_using_gzip));
+	ut_assertok(run_stream_test(uts, IH_COMP_LZMA, compress_using_lzma));
+	ut_assertok(run_stream_test(uts, IH_COMP_LZ4, compress_using_lz4));
+	ut_assertok(run_stream_test(uts, IH_COMP_ZSTD, compress_using_zstd));
+	ut_assertok(run_stream_test(uts, IH_COMP_NONE, compress_using_none));
+	ut_assertok(run_stream_concat_test(uts, IH_COMP_LZ4,
+					   compress_using_lz4, "", 0));
+	ut_assertok(run_stream_concat_test(uts, IH_COMP_ZSTD,
+					   compress_using_zstd, zstd_skippable,
+					   sizeof(zstd_skippable) - 1));
+
+	/* Formats without a streaming decompressor are refused */
+	ut_asserteq(-EPROTONOSUPPORT,
+		    image_decomp_stream_start(&ds, IH_COMP_BZIP2, NULL, 0));
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_stream, 0);
+
+#if IMAGE_ENABLE_STREAM
+#define FIT_STREAM_TEST_SIZE	(200 * 1024)
+#define FIT_STREAM_FIT_SIZE	0x1000
+
+/* Build a FIT holding @data in a single image with crc32 and sha1 hashes */
+static int make_stream_fit(struct unit_test_state *uts, void *fit,
+			   const void *data, int size, int *nodep)
+{
+	static const char *const algos[] = { "crc32", "sha1" };
+	uint8_t value[FIT_MAX_HASH_LEN];
+	char name[10];
+	int images, node, hash;
+	int value_len;
+	int i;
+
+	ut_assertok(fdt_create_empty_tree(fit, FIT_STREAM_FIT_SIZE));
+	images = fdt_add_subnode(fit, 0, "images");
+	ut_assert(images >= 0);
+	node = fdt_add_subnode(fit, images, "image-1");
+	ut_assert(node >= 0);
+	for (i = 0; i < ARRAY_SIZE(algos); i++) {
+		snprintf(name, sizeof(name), "hash-%d", i + 1);
+		hash = fdt_add_subnode(fit, node, name);
+		ut_assert(hash >= 0);
+		ut_assertok(fdt_setprop_string(fit, hash, "algo", algos[i]));
+		ut_assertok(calculate_hash(data, size, algos[i], value,
+					   &value_len));
+		ut_assertok(fdt_setprop(fit, hash, "value", value, value_len));
+	}
+	*nodep = node;
+
+	return 0;
+}
+
+/* Check loading an image in pieces while hashing and decompressing it */
+static int compression_test_fit_stream(struct unit_test_state *uts)
+{
+	struct fit_stream st;
+	ulong comp_size, len, pos, chunk;
+	char *plain_buf, *comp_buf, *out_buf;
+	const void *old_blob;
+	void *fit, *key_blob;
+	int node, sig, key;
+	int ret;
+	int i;
+
+	plain_buf = malloc(FIT_STREAM_TEST_SIZE);
+	comp_buf = malloc(FIT_STREAM_TEST_SIZE);
+	out_buf = malloc(FIT_STREAM_TEST_SIZE);
+	fit = malloc(FIT_STREAM_FIT_SIZE);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(comp_buf);
+	ut_assertnonnull(out_buf);
+	ut_assertnonnull(fit);
+	for (i = 0; i < FIT_STREAM_TEST_SIZE; i++)
+		plain_buf[i] = plain[i % strlen(plain)] ^ (i / 4096);
+	comp_size = FIT_STREAM_TEST_SIZE;
+	ut_assertok(gzip(comp_buf, &comp_size, (uchar *)plain_buf,
+			 FIT_STREAM_TEST_SIZE));
+
+	/* Compressed data, fed in odd-sized pieces */
+	ut_assertok(make_stream_fit(uts, fit, comp_buf, comp_size, &node));
+	ut_assertok(fit_stream_start(&st, fit, node, IH_COMP_GZIP, out_buf,
+				     FIT_STREAM_TEST_SIZE, true));
+	for (pos = 0; pos < comp_size; pos += chunk) {
+		chunk = min(comp_size - pos, 1000UL);
+		ut_assertok(fit_stream_feed(&st, comp_buf + pos, chunk));
+	}
+	ut_assertok(fit_stream_finish(&st, &len));
+	ut_asserteq(FIT_STREAM_TEST_SIZE, len);
+	ut_assertok(memcmp(plain_buf, out_buf, len));
+
+	/* Not enough space for the uncompressed data */
+	ut_assertok(fit_stream_start(&st, fit, node, IH_COMP_GZIP, out_buf,
+				     FIT_STREAM_TEST_SIZE / 2, true));
+	ut_asserteq(-ENOSPC, fit_stream_load(&st, comp_buf, comp_size, &len));
+
+	/* Uncompressed data copied in pieces */
+	ut_assertok(make_stream_fit(uts, fit, plain_buf, FIT_STREAM_TEST_SIZE,
+				    &node));
+	memset(out_buf, '\0', FIT_STREAM_TEST_SIZE);
+	ut_assertok(fit_stream_start(&st, fit, node, IH_COMP_NONE, out_buf,
+				     FIT_STREAM_TEST_SIZE, true));
+	ut_assertok(fit_stream_load(&st, plain_buf, FIT_STREAM_TEST_SIZE,
+				    &len));
+	ut_asserteq(FIT_STREAM_TEST_SIZE, len);
+	ut_assertok(memcmp(plain_buf, out_buf, len));
+
+	/* Data read in place only needs hashing */
+	ut_assertok(fit_stream_start(&st, fit, node, IH_COMP_NONE, out_buf,
+				     FIT_STREAM_TEST_SIZE, true));
+	ut_assertok(fit_stream_load(&st, out_buf, FIT_STREAM_TEST_SIZE,
+				    &len));
+
+	/* Corrupted data must be detected */
+	out_buf[FIT_STREAM_TEST_SIZE / 2] ^= 1;
+	ut_assertok(fit_stream_start(&st, fit, node, IH_COMP_NONE, out_buf,
+				     FIT_STREAM_TEST_SIZE, true));
+	ut_asserteq(-EACCES, fit_stream_load(&st, out_buf,
+					     FIT_STREAM_TEST_SIZE, &len));
+
+	/* Unsupported compression falls back to the normal path */
+	ut_asserteq(-EPROTONOSUPPORT,
+		    fit_stream_start(&st, fit, node, IH_COMP_BZIP2, out_buf,
+				     FIT_STREAM_TEST_SIZE, true));
+
+	/*
+	 * With a required configuration signature, compressed data is only
+	 * decompressed after its hashes are checked, so it is not streamed
+	 */
+	key_blob = malloc(FIT_STREAM_FIT_SIZE);
+	ut_assertnonnull(key_blob);
+	ut_assertok(fdt_create_empty_tree(key_blob, FIT_STREAM_FIT_SIZE));
+	sig = fdt_add_subnode(key_blob, 0, FIT_SIG_NODENAME);
+	ut_assert(sig >= 0);
+	key = fdt_add_subnode(key_blob, sig, "key-test");
+	ut_assert(key >= 0);
+	ut_assertok(fdt_setprop_string(key_blob, key, "required", "conf"));
+	old_blob = gd->fdt_blob;
+	gd->fdt_blob = key_blob;
+	ret = fit_stream_start(&st, fit, node, IH_COMP_GZIP, out_buf,
+			       FIT_STREAM_TEST_SIZE, true);
+	gd->fdt_blob = old_blob;
+	ut_asserteq(-EPROTONOSUPPORT, ret);
+	free(key_blob);
+
+	free(fit);
+	free(out_buf);
+	free(comp_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_fit_stream, 0);
+#endif
+
+#ifdef CONFIG_CMD_FS_LOAD_DECOMP
+#define LOAD_TEST_FILE		"compression-load-test.bin"
+#define LOAD_TEST_SIZE		(200 * 1024)
+#define LOAD_TEST_ADDR		0x100000
+
+/* Write a file for the load command to read through hostfs */
+static int write_load_file(struct unit_test_state *uts, const void *buf,
+			   ulong size)
+{
+	int fd;
+
+	fd = os_open(LOAD_TEST_FILE, OS_O_WRONLY | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(size, os_write(fd, buf, size));
+	os_close(fd);
+
+	return 0;
+}
+
+/* Check that load -z decompresses a file as it reads it */
+static int compression_test_load(struct unit_test_state *uts)
+{
+	char *plain_buf, *comp_buf, *out_buf;
+	ulong comp_size;
+	uint seed = 1;
+	char cmd[80];
+	int i;
+
+	plain_buf = malloc(LOAD_TEST_SIZE);
+	comp_buf = malloc(LOAD_TEST_SIZE * 2);
+	ut_assertnonnull(plain_buf);
+	ut_assertnonnull(comp_buf);
+
+	/* Make half the data hard to compress, so it takes several reads */
+	for (i = 0; i < LOAD_TEST_SIZE / 2; i++) {
+		seed = seed * 1103515245 + 12345;
+		plain_buf[i] = seed >> 16;
+	}
+	for (; i < LOAD_TEST_SIZE; i++)
+		plain_buf[i] = plain[i % strlen(plain)];
+	comp_size = LOAD_TEST_SIZE * 2;
+	ut_assertok(gzip(comp_buf, &comp_size, (uchar *)plain_buf,
+			 LOAD_TEST_SIZE));
+	ut_assert(comp_size > 64 * 1024);
+	ut_assertok(write_load_file(uts, comp_buf, comp_size));
+
+	out_buf = map_sysmem(LOAD_TEST_ADDR, LOAD_TEST_SIZE);
+	memset(out_buf, '\0', LOAD_TEST_SIZE);
+	snprintf(cmd, sizeof(cmd), "load -z hostfs - %x %s", LOAD_TEST_ADDR,
+		 LOAD_TEST_FILE);
+	ut_assertok(run_command(cmd, 0));
+	ut_asserteq(LOAD_TEST_SIZE, env_get_hex("filesize", 0));
+	ut_assertok(memcmp(plain_buf, out_buf, LOAD_TEST_SIZE));
+
+	/* The uncompressed data must fit in 'bytes' */
+	snprintf(cmd, sizeof(cmd), "load -z hostfs - %x %s %x",
+		 LOAD_TEST_ADDR, LOAD_TEST_FILE, LOAD_TEST_SIZE - 1);
+	ut_asserteq(1, run_command(cmd, 0));
+
+	/* A file which is not compressed is just copied */
+	ut_assertok(write_load_file(uts, plain_buf, LOAD_TEST_SIZE));
+	memset(out_buf, '\0', LOAD_TEST_SIZE);
+	snprintf(cmd, sizeof(cmd), "load -z hostfs - %x %s", LOAD_TEST_ADDR,
+		 LOAD_TEST_FILE);
+	ut_assertok(run_command(cmd, 0));
+	ut_asserteq(LOAD_TEST_SIZE, env_get_hex("filesize", 0));
+	ut_assertok(memcmp(plain_buf, out_buf, LOAD_TEST_SIZE));
+
+	unmap_sysmem(out_buf);
+	os_unlink(LOAD_TEST_FILE);
+	free(comp_buf);
+	free(plain_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_load, 0);
+#endif
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the DFU write path, using the RAM back end
+ */
+
+#include <common.h>
+#include <dfu.h>
+#include <env.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new DFU test */
+#define DFU_TEST(_name, _flags)	UNIT_TEST(_name, _flags, dfu_test)
+
+enum {
+	TEST_BUF_SIZE		= 0x40000,
+	TEST_PKT_SIZE		= 4096,
+	TEST_DATA_SIZE		= 0x300000 + 1234,
+	TEST_RAM_SIZE		= 0x400000,
+
+	TEST_BENCH_SIZE		= 32 << 20,
+
+	TEST_SRC_ADDR		= 0x800000,
+	TEST_RAM_ADDR		= 0x1000000,
+};
+
+static int dfu_test_setup(struct unit_test_state *uts, void *ram, ulong size,
+			  struct dfu_entity **dfup)
+{
+	char alt_info[64];
+
+	/* The RAM back end takes a pointer, not a sandbox address */
+	snprintf(alt_info, sizeof(alt_info), "img ram %lx %lx",
+		 (ulong)ram, size);
+	ut_assertok(env_set("dfu_alt_info", alt_info));
+	ut_assertok(env_set("dfu_bufsiz", simple_itoa(TEST_BUF_SIZE)));
+	ut_assertok(dfu_init_env_entities("ram", "0"));
+	*dfup = dfu_get_entity(0);
+	ut_assertnonnull(*dfup);
+
+	return 0;
+}
+
+static void dfu_test_teardown(void)
+{
+	dfu_free_entities();
+	env_set("dfu_bufsiz", NULL);
+	env_set("dfu_alt_info", NULL);
+}
+
+/* Test that full buffers are written by dfu_write_poll() */
+static int dfu_test_write_ring(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	u8 *src, *ram;
+	int seq, pos, len;
+
+	src = map_sysmem(TEST_SRC_ADDR, TEST_DATA_SIZE);
+	ram = map_sysmem(TEST_RAM_ADDR, TEST_RAM_SIZE);
+	memset(ram, '\0', TEST_RAM_SIZE);
+	for (pos = 0; pos < TEST_DATA_SIZE; pos++)
+		src[pos] = pos ^ (pos >> 12);
+
+	ut_assertok(dfu_test_setup(uts, ram, TEST_RAM_SIZE, &dfu));
+
+	/* Fill the first buffer; it should be queued, not written */
+	for (seq = 0, pos = 0; pos < TEST_BUF_SIZE; seq++, pos += len) {
+		len = TEST_PKT_SIZE;
+		ut_assertok(dfu_write(dfu, src + pos, len, seq));
+	}
+	if (CONFIG_DFU_WRITE_BUFFERS > 1) {
+		ut_asserteq(0, ram[0]);
+		ut_assertok(dfu_write_poll());
+	}
+	ut_assertok(memcmp(src, ram, TEST_BUF_SIZE));
+
+	/* The rest is written as the ring fills and is polled */
+	for (; pos < TEST_DATA_SIZE; seq++, pos += len) {
+		len = min(TEST_DATA_SIZE - pos, TEST_PKT_SIZE);
+		ut_assertok(dfu_write(dfu, src + pos, len, seq));
+		if (seq & 1)
+			ut_assertok(dfu_write_poll());
+	}
+	ut_assertok(dfu_flush(dfu, NULL, 0, seq));
+	ut_assertok(memcmp(src, ram, TEST_DATA_SIZE));
+	ut_asserteq(0, ram[TEST_DATA_SIZE]);
+
+	/* Nothing is left queued after the flush */
+	ut_assertok(dfu_write_poll());
+
+	dfu_test_teardown();
+	unmap_sysmem(ram);
+	unmap_sysmem(src);
+
+	return 0;
+}
+DFU_TEST(dfu_test_write_ring, 0);
+
+/* Test writing from dfu_get_buf() itself, as thor does */
+static int dfu_test_write_alias(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	u8 *buf, *ram;
+	int seq, i;
+
+	ram = map_sysmem(TEST_RAM_ADDR, TEST_RAM_SIZE);
+	memset(ram, '\0', TEST_RAM_SIZE);
+	ut_assertok(dfu_test_setup(uts, ram, TEST_RAM_SIZE, &dfu));
+
+	buf = dfu_get_buf(dfu);
+	ut_assertnonnull(buf);
+	ut_asserteq(TEST_BUF_SIZE, dfu_get_buf_size());
+	for (seq = 0; seq < 3; seq++) {
+		memset(buf, 'a' + seq, TEST_BUF_SIZE);
+		ut_assertok(dfu_write(dfu, buf, TEST_BUF_SIZE, seq));
+	}
+	ut_assertok(dfu_flush(dfu, NULL, 0, seq));
+	for (i = 0; i < 3 * TEST_BUF_SIZE; i += TEST_BUF_SIZE / 2)
+		ut_asserteq('a' + i / TEST_BUF_SIZE, ram[i]);
+
+	dfu_test_teardown();
+	unmap_sysmem(ram);
+
+	return 0;
+}
+DFU_TEST(dfu_test_write_alias, 0);
+
+/* Measure the throughput of the write path; dfu_flush() reports it */
+static int dfu_test_write_bench(struct unit_test_state *uts)
+{
+	struct dfu_entity *dfu;
+	u8 pkt[TEST_PKT_SIZE];
+	u8 *ram;
+	int seq;
+	ulong pos;
+
+	memset(pkt, 0x5a, TEST_PKT_SIZE);
+	ram = map_sysmem(TEST_RAM_ADDR, TEST_BENCH_SIZE);
+	ut_assertok(dfu_test_setup(uts, ram, TEST_BENCH_SIZE, &dfu));
+	for (seq = 0, pos = 0; pos < TEST_BENCH_SIZE; seq++) {
+		ut_assertok(dfu_write(dfu, pkt, TEST_PKT_SIZE, seq & 0xffff));
+		ut_assertok(dfu_write_poll());
+		pos += TEST_PKT_SIZE;
+	}
+	ut_assertok(dfu_flush(dfu, NULL, 0, seq & 0xffff));
+	ut_asserteq(0x5a, ram[TEST_BENCH_SIZE - 1]);
+
+	dfu_test_teardown();
+	unmap_sysmem(ram);
+
+	return 0;
+}
+DFU_TEST(dfu_test_write_bench, 0);
+
+int do_ut_dfu(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, dfu_test);
+	const int n_ents = ll_entry_count(struct unit_test, dfu_test);
+
+	return cmd_ut_category("dfu", tests, n_ents, argc, argv);
+}
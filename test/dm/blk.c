@@ -5,8 +5,14 @@
 
 #include <common.h>
 #include <dm.h>
+#include <fs.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
+#include <sysreset.h>
 #include <usb.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -162,3 +168,392 @@ static int dm_test_blk_get_from_parent(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_get_from_parent, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+#define BLKCACHE_TEST_FILE	"blkcache-test.img"
+#define BLKCACHE_TEST_BLOCKS	256
+
+/* Check that block @blk of the backing file is filled with @val */
+static int blkcache_check_file(struct unit_test_state *uts, int fd,
+			       lbaint_t blk, u8 val)
+{
+	u8 buf[512];
+	int i;
+
+	ut_asserteq(blk * 512, os_lseek(fd, blk * 512, OS_SEEK_SET));
+	ut_asserteq(512, os_read(fd, buf, sizeof(buf)));
+	for (i = 0; i < sizeof(buf); i++)
+		ut_asserteq(val, buf[i]);
+
+	return 0;
+}
+
+/* Get the block cache statistics of host device 0 */
+static int blkcache_host_stats(struct unit_test_state *uts,
+			       struct block_cache_dev_stats *dstats)
+{
+	int i;
+
+	for (i = 0; !blkcache_dev_stats(i, dstats); i++) {
+		if (dstats->iftype == IF_TYPE_HOST && !dstats->devnum)
+			return 0;
+	}
+	ut_assert(false);
+
+	return 0;
+}
+
+/* Test the block cache with a host-backed block device */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	struct block_cache_dev_stats dstats;
+	struct block_cache_stats stats, orig;
+	struct blk_desc *desc;
+	u8 *buf;
+	int fd, i;
+
+	buf = malloc(BLKCACHE_TEST_BLOCKS * 512);
+	ut_assertnonnull(buf);
+	for (i = 0; i < BLKCACHE_TEST_BLOCKS; i++)
+		memset(buf + i * 512, i, 512);
+	fd = os_open(BLKCACHE_TEST_FILE, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(BLKCACHE_TEST_BLOCKS * 512,
+		    os_write(fd, buf, BLKCACHE_TEST_BLOCKS * 512));
+
+	/* 16 sets of 4 lines of 8 blocks */
+	blkcache_stats(&orig);
+	blkcache_configure(8, 64);
+	ut_assertok(blkcache_set_writeback(false));
+	ut_assertok(host_dev_bind(0, BLKCACHE_TEST_FILE));
+	ut_asserteq(0, blk_get_device_by_str("host", "0", &desc));
+
+	/* Start from an empty cache, whatever the partition probe read */
+	blkcache_invalidate(IF_TYPE_HOST, 0);
+	blkcache_stats(&stats);
+	ut_assertok(blkcache_host_stats(uts, &dstats));
+
+	/* A miss reads the whole line, so the next block is a hit */
+	memset(buf, '\0', 512);
+	ut_asserteq(1, blk_dread(desc, 3, 1, buf));
+	ut_asserteq(3, buf[0]);
+	ut_asserteq(1, blk_dread(desc, 4, 1, buf));
+	ut_asserteq(4, buf[511]);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+
+	/* Sequential reads start readahead */
+	ut_asserteq(8, blk_dread(desc, 16, 8, buf));
+	ut_asserteq(8, blk_dread(desc, 24, 8, buf));
+	ut_asserteq(8, blk_dread(desc, 32, 8, buf));
+	ut_asserteq(32, buf[0]);
+	ut_asserteq(8, blk_dread(desc, 40, 8, buf));
+	ut_asserteq(40, buf[0]);
+	ut_asserteq(47, buf[7 * 512]);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(3, stats.misses);
+	ut_assertok(blkcache_host_stats(uts, &dstats));
+	ut_asserteq(8, dstats.readahead);
+
+	/* Large reads bypass the cache */
+	ut_asserteq(100, blk_dread(desc, 100, 100, buf));
+	ut_asserteq(100, buf[0]);
+	ut_asserteq(199, buf[99 * 512]);
+	ut_assertok(blkcache_host_stats(uts, &dstats));
+	ut_asserteq(1, dstats.bypass);
+
+	/* Write-through updates the device and the cached copy */
+	memset(buf, 0xaa, 512);
+	ut_asserteq(1, blk_dwrite(desc, 4, 1, buf));
+	ut_assertok(blkcache_check_file(uts, fd, 4, 0xaa));
+	ut_asserteq(1, blk_dread(desc, 4, 1, buf));
+	ut_asserteq(0xaa, buf[0]);
+
+	/* Write-back only updates the device on flush */
+	ut_assertok(blkcache_set_writeback(true));
+	memset(buf, 0x55, 512);
+	ut_asserteq(1, blk_dwrite(desc, 5, 1, buf));
+	ut_asserteq(1, blk_dwrite(desc, 64, 1, buf));
+	ut_assertok(blkcache_check_file(uts, fd, 5, 5));
+	ut_assertok(blkcache_check_file(uts, fd, 64, 64));
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.dirty);
+
+	/* Uncached reads still see the dirty data */
+	ut_asserteq(100, blk_dread(desc, 0, 100, buf));
+	ut_asserteq(0xaa, buf[4 * 512]);
+	ut_asserteq(0x55, buf[5 * 512]);
+	ut_asserteq(6, buf[6 * 512]);
+	ut_asserteq(0x55, buf[64 * 512]);
+	ut_asserteq(65, buf[65 * 512]);
+
+	ut_assertok(blkcache_flush(desc));
+	ut_assertok(blkcache_check_file(uts, fd, 5, 0x55));
+	ut_assertok(blkcache_check_file(uts, fd, 64, 0x55));
+	ut_assertok(blkcache_check_file(uts, fd, 65, 65));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.dirty);
+	ut_asserteq(2, stats.writebacks);
+
+	/* A system reset writes back all dirty lines first */
+	memset(buf, 0x44, 512);
+	ut_asserteq(1, blk_dwrite(desc, 7, 1, buf));
+	ut_assertok(blkcache_check_file(uts, fd, 7, 7));
+	state->sysreset_allowed[SYSRESET_POWER] = false;
+	state->sysreset_allowed[SYSRESET_POWER_OFF] = false;
+	ut_asserteq(-EACCES, sysreset_walk(SYSRESET_COLD));
+	state->sysreset_allowed[SYSRESET_POWER] = true;
+	state->sysreset_allowed[SYSRESET_POWER_OFF] = true;
+	ut_assertok(blkcache_check_file(uts, fd, 7, 0x44));
+
+	/* Removing the device writes back its dirty lines */
+	memset(buf, 0x33, 512);
+	ut_asserteq(1, blk_dwrite(desc, 6, 1, buf));
+	ut_assertok(host_dev_bind(0, NULL));
+	ut_assertok(blkcache_check_file(uts, fd, 6, 0x33));
+
+	ut_assertok(blkcache_set_writeback(orig.writeback));
+	blkcache_configure(orig.max_blocks_per_entry, orig.max_entries);
+	os_close(fd);
+	os_unlink(BLKCACHE_TEST_FILE);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#define HWPART_TEST_BLOCKS	16
+
+/* A block device with two hardware partitions, each held in memory */
+struct hwpart_test_priv {
+	u8 data[2][HWPART_TEST_BLOCKS * 512];
+};
+
+static ulong hwpart_test_read(struct udevice *dev, lbaint_t start,
+			      lbaint_t blkcnt, void *buffer)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct hwpart_test_priv *priv = dev_get_priv(dev);
+
+	memcpy(buffer, priv->data[desc->hwpart] + start * 512, blkcnt * 512);
+
+	return blkcnt;
+}
+
+static ulong hwpart_test_write(struct udevice *dev, lbaint_t start,
+			       lbaint_t blkcnt, const void *buffer)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct hwpart_test_priv *priv = dev_get_priv(dev);
+
+	memcpy(priv->data[desc->hwpart] + start * 512, buffer, blkcnt * 512);
+
+	return blkcnt;
+}
+
+static int hwpart_test_select_hwpart(struct udevice *dev, int hwpart)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	if (hwpart < 0 || hwpart > 1)
+		return -EINVAL;
+	desc->hwpart = hwpart;
+
+	return 0;
+}
+
+static const struct blk_ops hwpart_test_ops = {
+	.read	= hwpart_test_read,
+	.write	= hwpart_test_write,
+	.select_hwpart	= hwpart_test_select_hwpart,
+};
+
+U_BOOT_DRIVER(hwpart_test_blk) = {
+	.name		= "hwpart_test_blk",
+	.id		= UCLASS_BLK,
+	.ops		= &hwpart_test_ops,
+	.priv_auto_alloc_size	= sizeof(struct hwpart_test_priv),
+};
+
+/* Test that the block cache keeps hardware partitions apart */
+static int dm_test_blk_cache_hwpart(struct unit_test_state *uts)
+{
+	struct block_cache_stats orig;
+	struct hwpart_test_priv *priv;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	u8 buf[512];
+
+	blkcache_stats(&orig);
+	blkcache_configure(8, 64);
+	ut_assertok(blkcache_set_writeback(true));
+	ut_assertok(blk_create_devicef(gd->dm_root, "hwpart_test_blk", "test",
+				       IF_TYPE_HOST, -1, 512,
+				       HWPART_TEST_BLOCKS, &dev));
+	ut_assertok(device_probe(dev));
+	desc = dev_get_uclass_platdata(dev);
+	priv = dev_get_priv(dev);
+
+	/* Dirty blocks are written to partition 0 before switching */
+	memset(buf, 0x11, sizeof(buf));
+	ut_asserteq(1, blk_dwrite(desc, 1, 1, buf));
+	ut_asserteq(0, priv->data[0][512]);
+	ut_assertok(blk_select_hwpart(dev, 1));
+	ut_asserteq(0x11, priv->data[0][512]);
+	ut_asserteq(0, priv->data[1][512]);
+
+	/* Partition 1 does not see the cached blocks of partition 0 */
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+	ut_asserteq(0, buf[0]);
+	memset(buf, 0x22, sizeof(buf));
+	ut_asserteq(1, blk_dwrite(desc, 1, 1, buf));
+
+	/* Each partition reads back its own data */
+	ut_assertok(blk_select_hwpart(dev, 0));
+	ut_asserteq(0x22, priv->data[1][512]);
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+	ut_asserteq(0x11, buf[0]);
+	ut_assertok(blk_select_hwpart(dev, 1));
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+	ut_asserteq(0x22, buf[0]);
+
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+	ut_assertok(blkcache_set_writeback(orig.writeback));
+	blkcache_configure(orig.max_blocks_per_entry, orig.max_entries);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache_hwpart, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE) && defined(CONFIG_FS_FAT)
+#define FSCACHE_TEST_FILE	"fscache-test.img"
+#define FSCACHE_TEST_SECTORS	64
+#define FSCACHE_TEST_SIZE	3000
+
+/*
+ * Create a FAT12 image with one sector each for the boot sector, the FAT
+ * and the root directory, followed by /TEST.BIN in clusters 2 to 7
+ */
+static void fscache_make_image(u8 *img)
+{
+	u8 *fat = img + 512, *dent = img + 1024, *data = img + 1536;
+	int i;
+
+	memset(img, '\0', FSCACHE_TEST_SECTORS * 512);
+	memcpy(img, "\xeb\x3c\x90MSDOS5.0", 11);
+	img[0x0c] = 2;				/* 512 bytes per sector */
+	img[0x0d] = 1;				/* sectors per cluster */
+	img[0x0e] = 1;				/* reserved sectors */
+	img[0x10] = 1;				/* number of FATs */
+	img[0x11] = 16;				/* root directory entries */
+	img[0x13] = FSCACHE_TEST_SECTORS;	/* total sectors */
+	img[0x15] = 0xf8;			/* media */
+	img[0x16] = 1;				/* sectors per FAT */
+	img[0x26] = 0x29;			/* extended boot signature */
+	memcpy(img + 0x2b, "TEST       FAT12   ", 19);
+	img[510] = 0x55;
+	img[511] = 0xaa;
+
+	/* Media entry, end of chain, then 2 -> 3 -> 4 -> 5 -> 6 -> 7 -> end */
+	memcpy(fat, "\xf8\xff\xff\x03\x40\x00\x05\x60\x00\x07\xf0\xff", 12);
+
+	memcpy(dent, "TEST    BIN", 11);
+	dent[0x0b] = 0x20;			/* archive */
+	dent[0x1a] = 2;				/* first cluster */
+	dent[0x1c] = FSCACHE_TEST_SIZE & 0xff;
+	dent[0x1d] = FSCACHE_TEST_SIZE >> 8;
+	for (i = 0; i < FSCACHE_TEST_SIZE; i++)
+		data[i] = i % 251;
+}
+
+/* Check that @buf holds @len bytes of /TEST.BIN starting at @pos */
+static int fscache_check_data(struct unit_test_state *uts, const u8 *buf,
+			      int pos, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		ut_asserteq((pos + i) % 251, buf[i]);
+
+	return 0;
+}
+
+/* Test that filesystems stay mounted between operations */
+static int dm_test_fs_mount_cache(struct unit_test_state *uts)
+{
+	struct fs_file *file;
+	struct blk_desc *desc;
+	loff_t size, actread;
+	ulong mounts;
+	u8 *img, *buf;
+	int fd, pos;
+
+	img = malloc(FSCACHE_TEST_SECTORS * 512);
+	ut_assertnonnull(img);
+	buf = img;
+	fscache_make_image(img);
+	fd = os_open(FSCACHE_TEST_FILE, OS_O_RDWR | OS_O_CREAT | OS_O_TRUNC);
+	ut_assert(fd >= 0);
+	ut_asserteq(FSCACHE_TEST_SECTORS * 512,
+		    os_write(fd, img, FSCACHE_TEST_SECTORS * 512));
+	os_close(fd);
+	ut_assertok(host_dev_bind(0, FSCACHE_TEST_FILE));
+	ut_asserteq(0, blk_get_device_by_str("host", "0", &desc));
+
+	/* Only the first operation mounts the filesystem */
+	fs_unmount();
+	mounts = fs_get_mount_count();
+	ut_assertok(fs_set_blk_dev("host", "0", FS_TYPE_ANY));
+	ut_assertok(fs_size("/test.bin", &size));
+	ut_asserteq(FSCACHE_TEST_SIZE, size);
+	ut_assertok(fs_set_blk_dev("host", "0", FS_TYPE_FAT));
+	memset(buf, '\0', FSCACHE_TEST_SIZE);
+	ut_assertok(fs_read("/test.bin", map_to_sysmem(buf), 1000, 0,
+			    &actread));
+	ut_asserteq(FSCACHE_TEST_SIZE - 1000, actread);
+	ut_assertok(fscache_check_data(uts, buf, 1000, actread));
+	ut_assert(fs_get_mount_count() == mounts + 1);
+
+	/* Read an open file in chunks */
+	ut_assertok(fs_set_blk_dev("host", "0", FS_TYPE_ANY));
+	ut_assertok(fs_open("/test.bin", &file));
+	ut_asserteq(FSCACHE_TEST_SIZE, file->size);
+	for (pos = 0; pos < FSCACHE_TEST_SIZE; pos += actread) {
+		ut_assertok(fs_file_read(file, buf, 700, &actread));
+		ut_asserteq(min(700, FSCACHE_TEST_SIZE - pos), actread);
+		ut_assertok(fscache_check_data(uts, buf, pos, actread));
+	}
+	ut_assertok(fs_file_read(file, buf, 700, &actread));
+	ut_asserteq(0, actread);
+	ut_assert(fs_get_mount_count() == mounts + 1);
+
+	/* Writing to the device mounts it again, even for an open file */
+	memset(buf, '\0', 512);
+	ut_asserteq(1, blk_dwrite(desc, FSCACHE_TEST_SECTORS - 1, 1, buf));
+	ut_assertok(fs_file_seek(file, 2000));
+	ut_assertok(fs_file_read(file, buf, 100, &actread));
+	ut_asserteq(100, actread);
+	ut_assertok(fscache_check_data(uts, buf, 2000, actread));
+	ut_assert(fs_get_mount_count() == mounts + 2);
+	ut_asserteq(-EINVAL, fs_file_seek(file, -1));
+	fs_file_close(file);
+
+	/* A missing file cannot be opened */
+	ut_assertok(fs_set_blk_dev("host", "0", FS_TYPE_ANY));
+	ut_assert(fs_open("/missing.bin", &file) < 0);
+	ut_assert(fs_get_mount_count() == mounts + 2);
+
+	fs_unmount();
+	ut_assertok(host_dev_bind(0, NULL));
+	os_unlink(FSCACHE_TEST_FILE);
+	free(img);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_mount_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
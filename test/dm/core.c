@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -904,3 +905,50 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Test that the compatible-string lookup matches a linear driver search */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id, *expect_id;
+	struct driver *entry, *drv, *expect;
+	int count = 0;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			/* The first driver with this string must be found */
+			expect_id = NULL;
+			for (expect = driver; expect != entry + 1; expect++) {
+				for (expect_id = expect->of_match;
+				     expect_id && expect_id->compatible;
+				     expect_id++) {
+					if (!strcmp(expect_id->compatible,
+						    of_match->compatible))
+						break;
+				}
+				if (expect_id && expect_id->compatible)
+					break;
+			}
+			drv = lists_driver_lookup_compat(of_match->compatible,
+							 &id);
+			ut_asserteq_ptr(expect, drv);
+			ut_asserteq_ptr(expect_id, id);
+			count++;
+		}
+	}
+	ut_assert(count > 0);
+
+	ut_assertnull(lists_driver_lookup_compat("sandbox,no-such-driver",
+						 &id));
+	drv = lists_driver_lookup_compat("denx,u-boot-fdt-test", &id);
+	ut_asserteq_ptr(DM_GET_DRIVER(testfdt_drv), drv);
+	ut_asserteq_str("denx,u-boot-fdt-test", id->compatible);
+
+	if (CONFIG_IS_ENABLED(DM_COMPAT_INDEX))
+		ut_assertnonnull(gd->dm_compat_index);
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
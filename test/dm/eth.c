@@ -11,11 +11,13 @@
 #include <env.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 #include <asm/eth.h>
+#include <asm/unaligned.h>
 #include <test/ut.h>
 
 #define DM_TEST_ETH_NUM		4
@@ -429,3 +431,501 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_CMD_TFTPBOOT
+#define SB_TFTP_PORT		5000
+#define SB_TFTP_BLKSIZE		512
+#define SB_TFTP_SIZE		(30 * SB_TFTP_BLKSIZE + 100)
+#define SB_TFTP_LOAD_ADDR	0x100000
+
+/**
+ * struct sb_tftp_server - state of the fake TFTP server
+ *
+ * @uts: test state, used by the ut_assert macros
+ * @client_port: UDP port of the client
+ * @window: negotiated window size
+ * @drop_block: block to drop the first time it is sent, 0 for none
+ * @acks: number of acknowledgments received
+ * @sent: number of data blocks sent
+ */
+struct sb_tftp_server {
+	struct unit_test_state *uts;
+	int client_port;
+	int window;
+	int drop_block;
+	int acks;
+	int sent;
+};
+
+static u8 sb_tftp_data(int offset)
+{
+	return offset ^ (offset >> 8);
+}
+
+/* Send the blocks of the window following block @ack */
+static int sb_tftp_send_window(struct udevice *dev,
+			       struct sb_tftp_server *srv, int ack)
+{
+	const int last = SB_TFTP_SIZE / SB_TFTP_BLKSIZE + 1;
+	u8 buf[4 + SB_TFTP_BLKSIZE];
+	int block, i;
+
+	for (block = ack + 1; block <= ack + srv->window && block <= last;
+	     block++) {
+		int offset = (block - 1) * SB_TFTP_BLKSIZE;
+		int len = min(SB_TFTP_SIZE - offset, SB_TFTP_BLKSIZE);
+
+		if (block == srv->drop_block) {
+			srv->drop_block = 0;
+			continue;
+		}
+		put_unaligned_be16(3, buf);
+		put_unaligned_be16(block, buf + 2);
+		for (i = 0; i < len; i++)
+			buf[4 + i] = sb_tftp_data(offset + i);
+		if (sandbox_eth_recv_udp(dev, srv->client_port, SB_TFTP_PORT,
+					 buf, 4 + len))
+			break;
+		srv->sent++;
+	}
+
+	return 0;
+}
+
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_tftp_server *srv = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	char *req = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	char *end = packet + len;
+	char oack[64];
+	int oack_len;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	switch (get_unaligned_be16(req)) {
+	case 1: /* RRQ */
+		srv->client_port = ntohs(ip->udp_src);
+		srv->window = 1;
+		/* Skip the file name and the mode, then look at the options */
+		req += 2;
+		req += strlen(req) + 1;
+		req += strlen(req) + 1;
+		while (req < end && *req) {
+			char *val = req + strlen(req) + 1;
+
+			if (!strcmp(req, "windowsize"))
+				srv->window = simple_strtoul(val, NULL, 10);
+			req = val + strlen(val) + 1;
+		}
+		put_unaligned_be16(6, oack);
+		oack_len = 2;
+		oack_len += sprintf(oack + oack_len, "blksize%c%d%c", 0,
+				    SB_TFTP_BLKSIZE, 0);
+		if (srv->window > 1)
+			oack_len += sprintf(oack + oack_len,
+					    "windowsize%c%d%c", 0,
+					    srv->window, 0);
+		return sandbox_eth_recv_udp(dev, srv->client_port,
+					    SB_TFTP_PORT, oack, oack_len);
+	case 4: /* ACK */
+		srv->acks++;
+		return sb_tftp_send_window(dev, srv,
+					   get_unaligned_be16(req + 2));
+	}
+
+	return 0;
+}
+
+static int sb_tftp_get(struct unit_test_state *uts,
+		       struct sb_tftp_server *srv, const char *windowsize,
+		       int drop_block)
+{
+	u8 *buf;
+	int i;
+
+	memset(srv, '\0', sizeof(*srv));
+	srv->uts = uts;
+	srv->drop_block = drop_block;
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	sandbox_eth_set_priv(0, srv);
+
+	env_set("ethact", "eth@10002000");
+	net_server_ip = string_to_ip("1.1.2.2");
+	env_set("tftpwindowsize", windowsize);
+	load_addr = SB_TFTP_LOAD_ADDR;
+	buf = map_sysmem(SB_TFTP_LOAD_ADDR, SB_TFTP_SIZE);
+	memset(buf, '\0', SB_TFTP_SIZE);
+
+	ut_asserteq(SB_TFTP_SIZE, net_loop(TFTPGET));
+	for (i = 0; i < SB_TFTP_SIZE; i++)
+		ut_asserteq(sb_tftp_data(i), buf[i]);
+	unmap_sysmem(buf);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("tftpwindowsize", NULL);
+
+	return 0;
+}
+
+/* Test a TFTP transfer with and without RFC 7440 windows */
+static int dm_test_eth_tftp_windowsize(struct unit_test_state *uts)
+{
+	struct sb_tftp_server srv;
+
+	/* Lock-step: one ACK per block, plus one for the OACK */
+	ut_assertok(sb_tftp_get(uts, &srv, "1", 0));
+	ut_asserteq(1, srv.window);
+	ut_asserteq(31, srv.sent);
+	ut_asserteq(32, srv.acks);
+
+	/* One ACK per window of three blocks, plus the last block */
+	ut_assertok(sb_tftp_get(uts, &srv, "3", 0));
+	ut_asserteq(3, srv.window);
+	ut_asserteq(31, srv.sent);
+	ut_asserteq(12, srv.acks);
+
+	/* A lost block makes the server restart the window from it */
+	ut_assertok(sb_tftp_get(uts, &srv, "3", 5));
+	ut_asserteq(32, srv.sent);
+	ut_asserteq(12, srv.acks);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_tftp_windowsize, DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_NET_RX_STATS
+/* Test that TFTP copies each received byte of the file only once */
+static int dm_test_eth_tftp_copies(struct unit_test_state *uts)
+{
+	struct sb_tftp_server srv;
+
+	memset(&net_rx_stats, '\0', sizeof(net_rx_stats));
+	ut_assertok(sb_tftp_get(uts, &srv, "3", 0));
+	ut_assert(net_rx_stats.frames >= srv.sent);
+	ut_assert(net_rx_stats.bytes > SB_TFTP_SIZE);
+	ut_asserteq(SB_TFTP_SIZE, net_rx_stats.copied);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_tftp_copies, DM_TESTF_SCAN_FDT);
+#endif
+#endif
+
+#ifdef CONFIG_CMD_NFS
+#define SB_NFS_MOUNT_PORT	635
+#define SB_NFS_PORT		2049
+#define SB_NFS_SIZE		(30 * 1024 + 100)
+#define SB_NFS_MAX_READ		1024
+#define SB_NFS_LOAD_ADDR	0x100000
+/* RPC reply header, NFSv3 READ result header and data, in 32-bit words */
+#define SB_NFS_REPLY_WORDS	(6 + 26 + SB_NFS_MAX_READ / 4)
+
+/**
+ * struct sb_nfs_server - state of the fake NFS server
+ *
+ * @uts: test state, used by the ut_assert macros
+ * @client_port: UDP port of the client
+ * @v3_only: reject NFSv2 calls, so that the client uses NFSv3
+ * @reorder: hold back a READ reply until the next READ call arrives
+ * @drop_offset: offset of the READ call to drop the first time, -1 for none
+ * @read_size: size that every READ call must ask for, 0 for any
+ * @reads: number of READ calls received
+ * @retransmits: number of READ calls received again with the same XID
+ * @max_id: largest READ XID received
+ * @dropped: true if a READ call has been dropped and not sent again
+ * @held: READ reply being held back
+ * @held_len: length of @held in bytes, 0 if none
+ */
+struct sb_nfs_server {
+	struct unit_test_state *uts;
+	int client_port;
+	bool v3_only;
+	bool reorder;
+	int drop_offset;
+	int read_size;
+	int reads;
+	int retransmits;
+	u32 max_id;
+	bool dropped;
+	__be32 held[SB_NFS_REPLY_WORDS];
+	int held_len;
+};
+
+static u8 sb_nfs_data(int offset)
+{
+	return offset ^ (offset >> 8) ^ 0x5a;
+}
+
+static u32 sb_nfs_word(const u8 *call, int word)
+{
+	return get_unaligned_be32(call + word * 4);
+}
+
+/* Reply to a READ call, returning the length of the reply in bytes */
+static int sb_nfs_read(struct sb_nfs_server *srv, const u8 *call, u32 vers,
+		       __be32 *reply)
+{
+	struct unit_test_state *uts = srv->uts;
+	__be32 *data = reply + 6;
+	int args = 6 + 9;	/* call header and credentials */
+	int offset, count, len, i;
+	bool eof;
+	u8 *ptr;
+
+	if (vers == 2) {
+		offset = sb_nfs_word(call, args + 8);
+		count = sb_nfs_word(call, args + 9);
+	} else {
+		offset = sb_nfs_word(call, args + 10);
+		count = sb_nfs_word(call, args + 11);
+	}
+	if (srv->read_size)
+		ut_asserteq(srv->read_size, count);
+
+	len = min(count, SB_NFS_MAX_READ);
+	len = max(0, min(len, SB_NFS_SIZE - offset));
+	eof = offset + len >= SB_NFS_SIZE;
+	if (vers == 2) {
+		data[18] = htonl(len);
+		ptr = (u8 *)&data[19];
+	} else {
+		data[1] = htonl(1);	/* attributes follow (all zero) */
+		data[23] = htonl(len);
+		data[24] = htonl(eof);
+		data[25] = htonl(len);
+		ptr = (u8 *)&data[26];
+	}
+	for (i = 0; i < len; i++)
+		ptr[i] = sb_nfs_data(offset + i);
+
+	return ptr + ALIGN(len, 4) - (u8 *)reply;
+}
+
+static int sb_nfs_handler(struct udevice *dev, void *packet,
+			  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct sb_nfs_server *srv = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	const u8 *call = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	__be32 reply[SB_NFS_REPLY_WORDS];
+	__be32 *data = reply + 6;
+	u32 id, prog, vers, proc;
+	int sport, reply_len;
+	bool eof = true;
+	int ret;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	srv->client_port = ntohs(ip->udp_src);
+	sport = ntohs(ip->udp_dst);
+	id = sb_nfs_word(call, 0);
+	prog = sb_nfs_word(call, 3);
+	vers = sb_nfs_word(call, 4);
+	proc = sb_nfs_word(call, 5);
+
+	memset(reply, '\0', sizeof(reply));
+	reply[0] = htonl(id);
+	reply[1] = htonl(1);	/* MSG_REPLY */
+	reply_len = 6 * 4;
+	switch (prog) {
+	case 100000: /* portmap GETPORT: skip the auth, then the program */
+		data[0] = htonl(sb_nfs_word(call, 10) == 100005 ?
+				SB_NFS_MOUNT_PORT : SB_NFS_PORT);
+		reply_len += 4;
+		break;
+	case 100005: /* mount, giving the directory handle, or umount */
+		if (proc == 1)
+			reply_len += 9 * 4;
+		break;
+	case 100003:
+		if (vers == 2 && srv->v3_only) {
+			reply[5] = htonl(2);	/* PROG_MISMATCH */
+			data[0] = htonl(3);
+			data[1] = htonl(3);
+			reply_len += 2 * 4;
+		} else if (proc == 4 && vers == 2) {	/* LOOKUP */
+			reply_len += (1 + 8 + 17) * 4;
+		} else if (proc == 3 && vers == 3) {	/* LOOKUP */
+			data[1] = htonl(32);
+			reply_len += (1 + 1 + 8 + 2) * 4;
+		} else if (proc == 6) {			/* READ */
+			srv->reads++;
+			if (id <= srv->max_id)
+				srv->retransmits++;
+			srv->max_id = max(srv->max_id, id);
+			if (sb_nfs_word(call, 6 + 9 + (vers == 2 ? 8 : 10)) ==
+			    srv->drop_offset) {
+				srv->drop_offset = -1;
+				srv->dropped = true;
+				return 0;
+			}
+			reply_len = sb_nfs_read(srv, call, vers, reply);
+			eof = ntohl(vers == 2 ? data[18] : data[23]) <
+				SB_NFS_MAX_READ;
+		}
+		break;
+	}
+
+	/* Let the client time out a dropped call once the others are done */
+	if (eof && srv->dropped) {
+		srv->dropped = false;
+		sandbox_eth_skip_timeout();
+	}
+	if (srv->reorder && !eof && !srv->held_len) {
+		memcpy(srv->held, reply, reply_len);
+		srv->held_len = reply_len;
+		return 0;
+	}
+	ret = sandbox_eth_recv_udp(dev, srv->client_port, sport, reply,
+				   reply_len);
+	if (!ret && srv->held_len) {
+		ret = sandbox_eth_recv_udp(dev, srv->client_port, SB_NFS_PORT,
+					   srv->held, srv->held_len);
+		srv->held_len = 0;
+	}
+
+	return ret;
+}
+
+static int sb_nfs_get(struct unit_test_state *uts, struct sb_nfs_server *srv,
+		      const char *rsize, const char *windowsize)
+{
+	u8 *buf;
+	int i;
+
+	srv->uts = uts;
+	sandbox_eth_set_tx_handler(0, sb_nfs_handler);
+	sandbox_eth_set_priv(0, srv);
+
+	env_set("ethact", "eth@10002000");
+	net_server_ip = string_to_ip("1.1.2.2");
+	strcpy(net_boot_file_name, "/export/image.bin");
+	env_set("nfsrsize", rsize);
+	env_set("nfswindowsize", windowsize);
+	load_addr = SB_NFS_LOAD_ADDR;
+	buf = map_sysmem(SB_NFS_LOAD_ADDR, SB_NFS_SIZE);
+	memset(buf, '\0', SB_NFS_SIZE);
+
+	ut_asserteq(SB_NFS_SIZE, net_loop(NFS));
+	for (i = 0; i < SB_NFS_SIZE; i++)
+		ut_asserteq(sb_nfs_data(i), buf[i]);
+	unmap_sysmem(buf);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("nfsrsize", NULL);
+	env_set("nfswindowsize", NULL);
+	net_boot_file_name[0] = '\0';
+
+	return 0;
+}
+
+/* Test NFS transfers with one and with several READ calls in flight */
+static int dm_test_eth_nfs_window(struct unit_test_state *uts)
+{
+	struct sb_nfs_server srv;
+
+	/* NFSv2 in lock-step: the last, short read marks the end */
+	memset(&srv, '\0', sizeof(srv));
+	srv.drop_offset = -1;
+	srv.read_size = 1024;
+	ut_assertok(sb_nfs_get(uts, &srv, NULL, "1"));
+	ut_asserteq(31, srv.reads);
+	ut_asserteq(0, srv.retransmits);
+
+	/*
+	 * NFSv3 with replies arriving out of order, which would stall a
+	 * client waiting for each reply before sending the next call
+	 */
+	memset(&srv, '\0', sizeof(srv));
+	srv.drop_offset = -1;
+	srv.v3_only = true;
+	srv.reorder = true;
+	srv.read_size = 512;
+	ut_assertok(sb_nfs_get(uts, &srv, "512", "3"));
+	ut_assert(srv.reads >= 61 && srv.reads <= 61 + 2);
+	ut_asserteq(0, srv.retransmits);
+
+	/* A lost reply makes the client send just that call again */
+	memset(&srv, '\0', sizeof(srv));
+	srv.drop_offset = 2048;
+	srv.v3_only = true;
+	ut_assertok(sb_nfs_get(uts, &srv, NULL, "3"));
+	ut_asserteq(1, srv.retransmits);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_nfs_window, DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_NET_RX_STATS
+/*
+ * Test that NFS copies each received byte of the file only once. Besides
+ * the data, only the RPC headers of the replies are copied.
+ */
+static int dm_test_eth_nfs_copies(struct unit_test_state *uts)
+{
+	struct sb_nfs_server srv;
+
+	memset(&srv, '\0', sizeof(srv));
+	srv.drop_offset = -1;
+	srv.v3_only = true;
+	memset(&net_rx_stats, '\0', sizeof(net_rx_stats));
+	ut_assertok(sb_nfs_get(uts, &srv, NULL, "3"));
+	ut_assert(net_rx_stats.copied >= SB_NFS_SIZE);
+	ut_assert(net_rx_stats.copied - SB_NFS_SIZE <= net_rx_stats.frames *
+		  (SB_NFS_REPLY_WORDS - SB_NFS_MAX_READ / 4) * 4);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_nfs_copies, DM_TESTF_SCAN_FDT);
+#endif
+#endif
+
+/* Test the ring of receive buffers used by the sandbox driver */
+static int dm_test_eth_rx_ring(struct unit_test_state *uts)
+{
+	struct eth_rx_ring ring;
+	uchar *buf[3], *packet;
+	int i;
+
+	ut_assertok(eth_rx_ring_init(&ring, 3));
+	ut_asserteq(-EAGAIN, eth_rx_ring_recv(&ring, &packet));
+	for (i = 0; i < 3; i++) {
+		buf[i] = eth_rx_ring_get_buf(&ring);
+		ut_assertnonnull(buf[i]);
+		ut_asserteq(0, (ulong)buf[i] & (PKTALIGN - 1));
+		eth_rx_ring_push(&ring, 100 + i);
+	}
+	ut_assertnull(eth_rx_ring_get_buf(&ring));
+
+	/* Packets come out in order, in the buffers they were received in */
+	ut_asserteq(100, eth_rx_ring_recv(&ring, &packet));
+	ut_asserteq_ptr(buf[0], packet);
+	ut_asserteq(-EINVAL, eth_rx_ring_free_pkt(&ring, buf[1]));
+	ut_assertok(eth_rx_ring_free_pkt(&ring, packet));
+
+	/* The freed buffer is used again, wrapping around the ring */
+	ut_asserteq_ptr(buf[0], eth_rx_ring_get_buf(&ring));
+	eth_rx_ring_push(&ring, 103);
+	for (i = 1; i < 4; i++) {
+		ut_asserteq(100 + i, eth_rx_ring_recv(&ring, &packet));
+		ut_asserteq_ptr(buf[i % 3], packet);
+		ut_assertok(eth_rx_ring_free_pkt(&ring, packet));
+	}
+	ut_asserteq(-EAGAIN, eth_rx_ring_recv(&ring, &packet));
+	eth_rx_ring_uninit(&ring);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_rx_ring, 0);
@@ -2,10 +2,14 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
+#include <dm/of_access.h>
 #include <dm/of_extra.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static int dm_test_ofnode_compatible(struct unit_test_state *uts)
 {
 	ofnode root_node = ofnode_path("/");
@@ -58,3 +62,100 @@ static int dm_test_ofnode_fmap(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ofnode_fmap, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_OF_LIVE
+/* Look up every phandle in the live tree, returning the number of nodes */
+static int ofnode_check_phandles_live(struct unit_test_state *uts)
+{
+	struct device_node *np;
+	int count = 0;
+	ofnode node;
+
+	for_each_of_allnodes(np) {
+		if (!np->phandle)
+			continue;
+		ut_asserteq_ptr(np, of_find_node_by_phandle(np->phandle));
+		node = ofnode_get_by_phandle(np->phandle);
+		ut_asserteq_ptr(np, ofnode_to_np(node));
+		count++;
+	}
+
+	return count;
+}
+
+static int dm_test_ofnode_phandle_live(struct unit_test_state *uts)
+{
+	ulong start, walk_nocache;
+	int count;
+
+	/* Without the cache, each lookup walks the tree */
+	of_free_phandle_cache();
+	start = of_phandle_walk_count();
+	count = ofnode_check_phandles_live(uts);
+	ut_assert(count > 10);
+	walk_nocache = of_phandle_walk_count() - start;
+	ut_assert(walk_nocache > count);
+
+	/* With it, no nodes are visited */
+	ut_assertok(of_populate_phandle_cache());
+	start = of_phandle_walk_count();
+	ut_asserteq(count, ofnode_check_phandles_live(uts));
+	ut_asserteq(0, of_phandle_walk_count() - start);
+	ut_assertnull(of_find_node_by_phandle(0));
+	ut_assertnull(of_find_node_by_phandle(0x7fffffff));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_live, DM_TESTF_SCAN_FDT |
+		DM_TESTF_LIVE_TREE);
+#endif
+
+/* Check that every phandle in @blob is found, returning the number */
+static int ofnode_check_phandles_flat(struct unit_test_state *uts,
+				      const void *blob)
+{
+	int offset, count = 0;
+	u32 phandle;
+
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (!phandle)
+			continue;
+		ut_asserteq(offset, fdtdec_node_offset_by_phandle(blob,
+								  phandle));
+		count++;
+	}
+
+	return count;
+}
+
+static int dm_test_ofnode_phandle_flat(struct unit_test_state *uts)
+{
+	const void *old_blob = gd->fdt_blob;
+	int size, count;
+	void *blob;
+
+	count = ofnode_check_phandles_flat(uts, gd->fdt_blob);
+	ut_assert(count > 10);
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(gd->fdt_blob, 0x7fffffff));
+
+	/* Offsets move when the tree is changed, but lookups still work */
+	size = fdt_totalsize(old_blob) + 1024;
+	blob = malloc(size);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_open_into(old_blob, blob, size));
+	gd->fdt_blob = blob;
+	ut_asserteq(count, ofnode_check_phandles_flat(uts, blob));
+	ut_assertok(fdt_setprop_string(blob, 0, "test-prop", "pushes nodes"));
+	ut_asserteq(count, ofnode_check_phandles_flat(uts, blob));
+	gd->fdt_blob = old_blob;
+	free(blob);
+
+	ut_asserteq(count, ofnode_check_phandles_flat(uts, gd->fdt_blob));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_flat, DM_TESTF_SCAN_FDT |
+		DM_TESTF_FLAT_TREE);
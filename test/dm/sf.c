@@ -11,6 +11,7 @@
 #include <os.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <linux/sizes.h>
 #include <asm/state.h>
 #include <asm/test.h>
 #include <dm/test.h>
@@ -101,3 +102,96 @@ static int dm_test_spi_flash_func(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash_func, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that erases use the largest erase command which fits */
+static int dm_test_spi_flash_erase_plan(struct unit_test_state *uts)
+{
+	const struct spi_nor_erase_type types[SNOR_ERASE_TYPE_MAX] = {
+		{ SZ_4K, SPINOR_OP_BE_4K },
+		{ SZ_32K, SPINOR_OP_BE_32K },
+		{ SZ_64K, SPINOR_OP_SE },
+	};
+	const struct spi_nor_erase_type *type;
+	static const u32 expect[] = {
+		SZ_4K, SZ_4K, SZ_4K, SZ_4K, SZ_4K, SZ_4K, SZ_4K, SZ_32K,
+		SZ_64K, SZ_64K, SZ_4K,
+	};
+	u32 addr = 0x1000, end = 0x31000;
+	int count;
+
+	for (count = 0; addr < end; count++) {
+		type = spi_nor_erase_plan(types, addr, end - addr);
+		ut_assertnonnull(type);
+		ut_assert(count < ARRAY_SIZE(expect));
+		ut_asserteq(expect[count], type->size);
+		addr += type->size;
+	}
+	ut_asserteq(ARRAY_SIZE(expect), count);
+	ut_asserteq(end, addr);
+
+	/* Nothing fits if the range is smaller than the smallest type */
+	ut_assertnull(spi_nor_erase_plan(types, 0, SZ_2K));
+	ut_asserteq(SZ_64K, spi_nor_erase_plan(types, SZ_64K, SZ_1M)->size);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_erase_plan, 0);
+
+/* Test the erase commands sent to the sandbox SPI flash */
+static int dm_test_spi_flash_erase_ops(struct unit_test_state *uts)
+{
+	struct udevice *dev, *emul;
+	int full_size = 0x200000;
+	ulong time_us, start_time_us, sector_time_us;
+	uint count, start_count;
+	u8 *src, *dst;
+	int i;
+
+	src = map_sysmem(0x20000, full_size);
+	memset(src, '\0', full_size);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_EMUL, &emul));
+	dst = map_sysmem(0x20000 + full_size, full_size);
+
+	/* The m25p16 has only 64KiB sectors, so one command for each */
+	sandbox_sf_get_erase_stats(emul, &start_count, &start_time_us);
+	ut_assertok(spi_flash_erase_dm(dev, 0x10000, 0x30000));
+	sandbox_sf_get_erase_stats(emul, &count, &time_us);
+	ut_asserteq(3, count - start_count);
+	sector_time_us = (time_us - start_time_us) / 3;
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, dst));
+	for (i = 0; i < full_size; i++) {
+		ut_asserteq(i >= 0x10000 && i < 0x40000 ? 0xff : 0,
+			    dst[i]);
+	}
+
+	/* Erasing the whole flash uses a single chip-erase command */
+	start_count = count;
+	start_time_us = time_us;
+	ut_assertok(spi_flash_erase_dm(dev, 0, full_size));
+	sandbox_sf_get_erase_stats(emul, &count, &time_us);
+	ut_asserteq(1, count - start_count);
+	ut_assert(time_us - start_time_us <
+		  full_size / SZ_64K * sector_time_us);
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, dst));
+	for (i = 0; i < full_size; i++)
+		ut_asserteq(0xff, dst[i]);
+
+	/* ...but not if any of it is protected */
+	sandbox_sf_set_block_protect(emul, 1);
+	start_count = count;
+	ut_assertok(spi_flash_erase_dm(dev, 0, full_size));
+	sandbox_sf_get_erase_stats(emul, &count, &time_us);
+	ut_asserteq(full_size / SZ_64K, count - start_count);
+	sandbox_sf_set_block_protect(emul, 0);
+
+	/*
+	 * Since we are about to destroy all devices, we must tell sandbox
+	 * to forget the emulation device
+	 */
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_erase_ops, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
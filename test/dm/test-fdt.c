@@ -349,6 +349,157 @@ static int dm_test_fdt_offset(struct unit_test_state *uts)
 DM_TEST(dm_test_fdt_offset,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT | DM_TESTF_FLAT_TREE);
 
+/* Check that every device in a uclass can be found by its seq and node */
+static int check_uclass_lookups(struct unit_test_state *uts,
+				enum uclass_id id)
+{
+	struct udevice *dev, *found, *first;
+	struct uclass *uc;
+
+	ut_assertok(uclass_get(id, &uc));
+	uclass_foreach_dev(dev, uc) {
+		if (dev->seq != -1) {
+			ut_assertok(uclass_find_device_by_seq(id, dev->seq,
+							      false, &found));
+			ut_asserteq_ptr(dev, found);
+		}
+		if (!dev_has_of_node(dev))
+			continue;
+
+		/* If devices share a node, the first one is found */
+		uclass_foreach_dev(first, uc) {
+			if (ofnode_equal(dev_ofnode(first), dev_ofnode(dev)))
+				break;
+		}
+		ut_assertok(uclass_find_device_by_ofnode(id, dev_ofnode(dev),
+							 &found));
+		ut_asserteq_ptr(first, found);
+	}
+
+	return 0;
+}
+
+/* Test that uclass and device lookups follow bind, probe, remove and unbind */
+static int dm_test_fdt_uclass_maps(struct unit_test_state *uts)
+{
+	struct udevice *dev, *found;
+	struct uclass *uc;
+	ofnode node;
+	int id, seq;
+
+	/* Every uclass is found, whether or not it is first in the list */
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		struct uclass *expect = NULL;
+
+		list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+			if (uc->uc_drv->id == id)
+				expect = uc;
+		}
+		ut_asserteq_ptr(expect, uclass_find(id));
+	}
+	ut_assertnull(uclass_find(UCLASS_COUNT));
+
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+	for (uclass_first_device(UCLASS_TEST_FDT, &dev); dev;
+	     uclass_next_device(&dev))
+		;
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+
+	/* Removing a device frees its sequence number */
+	ut_assertok(uclass_get_device_by_seq(UCLASS_TEST_FDT, 6, &dev));
+	ut_asserteq_str("e-test", dev->name);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST_FDT, 6,
+						       false, &found));
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+	ut_assertok(device_probe(dev));
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST_FDT, 6, false,
+					      &found));
+	ut_asserteq_ptr(dev, found);
+
+	/* Moving a device to another node moves its lookup too */
+	node = dev_ofnode(dev);
+	dev_set_ofnode(dev, ofnode_path("/junk"));
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+							  node, &found));
+	ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+						 ofnode_path("/junk"), &found));
+	ut_asserteq_ptr(dev, found);
+	dev_set_ofnode(dev, node);
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+
+	/* Unbinding a device takes it out of every lookup */
+	seq = dev->seq;
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+							  node, &found));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST_FDT, seq,
+						       false, &found));
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+
+	/* Binding it again puts it back */
+	ut_assertok(lists_bind_fdt(gd->dm_root, node, &dev, false));
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+	ut_assertok(device_probe(dev));
+	ut_asserteq(6, dev->seq);
+	ut_assertok(check_uclass_lookups(uts, UCLASS_TEST_FDT));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_uclass_maps, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_MAPS) && CONFIG_IS_ENABLED(DM_STATS)
+/* Test that lookups compare fewer devices than walking the uclass does */
+static int dm_test_fdt_uclass_maps_stats(struct unit_test_state *uts)
+{
+	struct dm_stats *stats = gd->dm_stats;
+	ulong walk, list_walk = 0, count = 0;
+	struct udevice *dev, *found;
+	struct uclass *uc;
+
+	ut_assertnonnull(stats);
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	for (uclass_first_device(UCLASS_TEST_FDT, &dev); dev;
+	     uclass_next_device(&dev))
+		;
+
+	walk = stats->ofnode_walk;
+	uclass_foreach_dev(dev, uc) {
+		/* Walking the list would compare this many devices */
+		list_walk += ++count;
+		if (!dev_has_of_node(dev))
+			continue;
+		ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+							 dev_ofnode(dev),
+							 &found));
+	}
+	ut_assert(stats->ofnode_walk - walk < list_walk);
+
+	count = 0;
+	list_walk = 0;
+	walk = stats->seq_walk;
+	uclass_foreach_dev(dev, uc) {
+		list_walk += ++count;
+		if (dev->seq == -1)
+			continue;
+		ut_assertok(uclass_find_device_by_seq(UCLASS_TEST_FDT, dev->seq,
+						      false, &found));
+	}
+	ut_assert(stats->seq_walk - walk < list_walk);
+
+	/* Each uclass lookup looks at a single array entry */
+	walk = stats->uclass_walk;
+	count = stats->uclass_find;
+	ut_assertnonnull(uclass_find(UCLASS_TEST_FDT));
+	ut_asserteq(count + 1, stats->uclass_find);
+	ut_asserteq(walk + 1, stats->uclass_walk);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_uclass_maps_stats, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
 /**
  * Test various error conditions with uclass_first_device() and
  * uclass_next_device()
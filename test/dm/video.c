@@ -11,6 +11,8 @@
 #include <os.h>
 #include <video.h>
 #include <video_console.h>
+#include <video_font.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <test/ut.h>
@@ -264,6 +266,63 @@ static int dm_test_video_rotation3(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_rotation3, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Test that video_sync() only flushes the part of the display that changed */
+static int dm_test_video_damage(struct unit_test_state *uts)
+{
+	struct video_priv *priv;
+	struct udevice *dev, *con;
+	ulong flushed;
+	int i;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	priv = dev_get_uclass_priv(dev);
+	video_set_flush_dcache(dev, true);
+
+	/* A forced sync flushes everything, after which nothing has changed */
+	sandbox_get_dcache_flushed(true);
+	video_sync(dev, true);
+	ut_asserteq(priv->fb_size, sandbox_get_dcache_flushed(true));
+	video_sync(dev, false);
+	ut_asserteq(0, sandbox_get_dcache_flushed(true));
+
+	/* A character flushes just its own part of each line it is on */
+	vidconsole_put_char(con, 'a');
+	video_sync(dev, false);
+	flushed = sandbox_get_dcache_flushed(true);
+	ut_assert(flushed >= VIDEO_FONT_HEIGHT * VIDEO_FONT_WIDTH * 2);
+	ut_assert(flushed <= VIDEO_FONT_HEIGHT * (VIDEO_FONT_WIDTH * 2 +
+			     2 * CONFIG_SYS_CACHELINE_SIZE));
+
+	/* Damage is clipped to the display */
+	video_damage(dev, -10, -10, 20, 20);
+	video_sync(dev, false);
+	flushed = sandbox_get_dcache_flushed(true);
+	ut_assert(flushed >= 10 * 10 * 2);
+	ut_assert(flushed <= 10 * (10 * 2 + 2 * CONFIG_SYS_CACHELINE_SIZE));
+
+	/* Full lines are flushed as a single range */
+	video_damage(dev, 0, 10, priv->xsize, 2);
+	video_sync(dev, false);
+	flushed = sandbox_get_dcache_flushed(true);
+	ut_assert(flushed >= 2 * priv->line_length);
+	ut_assert(flushed <= 2 * priv->line_length +
+	       2 * CONFIG_SYS_CACHELINE_SIZE);
+
+	/* Moving to the next line does not draw anything */
+	vidconsole_put_char(con, '\n');
+	ut_asserteq(0, sandbox_get_dcache_flushed(true));
+
+	/* Go down to the last line and scroll once, which changes everything */
+	for (i = 0; i < priv->ysize / VIDEO_FONT_HEIGHT - 1; i++)
+		vidconsole_put_char(con, '\n');
+	ut_asserteq(priv->fb_size, sandbox_get_dcache_flushed(true));
+
+	return 0;
+}
+DM_TEST(dm_test_video_damage, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* Read a file into memory and return a pointer to it */
 static int read_file(struct unit_test_state *uts, const char *fname,
 		     ulong *addrp)
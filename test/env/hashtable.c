@@ -6,6 +6,8 @@
 
 #include <common.h>
 #include <command.h>
+#include <env_internal.h>
+#include <malloc.h>
 #include <search.h>
 #include <stdio.h>
 #include <test/env.h>
@@ -123,3 +125,136 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Check that the exported keys are in ascending order, returning the count */
+static int htab_check_export(struct unit_test_state *uts,
+			     struct hsearch_data *htab, int *countp)
+{
+	char *res = NULL;
+	char *key, *next, *prev = NULL;
+	int count = 0;
+
+	ut_assert(hexport_r(htab, '\n', 0, &res, 0, 0, NULL) > 0);
+	for (key = res; *key; key = next) {
+		next = strchr(key, '\n') + 1;
+		*strchr(key, '=') = '\0';
+		if (prev)
+			ut_assert(strcmp(prev, key) < 0);
+		prev = key;
+		count++;
+	}
+	free(res);
+	*countp = count;
+
+	return 0;
+}
+
+/* Grow the hash table well past its initial size and delete from it */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	char key[20];
+	int count;
+	int i;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, SIZE * 64));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 64));
+	ut_asserteq(SIZE * 64, htab.filled);
+	ut_assert(htab.size > htab.filled);
+	ut_assertok(htab_check_export(uts, &htab, &count));
+	ut_asserteq(SIZE * 64, count);
+
+	/* Delete every other entry; the rest must still be found */
+	for (i = 0; i < SIZE * 64; i += 2) {
+		sprintf(key, "%d", i);
+		ut_asserteq(1, hdelete_r(key, &htab, 0));
+	}
+	ut_asserteq(SIZE * 32, htab.filled);
+	ut_assertok(htab_check_export(uts, &htab, &count));
+	ut_asserteq(SIZE * 32, count);
+
+	/* Add them back, reusing the deleted entries */
+	for (i = 0; i < SIZE * 64; i += 2) {
+		struct env_entry item, *ritem;
+
+		sprintf(key, "%d", i);
+		item.callback = NULL;
+		item.data = key;
+		item.flags = 0;
+		item.key = key;
+		ut_asserteq(1, hsearch_r(item, ENV_ENTER, &ritem, &htab, 0));
+	}
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 64));
+	ut_asserteq(SIZE * 64, htab.filled);
+	ut_assertok(htab_check_export(uts, &htab, &count));
+	ut_asserteq(SIZE * 64, count);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+#define BENCH_VARS 4096
+
+/* Time env_set(), env_get() and export with thousands of variables */
+static int env_test_htab_bench(struct unit_test_state *uts)
+{
+	ulong start, set_us, get_us, export_us;
+	uint size = env_htab.size;
+	char *res = NULL;
+	char name[20];
+	int i;
+
+	start = timer_get_us();
+	for (i = 0; i < BENCH_VARS; i++) {
+		sprintf(name, "bench%d", i);
+		ut_assertok(env_set(name, name));
+	}
+	set_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < BENCH_VARS; i++) {
+		sprintf(name, "bench%d", i);
+		ut_asserteq_str(name, env_get(name));
+	}
+	get_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	ut_assert(hexport_r(&env_htab, '\0', 0, &res, 0, 0, NULL) > 0);
+	export_us = timer_get_us() - start;
+	free(res);
+
+	/* Every variable must still be there, in a table which has grown */
+	for (i = 0; i < BENCH_VARS; i++) {
+		struct env_entry item, *ritem;
+
+		sprintf(name, "bench%d", i);
+		item.callback = NULL;
+		item.flags = 0;
+		item.data = NULL;
+		item.key = name;
+		ritem = NULL;
+		hsearch_r(item, ENV_FIND, &ritem, &env_htab, 0);
+		ut_assert(ritem);
+		ut_asserteq_str(name, ritem->key);
+		ut_asserteq_str(name, ritem->data);
+	}
+	ut_assert(env_htab.size > size);
+	ut_assert(env_htab.size > env_htab.filled);
+
+	for (i = 0; i < BENCH_VARS; i++) {
+		sprintf(name, "bench%d", i);
+		ut_assertok(env_set(name, NULL));
+	}
+
+	printf("%d vars: set %lu us, get %lu us, export %lu us\n",
+	       BENCH_VARS, set_us, get_us, export_us);
+
+	return 0;
+}
+
+ENV_TEST(env_test_htab_bench, 0);
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the CRC32 implementations
+ */
+
+#include <common.h>
+#include <mapmem.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define BENCH_ADDR	0x1000000
+#define BENCH_SIZE	(16 << 20)
+
+/* Fill a buffer with reproducible data */
+static void crc32_test_fill(u8 *buf, uint len)
+{
+	u32 val = 0x12345678;
+	uint i;
+
+	for (i = 0; i < len; i++) {
+		val = val * 1103515245 + 12345;
+		buf[i] = val >> 16;
+	}
+}
+
+/* Test that every implementation matches the reference one */
+static int lib_test_crc32(struct unit_test_state *uts)
+{
+	const uint len = 4096 + 64;
+	enum crc32_impl impl;
+	u32 ref, crc, part;
+	uint ofs, size;
+	u8 *buf;
+
+	ut_asserteq(0xcbf43926, crc32(0, (u8 *)"123456789", 9));
+	ut_asserteq(0, crc32(0, NULL, 0));
+	ut_asserteq(0xcbf43926, crc32_runtime(0, (u8 *)"123456789", 9));
+
+	buf = malloc(len);
+	ut_assertnonnull(buf);
+	crc32_test_fill(buf, len);
+
+	for (impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+		crc = 0;
+		if (crc32_impl_no_comp(impl, &crc, buf, 1) == -ENOSYS) {
+			printf("crc32 %s: not available\n",
+			       crc32_impl_name(impl));
+			continue;
+		}
+
+		/* All alignments, and lengths around the word sizes */
+		for (ofs = 0; ofs < 8; ofs++) {
+			for (size = 0; size < 72; size++) {
+				ref = ~0;
+				crc32_impl_no_comp(CRC32_IMPL_BYTE, &ref,
+						   buf + ofs, size);
+				crc = ~0;
+				ut_assertok(crc32_impl_no_comp(impl, &crc,
+							       buf + ofs,
+							       size));
+				ut_asserteq(ref, crc);
+			}
+		}
+
+		/* A large buffer, in one go and in two parts */
+		ref = 0x5a5a5a5a;
+		crc32_impl_no_comp(CRC32_IMPL_BYTE, &ref, buf + 3, len - 3);
+		crc = 0x5a5a5a5a;
+		ut_assertok(crc32_impl_no_comp(impl, &crc, buf + 3, len - 3));
+		ut_asserteq(ref, crc);
+		part = 0x5a5a5a5a;
+		ut_assertok(crc32_impl_no_comp(impl, &part, buf + 3, 1001));
+		ut_assertok(crc32_impl_no_comp(impl, &part, buf + 1004,
+					       len - 1004));
+		ut_asserteq(ref, part);
+	}
+
+	/* crc32() uses the default implementation */
+	ref = ~0;
+	crc32_impl_no_comp(CRC32_IMPL_BYTE, &ref, buf + 1, len - 1);
+	ut_asserteq(~ref, crc32(0, buf + 1, len - 1));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32, 0);
+
+/* Measure the throughput of each implementation */
+static int lib_test_crc32_bench(struct unit_test_state *uts)
+{
+	enum crc32_impl impl;
+	ulong start, us;
+	u32 ref, crc;
+	u8 *buf;
+
+	buf = map_sysmem(BENCH_ADDR, BENCH_SIZE);
+	crc32_test_fill(buf, BENCH_SIZE);
+	ref = crc32(0, buf, BENCH_SIZE);
+
+	for (impl = 0; impl < CRC32_IMPL_COUNT; impl++) {
+		crc = ~0;
+		start = timer_get_us();
+		if (crc32_impl_no_comp(impl, &crc, buf, BENCH_SIZE))
+			continue;
+		us = max(timer_get_us() - start, 1UL);
+		ut_asserteq(ref, ~crc);
+		printf("crc32 %-6s: %lu MiB/s\n", crc32_impl_name(impl),
+		       (ulong)((u64)BENCH_SIZE * 1000000 / us >> 20));
+	}
+	unmap_sysmem(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_bench, 0);
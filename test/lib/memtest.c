@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the memory test engine
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <memtest.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Number of bytes to test, enough for a few chunks and an odd tail */
+#define TEST_SIZE	(3 * 4096 + 3 * sizeof(ulong))
+
+/* Check that all the tests pass on good memory */
+static int lib_test_memtest_pass(struct unit_test_state *uts)
+{
+	struct memtest mt;
+	ulong *buf;
+
+	buf = malloc(TEST_SIZE);
+	ut_assertnonnull(buf);
+	memtest_init(&mt, buf, 0x1000, TEST_SIZE, MEMTEST_FLUSH_CACHE);
+	mt.chunk = 4096;
+
+	ut_assertok(memtest_data_bus(&mt, NULL));
+	ut_assertok(memtest_addr_bus(&mt));
+	ut_assertok(memtest_device(&mt));
+	ut_assert(buf[TEST_SIZE / sizeof(ulong) - 1] ==
+		  ~(TEST_SIZE / sizeof(ulong)));
+	ut_assertok(memtest_addr_in_addr(&mt));
+	ut_assert(buf[0] == ~0x1000UL);
+	ut_assertok(memtest_moving_inv(&mt, 0x5a5a5a5a));
+	ut_asserteq(0x5a5a5a5a, buf[0]);
+	ut_asserteq(0, mt.errs);
+
+	/* memtest_device() alone reads and writes each word five times */
+	ut_assert(mt.bytes >= 5 * TEST_SIZE);
+	free(buf);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_memtest_pass, 0);
+
+/* Check that errors are found and reported correctly */
+static int lib_test_memtest_errors(struct unit_test_state *uts)
+{
+	struct memtest mt;
+	ulong *buf;
+
+	buf = malloc(TEST_SIZE);
+	ut_assertnonnull(buf);
+	memtest_init(&mt, buf, 0x1000, TEST_SIZE, MEMTEST_QUIET);
+
+	ut_assertok(memtest_fill(&mt, 0x100, 2));
+	ut_asserteq(0x100, buf[0]);
+	ut_asserteq(0x102, buf[1]);
+	ut_assertok(memtest_check(&mt, 0x100, 2, false));
+	ut_asserteq(0, mt.errs);
+
+	/* Corrupt words in the unrolled part and in the tail */
+	buf[5] ^= 0x30;
+	buf[TEST_SIZE / sizeof(ulong) - 1] ^= 0x400;
+	ut_assertok(memtest_check(&mt, 0x100, 2, false));
+	ut_asserteq(2, mt.errs);
+	ut_asserteq(0x1000 + 5 * sizeof(ulong), mt.first_err);
+	ut_asserteq(0x430, mt.err_bits);
+	free(buf);
+
+	return 0;
+}
+
+LIB_TEST(lib_test_memtest_errors, 0);
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the SHA-1 and SHA-256 implementations
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+/* FIPS 180-2 test vector: one million repetitions of 'a' */
+#define MILLION_LEN	1000000
+
+/*
+ * Sizes of the pieces the message is passed in, so that the buffered and
+ * multi-block paths are all taken
+ */
+static const uint sha_test_pieces[] = { 1, 63, 64, 65, 128, 3, 4096, 200000 };
+
+#ifdef CONFIG_SHA1
+static const u8 sha1_abc[SHA1_SUM_LEN] = {
+	0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d,
+};
+
+static const u8 sha1_million[SHA1_SUM_LEN] = {
+	0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+	0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f,
+};
+
+/* Test that every SHA-1 implementation gives the right digest */
+static int lib_test_sha1(struct unit_test_state *uts)
+{
+	u8 digest[SHA1_SUM_LEN];
+	enum sha1_impl impl;
+	sha1_context ctx;
+	uint pos, len, i;
+	u8 *buf;
+	int ret;
+
+	buf = malloc(MILLION_LEN);
+	ut_assertnonnull(buf);
+	memset(buf, 'a', MILLION_LEN);
+
+	sha1_csum_wd(buf, MILLION_LEN, digest, CHUNKSZ_SHA1);
+	ut_assertok(memcmp(sha1_million, digest, SHA1_SUM_LEN));
+
+	sha1_starts(&ctx);
+	sha1_update_wd(&ctx, (u8 *)"abc", 3, 1);
+	sha1_finish(&ctx, digest);
+	ut_assertok(memcmp(sha1_abc, digest, SHA1_SUM_LEN));
+
+	for (impl = 0; impl < SHA1_IMPL_COUNT; impl++) {
+		sha1_starts(&ctx);
+		ret = sha1_impl_update(impl, &ctx, (u8 *)"abc", 3);
+		if (ret == -ENOSYS && impl != SHA1_IMPL_GENERIC)
+			continue;
+		ut_assertok(ret);
+		sha1_finish(&ctx, digest);
+		ut_assertok(memcmp(sha1_abc, digest, SHA1_SUM_LEN));
+
+		sha1_starts(&ctx);
+		for (pos = 0, i = 0; pos < MILLION_LEN; pos += len, i++) {
+			len = sha_test_pieces[i % ARRAY_SIZE(sha_test_pieces)];
+			len = min(len, MILLION_LEN - pos);
+			ut_assertok(sha1_impl_update(impl, &ctx, buf + pos,
+						     len));
+		}
+		sha1_finish(&ctx, digest);
+		ut_assertok(memcmp(sha1_million, digest, SHA1_SUM_LEN));
+	}
+	ut_assertnull(sha1_impl_name(SHA1_IMPL_COUNT));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_sha1, 0);
+#endif
+
+#ifdef CONFIG_SHA256
+static const u8 sha256_abc[SHA256_SUM_LEN] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+	0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+	0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+	0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static const u8 sha256_million[SHA256_SUM_LEN] = {
+	0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92,
+	0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+	0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e,
+	0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0,
+};
+
+/* Test that every SHA-256 implementation gives the right digest */
+static int lib_test_sha256(struct unit_test_state *uts)
+{
+	u8 digest[SHA256_SUM_LEN];
+	enum sha256_impl impl;
+	sha256_context ctx;
+	uint pos, len, i;
+	u8 *buf;
+	int ret;
+
+	buf = malloc(MILLION_LEN);
+	ut_assertnonnull(buf);
+	memset(buf, 'a', MILLION_LEN);
+
+	sha256_csum_wd(buf, MILLION_LEN, digest, CHUNKSZ_SHA256);
+	ut_assertok(memcmp(sha256_million, digest, SHA256_SUM_LEN));
+
+	sha256_starts(&ctx);
+	sha256_update_wd(&ctx, (u8 *)"abc", 3, 1);
+	sha256_finish(&ctx, digest);
+	ut_assertok(memcmp(sha256_abc, digest, SHA256_SUM_LEN));
+
+	for (impl = 0; impl < SHA256_IMPL_COUNT; impl++) {
+		sha256_starts(&ctx);
+		ret = sha256_impl_update(impl, &ctx, (u8 *)"abc", 3);
+		if (ret == -ENOSYS && impl != SHA256_IMPL_GENERIC)
+			continue;
+		ut_assertok(ret);
+		sha256_finish(&ctx, digest);
+		ut_assertok(memcmp(sha256_abc, digest, SHA256_SUM_LEN));
+
+		sha256_starts(&ctx);
+		for (pos = 0, i = 0; pos < MILLION_LEN; pos += len, i++) {
+			len = sha_test_pieces[i % ARRAY_SIZE(sha_test_pieces)];
+			len = min(len, MILLION_LEN - pos);
+			ut_assertok(sha256_impl_update(impl, &ctx, buf + pos,
+						       len));
+		}
+		sha256_finish(&ctx, digest);
+		ut_assertok(memcmp(sha256_million, digest, SHA256_SUM_LEN));
+	}
+	ut_assertnull(sha256_impl_name(SHA256_IMPL_COUNT));
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_sha256, 0);
+#endif
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for writing Android sparse images
+ */
+
+#include <common.h>
+#include <image-sparse.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define SPARSE_BLK_SZ		4096
+#define STORAGE_BLKSZ		512
+#define STORAGE_START		16
+#define STORAGE_ERASE_GRP	64
+#define STORAGE_SIZE		(2 << 20)
+
+#define FILL_VAL		0x12345678
+#define BIG_RAW_BLKS	(CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / SPARSE_BLK_SZ + 32)
+
+struct sparse_test {
+	u8 *disk;
+	uint writes;
+	uint erases;
+	lbaint_t erased;
+};
+
+static lbaint_t sparse_test_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_test *st = info->priv;
+
+	st->writes++;
+	memcpy(st->disk + blk * STORAGE_BLKSZ, buffer, blkcnt * STORAGE_BLKSZ);
+
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_reserve(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t sparse_test_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	struct sparse_test *st = info->priv;
+
+	/* Unaligned erases would hit neighbouring blocks */
+	if (blk % STORAGE_ERASE_GRP || blkcnt % STORAGE_ERASE_GRP)
+		return 0;
+	st->erases++;
+	st->erased += blkcnt;
+	memset(st->disk + blk * STORAGE_BLKSZ, '\0', blkcnt * STORAGE_BLKSZ);
+
+	return blkcnt;
+}
+
+/* Append a chunk to the image at @p, returning a pointer to its data */
+static void *add_chunk(sparse_header_t *hdr, void **p, u16 type, u32 blks,
+		       u32 data_sz)
+{
+	chunk_header_t *chunk = *p;
+
+	chunk->chunk_type = type;
+	chunk->reserved1 = 0;
+	chunk->chunk_sz = blks;
+	chunk->total_sz = sizeof(*chunk) + data_sz;
+	*p += chunk->total_sz;
+	hdr->total_chunks++;
+	hdr->total_blks += blks;
+
+	return chunk + 1;
+}
+
+static void *add_raw(sparse_header_t *hdr, void **p, u32 blks, u8 *expect,
+		     int val)
+{
+	void *data = add_chunk(hdr, p, CHUNK_TYPE_RAW, blks,
+			       blks * SPARSE_BLK_SZ);
+	int i;
+
+	for (i = 0; i < blks * SPARSE_BLK_SZ; i++)
+		((u8 *)data)[i] = val + i / 7;
+	memcpy(expect, data, blks * SPARSE_BLK_SZ);
+
+	return expect + blks * SPARSE_BLK_SZ;
+}
+
+static void *add_fill(sparse_header_t *hdr, void **p, u32 blks, u8 *expect,
+		      u32 val)
+{
+	u32 *data = add_chunk(hdr, p, CHUNK_TYPE_FILL, blks, sizeof(u32));
+	u32 *out = (u32 *)expect;
+	int i;
+
+	*data = val;
+	for (i = 0; i < blks * SPARSE_BLK_SZ / sizeof(u32); i++)
+		out[i] = val;
+
+	return expect + blks * SPARSE_BLK_SZ;
+}
+
+/* Test that chunks are merged, and zero fills erased, on the way out */
+static int lib_test_sparse_write(struct unit_test_state *uts)
+{
+	struct sparse_test st = { };
+	struct sparse_storage info;
+	sparse_header_t *hdr;
+	u8 *image, *expect, *out;
+	void *p;
+
+	image = malloc(STORAGE_SIZE);
+	expect = malloc(STORAGE_SIZE);
+	st.disk = malloc(STORAGE_SIZE);
+	ut_assertnonnull(image);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(st.disk);
+	memset(st.disk, 0xaa, STORAGE_SIZE);
+	memset(expect, 0xaa, STORAGE_SIZE);
+
+	hdr = (sparse_header_t *)image;
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->file_hdr_sz = sizeof(*hdr);
+	hdr->chunk_hdr_sz = sizeof(chunk_header_t);
+	hdr->blk_sz = SPARSE_BLK_SZ;
+	p = hdr + 1;
+
+	out = expect + STORAGE_START * STORAGE_BLKSZ;
+	/* Two small RAW chunks, written together */
+	out = add_raw(hdr, &p, 2, out, 1);
+	out = add_raw(hdr, &p, 1, out, 2);
+	/* Two FILL chunks with the same value, written together */
+	out = add_fill(hdr, &p, 3, out, FILL_VAL);
+	out = add_fill(hdr, &p, 2, out, FILL_VAL);
+	/* Left alone */
+	add_chunk(hdr, &p, CHUNK_TYPE_DONT_CARE, 4, 0);
+	out += 4 * SPARSE_BLK_SZ;
+	/* Zero fill: unaligned head and tail written, the rest erased */
+	out = add_fill(hdr, &p, 40, out, 0);
+	add_chunk(hdr, &p, CHUNK_TYPE_CRC32, 0, 0);
+	/* A RAW chunk too big to merge, then a small one */
+	out = add_raw(hdr, &p, BIG_RAW_BLKS, out, 3);
+	out = add_raw(hdr, &p, 1, out, 4);
+	ut_assert(out - expect <= STORAGE_SIZE);
+	ut_assert(p - (void *)image <= STORAGE_SIZE);
+	ut_assert(is_sparse_image(image));
+
+	info.blksz = STORAGE_BLKSZ;
+	info.start = STORAGE_START;
+	info.size = STORAGE_SIZE / STORAGE_BLKSZ - STORAGE_START;
+	info.priv = &st;
+	info.write = sparse_test_write;
+	info.reserve = sparse_test_reserve;
+	info.erase = sparse_test_erase;
+	info.erase_grp = STORAGE_ERASE_GRP;
+	info.mssg = NULL;
+	ut_assertok(write_sparse_image(&info, "test", image, NULL));
+
+	ut_assertok(memcmp(expect, st.disk, STORAGE_SIZE));
+	ut_asserteq(6, st.writes);
+	ut_asserteq(1, st.erases);
+	ut_asserteq(256, st.erased);
+
+	/* Without erase support the zero fill is written instead */
+	memset(st.disk, 0xaa, STORAGE_SIZE);
+	st.writes = 0;
+	st.erases = 0;
+	info.erase = NULL;
+	ut_assertok(write_sparse_image(&info, "test", image, NULL));
+	ut_assertok(memcmp(expect, st.disk, STORAGE_SIZE));
+	ut_asserteq(5, st.writes);
+	ut_asserteq(0, st.erases);
+
+	free(st.disk);
+	free(expect);
+	free(image);
+
+	return 0;
+}
+LIB_TEST(lib_test_sparse_write, 0);
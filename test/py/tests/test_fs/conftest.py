@@ -14,6 +14,7 @@ supported_fs_ext = ['fat16', 'fat32']
 supported_fs_mkdir = ['fat16', 'fat32']
 supported_fs_unlink = ['fat16', 'fat32']
 supported_fs_symlink = ['ext4']
+supported_fs_frag = ['fat16', 'fat32', 'ext4']
 
 #
 # Filesystem test specific setup
@@ -50,6 +51,7 @@ def pytest_configure(config):
     global supported_fs_mkdir
     global supported_fs_unlink
     global supported_fs_symlink
+    global supported_fs_frag
 
     def intersect(listA, listB):
         return  [x for x in listA if x in listB]
@@ -62,6 +64,7 @@ def pytest_configure(config):
         supported_fs_mkdir =  intersect(supported_fs, supported_fs_mkdir)
         supported_fs_unlink =  intersect(supported_fs, supported_fs_unlink)
         supported_fs_symlink =  intersect(supported_fs, supported_fs_symlink)
+        supported_fs_frag =  intersect(supported_fs, supported_fs_frag)
 
 def pytest_generate_tests(metafunc):
     """Parametrize fixtures, fs_obj_xxx
@@ -90,6 +93,9 @@ def pytest_generate_tests(metafunc):
     if 'fs_obj_symlink' in metafunc.fixturenames:
         metafunc.parametrize('fs_obj_symlink', supported_fs_symlink,
             indirect=True, scope='module')
+    if 'fs_obj_frag' in metafunc.fixturenames:
+        metafunc.parametrize('fs_obj_frag', supported_fs_frag,
+            indirect=True, scope='module')
 
 #
 # Helper functions
@@ -600,3 +606,68 @@ def fs_obj_symlink(request, u_boot_config):
         call('rmdir %s' % mount_dir, shell=True)
         if fs_img:
             call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for fragmented fs test
+#
+# NOTE: yield_fixture was deprecated since pytest-3.0
+@pytest.yield_fixture()
+def fs_obj_frag(request, u_boot_config):
+    """Set up a fragmented file system to be used in fragmentation test.
+
+    The clusters of $FRAG_FILE are interleaved with those of another file,
+    which is then deleted, so that the file is split into many runs and the
+    free space into as many holes.
+
+    Args:
+        request: Pytest request object.
+	u_boot_config: U-boot configuration.
+
+    Return:
+        A fixture for fragmentation test, i.e. a triplet of file system type,
+        volume file name and a list of MD5 hashes.
+    """
+    fs_type = request.param
+    fs_img = ''
+
+    fs_ubtype = fstype_to_ubname(fs_type)
+    check_ubconfig(u_boot_config, fs_ubtype)
+
+    mount_dir = u_boot_config.persistent_data_dir + '/mnt'
+
+    frag_file = mount_dir + '/' + FRAG_FILE
+    hole_file = mount_dir + '/holes'
+
+    try:
+
+        # 128MiB volume
+        fs_img = mk_fs(u_boot_config, fs_type, 0x8000000, '128MB')
+
+        # Mount the image so we can populate it.
+        check_call('mkdir -p %s' % mount_dir, shell=True)
+        mount_fs(fs_type, fs_img, mount_dir)
+
+        # Grow both files in turn, one chunk at a time
+        for i in range(0, FRAG_CHUNKS):
+            check_call('dd if=/dev/urandom bs=%d count=1 >> %s 2> /dev/null'
+                % (FRAG_CHUNK_SIZE, frag_file), shell=True)
+            check_call('dd if=/dev/urandom bs=%d count=1 >> %s 2> /dev/null'
+                % (FRAG_CHUNK_SIZE, hole_file), shell=True)
+        check_call('rm %s' % hole_file, shell=True)
+
+        out = check_output(
+            'dd if=%s bs=1K 2> /dev/null | md5sum'
+            % frag_file, shell=True).decode()
+        md5val = [ out.split()[0] ]
+
+        umount_fs(mount_dir)
+    except CalledProcessError:
+        pytest.skip('Setup failed for filesystem: ' + fs_type)
+        return
+    else:
+        yield [fs_ubtype, fs_img, md5val]
+    finally:
+        umount_fs(mount_dir)
+        call('rmdir %s' % mount_dir, shell=True)
+        if fs_img:
+            call('rm -f %s' % fs_img, shell=True)
@@ -12,5 +12,11 @@ MEDIUM_FILE='10MB.file'
 # $BIG_FILE is the name of the 2.5GB file in the file system image
 BIG_FILE='2.5GB.file'
 
+# $FRAG_FILE is the name of the fragmented file in the file system image,
+# made of $FRAG_CHUNKS chunks of $FRAG_CHUNK_SIZE bytes
+FRAG_FILE='frag.file'
+FRAG_CHUNKS=512
+FRAG_CHUNK_SIZE=4096
+
 ADDR=0x01000008
 LENGTH=0x00100000
@@ -0,0 +1,55 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System:Fragmentation Test
+
+"""
+This test verifies reading and writing files whose clusters are scattered
+over the file system, and reports how long it takes.
+"""
+
+import pytest
+import re
+from fstest_defs import *
+from fstest_helpers import assert_fs_integrity
+
+FRAG_SIZE = FRAG_CHUNKS * FRAG_CHUNK_SIZE
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.slow
+class TestFsFrag(object):
+    def test_fs_frag1(self, u_boot_console, fs_obj_frag):
+        """
+        Test Case 1 - read a fragmented file
+        """
+        fs_type,fs_img,md5val = fs_obj_frag
+        with u_boot_console.log.section('Test Case 1 - read fragmented'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'time %sload host 0:0 %x /%s' % (fs_type, ADDR, FRAG_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert('%d bytes read' % FRAG_SIZE in ''.join(output))
+            assert(md5val[0] in ''.join(output))
+
+    def test_fs_frag2(self, u_boot_console, fs_obj_frag):
+        """
+        Test Case 2 - write a file into fragmented free space
+        """
+        fs_type,fs_img,md5val = fs_obj_frag
+        with u_boot_console.log.section('Test Case 2 - write fragmented'):
+            # Test Case 2a - The file fills the holes left by the other one
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR, FRAG_FILE),
+                'time %swrite host 0:0 %x /%s.w $filesize'
+                    % (fs_type, ADDR, FRAG_FILE)])
+            assert('%d bytes written' % FRAG_SIZE in ''.join(output))
+
+            # Test Case 2b - Check md5 of file content
+            output = u_boot_console.run_command_list([
+                'mw.b %x 00 100' % ADDR,
+                'time %sload host 0:0 %x /%s.w' % (fs_type, ADDR, FRAG_FILE),
+                'md5sum %x $filesize' % ADDR,
+                'setenv filesize'])
+            assert(md5val[0] in ''.join(output))
+            assert_fs_integrity(fs_type, fs_img)
@@ -24,6 +24,7 @@ For configuration verification:
 Tests run with both SHA1 and SHA256 hashing.
 """
 
+import os
 import pytest
 import sys
 import struct
@@ -94,6 +95,29 @@ def test_vboot(u_boot_console):
         util.run_and_log(cons, [mkimage, '-D', dtc_args, '-f',
                                 '%s%s' % (datadir, its), fit])
 
+    def check_jobs(its):
+        """Check that hashing with several threads gives the same FIT
+
+        This runs 'mkimage -f' with one thread and then with four, and checks
+        that the output is the same.
+
+        Args:
+            its: Filename containing .its source.
+        """
+        cons.log.action('Check FIT hashed with several threads')
+        data = []
+        os.environ['SOURCE_DATE_EPOCH'] = '1'
+        try:
+            for jobs in ['1', '4']:
+                out = '%s.j%s' % (fit, jobs)
+                util.run_and_log(cons, [mkimage, '-j', jobs, '-D', dtc_args,
+                                        '-f', '%s%s' % (datadir, its), out])
+                with open(out, 'rb') as handle:
+                    data.append(handle.read())
+        finally:
+            del os.environ['SOURCE_DATE_EPOCH']
+        assert(data[0] == data[1])
+
     def sign_fit(sha_algo):
         """Sign the FIT
 
@@ -173,6 +197,7 @@ def test_vboot(u_boot_console):
         cons.log.action('%s: Test FIT with signed configuration' % sha_algo)
         make_fit('sign-configs-%s%s.its' % (sha_algo , padding))
         run_bootm(sha_algo, 'unsigned config', '%s+ OK' % sha_algo, True)
+        check_jobs('sign-configs-%s%s.its' % (sha_algo , padding))
 
         # Sign images with our dev keys
         sign_fit(sha_algo)
@@ -20,6 +20,7 @@ import time
 import builderthread
 import command
 import gitutil
+import objcache
 import terminal
 from terminal import Print
 import toolchain
@@ -224,7 +225,7 @@ class Builder:
                  no_subdirs=False, full_path=False, verbose_build=False,
                  incremental=False, per_board_out_dir=False,
                  config_only=False, squash_config_y=False,
-                 warnings_as_errors=False):
+                 warnings_as_errors=False, obj_cache=None):
         """Create a new Builder object
 
         Args:
@@ -250,6 +251,8 @@ class Builder:
             config_only: Only configure each build, don't build it
             squash_config_y: Convert CONFIG options with the value 'y' to '1'
             warnings_as_errors: Treat all compiler warnings as errors
+            obj_cache: Directory holding a cache of object files to share
+                between builds, or None to not use one
         """
         self.toolchains = toolchains
         self.base_dir = base_dir
@@ -284,6 +287,7 @@ class Builder:
             self.config_filenames += EXTRA_CONFIG_FILENAMES
 
         self.warnings_as_errors = warnings_as_errors
+        self.obj_cache = obj_cache
         self.col = terminal.Color()
 
         self._re_function = re.compile('(.*): In function.*')
@@ -1467,6 +1471,10 @@ class Builder:
         self.upto = self.warned = self.fail = 0
         self._timestamps = collections.deque()
 
+    def GetObjCacheStatsFile(self):
+        """Get the name of the file holding object cache statistics"""
+        return os.path.join(self.base_dir, '.bm-obj-cache-stats')
+
     def GetThreadDir(self, thread_num):
         """Get the directory path to the working dir for a thread.
 
@@ -1560,6 +1568,10 @@ class Builder:
         self._PrepareWorkingSpace(min(self.num_threads, len(board_selected)),
                 commits is not None)
         self._PrepareOutputSpace()
+        if self.obj_cache:
+            stats_fname = self.GetObjCacheStatsFile()
+            if os.path.exists(stats_fname):
+                os.remove(stats_fname)
         Print('\rStarting build...', newline=False)
         self.SetupBuild(board_selected, commits)
         self.ProcessResult(None)
@@ -1583,4 +1595,8 @@ class Builder:
         self.out_queue.join()
         Print()
         self.ClearLine(0)
+        if self.obj_cache:
+            summary = objcache.GetSummary(self.GetObjCacheStatsFile())
+            if summary:
+                Print(summary)
         return (self.fail, self.warned)
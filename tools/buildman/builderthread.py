@@ -11,6 +11,7 @@ import threading
 
 import command
 import gitutil
+import objcache
 
 RETURN_CODE_RETRY = -1
 
@@ -199,6 +200,9 @@ class BuilderThread(threading.Thread):
 
                 # Set up the environment and command line
                 env = self.toolchain.MakeEnvironment(self.builder.full_path)
+                if self.builder.obj_cache:
+                    objcache.SetupEnv(env, self.builder.obj_cache,
+                                      self.builder.GetObjCacheStatsFile())
                 Mkdir(out_dir)
                 args = []
                 cwd = work_dir
@@ -300,7 +300,8 @@ def DoBuildman(options, args, toolchains=None, make_func=None, boards=None,
             per_board_out_dir=options.per_board_out_dir,
             config_only=options.config_only,
             squash_config_y=not options.preserve_config_y,
-            warnings_as_errors=options.warnings_as_errors)
+            warnings_as_errors=options.warnings_as_errors,
+            obj_cache=options.obj_cache)
     builder.force_config_on_failure = not options.quick
     if make_func:
         builder.do_make = make_func
@@ -0,0 +1,341 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0+
+#
+
+"""Object cache shared between builds
+
+This is a compiler wrapper which keeps a local cache of object files,
+indexed by a hash of the preprocessed source and the flags used to compile
+it. Since the same lib/, common/ and drivers/ files are compiled in the same
+way for many boards, buildman can reuse these objects across boards and
+across commits instead of compiling them again.
+
+Buildman puts this wrapper in front of CROSS_COMPILE, so it is also run for
+the linker and other tools. Anything which is not a simple compile of a
+single .c or .S file to a .o file is passed straight to the real tool.
+
+Objects which include a binary file with .incbin are never cached, since
+the contents of that file are not known from the preprocessed source.
+
+Paths to the source and output directories are replaced with markers
+before hashing, so that builds in different directories can share objects.
+The debug information in a reused object still names the directory where
+it was first built. This does not affect the code or the image sizes.
+
+Each run appends a line to a statistics file, from which buildman reports
+the hit rate and the time saved.
+"""
+
+import hashlib
+import os
+import shutil
+import subprocess
+import sys
+import time
+
+# Environment variables used to pass settings to the wrapper
+ENV_CACHE_DIR = 'BUILDMAN_OBJ_CACHE'
+ENV_STATS_FILE = 'BUILDMAN_OBJ_CACHE_STATS'
+
+# Markers which replace directory names before hashing
+SRC_MARKER = b'@srctree@'
+OBJ_MARKER = b'@objtree@'
+
+# Source files which we know how to cache
+SOURCE_EXTS = ('.c', '.S')
+
+# Options which take the next argument as their value
+OPTS_WITH_ARG = ('-o', '-include', '-imacros', '-I', '-isystem', '-MF',
+                 '-MT', '-MQ', '-D', '-U')
+
+# Assembler directive which includes a binary file in the object
+INCBIN = b'.incbin'
+
+# Options which we cannot handle, so the compiler is run directly
+BAD_OPTS = ('-', '-x', '-M', '-MM', '-MD', '-MMD', '-E', '-S', '-save-temps')
+
+
+def SetupEnv(env, cache_dir, stats_fname):
+    """Set up an environment so that 'make' compiles through the cache
+
+    This puts the wrapper in front of CROSS_COMPILE. If CROSS_COMPILE is not
+    set (e.g. when the toolchain is overridden) nothing is changed.
+
+    Args:
+        env: Environment dict to update
+        cache_dir: Directory holding the cache
+        stats_fname: File to which each compile adds its statistics
+    """
+    if 'CROSS_COMPILE' not in env:
+        return
+    env[ENV_CACHE_DIR] = os.path.abspath(cache_dir)
+    env[ENV_STATS_FILE] = os.path.abspath(stats_fname)
+    env['CROSS_COMPILE'] = '%s %s %s' % (sys.executable,
+            os.path.abspath(__file__), env['CROSS_COMPILE'])
+
+def ParseArgs(args):
+    """Check whether a compiler command line can use the cache
+
+    Args:
+        args: Arguments to the compiler (not including the compiler itself)
+
+    Returns:
+        tuple:
+            Source filename
+            Object filename
+        or None if the command cannot use the cache
+    """
+    if '-c' not in args:
+        return None
+    src = obj = None
+    skip = False
+    for seq, arg in enumerate(args):
+        if skip:
+            skip = False
+        elif arg in BAD_OPTS:
+            return None
+        elif arg in OPTS_WITH_ARG:
+            skip = True
+            if arg == '-o' and seq + 1 < len(args):
+                obj = args[seq + 1]
+        elif not arg.startswith('-'):
+            if src or os.path.splitext(arg)[1] not in SOURCE_EXTS:
+                return None
+            src = arg
+    if not src or not obj or not obj.endswith('.o'):
+        return None
+    return src, obj
+
+def GetDirs():
+    """Get the directories to replace with markers, longest first
+
+    Returns:
+        List of tuples:
+            Directory name as bytes
+            Marker to replace it with
+    """
+    dirs = [(os.getcwd().encode(), OBJ_MARKER)]
+    srctree = os.environ.get('srctree')
+    if srctree and os.path.isabs(srctree):
+        dirs.append((os.path.realpath(srctree).encode(), SRC_MARKER))
+    return sorted(dirs, key=lambda item: len(item[0]), reverse=True)
+
+def Normalise(data, dirs):
+    """Replace directory names with markers
+
+    Args:
+        data: Data to process (bytes)
+        dirs: List of directories and markers, from GetDirs()
+
+    Returns:
+        data with all directory names replaced
+    """
+    for dirname, marker in dirs:
+        data = data.replace(dirname, marker)
+    return data
+
+def Denormalise(data, dirs):
+    """Replace markers with directory names, reversing Normalise()"""
+    for dirname, marker in dirs:
+        data = data.replace(marker, dirname)
+    return data
+
+def GetCompilerId(compiler):
+    """Get something which identifies the compiler being used
+
+    Args:
+        compiler: Name of compiler, which may be on the PATH
+
+    Returns:
+        String containing the full path, size and modification time
+    """
+    fname = shutil.which(compiler) or compiler
+    try:
+        stat = os.stat(fname)
+        return '%s %d %d' % (fname, stat.st_size, stat.st_mtime)
+    except OSError:
+        return fname
+
+def GetKey(cmd, obj, dirs, preproc):
+    """Get the cache key for a compile
+
+    Args:
+        cmd: Compiler command line, including the compiler
+        obj: Object filename, which is not included in the key
+        dirs: List of directories and markers, from GetDirs()
+        preproc: Preprocessed source (bytes)
+
+    Returns:
+        Hex string containing the key
+    """
+    hasher = hashlib.sha256()
+    hasher.update(GetCompilerId(cmd[0]).encode())
+    skip = False
+    for arg in cmd[1:]:
+        # Leave out the object and dependency filenames
+        if skip or arg.startswith('-Wp,-MD,'):
+            skip = False
+            continue
+        if arg == '-o':
+            skip = True
+            continue
+        hasher.update(b'\0' + Normalise(arg.encode(), dirs))
+    hasher.update(b'\0' + Normalise(preproc, dirs))
+    return hasher.hexdigest()
+
+def AddStats(kind, secs):
+    """Add a line to the statistics file
+
+    Args:
+        kind: 'hit' or 'miss'
+        secs: For a hit, the time saved; for a miss, the time spent on
+            preprocessing, i.e. the time lost
+    """
+    fname = os.environ.get(ENV_STATS_FILE)
+    if not fname:
+        return
+    # A short append is atomic, so wrappers can run in parallel
+    fd = os.open(fname, os.O_WRONLY | os.O_APPEND | os.O_CREAT, 0o644)
+    try:
+        os.write(fd, ('%s %.3f\n' % (kind, secs)).encode())
+    finally:
+        os.close(fd)
+
+def WriteFile(fname, data):
+    """Write a file atomically, by writing it elsewhere and renaming it"""
+    tmp = '%s.%d.tmp' % (fname, os.getpid())
+    with open(tmp, 'wb') as fd:
+        fd.write(data)
+    os.rename(tmp, fname)
+
+def ReadFile(fname):
+    with open(fname, 'rb') as fd:
+        return fd.read()
+
+def Compile(cmd, cache_dir):
+    """Compile a file using the cache if possible
+
+    Args:
+        cmd: Compiler command line, including the compiler
+        cache_dir: Directory holding the cache
+
+    Returns:
+        Exit code of the compiler
+    """
+    parsed = ParseArgs(cmd[1:])
+    if not parsed:
+        os.execvp(cmd[0], cmd)
+    src, obj = parsed
+    start = time.time()
+
+    # Preprocess the source. This also writes the dependency file, if
+    # requested, in the same way as the compile would.
+    pp_cmd = []
+    skip = False
+    for arg in cmd:
+        if skip:
+            pp_cmd.append('-')
+            skip = False
+        else:
+            pp_cmd.append('-E' if arg == '-c' else arg)
+            skip = arg == '-o'
+    pp = subprocess.run(pp_cmd, stdout=subprocess.PIPE,
+                        stderr=subprocess.DEVNULL)
+    if pp.returncode:
+        # Let the compiler report the error
+        return subprocess.call(cmd)
+
+    # The contents of files pulled in with .incbin (e.g. the device tree in
+    # dts/dt.dtb.S) are not part of the preprocessed output, so the same
+    # source can produce a different object. Always compile these.
+    if INCBIN in pp.stdout:
+        AddStats('miss', time.time() - start)
+        return subprocess.call(cmd)
+
+    dirs = GetDirs()
+    key = GetKey(cmd, obj, dirs, pp.stdout)
+    base = os.path.join(cache_dir, key[:2], key)
+    if os.path.exists(base + '.o'):
+        try:
+            log = ReadFile(base + '.log')
+            secs = float(ReadFile(base + '.time'))
+            WriteFile(obj, ReadFile(base + '.o'))
+            sys.stderr.buffer.write(Denormalise(log, dirs))
+            AddStats('hit', max(secs - (time.time() - start), 0))
+            return 0
+        except (OSError, ValueError):
+            # Fall back to compiling if the entry is incomplete
+            pass
+
+    pp_secs = time.time() - start
+    start = time.time()
+    result = subprocess.run(cmd, stderr=subprocess.PIPE)
+    secs = time.time() - start
+    sys.stderr.buffer.write(result.stderr)
+    if not result.returncode:
+        try:
+            os.makedirs(os.path.dirname(base), exist_ok=True)
+            WriteFile(base + '.log', Normalise(result.stderr, dirs))
+            WriteFile(base + '.time', b'%.3f' % secs)
+            # The object is written last, since it shows the entry is valid
+            WriteFile(base + '.o', ReadFile(obj))
+        except OSError:
+            pass
+    AddStats('miss', pp_secs)
+    return result.returncode
+
+def ReadStats(fname):
+    """Read the statistics written by the wrapper
+
+    Args:
+        fname: Statistics file
+
+    Returns:
+        tuple:
+            Number of cache hits
+            Number of cache misses
+            Number of seconds saved (compile time avoided on hits, less the
+                time spent preprocessing on misses)
+    """
+    hits = misses = 0
+    saved = 0.0
+    if not os.path.exists(fname):
+        return hits, misses, saved
+    with open(fname) as fd:
+        for line in fd:
+            fields = line.split()
+            if len(fields) != 2:
+                continue
+            if fields[0] == 'hit':
+                hits += 1
+                saved += float(fields[1])
+            elif fields[0] == 'miss':
+                misses += 1
+                saved -= float(fields[1])
+    return hits, misses, saved
+
+def GetSummary(fname):
+    """Get a summary of the cache statistics, for display
+
+    Args:
+        fname: Statistics file
+
+    Returns:
+        String describing the hit rate and time saved, or None if the cache
+        was not used
+    """
+    hits, misses, saved = ReadStats(fname)
+    if not hits and not misses:
+        return None
+    return ('Object cache: %d hits, %d misses (%d%% hit rate), saved %s' %
+            (hits, misses, hits * 100 // (hits + misses),
+             time.strftime('%H:%M:%S', time.gmtime(max(saved, 0)))))
+
+
+if __name__ == '__main__':
+    cache_dir = os.environ.get(ENV_CACHE_DIR)
+    if len(sys.argv) < 2:
+        sys.exit('Usage: %s <compiler> [args...]' % sys.argv[0])
+    if cache_dir:
+        sys.exit(Compile(sys.argv[1:], cache_dir))
+    os.execvp(sys.argv[1], sys.argv[1:])
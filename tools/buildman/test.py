@@ -19,6 +19,7 @@ import builder
 import control
 import command
 import commit
+import objcache
 import terminal
 import test_util
 import toolchain
@@ -451,6 +452,83 @@ class TestBuild(unittest.TestCase):
                     'crosstool/files/bin/x86_64/.*/'
                     'x86_64-gcc-.*-nolibc_arm-.*linux-gnueabi.tar.xz')
 
+    def testObjCacheArgs(self):
+        """Test detecting which compiles can use the object cache"""
+        self.assertEqual(('lib/a.c', 'lib/a.o'), objcache.ParseArgs(
+            ['-Wp,-MD,lib/.a.o.d', '-Iinclude', '-include', 'b.h', '-c',
+             '-o', 'lib/a.o', 'lib/a.c']))
+        self.assertEqual(('a.S', 'a.o'),
+                         objcache.ParseArgs(['-c', '-o', 'a.o', 'a.S']))
+        self.assertIsNone(objcache.ParseArgs(['-o', 'u-boot', 'a.o']))
+        self.assertIsNone(objcache.ParseArgs(['-E', '-c', '-o', 'a.o', 'a.c']))
+        self.assertIsNone(objcache.ParseArgs(['-c', '-o', 'a.s', 'a.c']))
+        self.assertIsNone(objcache.ParseArgs(['-c', '-x', 'c', '/dev/null',
+                                              '-o', 'a.o']))
+        self.assertIsNone(objcache.ParseArgs(['-c', '-o', 'a.o', 'a.c',
+                                              'b.c']))
+
+    def testObjCacheCompile(self):
+        """Test that objects and warnings are shared between directories"""
+        tmpdir = tempfile.mkdtemp()
+        try:
+            env = dict(os.environ)
+            env[objcache.ENV_CACHE_DIR] = os.path.join(tmpdir, 'cache')
+            stats = os.path.join(tmpdir, 'stats')
+            env[objcache.ENV_STATS_FILE] = stats
+            with open(os.path.join(tmpdir, 'a.c'), 'w') as fd:
+                fd.write('#warning "careful"\nint a(void) { return 1; }\n')
+            objs = []
+            for name in ['out1', 'out2']:
+                out = os.path.join(tmpdir, name)
+                os.mkdir(out)
+                result = command.RunPipe([[sys.executable,
+                        objcache.__file__, 'gcc', '-Wp,-MD,.a.o.d', '-c',
+                        '-o', 'a.o', os.path.join(tmpdir, 'a.c')]],
+                        capture=True, capture_stderr=True, cwd=out,
+                        raise_on_error=False, env=env)
+                self.assertEqual(0, result.return_code)
+                self.assertIn('careful', result.stderr)
+                self.assertTrue(os.path.exists(os.path.join(out, '.a.o.d')))
+                with open(os.path.join(out, 'a.o'), 'rb') as fd:
+                    objs.append(fd.read())
+            self.assertEqual(objs[0], objs[1])
+            hits, misses, _ = objcache.ReadStats(stats)
+            self.assertEqual((1, 1), (hits, misses))
+            self.assertIn('50% hit rate', objcache.GetSummary(stats))
+        finally:
+            shutil.rmtree(tmpdir)
+
+    def testObjCacheIncbin(self):
+        """Test that objects including a binary file are not cached"""
+        tmpdir = tempfile.mkdtemp()
+        try:
+            env = dict(os.environ)
+            env[objcache.ENV_CACHE_DIR] = os.path.join(tmpdir, 'cache')
+            stats = os.path.join(tmpdir, 'stats')
+            env[objcache.ENV_STATS_FILE] = stats
+            with open(os.path.join(tmpdir, 'a.S'), 'w') as fd:
+                fd.write('.section .rodata\n.incbin "a.bin"\n')
+            objs = []
+            for name in ['out1', 'out2']:
+                out = os.path.join(tmpdir, name)
+                os.mkdir(out)
+                with open(os.path.join(out, 'a.bin'), 'w') as fd:
+                    fd.write(name)
+                result = command.RunPipe([[sys.executable,
+                        objcache.__file__, 'gcc', '-c', '-o', 'a.o',
+                        os.path.join(tmpdir, 'a.S')]],
+                        capture=True, capture_stderr=True, cwd=out,
+                        raise_on_error=False, env=env)
+                self.assertEqual(0, result.return_code)
+                with open(os.path.join(out, 'a.o'), 'rb') as fd:
+                    objs.append(fd.read())
+            self.assertNotEqual(objs[0], objs[1])
+            hits, misses, _ = objcache.ReadStats(stats)
+            self.assertEqual((0, 2), (hits, misses))
+            self.assertFalse(os.path.exists(os.path.join(tmpdir, 'cache')))
+        finally:
+            shutil.rmtree(tmpdir)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -63,7 +63,8 @@ static int fit_add_file_data(struct image_tool_params *params, size_t size_inc,
 						params->comment,
 						params->require_keys,
 						params->engine_id,
-						params->cmdname);
+						params->cmdname,
+						params->jobs);
 	}
 
 	if (dest_blob) {
@@ -117,11 +118,11 @@ static int fdt_property_file(struct image_tool_params *params,
 			     void *fdt, const char *name, const char *fname)
 {
 	struct stat sbuf;
-	void *ptr;
+	void *ptr, *src;
 	int ret;
 	int fd;
 
-	fd = open(fname, O_RDWR | O_BINARY);
+	fd = open(fname, O_RDONLY | O_BINARY);
 	if (fd < 0) {
 		fprintf(stderr, "%s: Can't open %s: %s\n",
 			params->cmdname, fname, strerror(errno));
@@ -137,11 +138,17 @@ static int fdt_property_file(struct image_tool_params *params,
 	ret = fdt_property_placeholder(fdt, "data", sbuf.st_size, &ptr);
 	if (ret)
 		goto err;
-	ret = read(fd, ptr, sbuf.st_size);
-	if (ret != sbuf.st_size) {
-		fprintf(stderr, "%s: Can't read %s: %s\n",
-			params->cmdname, fname, strerror(errno));
-		goto err;
+
+	/* Map the file rather than reading it, since it may be large */
+	if (sbuf.st_size) {
+		src = mmap(0, sbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (src == MAP_FAILED) {
+			fprintf(stderr, "%s: Can't read %s: %s\n",
+				params->cmdname, fname, strerror(errno));
+			goto err;
+		}
+		memcpy(ptr, src, sbuf.st_size);
+		munmap(src, sbuf.st_size);
 	}
 	close(fd);
 
@@ -11,8 +11,43 @@
 #include "mkimage.h"
 #include <bootm.h>
 #include <image.h>
+#include <pthread.h>
 #include <version.h>
 
+/**
+ * struct fit_hash_job - a hash to calculate ahead of updating the FIT
+ *
+ * @data:	Data to hash (points into the FIT)
+ * @size:	Size of data in bytes
+ * @algo:	Hash algorithm name (points into the FIT)
+ * @value:	Calculated hash value
+ * @value_len:	Length of calculated hash value
+ * @ret:	0 if @value is valid, else the hash must be calculated again
+ */
+struct fit_hash_job {
+	const void *data;
+	size_t size;
+	const char *algo;
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int value_len;
+	int ret;
+};
+
+/**
+ * struct fit_hash_pool - a set of hashes to calculate using several threads
+ *
+ * @jobs:	Hashes to calculate, in the order that the FIT is processed
+ * @count:	Number of hashes in @jobs
+ * @next:	Next hash to calculate, or to use when updating the FIT
+ * @lock:	Protects @next while threads are running
+ */
+struct fit_hash_pool {
+	struct fit_hash_job *jobs;
+	int count;
+	int next;
+	pthread_mutex_t lock;
+};
+
 /**
  * fit_set_hash_value - set hash value in requested has node
  * @fit: pointer to the FIT format image header
@@ -54,10 +89,12 @@ static int fit_set_hash_value(void *fit, int noffset, uint8_t *value,
  * @noffset:	subnode offset
  * @data:	data to process
  * @size:	size of data in bytes
+ * @job:	hash already calculated for this node, or NULL if none
  * @return 0 if ok, -1 on error
  */
 static int fit_image_process_hash(void *fit, const char *image_name,
-		int noffset, const void *data, size_t size)
+		int noffset, const void *data, size_t size,
+		const struct fit_hash_job *job)
 {
 	uint8_t value[FIT_MAX_HASH_LEN];
 	const char *node_name;
@@ -73,7 +110,10 @@ static int fit_image_process_hash(void *fit, const char *image_name,
 		return -ENOENT;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (job && !job->ret) {
+		value_len = job->value_len;
+		memcpy(value, job->value, value_len);
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		printf("Unsupported hash algorithm (%s) for '%s' hash node in '%s' image node\n",
 		       algo, node_name, image_name);
 		return -EPROTONOSUPPORT;
@@ -301,11 +341,13 @@ static int fit_image_process_sig(const char *keydir, void *keydest,
  * @comment:	Comment to add to signature nodes
  * @require_keys: Mark all keys as 'required'
  * @engine_id:	Engine to use for signing
+ * @pool:	Hashes calculated in advance, or NULL to calculate them here
  * @return: 0 on success, <0 on failure
  */
-int fit_image_add_verification_data(const char *keydir, void *keydest,
+static int fit_image_add_verification_data(const char *keydir, void *keydest,
 		void *fit, int image_noffset, const char *comment,
-		int require_keys, const char *engine_id, const char *cmdname)
+		int require_keys, const char *engine_id, const char *cmdname,
+		struct fit_hash_pool *pool)
 {
 	const char *image_name;
 	const void *data;
@@ -335,8 +377,12 @@ int fit_image_add_verification_data(const char *keydir, void *keydest,
 		node_name = fit_get_name(fit, noffset, NULL);
 		if (!strncmp(node_name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
+			const struct fit_hash_job *job = NULL;
+
+			if (pool && pool->next < pool->count)
+				job = &pool->jobs[pool->next++];
 			ret = fit_image_process_hash(fit, image_name, noffset,
-						data, size);
+						data, size, job);
 		} else if (IMAGE_ENABLE_SIGN && keydir &&
 			   !strncmp(node_name, FIT_SIG_NODENAME,
 				strlen(FIT_SIG_NODENAME))) {
@@ -675,13 +721,135 @@ static int fit_config_add_verification_data(const char *keydir, void *keydest,
 	return 0;
 }
 
+/**
+ * fit_hash_pool_add() - Add the hashes of all images to a pool
+ *
+ * This walks the images in the same order as fit_add_verification_data()
+ * so that the hashes can be picked up in turn as each node is updated.
+ * Hashes which cannot be set up here are left for the normal path, which
+ * reports the error.
+ *
+ * @pool:	Pool to add to
+ * @fit:	Pointer to the FIT format image header
+ * @images_noffset: Offset of the images node
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+static int fit_hash_pool_add(struct fit_hash_pool *pool, void *fit,
+			     int images_noffset)
+{
+	int image_noffset, noffset;
+
+	fdt_for_each_subnode(image_noffset, fit, images_noffset) {
+		const void *data;
+		size_t size;
+
+		if (fit_image_get_data(fit, image_noffset, &data, &size))
+			continue;
+		fdt_for_each_subnode(noffset, fit, image_noffset) {
+			const char *node_name = fit_get_name(fit, noffset,
+							     NULL);
+			struct fit_hash_job *job, *jobs;
+			char *algo;
+
+			if (strncmp(node_name, FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)))
+				continue;
+			jobs = realloc(pool->jobs,
+				       (pool->count + 1) * sizeof(*job));
+			if (!jobs)
+				return -ENOMEM;
+			pool->jobs = jobs;
+			job = &jobs[pool->count++];
+			job->data = data;
+			job->size = size;
+			job->ret = -ENOENT;
+			if (fit_image_hash_get_algo(fit, noffset, &algo))
+				algo = NULL;
+			job->algo = algo;
+		}
+	}
+
+	return 0;
+}
+
+static void *fit_hash_worker(void *arg)
+{
+	struct fit_hash_pool *pool = arg;
+	struct fit_hash_job *job;
+
+	while (1) {
+		pthread_mutex_lock(&pool->lock);
+		job = pool->next < pool->count ? &pool->jobs[pool->next++] :
+			NULL;
+		pthread_mutex_unlock(&pool->lock);
+		if (!job)
+			break;
+		if (job->algo && !calculate_hash(job->data, job->size,
+						 job->algo, job->value,
+						 &job->value_len))
+			job->ret = 0;
+	}
+
+	return NULL;
+}
+
+/**
+ * fit_hash_pool_run() - Calculate all the hashes in a pool
+ *
+ * This uses up to @jobs threads, each taking the next hash from the pool
+ * until there are none left. If threads cannot be created, the remaining
+ * hashes are calculated by the calling thread.
+ *
+ * @pool:	Pool to process
+ * @jobs:	Maximum number of threads to use
+ */
+static void fit_hash_pool_run(struct fit_hash_pool *pool, int jobs)
+{
+	pthread_t *threads;
+	int i, started = 0;
+
+	/*
+	 * A hash algorithm may set up its tables the first time it is used,
+	 * which is not safe to do from several threads at once. Hash nothing
+	 * with each job's algorithm first, so that this is done here.
+	 */
+	for (i = 0; i < pool->count; i++) {
+		struct fit_hash_job *job = &pool->jobs[i];
+
+		if (job->algo)
+			calculate_hash(job->data, 0, job->algo, job->value,
+				       &job->value_len);
+	}
+
+	if (jobs > pool->count)
+		jobs = pool->count;
+	threads = calloc(jobs, sizeof(*threads));
+	pthread_mutex_init(&pool->lock, NULL);
+	pool->next = 0;
+	for (i = 0; threads && i < jobs; i++) {
+		if (pthread_create(&threads[i], NULL, fit_hash_worker, pool))
+			break;
+		started++;
+	}
+	fit_hash_worker(pool);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&pool->lock);
+	free(threads);
+
+	/* Rewind so that the FIT can be updated in the same order */
+	pool->next = 0;
+}
+
 int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 			      const char *comment, int require_keys,
-			      const char *engine_id, const char *cmdname)
+			      const char *engine_id, const char *cmdname,
+			      int jobs)
 {
+	struct fit_hash_pool pool = { 0 };
 	int images_noffset, confs_noffset;
 	int noffset;
-	int ret;
+	int ret = 0;
 
 	/* Find images parent node offset */
 	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
@@ -691,6 +859,20 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 		return images_noffset;
 	}
 
+	/*
+	 * Calculate the image hashes in parallel before updating the FIT.
+	 * The FIT is then updated in the same order as before, so the
+	 * output does not depend on the number of jobs.
+	 */
+	if (jobs > 1) {
+		ret = fit_hash_pool_add(&pool, fit, images_noffset);
+		if (ret) {
+			free(pool.jobs);
+			return ret;
+		}
+		fit_hash_pool_run(&pool, jobs);
+	}
+
 	/* Process its subnodes, print out component images details */
 	for (noffset = fdt_first_subnode(fit, images_noffset);
 	     noffset >= 0;
@@ -701,10 +883,13 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 		 */
 		ret = fit_image_add_verification_data(keydir, keydest,
 				fit, noffset, comment, require_keys, engine_id,
-				cmdname);
+				cmdname, jobs > 1 ? &pool : NULL);
 		if (ret)
-			return ret;
+			break;
 	}
+	free(pool.jobs);
+	if (ret)
+		return ret;
 
 	/* If there are no keys, we can't sign configurations */
 	if (!IMAGE_ENABLE_SIGN || !keydir)